@@ -11,9 +11,30 @@
 #define ABCG_HPP_
 
 #include "abcg_application.hpp"
+#include "abcg_compressedimage.hpp"
 #include "abcg_elapsedtimer.hpp"
+#include "abcg_gputimer.hpp"
+#include "abcg_hash.hpp"
 #include "abcg_image.hpp"
+#include "abcg_mappedfile.hpp"
+#include "abcg_meshcache.hpp"
+#include "abcg_meshlets.hpp"
+#include "abcg_meshoptimizer.hpp"
+#include "abcg_meshregistry.hpp"
+#include "abcg_meshsimplifier.hpp"
+#include "abcg_mipstreamer.hpp"
+#include "abcg_objparser.hpp"
+#include "abcg_programcache.hpp"
+#include "abcg_shaderpreprocessor.hpp"
+#include "abcg_shaderprogram.hpp"
+#include "abcg_shadervariants.hpp"
 #include "abcg_string.hpp"
+#include "abcg_tangentspace.hpp"
+#include "abcg_textureatlas.hpp"
+#include "abcg_texturecache.hpp"
+#include "abcg_threadpool.hpp"
 #include "abcg_trackball.hpp"
+#include "abcg_uniformbuffer.hpp"
+#include "abcg_vertexwelder.hpp"
 
 #endif
\ No newline at end of file
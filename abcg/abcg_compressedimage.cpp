@@ -0,0 +1,680 @@
+/**
+ * @file abcg_compressedimage.cpp
+ * @brief Definition of block-compressed texture helper functions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_compressedimage.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glm/geometric.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <limits>
+#include <system_error>
+
+#include "abcg_exception.hpp"
+#include "abcg_mappedfile.hpp"
+#include "abcg_threadpool.hpp"
+
+namespace {
+using abcg::opengl::CompressedFormat;
+using Pixel = std::array<std::uint8_t, 4>;
+using Block = std::array<Pixel, 16>;
+
+// Compressed formats of OpenGL, from EXT_texture_compression_s3tc and
+// ARB_texture_compression_rgtc (core since OpenGL 3.0)
+constexpr GLenum compressedRGBDXT1{0x83F0};
+constexpr GLenum compressedRGBADXT5{0x83F3};
+constexpr GLenum compressedRGRGTC2{0x8DBD};
+
+constexpr std::uint32_t makeFourCC(char a, char b, char c, char d) noexcept {
+  return static_cast<std::uint32_t>(static_cast<unsigned char>(a)) |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(b)) << 8 |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(c)) << 16 |
+         static_cast<std::uint32_t>(static_cast<unsigned char>(d)) << 24;
+}
+
+// DDS file layout, after the "DDS " magic number
+struct DDSPixelFormat {
+  std::uint32_t size{sizeof(DDSPixelFormat)};
+  std::uint32_t flags{};
+  std::uint32_t fourCC{};
+  std::uint32_t rgbBitCount{};
+  std::array<std::uint32_t, 4> masks{};
+};
+
+struct DDSHeader {
+  std::uint32_t size{};
+  std::uint32_t flags{};
+  std::uint32_t height{};
+  std::uint32_t width{};
+  std::uint32_t pitchOrLinearSize{};
+  std::uint32_t depth{};
+  std::uint32_t mipMapCount{};
+  std::array<std::uint32_t, 11> reserved1{};
+  DDSPixelFormat pixelFormat;
+  std::uint32_t caps{};
+  std::uint32_t caps2{};
+  std::uint32_t caps3{};
+  std::uint32_t caps4{};
+  std::uint32_t reserved2{};
+};
+static_assert(sizeof(DDSHeader) == 124);
+
+constexpr std::uint32_t ddsMagic{makeFourCC('D', 'D', 'S', ' ')};
+constexpr std::uint32_t ddsdCaps{0x1};
+constexpr std::uint32_t ddsdHeight{0x2};
+constexpr std::uint32_t ddsdWidth{0x4};
+constexpr std::uint32_t ddsdPixelFormat{0x1000};
+constexpr std::uint32_t ddsdMipMapCount{0x20000};
+constexpr std::uint32_t ddsdLinearSize{0x80000};
+constexpr std::uint32_t ddpfFourCC{0x4};
+constexpr std::uint32_t ddscapsComplex{0x8};
+constexpr std::uint32_t ddscapsTexture{0x1000};
+constexpr std::uint32_t ddscapsMipMap{0x400000};
+
+std::uint32_t getFourCC(CompressedFormat format) {
+  switch (format) {
+    case CompressedFormat::BC1:
+      return makeFourCC('D', 'X', 'T', '1');
+    case CompressedFormat::BC3:
+      return makeFourCC('D', 'X', 'T', '5');
+    case CompressedFormat::BC5:
+      return makeFourCC('A', 'T', 'I', '2');
+  }
+  return 0;
+}
+
+int getLevelSize(int size, int level) { return std::max(size >> level, 1); }
+
+std::size_t getLevelBytes(int width, int height, CompressedFormat format) {
+  const std::size_t blockBytes{format == CompressedFormat::BC1 ? 8U : 16U};
+  return static_cast<std::size_t>((width + 3) / 4) *
+         static_cast<std::size_t>((height + 3) / 4) * blockBytes;
+}
+
+// Pixels of a mipmap level before compression. Colors are linear; normals
+// are unit vectors.
+struct FloatLevel {
+  int width{};
+  int height{};
+  std::vector<glm::vec4> pixels;
+};
+
+float srgbToLinear(float value) {
+  return value <= 0.04045f ? value / 12.92f
+                           : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float value) {
+  return value <= 0.0031308f
+             ? value * 12.92f
+             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+std::uint8_t toByte(float value) {
+  return static_cast<std::uint8_t>(
+      std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+FloatLevel toFloatLevel(const abcg::opengl::Image &image, bool isNormalMap) {
+  std::array<float, 256> linear{};
+  for (auto value : iter::range(linear.size())) {
+    linear.at(value) = srgbToLinear(static_cast<float>(value) / 255.0f);
+  }
+
+  const std::size_t channels{image.format == GL_RGBA ? 4U : 3U};
+  FloatLevel level{image.width, image.height, {}};
+  level.pixels.resize(image.pixels.size() / channels);
+  for (auto &&[index, pixel] : iter::enumerate(level.pixels)) {
+    const auto *source{&image.pixels.at(index * channels)};
+    std::array<std::uint8_t, 4> bytes{0, 0, 0, 255};
+    for (auto channel : iter::range(channels)) {
+      bytes.at(channel) = std::to_integer<std::uint8_t>(source[channel]);
+    }
+    if (isNormalMap) {
+      const glm::vec3 normal{bytes[0], bytes[1], bytes[2]};
+      const auto length{glm::length(normal / 127.5f - 1.0f)};
+      pixel = glm::vec4{length > 0.0f ? (normal / 127.5f - 1.0f) / length
+                                      : glm::vec3{0, 0, 1},
+                        1.0f};
+    } else {
+      pixel = {linear.at(bytes[0]), linear.at(bytes[1]), linear.at(bytes[2]),
+               static_cast<float>(bytes[3]) / 255.0f};
+    }
+  }
+  return level;
+}
+
+// Averages 2x2 blocks of a level. The last row and column of odd sizes are
+// clamped.
+FloatLevel downsample(const FloatLevel &level, bool isNormalMap) {
+  FloatLevel next{std::max(level.width / 2, 1), std::max(level.height / 2, 1),
+                  {}};
+  next.pixels.resize(static_cast<std::size_t>(next.width) *
+                     static_cast<std::size_t>(next.height));
+  const auto getPixel{[&](int x, int y) {
+    return level.pixels.at(
+        static_cast<std::size_t>(std::min(y, level.height - 1)) *
+            static_cast<std::size_t>(level.width) +
+        static_cast<std::size_t>(std::min(x, level.width - 1)));
+  }};
+
+  for (auto y : iter::range(next.height)) {
+    for (auto x : iter::range(next.width)) {
+      auto sum{getPixel(x * 2, y * 2) + getPixel(x * 2 + 1, y * 2) +
+               getPixel(x * 2, y * 2 + 1) + getPixel(x * 2 + 1, y * 2 + 1)};
+      if (isNormalMap) {
+        const auto length{glm::length(glm::vec3{sum})};
+        sum = glm::vec4{length > 0.0f ? glm::vec3{sum} / length
+                                      : glm::vec3{0, 0, 1},
+                        1.0f};
+      } else {
+        sum *= 0.25f;
+      }
+      next.pixels.at(static_cast<std::size_t>(y) *
+                         static_cast<std::size_t>(next.width) +
+                     static_cast<std::size_t>(x)) = sum;
+    }
+  }
+  return next;
+}
+
+// Converts a level back to 8-bit sRGB colors, or to normals mapped to [0,
+// 1]
+std::vector<Pixel> toBytes(const FloatLevel &level, bool isNormalMap) {
+  std::vector<Pixel> pixels(level.pixels.size());
+  for (auto &&[pixel, value] : iter::zip(pixels, level.pixels)) {
+    if (isNormalMap) {
+      const auto normal{glm::vec3{value} * 0.5f + 0.5f};
+      pixel = {toByte(normal.x), toByte(normal.y), toByte(normal.z), 255};
+    } else {
+      pixel = {toByte(linearToSrgb(value.r)), toByte(linearToSrgb(value.g)),
+               toByte(linearToSrgb(value.b)), toByte(value.a)};
+    }
+  }
+  return pixels;
+}
+
+void writeLE(std::byte *target, std::uint64_t value, std::size_t numBytes) {
+  for (auto index : iter::range(numBytes)) {
+    target[index] = static_cast<std::byte>((value >> (index * 8)) & 0xFF);
+  }
+}
+
+std::uint16_t packRGB565(const glm::vec3 &color) {
+  const auto r{std::lround(std::clamp(color.r, 0.0f, 255.0f) * 31.0f / 255)};
+  const auto g{std::lround(std::clamp(color.g, 0.0f, 255.0f) * 63.0f / 255)};
+  const auto b{std::lround(std::clamp(color.b, 0.0f, 255.0f) * 31.0f / 255)};
+  return static_cast<std::uint16_t>(r << 11 | g << 5 | b);
+}
+
+glm::vec3 unpackRGB565(std::uint16_t color) {
+  const auto r{(color >> 11) & 0x1F};
+  const auto g{(color >> 5) & 0x3F};
+  const auto b{color & 0x1F};
+  return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+// Encodes the colors of a block in the 8-byte BC1 layout, in four-color
+// mode. The endpoints are the extremes of the colors along their principal
+// axis.
+void encodeColorBlock(const Block &block, std::byte *target) {
+  std::array<glm::vec3, 16> colors{};
+  glm::vec3 mean{};
+  for (auto &&[color, pixel] : iter::zip(colors, block)) {
+    color = {pixel[0], pixel[1], pixel[2]};
+    mean += color / 16.0f;
+  }
+
+  glm::mat3 covariance{0.0f};
+  for (const auto &color : colors) {
+    const auto offset{color - mean};
+    covariance += glm::mat3{offset * offset.x, offset * offset.y,
+                            offset * offset.z};
+  }
+  // Power iteration
+  glm::vec3 axis{1.0f, 1.0f, 1.0f};
+  for ([[maybe_unused]] auto iteration : iter::range(8)) {
+    const auto next{covariance * axis};
+    const auto length{glm::length(next)};
+    if (length < 1.0e-6f) break;
+    axis = next / length;
+  }
+  axis = glm::normalize(axis);
+
+  auto minProjection{std::numeric_limits<float>::max()};
+  auto maxProjection{std::numeric_limits<float>::lowest()};
+  for (const auto &color : colors) {
+    const auto projection{glm::dot(color - mean, axis)};
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  auto color0{packRGB565(mean + axis * maxProjection)};
+  auto color1{packRGB565(mean + axis * minProjection)};
+  if (color0 < color1) std::swap(color0, color1);
+
+  std::uint32_t indices{};
+  if (color0 != color1) {
+    const auto endpoint0{unpackRGB565(color0)};
+    const auto endpoint1{unpackRGB565(color1)};
+    const std::array palette{endpoint0, endpoint1,
+                             (endpoint0 * 2.0f + endpoint1) / 3.0f,
+                             (endpoint0 + endpoint1 * 2.0f) / 3.0f};
+    for (auto &&[position, color] : iter::enumerate(colors)) {
+      std::uint32_t best{};
+      auto bestDistance{std::numeric_limits<float>::max()};
+      for (auto &&[index, entry] : iter::enumerate(palette)) {
+        const auto offset{color - entry};
+        const auto distance{glm::dot(offset, offset)};
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = static_cast<std::uint32_t>(index);
+        }
+      }
+      indices |= best << (position * 2);
+    }
+  }
+
+  writeLE(target, color0, 2);
+  writeLE(target + 2, color1, 2);
+  writeLE(target + 4, indices, 4);
+}
+
+// Encodes one channel of a block in the 8-byte BC4 layout (alpha of BC3,
+// channels of BC5), in eight-value mode
+void encodeChannelBlock(const Block &block, std::size_t channel,
+                        std::byte *target) {
+  int minValue{255};
+  int maxValue{0};
+  for (const auto &pixel : block) {
+    minValue = std::min<int>(minValue, pixel.at(channel));
+    maxValue = std::max<int>(maxValue, pixel.at(channel));
+  }
+
+  std::uint64_t indices{};
+  if (minValue != maxValue) {
+    std::array<int, 8> palette{maxValue, minValue};
+    for (auto index : iter::range(2, 8)) {
+      palette.at(static_cast<std::size_t>(index)) =
+          ((8 - index) * maxValue + (index - 1) * minValue + 3) / 7;
+    }
+    for (auto &&[position, pixel] : iter::enumerate(block)) {
+      std::uint64_t best{};
+      auto bestDistance{std::numeric_limits<int>::max()};
+      for (auto &&[index, entry] : iter::enumerate(palette)) {
+        const auto distance{std::abs(entry - pixel.at(channel))};
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = index;
+        }
+      }
+      indices |= best << (position * 3);
+    }
+  }
+
+  target[0] = static_cast<std::byte>(maxValue);
+  target[1] = static_cast<std::byte>(minValue);
+  writeLE(target + 2, indices, 6);
+}
+
+std::vector<std::byte> encodeLevel(const std::vector<Pixel> &pixels,
+                                   int width, int height,
+                                   CompressedFormat format) {
+  const auto blocksX{(width + 3) / 4};
+  const auto blocksY{(height + 3) / 4};
+  const std::size_t blockBytes{format == CompressedFormat::BC1 ? 8U : 16U};
+  std::vector<std::byte> blocks(getLevelBytes(width, height, format));
+
+  abcg::ThreadPool::getInstance().parallelFor(
+      static_cast<std::size_t>(blocksY),
+      [&](std::size_t begin, std::size_t end) {
+        for (auto blockY : iter::range(begin, end)) {
+          for (auto blockX : iter::range(static_cast<std::size_t>(blocksX))) {
+            // Pixels outside the level repeat the last row and column
+            Block block{};
+            for (auto &&[position, pixel] : iter::enumerate(block)) {
+              const auto x{std::min(blockX * 4 + position % 4,
+                                    static_cast<std::size_t>(width - 1))};
+              const auto y{std::min(blockY * 4 + position / 4,
+                                    static_cast<std::size_t>(height - 1))};
+              pixel = pixels.at(y * static_cast<std::size_t>(width) + x);
+            }
+
+            auto *target{&blocks.at(
+                (blockY * static_cast<std::size_t>(blocksX) + blockX) *
+                blockBytes)};
+            switch (format) {
+              case CompressedFormat::BC1:
+                encodeColorBlock(block, target);
+                break;
+              case CompressedFormat::BC3:
+                encodeChannelBlock(block, 3, target);
+                encodeColorBlock(block, target + 8);
+                break;
+              case CompressedFormat::BC5:
+                encodeChannelBlock(block, 0, target);
+                encodeChannelBlock(block, 1, target + 8);
+                break;
+            }
+          }
+        }
+      });
+  return blocks;
+}
+
+bool hasExtension(std::string_view name) {
+  GLint numExtensions{};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+  for (auto index : iter::range(numExtensions)) {
+    const auto *extension{reinterpret_cast<const char *>(  // NOLINT
+        glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(index)))};
+    if (extension != nullptr && name == extension) return true;
+  }
+  return false;
+}
+}  // namespace
+
+/**
+ * @brief Compresses an image and its mipmap chain.
+ *
+ * The mipmap levels are prefiltered by averaging 2x2 blocks of the previous
+ * level. Color maps are assumed to be sRGB encoded and are averaged in
+ * linear space, so that mipmaps keep the brightness of the full-size level.
+ * Normal maps (abcg::opengl::CompressedFormat::BC5) are averaged as unit
+ * vectors and renormalized, and only their X and Y components are kept.
+ *
+ * Blocks are encoded on the workers of abcg::ThreadPool. No OpenGL function
+ * is called.
+ *
+ * @param image Decoded image.
+ * @param format Compression format.
+ * @return Compressed image with every level down to 1x1.
+ *
+ * @throw abcg::Exception if the image is empty.
+ */
+abcg::opengl::CompressedImage abcg::opengl::compressImage(
+    const Image &image, CompressedFormat format) {
+  if (image.width <= 0 || image.height <= 0) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Cannot compress an empty image")};
+  }
+
+  const auto isNormalMap{format == CompressedFormat::BC5};
+  CompressedImage compressed{image.width, image.height, format, {}};
+  auto level{toFloatLevel(image, isNormalMap)};
+  while (true) {
+    compressed.levels.push_back(encodeLevel(toBytes(level, isNormalMap),
+                                            level.width, level.height,
+                                            format));
+    if (level.width == 1 && level.height == 1) break;
+    level = downsample(level, isNormalMap);
+  }
+  return compressed;
+}
+
+/**
+ * @brief Returns the path of the baked version of a texture file, which has
+ * the ".dds" extension.
+ */
+std::string abcg::opengl::getBakedPath(std::string_view path) {
+  return std::filesystem::path{path}.replace_extension(".dds").string();
+}
+
+/**
+ * @brief Looks for the baked version of a texture file.
+ *
+ * @param path Path to the source image file.
+ * @return Path to the baked file, or an empty string if there is none or if
+ * it is older than the source file.
+ */
+std::string abcg::opengl::findBakedTexture(std::string_view path) {
+  auto bakedPath{getBakedPath(path)};
+  std::error_code error;
+  const auto bakedTime{std::filesystem::last_write_time(bakedPath, error)};
+  if (error) return {};
+  const auto sourceTime{std::filesystem::last_write_time(path, error)};
+  if (!error && sourceTime > bakedTime) return {};
+  return bakedPath;
+}
+
+/**
+ * @brief Writes a compressed image to a DDS file.
+ *
+ * Rows are written bottom to top, as stored in the image, so other DDS
+ * viewers show the image upside down.
+ *
+ * @param path Path to the DDS file.
+ * @param image Compressed image.
+ *
+ * @throw abcg::Exception if the file cannot be written.
+ */
+void abcg::opengl::saveDDS(std::string_view path,
+                           const CompressedImage &image) {
+  DDSHeader header;
+  header.size = sizeof(DDSHeader);
+  header.flags = ddsdCaps | ddsdHeight | ddsdWidth | ddsdPixelFormat |
+                 ddsdMipMapCount | ddsdLinearSize;
+  header.height = static_cast<std::uint32_t>(image.height);
+  header.width = static_cast<std::uint32_t>(image.width);
+  header.pitchOrLinearSize = static_cast<std::uint32_t>(
+      getLevelBytes(image.width, image.height, image.format));
+  header.mipMapCount = static_cast<std::uint32_t>(image.levels.size());
+  header.pixelFormat.flags = ddpfFourCC;
+  header.pixelFormat.fourCC = getFourCC(image.format);
+  header.caps = ddscapsTexture;
+  if (image.levels.size() > 1) header.caps |= ddscapsComplex | ddscapsMipMap;
+
+  // Write to a temporary file first so that a concurrent reader never maps a
+  // partially written file
+  const std::string temporaryPath{std::string{path} + ".tmp"};
+  {
+    std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+    output.write(reinterpret_cast<const char *>(&ddsMagic),  // NOLINT
+                 sizeof(ddsMagic));
+    output.write(reinterpret_cast<const char *>(&header),  // NOLINT
+                 sizeof(header));
+    for (const auto &level : image.levels) {
+      output.write(reinterpret_cast<const char *>(level.data()),  // NOLINT
+                   static_cast<std::streamsize>(level.size()));
+    }
+    if (!output) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Failed to write texture file {}", temporaryPath))};
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, std::filesystem::path{path}, error);
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to write texture file {}", path))};
+  }
+}
+
+/**
+ * @brief Reads a DDS file with BC1 (DXT1), BC3 (DXT5) or BC5 (ATI2, BC5U)
+ * blocks.
+ *
+ * No OpenGL function is called.
+ *
+ * @param path Path to the DDS file.
+ * @return Compressed image.
+ *
+ * @throw abcg::Exception if the file cannot be opened, is truncated or uses
+ * another format.
+ */
+abcg::opengl::CompressedImage abcg::opengl::loadDDS(std::string_view path) {
+  const abcg::MappedFile file{path};
+  if (!file.isOpen()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to open texture file {}", path))};
+  }
+  const auto bytes{file.getBytes()};
+  const auto invalid{[path] {
+    return abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid or unsupported DDS file {}", path))};
+  }};
+
+  std::uint32_t magic{};
+  DDSHeader header;
+  if (bytes.size() < sizeof(magic) + sizeof(header)) throw invalid();
+  std::memcpy(&magic, bytes.data(), sizeof(magic));
+  std::memcpy(&header, bytes.data() + sizeof(magic), sizeof(header));
+  if (magic != ddsMagic || header.size != sizeof(DDSHeader) ||
+      (header.pixelFormat.flags & ddpfFourCC) == 0 || header.width == 0 ||
+      header.height == 0 ||
+      header.width > static_cast<std::uint32_t>(1 << 16) ||
+      header.height > static_cast<std::uint32_t>(1 << 16)) {
+    throw invalid();
+  }
+
+  CompressedImage image;
+  image.width = static_cast<int>(header.width);
+  image.height = static_cast<int>(header.height);
+  const auto fourCC{header.pixelFormat.fourCC};
+  if (fourCC == getFourCC(CompressedFormat::BC1)) {
+    image.format = CompressedFormat::BC1;
+  } else if (fourCC == getFourCC(CompressedFormat::BC3)) {
+    image.format = CompressedFormat::BC3;
+  } else if (fourCC == getFourCC(CompressedFormat::BC5) ||
+             fourCC == makeFourCC('B', 'C', '5', 'U')) {
+    image.format = CompressedFormat::BC5;
+  } else {
+    throw invalid();
+  }
+
+  const auto maxLevels{static_cast<int>(
+      std::bit_width(header.width | header.height))};
+  const auto numLevels{(header.flags & ddsdMipMapCount) != 0
+                           ? std::clamp(static_cast<int>(header.mipMapCount),
+                                        1, maxLevels)
+                           : 1};
+  auto offset{sizeof(magic) + sizeof(header)};
+  for (auto level : iter::range(numLevels)) {
+    const auto size{getLevelBytes(getLevelSize(image.width, level),
+                                  getLevelSize(image.height, level),
+                                  image.format)};
+    if (bytes.size() - offset < size) throw invalid();
+    const auto data{bytes.subspan(offset, size)};
+    image.levels.emplace_back(data.begin(), data.end());
+    offset += size;
+  }
+  return image;
+}
+
+/**
+ * @brief Returns whether the current OpenGL context can sample textures of a
+ * compressed format.
+ */
+bool abcg::opengl::isCompressedFormatSupported(CompressedFormat format) {
+  if (format == CompressedFormat::BC5) {
+#if defined(__EMSCRIPTEN__)
+    return hasExtension("GL_EXT_texture_compression_rgtc");
+#else
+    return true;
+#endif
+  }
+  return hasExtension("GL_EXT_texture_compression_s3tc") ||
+         hasExtension("GL_WEBGL_compressed_texture_s3tc");
+}
+
+/**
+ * @brief Returns the OpenGL internal format of a block compression format.
+ */
+GLenum abcg::opengl::getCompressedInternalFormat(CompressedFormat format) {
+  switch (format) {
+    case CompressedFormat::BC1:
+      return compressedRGBDXT1;
+    case CompressedFormat::BC3:
+      return compressedRGBADXT5;
+    case CompressedFormat::BC5:
+      return compressedRGRGTC2;
+  }
+  return 0;
+}
+
+/**
+ * @brief Creates a texture from a compressed image.
+ *
+ * The levels are uploaded as they are, without conversion or mipmap
+ * generation.
+ *
+ * @param image Compressed image, in a format supported by the context.
+ * @return Texture ID.
+ *
+ * @throw abcg::Exception if the image has no levels.
+ */
+GLuint abcg::opengl::createCompressedTexture(const CompressedImage &image) {
+  if (image.levels.empty()) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Compressed image has no levels")};
+  }
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  const auto internalFormat{getCompressedInternalFormat(image.format)};
+  for (auto &&[level, data] : iter::enumerate(image.levels)) {
+    const auto index{static_cast<int>(level)};
+    glCompressedTexImage2D(GL_TEXTURE_2D, index, internalFormat,
+                           getLevelSize(image.width, index),
+                           getLevelSize(image.height, index), 0,
+                           static_cast<GLsizei>(data.size()), data.data());
+  }
+
+  // Set texture filtering
+  const auto numLevels{static_cast<GLint>(image.levels.size())};
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return textureID;
+}
+
+/**
+ * @brief Loads the baked version of a texture file if there is one, or the
+ * file itself otherwise.
+ *
+ * The baked file is used if it is not older than the source file and if the
+ * context supports its format. Its mipmap levels are uploaded as they are.
+ *
+ * @param path Path to the source image file.
+ * @param generateMipmaps Whether to generate the mipmap levels when the
+ * source file is loaded.
+ * @return Texture ID.
+ *
+ * @throw abcg::Exception if the file cannot be opened or decoded.
+ */
+GLuint abcg::opengl::loadBakedTexture(std::string_view path,
+                                      bool generateMipmaps) {
+  if (const auto bakedPath{findBakedTexture(path)}; !bakedPath.empty()) {
+    const auto image{loadDDS(bakedPath)};
+    if (isCompressedFormatSupported(image.format)) {
+      return createCompressedTexture(image);
+    }
+  }
+  return loadTexture(path, generateMipmaps);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file abcg_compressedimage.hpp
+ * @brief Declaration of block-compressed texture helper functions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_COMPRESSEDIMAGE_HPP_
+#define ABCG_COMPRESSEDIMAGE_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg_image.hpp"
+
+namespace abcg::opengl {
+/**
+ * @brief Block compression formats of baked textures.
+ */
+enum class CompressedFormat {
+  /** @brief RGB, 8 bytes per 4x4 block. For opaque color maps. */
+  BC1,
+  /** @brief RGBA, 16 bytes per 4x4 block. For color maps with alpha. */
+  BC3,
+  /** @brief Two channels, 16 bytes per 4x4 block. For normal maps, which
+   * store X and Y only. */
+  BC5
+};
+
+/**
+ * @brief Block-compressed image with its whole mipmap chain, ready to be
+ * uploaded.
+ *
+ * As with abcg::opengl::Image, rows are stored bottom to top, so each level
+ * is uploaded as is.
+ */
+struct CompressedImage {
+  int width{};
+  int height{};
+  CompressedFormat format{};
+  /** @brief Blocks of each level, from the full-size level to 1x1. */
+  std::vector<std::vector<std::byte>> levels;
+};
+
+[[nodiscard]] CompressedImage compressImage(const Image &image,
+                                            CompressedFormat format);
+
+[[nodiscard]] std::string getBakedPath(std::string_view path);
+[[nodiscard]] std::string findBakedTexture(std::string_view path);
+void saveDDS(std::string_view path, const CompressedImage &image);
+[[nodiscard]] CompressedImage loadDDS(std::string_view path);
+
+[[nodiscard]] bool isCompressedFormatSupported(CompressedFormat format);
+[[nodiscard]] GLenum getCompressedInternalFormat(CompressedFormat format);
+[[nodiscard]] GLuint createCompressedTexture(const CompressedImage &image);
+[[nodiscard]] GLuint loadBakedTexture(std::string_view path,
+                                      bool generateMipmaps = true);
+}  // namespace abcg::opengl
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * @file abcg_gputimer.cpp
+ * @brief Definition of abcg::GPUTimer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_gputimer.hpp"
+
+/**
+ * @brief Creates the queries.
+ */
+void abcg::GPUTimer::create() {
+  destroy();
+#if !defined(__EMSCRIPTEN__)
+  for (auto &query : m_queries) {
+    glGenQueries(1, &query.id);
+  }
+#endif
+}
+
+/**
+ * @brief Deletes the queries. Pending results are discarded.
+ */
+void abcg::GPUTimer::destroy() {
+#if !defined(__EMSCRIPTEN__)
+  if (m_isActive) glEndQuery(GL_TIME_ELAPSED);
+  for (auto &query : m_queries) {
+    if (query.id != 0) glDeleteQueries(1, &query.id);
+  }
+#endif
+  m_queries = {};
+  m_next = 0;
+  m_oldest = 0;
+  m_isActive = false;
+}
+
+/**
+ * @brief Whether the GPU time can be measured.
+ *
+ * @return True if the timer was created and timer queries are available.
+ */
+bool abcg::GPUTimer::isSupported() const noexcept {
+#if !defined(__EMSCRIPTEN__)
+  return m_queries.front().id != 0;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief Starts measuring the commands issued from now on.
+ *
+ * Timers cannot be nested: only one timer of the context may be measuring
+ * at a time.
+ *
+ * @param tag Value returned with the result of this measurement.
+ */
+void abcg::GPUTimer::begin(int tag) {
+  if (!isSupported() || m_isActive) return;
+
+  // Skip this measurement if the results are read less often than measured
+  auto &query{m_queries.at(m_next)};
+  if (query.isPending) return;
+
+#if !defined(__EMSCRIPTEN__)
+  glBeginQuery(GL_TIME_ELAPSED, query.id);
+#endif
+  query.tag = tag;
+  m_isActive = true;
+}
+
+/**
+ * @brief Stops measuring.
+ */
+void abcg::GPUTimer::end() {
+  if (!m_isActive) return;
+
+#if !defined(__EMSCRIPTEN__)
+  glEndQuery(GL_TIME_ELAPSED);
+#endif
+  m_queries.at(m_next).isPending = true;
+  m_next = (m_next + 1) % numQueries;
+  m_isActive = false;
+}
+
+/**
+ * @brief Returns the result of the oldest measurement, if the GPU has
+ * finished it.
+ *
+ * Results are returned in the order they were measured, one per call.
+ *
+ * @return Result, or std::nullopt if no result is available yet.
+ */
+std::optional<abcg::GPUTimer::Result> abcg::GPUTimer::poll() {
+  auto &query{m_queries.at(m_oldest)};
+  if (!query.isPending) return std::nullopt;
+
+#if !defined(__EMSCRIPTEN__)
+  GLuint available{};
+  glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available == 0) return std::nullopt;
+
+  GLuint64 nanoseconds{};
+  glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds);
+  query.isPending = false;
+  m_oldest = (m_oldest + 1) % numQueries;
+  return Result{.tag = query.tag,
+                .milliseconds = static_cast<double>(nanoseconds) * 1.0e-6};
+#else
+  return std::nullopt;
+#endif
+}
@@ -0,0 +1,75 @@
+/**
+ * @file abcg_gputimer.hpp
+ * @brief abcg::GPUTimer header file.
+ *
+ * Declaration of abcg::GPUTimer class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GPUTIMER_HPP_
+#define ABCG_GPUTIMER_HPP_
+
+#include <abcg_external.hpp>
+#include <array>
+#include <cstddef>
+#include <optional>
+
+namespace abcg {
+class GPUTimer;
+}  // namespace abcg
+
+/**
+ * @brief abcg::GPUTimer class.
+ *
+ * Measures the time the GPU takes to execute the commands issued between
+ * begin and end, with GL_TIME_ELAPSED queries.
+ *
+ * Results are read a few frames later, when the GPU has finished, so that
+ * reading them never stalls the pipeline. Each query is therefore given a
+ * tag (e.g. the configuration being measured), returned with its result.
+ * A measurement is skipped if every query is still pending.
+ *
+ * Timer queries are not available in WebGL 2.0 without an extension, so on
+ * Emscripten the timer is not supported and never returns results.
+ *
+ */
+class abcg::GPUTimer {
+ public:
+  /**
+   * @brief Time of a measurement.
+   */
+  struct Result {
+    /** @brief Tag given to begin. */
+    int tag{};
+    /** @brief GPU time, in milliseconds. */
+    double milliseconds{};
+  };
+
+  void create();
+  void destroy();
+
+  [[nodiscard]] bool isSupported() const noexcept;
+
+  void begin(int tag = 0);
+  void end();
+  [[nodiscard]] std::optional<Result> poll();
+
+ private:
+  // Number of queries in flight, i.e. frames of latency of the results
+  static constexpr std::size_t numQueries{4};
+
+  struct Query {
+    GLuint id{};
+    int tag{};
+    bool isPending{false};
+  };
+
+  std::array<Query, numQueries> m_queries{};
+  // Next query to begin, and oldest pending query
+  std::size_t m_next{};
+  std::size_t m_oldest{};
+  bool m_isActive{false};
+};
+
+#endif
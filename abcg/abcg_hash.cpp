@@ -0,0 +1,77 @@
+/**
+ * @file abcg_hash.cpp
+ * @brief Definition of non-cryptographic hashing helpers.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_hash.hpp"
+
+#include <array>
+#include <cstring>
+
+/**
+ * @brief Computes a 64-bit hash of a byte sequence.
+ *
+ * The input is consumed in 8-byte words, each one mixed into one of four
+ * independent lanes so that the loop is not bound by a single multiply
+ * chain. It is meant for checksums and cache keys, not for security.
+ *
+ * @param bytes Bytes to hash.
+ * @param seed Initial hash value.
+ * @return Hash value.
+ */
+std::uint64_t abcg::hashBytes(std::span<const std::byte> bytes,
+                              std::uint64_t seed) {
+  constexpr std::uint64_t prime{0x9fb21c651e98df25ULL};
+
+  std::array<std::uint64_t, 4> lanes{seed ^ prime, seed + prime,
+                                     seed ^ (prime << 1), seed - prime};
+
+  const auto *data{bytes.data()};
+  auto remaining{bytes.size()};
+
+  while (remaining >= 32) {
+    for (auto &lane : lanes) {
+      std::uint64_t word{};
+      std::memcpy(&word, data, sizeof(word));
+      lane = (lane ^ word) * prime;
+      lane ^= lane >> 29;
+      data += sizeof(word);
+    }
+    remaining -= 32;
+  }
+
+  std::uint64_t hash{bytes.size()};
+  for (const auto lane : lanes) {
+    hash = hashCombine(hash, lane);
+  }
+
+  while (remaining >= 8) {
+    std::uint64_t word{};
+    std::memcpy(&word, data, sizeof(word));
+    hash = hashCombine(hash, word);
+    data += 8;
+    remaining -= 8;
+  }
+
+  if (remaining > 0) {
+    std::uint64_t word{};
+    std::memcpy(&word, data, remaining);
+    hash = hashCombine(hash, word);
+  }
+
+  return hashMix(hash);
+}
+
+/**
+ * @brief Computes a 64-bit hash of a string.
+ *
+ * @param string String to hash.
+ * @param seed Initial hash value.
+ * @return Hash value.
+ */
+std::uint64_t abcg::hashString(std::string_view string, std::uint64_t seed) {
+  return hashBytes(std::as_bytes(std::span{string.data(), string.size()}),
+                   seed);
+}
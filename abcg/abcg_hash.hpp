@@ -0,0 +1,53 @@
+/**
+ * @file abcg_hash.hpp
+ * @brief Declaration of non-cryptographic hashing helpers.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_HASH_HPP_
+#define ABCG_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace abcg {
+/**
+ * @brief Finalizer that spreads the entropy of a 64-bit value over all bits.
+ *
+ * This is the SplitMix64 / MurmurHash3 style avalanche step.
+ *
+ * @param value Value to mix.
+ * @return Mixed value.
+ */
+[[nodiscard]] constexpr std::uint64_t hashMix(std::uint64_t value) noexcept {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31;
+  return value;
+}
+
+/**
+ * @brief Combines a hash value with another one (order dependent).
+ *
+ * @param seed Current hash value.
+ * @param value Value to combine with.
+ * @return Combined hash value.
+ */
+[[nodiscard]] constexpr std::uint64_t hashCombine(
+    std::uint64_t seed, std::uint64_t value) noexcept {
+  return hashMix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) +
+                         (seed >> 2)));
+}
+
+[[nodiscard]] std::uint64_t hashBytes(std::span<const std::byte> bytes,
+                                      std::uint64_t seed = 0);
+[[nodiscard]] std::uint64_t hashString(std::string_view string,
+                                       std::uint64_t seed = 0);
+}  // namespace abcg
+
+#endif
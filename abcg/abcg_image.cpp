@@ -9,135 +9,294 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cppitertools/itertools.hpp>
-#include <fstream>
-#include <gsl/gsl>
-#include <vector>
+#include <filesystem>
+#include <string>
 
 #include "SDL_image.h"
+#include "abcg_elapsedtimer.hpp"
 #include "abcg_exception.hpp"
 #include "abcg_external.hpp"
+#include "abcg_mappedfile.hpp"
+#include "abcg_threadpool.hpp"
 
-void flipY(gsl::not_null<SDL_Surface*> surface) {
-  auto width{static_cast<size_t>(surface->w * surface->format->BytesPerPixel)};
-  auto height{static_cast<size_t>(surface->h)};
-  gsl::span pixels{static_cast<std::byte*>(surface->pixels), width * height};
-
-  // Row of pixels for the swap
-  std::vector<std::byte> row(width, std::byte{});
-
-  // If height is odd, don't need to swap middle row
-  size_t height_div_2{height / 2};
-  for (size_t index = 0; index < height_div_2; index++) {
-    auto offsetFromTop{width * index};
-    auto offsetFromBottom{width * (height - index - 1)};
-    memcpy(row.data(), pixels.subspan(offsetFromTop).data(), width);
-    memcpy(pixels.subspan(offsetFromTop).data(),
-           pixels.subspan(offsetFromBottom).data(), width);
-    memcpy(pixels.subspan(offsetFromBottom).data(), row.data(), width);
-  }
-}
-
-GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
-  GLuint textureID{};
+namespace {
+// Decodes an image file into 8-bit RGB or RGBA pixels (RGB only if
+// allowAlpha is false). The file is read once through a memory mapping and
+// decoded from memory. The conversion to the final format writes each row
+// directly at its final position, so flipping costs no extra pass. The time
+// of each stage is written to times, if not null.
+abcg::opengl::Image decodeImage(std::string_view path, bool allowAlpha,
+                                bool flipY,
+                                abcg::opengl::ImageLoadTimes* times) {
+  abcg::ElapsedTimer timer;
 
-  // Copy file data into buffer
-  std::ifstream input(path.data(), std::ios::binary);
-  if (!input) {
+  const abcg::MappedFile file{path};
+  if (!file.isOpen()) {
     throw abcg::Exception{abcg::Exception::Runtime(
         fmt::format("Failed to open texture file {}", path))};
   }
-  std::vector<char> buffer((std::istreambuf_iterator<char>(input)),
-                           std::istreambuf_iterator<char>());
-
-  // Load the bitmap
-  if (SDL_Surface * surface{IMG_Load(path.data())}) {
-    // Enforce RGB/RGBA
-    GLenum format{0};
-    SDL_Surface* formattedSurface{nullptr};
-    if (surface->format->BytesPerPixel == 3) {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
-      format = GL_RGB;
-    } else {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
-      format = GL_RGBA;
-    }
+  const auto bytes{file.getBytes()};
+  const auto readTime{timer.restart()};
+
+  // The extension is used for formats without a signature (TGA)
+  auto type{std::filesystem::path{path}.extension().string()};
+  if (!type.empty()) type.erase(0, 1);
+  std::transform(type.begin(), type.end(), type.begin(),
+                 [](unsigned char character) {
+                   return static_cast<char>(std::toupper(character));
+                 });
+
+  SDL_Surface* surface{IMG_LoadTyped_RW(
+      SDL_RWFromConstMem(bytes.data(), static_cast<int>(bytes.size())), 1,
+      type.c_str())};
+  if (surface == nullptr) {
+    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+        "Failed to load texture file {} ({})", path, IMG_GetError()))};
+  }
+  const auto decodeTime{timer.restart()};
+
+  // Enforce RGB/RGBA
+  abcg::opengl::Image image;
+  image.width = surface->w;
+  image.height = surface->h;
+  image.format =
+      (allowAlpha && surface->format->BytesPerPixel != 3) ? GL_RGBA : GL_RGB;
+  const auto rowSize{image.getRowSize()};
+  image.pixels.resize(rowSize * static_cast<std::size_t>(image.height));
+
+  // Rows are blitted one by one into the pixels of the image. Copy alpha
+  // and color-keyed pixels as they are, unless they can be made transparent.
+  SDL_Surface* target{SDL_CreateRGBSurfaceWithFormatFrom(
+      image.pixels.data(), image.width, image.height,
+      image.format == GL_RGBA ? 32 : 24, static_cast<int>(rowSize),
+      image.format == GL_RGBA ? SDL_PIXELFORMAT_RGBA32
+                              : SDL_PIXELFORMAT_RGB24)};
+  if (target == nullptr) {
     SDL_FreeSurface(surface);
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to convert texture file {}", path))};
+  }
+  SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+  if (image.format == GL_RGB) SDL_SetColorKey(surface, SDL_FALSE, 0);
 
-    // Flip horizontally
-    flipY(formattedSurface);
+  auto isConverted{true};
+  for (auto row : iter::range(image.height)) {
+    SDL_Rect source{0, row, image.width, 1};
+    SDL_Rect destination{0, flipY ? image.height - row - 1 : row, image.width,
+                         1};
+    isConverted &= SDL_BlitSurface(surface, &source, target, &destination) == 0;
+  }
+  SDL_FreeSurface(target);
+  SDL_FreeSurface(surface);
+  if (!isConverted) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to convert texture file {}", path))};
+  }
 
-    // Generate the texture
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format),
-                 formattedSurface->w, formattedSurface->h, 0, format,
-                 GL_UNSIGNED_BYTE, formattedSurface->pixels);
+  if (times != nullptr) {
+    *times = {
+        .read = readTime, .decode = decodeTime, .convert = timer.elapsed()};
+  }
+  return image;
+}
+}  // namespace
 
-    SDL_FreeSurface(formattedSurface);
+/**
+ * @brief Decodes an image file into 8-bit RGB or RGBA pixels.
+ *
+ * The file is read once, through a memory mapping, and each row is
+ * converted directly to its flipped position.
+ *
+ * No OpenGL function is called, so images may be decoded on any thread and
+ * uploaded later with createTexture, or in parts with allocateTexture,
+ * updateTexture and finishTexture.
+ *
+ * @param path Path to the image file.
+ * @param times If not null, receives the time taken by each stage.
+ * @return Decoded image, with rows stored bottom to top.
+ *
+ * @throw abcg::Exception if the file cannot be opened or decoded.
+ */
+abcg::opengl::Image abcg::opengl::loadImage(std::string_view path,
+                                            ImageLoadTimes* times) {
+  return decodeImage(path, true, true, times);
+}
 
-    // Set texture filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+/**
+ * @brief Decodes a list of image files concurrently.
+ *
+ * The files are decoded by the workers of abcg::ThreadPool and by the
+ * calling thread, which may itself be a worker. No OpenGL function is
+ * called.
+ *
+ * @param sources Image files and the layout to decode each one to.
+ * @return Decoded images, in the order of `sources`.
+ *
+ * @throw abcg::Exception if a file cannot be opened or decoded.
+ */
+std::vector<abcg::opengl::Image> abcg::opengl::loadImages(
+    std::span<const ImageSource> sources) {
+  std::vector<Image> images(sources.size());
+  abcg::ThreadPool::getInstance().parallelFor(
+      sources.size(), [&](std::size_t begin, std::size_t end) {
+        for (auto index : iter::range(begin, end)) {
+          const auto& source{sources[index]};
+          images[index] = decodeImage(source.path, source.allowAlpha,
+                                      source.flipY, nullptr);
+        }
+      });
+  return images;
+}
 
-    // Generate the mipmap levels
-    if (generateMipmaps) {
-      glGenerateMipmap(GL_TEXTURE_2D);
+/**
+ * @brief Creates a texture with storage for an image, without pixels.
+ *
+ * @param image Image that defines the size and format of the texture.
+ * @return Texture ID. The pixels are undefined until updated with
+ * updateTexture.
+ */
+GLuint abcg::opengl::allocateTexture(const Image& image) {
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(image.format),
+               image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE,
+               nullptr);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return textureID;
+}
 
-      // Override minifying filtering
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                      GL_LINEAR_MIPMAP_LINEAR);
-    }
+/**
+ * @brief Uploads a range of rows of an image to a texture created with
+ * allocateTexture.
+ *
+ * @param textureID Texture ID.
+ * @param image Image used to allocate the texture.
+ * @param firstRow First row to upload, counted from the bottom.
+ * @param numRows Number of rows to upload.
+ */
+void abcg::opengl::updateTexture(GLuint textureID, const Image& image,
+                                 int firstRow, int numRows) {
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, image.width, numRows,
+                  image.format, GL_UNSIGNED_BYTE,
+                  image.pixels.data() +
+                      image.getRowSize() * static_cast<std::size_t>(firstRow));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    // Set texture wrapping
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(
-        fmt::format("Failed to load texture file {}", path))};
+/**
+ * @brief Sets the filtering and wrapping parameters of a texture whose
+ * pixels have been uploaded, and optionally generates its mipmaps.
+ *
+ * @param textureID Texture ID.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ */
+void abcg::opengl::finishTexture(GLuint textureID, bool generateMipmaps) {
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  // Set texture filtering
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Generate the mipmap levels
+  if (generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    // Override minifying filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
   }
 
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
   glBindTexture(GL_TEXTURE_2D, 0);
+}
 
+/**
+ * @brief Creates a texture from a decoded image.
+ *
+ * @param image Decoded image.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture ID.
+ */
+GLuint abcg::opengl::createTexture(const Image& image, bool generateMipmaps) {
+  const auto textureID{allocateTexture(image)};
+  updateTexture(textureID, image, 0, image.height);
+  finishTexture(textureID, generateMipmaps);
   return textureID;
 }
 
-GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
-                                 bool generateMipmaps) {
+/**
+ * @brief Loads an image file into a new texture.
+ *
+ * @param path Path to the image file.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture ID.
+ *
+ * @throw abcg::Exception if the file cannot be opened or decoded.
+ */
+GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
+  return createTexture(loadImage(path), generateMipmaps);
+}
+
+/**
+ * @brief Loads image files into new textures.
+ *
+ * The files are decoded concurrently with loadImages, then the textures are
+ * created on the calling thread, which must have a current OpenGL context.
+ *
+ * @param paths Paths to the image files.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture IDs, in the order of `paths`.
+ *
+ * @throw abcg::Exception if a file cannot be opened or decoded. No texture
+ * is created in that case.
+ */
+std::vector<GLuint> abcg::opengl::loadTextures(
+    std::span<const std::string> paths, bool generateMipmaps) {
+  std::vector<ImageSource> sources;
+  sources.reserve(paths.size());
+  for (const auto& path : paths) {
+    sources.push_back({path});
+  }
+
+  std::vector<GLuint> textureIDs;
+  textureIDs.reserve(paths.size());
+  for (const auto& image : loadImages(sources)) {
+    textureIDs.push_back(createTexture(image, generateMipmaps));
+  }
+  return textureIDs;
+}
+
+/**
+ * @brief Creates a cube map texture from decoded faces.
+ *
+ * @param faces Faces in the order +X, -X, +Y, -Y, +Z, -Z, decoded to RGB
+ * with rows stored top to bottom, as expected by cube map lookups.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture ID.
+ */
+GLuint abcg::opengl::createCubemap(std::span<const Image, 6> faces,
+                                   bool generateMipmaps) {
   GLuint textureID{};
   glGenTextures(1, &textureID);
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-  for (auto&& [index, path] : iter::enumerate(paths)) {
-    // Copy file data into buffer
-    std::ifstream input(path.data(), std::ios::binary);
-    if (!input) {
-      throw abcg::Exception{abcg::Exception::Runtime(
-          fmt::format("Failed to open texture file {}", path))};
-    }
-    std::vector<char> buffer((std::istreambuf_iterator<char>(input)),
-                             std::istreambuf_iterator<char>());
-
-    // Load the bitmap
-    if (SDL_Surface * surface{IMG_Load(path.data())}) {
-      // Enforce RGB
-      SDL_Surface* formattedSurface{
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0)};
-      SDL_FreeSurface(surface);
-
-      // Create texture
-      glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(index),
-                   0, GL_RGB, formattedSurface->w, formattedSurface->h, 0,
-                   GL_RGB, GL_UNSIGNED_BYTE, formattedSurface->pixels);
-
-      SDL_FreeSurface(formattedSurface);
-    } else {
-      throw abcg::Exception{abcg::Exception::Runtime(
-          fmt::format("Failed to load texture file {}", path))};
-    }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (auto&& [index, image] : iter::enumerate(faces)) {
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(index),
+                 0, GL_RGB, image.width, image.height, 0, GL_RGB,
+                 GL_UNSIGNED_BYTE, image.pixels.data());
   }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
   // Set texture wrapping
   glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -159,3 +318,27 @@ GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
 
   return textureID;
 }
+
+/**
+ * @brief Loads six image files into a new cube map texture.
+ *
+ * The faces are decoded concurrently with loadImages and uploaded on the
+ * calling thread, which must have a current OpenGL context.
+ *
+ * @param paths Paths to the faces, in the order +X, -X, +Y, -Y, +Z, -Z.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture ID.
+ *
+ * @throw abcg::Exception if a file cannot be opened or decoded.
+ */
+GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
+                                 bool generateMipmaps) {
+  // Faces are stored top to bottom, as expected by cube map lookups
+  std::vector<ImageSource> sources;
+  for (const auto path : paths) {
+    sources.push_back({std::string{path}, false, false});
+  }
+  const auto images{loadImages(sources)};
+  return createCubemap(std::span<const Image, 6>{images.data(), 6},
+                       generateMipmaps);
+}
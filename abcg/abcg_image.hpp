@@ -10,11 +10,73 @@
 
 #include <abcg_external.hpp>
 #include <array>
+#include <cstddef>
+#include <span>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace abcg::opengl {
+/**
+ * @brief Decoded 8-bit RGB or RGBA image, ready to be uploaded.
+ *
+ * Rows are tightly packed and stored bottom to top, as expected by
+ * glTexImage2D.
+ */
+struct Image {
+  int width{};
+  int height{};
+  /** @brief GL_RGB or GL_RGBA. */
+  GLenum format{};
+  std::vector<std::byte> pixels;
+
+  [[nodiscard]] std::size_t getRowSize() const noexcept {
+    return static_cast<std::size_t>(width) * (format == GL_RGBA ? 4 : 3);
+  }
+};
+
+/**
+ * @brief Time taken by each stage of loadImage, in seconds.
+ */
+struct ImageLoadTimes {
+  /** @brief Mapping the file. */
+  double read{};
+  /** @brief Decoding the file into a surface. */
+  double decode{};
+  /** @brief Converting and flipping the surface into the image. */
+  double convert{};
+};
+
+/**
+ * @brief Image file to decode with loadImages, and the layout of its pixels.
+ */
+struct ImageSource {
+  std::string path;
+  /** @brief Whether rows are stored bottom to top, as expected by 2D
+   * textures. Cube map faces are stored top to bottom. */
+  bool flipY{true};
+  /** @brief Whether images with alpha are decoded to RGBA instead of RGB. */
+  bool allowAlpha{true};
+};
+
+[[nodiscard]] Image loadImage(std::string_view path,
+                              ImageLoadTimes* times = nullptr);
+[[nodiscard]] std::vector<Image> loadImages(
+    std::span<const ImageSource> sources);
+
+[[nodiscard]] GLuint allocateTexture(const Image& image);
+void updateTexture(GLuint textureID, const Image& image, int firstRow,
+                   int numRows);
+void finishTexture(GLuint textureID, bool generateMipmaps = true);
+[[nodiscard]] GLuint createTexture(const Image& image,
+                                   bool generateMipmaps = true);
+[[nodiscard]] GLuint createCubemap(std::span<const Image, 6> faces,
+                                   bool generateMipmaps = true);
+
 [[nodiscard]] GLuint loadTexture(std::string_view path,
                                  bool generateMipmaps = true);
+[[nodiscard]] std::vector<GLuint> loadTextures(
+    std::span<const std::string> paths, bool generateMipmaps = true);
 [[nodiscard]] GLuint loadCubemap(std::array<std::string_view, 6> paths,
                                  bool generateMipmaps = true);
 }  // namespace abcg::opengl
@@ -0,0 +1,124 @@
+/**
+ * @file abcg_mappedfile.cpp
+ * @brief Definition of abcg::MappedFile class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_mappedfile.hpp"
+
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Maps the file at the given path into memory.
+ *
+ * The object is left closed (see isOpen()) if the file cannot be opened or
+ * mapped, or if it is empty.
+ *
+ * @param path Path to the file.
+ */
+abcg::MappedFile::MappedFile(std::string_view path) {
+  const std::string pathString{path};
+#if defined(_WIN32)
+  auto *file{CreateFileA(pathString.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                         nullptr)};
+  if (file == INVALID_HANDLE_VALUE) return;
+
+  LARGE_INTEGER fileSize{};
+  if (GetFileSizeEx(file, &fileSize) == 0 || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    return;
+  }
+
+  auto *mapping{
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return;
+  }
+
+  auto *view{MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return;
+  }
+
+  m_fileHandle = file;
+  m_mappingHandle = mapping;
+  m_data = static_cast<const std::byte *>(view);
+  m_size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+  const auto fd{::open(pathString.c_str(), O_RDONLY)};
+  if (fd < 0) return;
+
+  struct stat status {};
+  if (::fstat(fd, &status) != 0 || status.st_size <= 0) {
+    ::close(fd);
+    return;
+  }
+
+  const auto size{static_cast<std::size_t>(status.st_size)};
+  auto *view{::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (view == MAP_FAILED) return;
+
+  m_data = static_cast<const std::byte *>(view);
+  m_size = size;
+#endif
+}
+
+abcg::MappedFile::~MappedFile() { close(); }
+
+abcg::MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data{std::exchange(other.m_data, nullptr)},
+      m_size{std::exchange(other.m_size, 0)}
+#if defined(_WIN32)
+      ,
+      m_fileHandle{std::exchange(other.m_fileHandle, nullptr)},
+      m_mappingHandle{std::exchange(other.m_mappingHandle, nullptr)}
+#endif
+{
+}
+
+abcg::MappedFile &abcg::MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+    m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+    m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#endif
+  }
+  return *this;
+}
+
+void abcg::MappedFile::close() noexcept {
+  if (m_data == nullptr) return;
+#if defined(_WIN32)
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mappingHandle);
+  CloseHandle(m_fileHandle);
+  m_fileHandle = nullptr;
+  m_mappingHandle = nullptr;
+#else
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  ::munmap(const_cast<std::byte *>(m_data), m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file abcg_mappedfile.hpp
+ * @brief abcg::MappedFile header file.
+ *
+ * Declaration of abcg::MappedFile class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MAPPEDFILE_HPP_
+#define ABCG_MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace abcg {
+class MappedFile;
+}  // namespace abcg
+
+/**
+ * @brief abcg::MappedFile class.
+ *
+ * Read-only memory mapping of a whole file. The mapping is released when the
+ * object is destroyed.
+ *
+ */
+class abcg::MappedFile {
+ public:
+  MappedFile() = default;
+  explicit MappedFile(std::string_view path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  [[nodiscard]] bool isOpen() const noexcept { return m_data != nullptr; }
+  [[nodiscard]] std::span<const std::byte> getBytes() const noexcept {
+    return {m_data, m_size};
+  }
+  [[nodiscard]] std::size_t size() const noexcept { return m_size; }
+
+ private:
+  void close() noexcept;
+
+  const std::byte* m_data{};
+  std::size_t m_size{};
+#if defined(_WIN32)
+  void* m_fileHandle{};
+  void* m_mappingHandle{};
+#endif
+};
+
+#endif
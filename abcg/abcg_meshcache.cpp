@@ -0,0 +1,323 @@
+/**
+ * @file abcg_meshcache.cpp
+ * @brief Definition of abcg::MeshCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshcache.hpp"
+
+#include <fmt/core.h>
+
+#include <array>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "abcg_hash.hpp"
+
+namespace {
+// Bump whenever the layout of the image changes
+constexpr std::uint32_t formatVersion{2};
+constexpr std::array<char, 8> formatMagic{'A', 'B', 'C', 'G',
+                                          'M', 'E', 'S', 'H'};
+constexpr std::size_t sectionAlignment{16};
+
+struct Header {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t numSections{};
+  std::uint64_t sourceSize{};
+  std::int64_t sourceTime{};
+  std::uint64_t optionsKey{};
+  // Hash of the size and modification time of every dependency
+  std::uint64_t dependencyKey{};
+  std::uint32_t numDependencies{};
+  std::uint32_t reserved{};
+  std::uint64_t checksum{};
+};
+
+struct SectionEntry {
+  std::uint32_t tag{};
+  std::uint32_t reserved{};
+  std::uint64_t offset{};
+  std::uint64_t size{};
+};
+
+static_assert(sizeof(Header) % sectionAlignment == 0);
+
+std::size_t alignUp(std::size_t value) {
+  return (value + sectionAlignment - 1) & ~(sectionAlignment - 1);
+}
+
+// Returns size and modification time of the source file
+std::optional<std::pair<std::uint64_t, std::int64_t>> getSourceStamp(
+    std::string_view sourcePath) {
+  std::error_code error;
+  const std::filesystem::path path{sourcePath};
+  const auto size{std::filesystem::file_size(path, error)};
+  if (error) return std::nullopt;
+  const auto time{std::filesystem::last_write_time(path, error)};
+  if (error) return std::nullopt;
+  return std::pair{static_cast<std::uint64_t>(size),
+                   std::int64_t{time.time_since_epoch().count()}};
+}
+
+// Combines the stamps of files the mesh depends on. A missing file has its
+// own stamp, so that creating it outdates the image.
+std::uint64_t getDependencyKey(std::span<const std::string> paths) {
+  std::uint64_t key{paths.size()};
+  for (const auto &path : paths) {
+    const auto stamp{getSourceStamp(path).value_or(
+        std::pair{std::uint64_t{}, std::int64_t{-1}})};
+    key = abcg::hashCombine(key, abcg::hashString(path));
+    key = abcg::hashCombine(key, stamp.first);
+    key = abcg::hashCombine(key, static_cast<std::uint64_t>(stamp.second));
+  }
+  return key;
+}
+
+template <typename T>
+void append(std::vector<std::byte> &buffer, const T &value) {
+  const auto offset{buffer.size()};
+  buffer.resize(offset + sizeof(T));
+  std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+void appendString(std::vector<std::byte> &buffer, std::string_view string) {
+  append(buffer, static_cast<std::uint32_t>(string.size()));
+  const auto offset{buffer.size()};
+  buffer.resize(offset + string.size());
+  std::memcpy(buffer.data() + offset, string.data(), string.size());
+}
+
+template <typename T>
+bool read(std::span<const std::byte> &bytes, T &value) {
+  if (bytes.size() < sizeof(T)) return false;
+  std::memcpy(&value, bytes.data(), sizeof(T));
+  bytes = bytes.subspan(sizeof(T));
+  return true;
+}
+
+bool readString(std::span<const std::byte> &bytes, std::string &string) {
+  std::uint32_t length{};
+  if (!read(bytes, length) || bytes.size() < length) return false;
+  string.assign(reinterpret_cast<const char *>(bytes.data()),  // NOLINT
+                length);
+  bytes = bytes.subspan(length);
+  return true;
+}
+}  // namespace
+
+/**
+ * @brief Returns the path of the cache image of a source file.
+ *
+ * @param sourcePath Path to the source file (e.g. an OBJ file).
+ * @return Path of the cache image.
+ */
+std::string abcg::MeshCache::getCachePath(std::string_view sourcePath) {
+  return std::string{sourcePath} + ".abcgmesh";
+}
+
+/**
+ * @brief Opens and validates the cache image of a source file.
+ *
+ * The image is outdated if the source file or any of the dependencies
+ * given to save changed.
+ *
+ * @param sourcePath Path to the source file.
+ * @param optionsKey Caller-defined key of the options used to build the mesh.
+ * @return Mapped image, or std::nullopt if there is no image or it is
+ * outdated, truncated or corrupted.
+ */
+std::optional<abcg::MeshCache> abcg::MeshCache::open(
+    std::string_view sourcePath, std::uint64_t optionsKey) {
+  const auto stamp{getSourceStamp(sourcePath)};
+  if (!stamp) return std::nullopt;
+
+  MeshCache cache;
+  cache.m_file = MappedFile{getCachePath(sourcePath)};
+  if (!cache.m_file.isOpen()) return std::nullopt;
+
+  auto bytes{cache.m_file.getBytes()};
+  Header header;
+  if (!read(bytes, header)) return std::nullopt;
+  if (header.magic != formatMagic || header.version != formatVersion ||
+      header.sourceSize != stamp->first || header.sourceTime != stamp->second ||
+      header.optionsKey != optionsKey) {
+    return std::nullopt;
+  }
+
+  if (hashBytes(bytes) != header.checksum) {
+    fmt::print("Warning: discarding corrupted mesh cache {}\n",
+               getCachePath(sourcePath));
+    return std::nullopt;
+  }
+
+  const auto payload{cache.m_file.getBytes()};
+  cache.m_sections.reserve(header.numSections);
+  for ([[maybe_unused]] auto index : iter::range(header.numSections)) {
+    SectionEntry entry;
+    if (!read(bytes, entry) || entry.offset > payload.size() ||
+        entry.size > payload.size() - entry.offset) {
+      return std::nullopt;
+    }
+    cache.m_sections.push_back(
+        {entry.tag, payload.subspan(entry.offset, entry.size)});
+  }
+
+  std::vector<std::string> dependencies(header.numDependencies);
+  for (auto &dependency : dependencies) {
+    if (!readString(bytes, dependency)) return std::nullopt;
+  }
+  if (getDependencyKey(dependencies) != header.dependencyKey) {
+    return std::nullopt;
+  }
+
+  return cache;
+}
+
+/**
+ * @brief Writes the cache image of a source file.
+ *
+ * Failing to write the image (e.g. read-only asset directory) is not an
+ * error: the mesh is simply rebuilt from the source on the next load.
+ *
+ * @param sourcePath Path to the source file.
+ * @param optionsKey Caller-defined key of the options used to build the mesh.
+ * @param sections Sections to store.
+ * @param dependencies Other files the mesh was built from, such as the
+ * material libraries of an OBJ file. Files that were looked for but not
+ * found should be included too.
+ * @return Whether the image was written.
+ */
+bool abcg::MeshCache::save(std::string_view sourcePath,
+                           std::uint64_t optionsKey,
+                           std::span<const Section> sections,
+                           std::span<const std::string> dependencies) {
+  const auto stamp{getSourceStamp(sourcePath)};
+  if (!stamp) return false;
+
+  std::vector<std::byte> dependencyBytes;
+  for (const auto &dependency : dependencies) {
+    appendString(dependencyBytes, dependency);
+  }
+
+  // Lay out header, section table, dependency paths and section data
+  auto offset{alignUp(sizeof(Header) + sections.size() * sizeof(SectionEntry) +
+                      dependencyBytes.size())};
+  std::vector<SectionEntry> entries;
+  entries.reserve(sections.size());
+  for (const auto &section : sections) {
+    entries.push_back({section.tag, 0, offset, section.data.size()});
+    offset = alignUp(offset + section.data.size());
+  }
+
+  std::vector<std::byte> image(offset);
+  auto *cursor{image.data() + sizeof(Header)};
+  for (const auto &entry : entries) {
+    std::memcpy(cursor, &entry, sizeof(entry));
+    cursor += sizeof(entry);
+  }
+  if (!dependencyBytes.empty()) {
+    std::memcpy(cursor, dependencyBytes.data(), dependencyBytes.size());
+  }
+  for (auto &&[section, entry] : iter::zip(sections, entries)) {
+    if (!section.data.empty()) {
+      std::memcpy(image.data() + entry.offset, section.data.data(),
+                  section.data.size());
+    }
+  }
+
+  Header header{.magic = formatMagic,
+                .version = formatVersion,
+                .numSections = static_cast<std::uint32_t>(sections.size()),
+                .sourceSize = stamp->first,
+                .sourceTime = stamp->second,
+                .optionsKey = optionsKey,
+                .dependencyKey = getDependencyKey(dependencies),
+                .numDependencies =
+                    static_cast<std::uint32_t>(dependencies.size()),
+                .checksum =
+                    hashBytes(std::span{image}.subspan(sizeof(Header)))};
+  std::memcpy(image.data(), &header, sizeof(header));
+
+  // Write to a temporary file first so that a concurrent reader never maps a
+  // partially written image
+  const auto cachePath{getCachePath(sourcePath)};
+  const auto temporaryPath{cachePath + ".tmp"};
+  {
+    std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!output) return false;
+    output.write(reinterpret_cast<const char *>(image.data()),  // NOLINT
+                 static_cast<std::streamsize>(image.size()));
+    if (!output) return false;
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Serializes a list of materials into a section payload.
+ *
+ * @param materials Materials to serialize.
+ * @return Serialized bytes.
+ */
+std::vector<std::byte> abcg::MeshCache::packMaterials(
+    std::span<const Material> materials) {
+  std::vector<std::byte> bytes;
+  append(bytes, static_cast<std::uint32_t>(materials.size()));
+  for (const auto &material : materials) {
+    append(bytes, material.Ka);
+    append(bytes, material.Kd);
+    append(bytes, material.Ks);
+    append(bytes, material.shininess);
+    appendString(bytes, material.diffuseTexName);
+    appendString(bytes, material.normalTexName);
+  }
+  return bytes;
+}
+
+/**
+ * @brief Deserializes a list of materials from a section payload.
+ *
+ * @param bytes Bytes produced by packMaterials.
+ * @return Materials, or an empty list if the payload is malformed.
+ */
+std::vector<abcg::MeshCache::Material> abcg::MeshCache::unpackMaterials(
+    std::span<const std::byte> bytes) {
+  std::uint32_t count{};
+  if (!read(bytes, count)) return {};
+
+  std::vector<Material> materials(count);
+  for (auto &material : materials) {
+    if (!read(bytes, material.Ka) || !read(bytes, material.Kd) ||
+        !read(bytes, material.Ks) || !read(bytes, material.shininess) ||
+        !readString(bytes, material.diffuseTexName) ||
+        !readString(bytes, material.normalTexName)) {
+      return {};
+    }
+  }
+  return materials;
+}
+
+/**
+ * @brief Returns the contents of a section.
+ *
+ * @param tag Section tag.
+ * @return Section bytes, or an empty span if the section is missing.
+ */
+std::span<const std::byte> abcg::MeshCache::getSection(
+    std::uint32_t tag) const noexcept {
+  for (const auto &section : m_sections) {
+    if (section.tag == tag) return section.data;
+  }
+  return {};
+}
@@ -0,0 +1,114 @@
+/**
+ * @file abcg_meshcache.hpp
+ * @brief abcg::MeshCache header file.
+ *
+ * Declaration of abcg::MeshCache class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHCACHE_HPP_
+#define ABCG_MESHCACHE_HPP_
+
+#include <cstdint>
+#include <glm/vec4.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "abcg_mappedfile.hpp"
+
+namespace abcg {
+class MeshCache;
+}  // namespace abcg
+
+/**
+ * @brief abcg::MeshCache class.
+ *
+ * Binary image of a processed mesh, stored next to its source file with the
+ * ".abcgmesh" suffix. The image is a list of tagged sections (vertices,
+ * indices, materials, ...) whose layout is defined by the caller. It is
+ * validated against a format version, the size and modification time of the
+ * source file and of the files it depends on (e.g. material libraries), a
+ * caller-defined key describing the load options, and a checksum of the
+ * payload.
+ *
+ * Opened images are memory mapped, so section data can be handed directly
+ * to OpenGL without intermediate copies.
+ *
+ */
+class abcg::MeshCache {
+ public:
+  /**
+   * @brief Tagged block of data stored in the image.
+   */
+  struct Section {
+    std::uint32_t tag{};
+    std::span<const std::byte> data;
+  };
+
+  /**
+   * @brief Material properties stored with the mesh.
+   */
+  struct Material {
+    glm::vec4 Ka{};
+    glm::vec4 Kd{};
+    glm::vec4 Ks{};
+    float shininess{};
+    std::string diffuseTexName;
+    std::string normalTexName;
+  };
+
+  [[nodiscard]] static constexpr std::uint32_t makeTag(char a, char b, char c,
+                                                       char d) noexcept {
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(a)) |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(b)) << 8 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(c)) << 16 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(d)) << 24;
+  }
+
+  [[nodiscard]] static std::string getCachePath(std::string_view sourcePath);
+  [[nodiscard]] static std::optional<MeshCache> open(
+      std::string_view sourcePath, std::uint64_t optionsKey);
+  static bool save(std::string_view sourcePath, std::uint64_t optionsKey,
+                   std::span<const Section> sections,
+                   std::span<const std::string> dependencies = {});
+
+  [[nodiscard]] static std::vector<std::byte> packMaterials(
+      std::span<const Material> materials);
+  [[nodiscard]] static std::vector<Material> unpackMaterials(
+      std::span<const std::byte> bytes);
+
+  [[nodiscard]] std::span<const std::byte> getSection(
+      std::uint32_t tag) const noexcept;
+
+  /**
+   * @brief Returns the contents of a section as a span of T.
+   *
+   * @tparam T Trivially copyable element type.
+   * @param tag Section tag.
+   * @return Span of elements, or an empty span if the section is missing or
+   * its size is not a multiple of sizeof(T).
+   */
+  template <typename T>
+  [[nodiscard]] std::span<const T> getSectionAs(
+      std::uint32_t tag) const noexcept {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto bytes{getSection(tag)};
+    if (bytes.size() % sizeof(T) != 0) return {};
+    // Sections are 16-byte aligned inside a page-aligned mapping
+    return {reinterpret_cast<const T*>(bytes.data()),  // NOLINT
+            bytes.size() / sizeof(T)};
+  }
+
+ private:
+  MeshCache() = default;
+
+  MappedFile m_file;
+  std::vector<Section> m_sections;
+};
+
+#endif
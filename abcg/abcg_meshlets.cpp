@@ -0,0 +1,230 @@
+/**
+ * @file abcg_meshlets.cpp
+ * @brief Definition of abcg::Meshlets class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshlets.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_access.hpp>
+#include <glm/matrix.hpp>
+#include <limits>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Sets the bounding sphere and normal cone of a meshlet from its vertices
+// and faces
+void computeBounds(abcg::Meshlets::Meshlet &meshlet,
+                   std::span<const std::uint32_t> vertices,
+                   std::span<const std::uint32_t> indices,
+                   std::span<const glm::vec3> positions) {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+  for (const auto vertex : vertices) {
+    min = glm::min(min, positions[vertex]);
+    max = glm::max(max, positions[vertex]);
+  }
+  meshlet.center = (min + max) * 0.5f;
+  meshlet.radius = 0.0f;
+  for (const auto vertex : vertices) {
+    meshlet.radius = std::max(meshlet.radius,
+                              glm::distance(meshlet.center, positions[vertex]));
+  }
+
+  // Unit normals of the faces that are not degenerate
+  std::vector<glm::vec3> normals;
+  normals.reserve(meshlet.numIndices / 3);
+  const auto faces{indices.subspan(meshlet.firstIndex, meshlet.numIndices)};
+  for (auto face : iter::range(faces.size() / 3)) {
+    const auto &a{positions[faces[face * 3 + 0]]};
+    const auto &b{positions[faces[face * 3 + 1]]};
+    const auto &c{positions[faces[face * 3 + 2]]};
+    const auto normal{glm::cross(b - a, c - a)};
+    const auto length{glm::length(normal)};
+    if (length > 0.0f) normals.push_back(normal / length);
+  }
+
+  glm::vec3 axis{};
+  for (const auto &normal : normals) {
+    axis += normal;
+  }
+  const auto axisLength{glm::length(axis)};
+  meshlet.coneCutoff = 1.0f;
+  if (axisLength <= std::numeric_limits<float>::epsilon()) return;
+  meshlet.coneAxis = axis / axisLength;
+
+  auto minCosine{1.0f};
+  for (const auto &normal : normals) {
+    minCosine = std::min(minCosine, glm::dot(normal, meshlet.coneAxis));
+  }
+  // A cone of 90 degrees or wider faces every direction
+  if (minCosine > 0.0f) {
+    meshlet.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+  }
+}
+}  // namespace
+
+/**
+ * @brief Partitions an index buffer into meshlets.
+ *
+ * Triangles are added in order to the current meshlet until it would exceed
+ * one of the limits.
+ *
+ * @param indices Index buffer with three indices per triangle.
+ * @param positions Vertex positions.
+ * @param maxVertices Maximum number of unique vertices of a meshlet.
+ * @param maxTriangles Maximum number of triangles of a meshlet.
+ * @return Meshlets covering the whole index buffer, in order.
+ *
+ * @throw abcg::Exception if the number of indices is not a multiple of 3, if
+ * an index is out of bounds or if the limits cannot hold a triangle.
+ */
+std::vector<abcg::Meshlets::Meshlet> abcg::Meshlets::build(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions, std::size_t maxVertices,
+    std::size_t maxTriangles) {
+  if (indices.size() % 3 != 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Number of indices is not a multiple of 3")};
+  }
+  if (maxVertices < 3 || maxTriangles < 1) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Meshlet limits are too small")};
+  }
+  if (indices.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Too many indices to build meshlets")};
+  }
+
+  std::vector<Meshlet> meshlets;
+  if (indices.empty()) return meshlets;
+
+  // Meshlet that last used each vertex, so that shared vertices are counted
+  // once
+  constexpr auto noMeshlet{std::numeric_limits<std::size_t>::max()};
+  std::vector<std::size_t> owners(positions.size(), noMeshlet);
+  std::vector<std::uint32_t> vertices;
+  vertices.reserve(maxVertices);
+
+  Meshlet meshlet;
+  for (auto face : iter::range(indices.size() / 3)) {
+    const auto *corners{&indices[face * 3]};
+    std::size_t newVertices{};
+    for (auto corner : iter::range(3)) {
+      if (corners[corner] >= positions.size()) {
+        throw abcg::Exception{
+            abcg::Exception::Runtime("Vertex index out of bounds")};
+      }
+      if (owners[corners[corner]] != meshlets.size()) ++newVertices;
+    }
+    // Repeated indices of degenerate faces are counted twice, which is only
+    // conservative
+    if (vertices.size() + newVertices > maxVertices ||
+        meshlet.numIndices / 3 == maxTriangles) {
+      computeBounds(meshlet, vertices, indices, positions);
+      meshlets.push_back(meshlet);
+      meshlet = {};
+      meshlet.firstIndex = static_cast<std::uint32_t>(face * 3);
+      vertices.clear();
+    }
+
+    for (auto corner : iter::range(3)) {
+      auto &owner{owners[corners[corner]]};
+      if (owner != meshlets.size()) {
+        owner = meshlets.size();
+        vertices.push_back(corners[corner]);
+      }
+    }
+    meshlet.numIndices += 3;
+  }
+  computeBounds(meshlet, vertices, indices, positions);
+  meshlets.push_back(meshlet);
+
+  return meshlets;
+}
+
+/**
+ * @brief Finds the meshlets that may be visible.
+ *
+ * Meshlets are tested in model space against the planes of the view frustum
+ * and, optionally, against the view direction, assuming counterclockwise
+ * front faces. Both tests are conservative.
+ *
+ * @param meshlets Meshlets to test.
+ * @param modelMatrix Model matrix.
+ * @param viewMatrix View matrix.
+ * @param projMatrix Perspective or orthographic projection matrix.
+ * @param cullBackfaces Whether to remove meshlets whose faces all face away
+ * from the camera. Use only when back faces are culled by OpenGL.
+ * @param visible Receives the positions in `meshlets` of the meshlets that
+ * may be visible, in increasing order.
+ * @return Number of meshlets kept and removed by each test.
+ */
+abcg::Meshlets::CullResult abcg::Meshlets::cull(
+    std::span<const Meshlet> meshlets, const glm::mat4 &modelMatrix,
+    const glm::mat4 &viewMatrix, const glm::mat4 &projMatrix,
+    bool cullBackfaces, std::vector<std::uint32_t> &visible) {
+  // Planes of the frustum in model space (Gribb and Hartmann), with unit
+  // normals pointing inside
+  const auto clipMatrix{projMatrix * viewMatrix * modelMatrix};
+  const auto w{glm::row(clipMatrix, 3)};
+  std::array<glm::vec4, 6> planes{};
+  for (auto axis : iter::range(3)) {
+    const auto row{glm::row(clipMatrix, axis)};
+    const auto plane{static_cast<std::size_t>(axis) * 2};
+    planes.at(plane + 0) = w + row;
+    planes.at(plane + 1) = w - row;
+  }
+  for (auto &plane : planes) {
+    plane /= glm::length(glm::vec3{plane});
+  }
+
+  // Camera position, or view direction for orthographic projections, in
+  // model space
+  const auto isPerspective{projMatrix[3][3] == 0.0f};
+  const auto inverseModelView{glm::inverse(viewMatrix * modelMatrix)};
+  const glm::vec3 eye{inverseModelView * glm::vec4{0, 0, 0, 1}};
+  const auto viewDirection{
+      glm::normalize(glm::vec3{inverseModelView * glm::vec4{0, 0, -1, 0}})};
+
+  CullResult result;
+  visible.clear();
+  for (auto &&[position, meshlet] : iter::enumerate(meshlets)) {
+    const auto isOutside{
+        std::any_of(planes.begin(), planes.end(), [&](const auto &plane) {
+          return glm::dot(glm::vec3{plane}, meshlet.center) + plane.w <
+                 -meshlet.radius;
+        })};
+    if (isOutside) {
+      ++result.numFrustumCulled;
+      continue;
+    }
+
+    if (cullBackfaces && meshlet.coneCutoff < 1.0f) {
+      // Every face of the cone faces away from any point of the sphere
+      const auto isBackfacing{
+          isPerspective
+              ? glm::dot(meshlet.center - eye, meshlet.coneAxis) >=
+                    meshlet.coneCutoff * glm::distance(meshlet.center, eye) +
+                        meshlet.radius
+              : glm::dot(viewDirection, meshlet.coneAxis) >=
+                    meshlet.coneCutoff};
+      if (isBackfacing) {
+        ++result.numBackfaceCulled;
+        continue;
+      }
+    }
+
+    visible.push_back(static_cast<std::uint32_t>(position));
+  }
+  result.numVisible = visible.size();
+
+  return result;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file abcg_meshlets.hpp
+ * @brief abcg::Meshlets header file.
+ *
+ * Declaration of abcg::Meshlets class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHLETS_HPP_
+#define ABCG_MESHLETS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+namespace abcg {
+class Meshlets;
+}  // namespace abcg
+
+/**
+ * @brief abcg::Meshlets class.
+ *
+ * Partitions an indexed triangle list into small clusters of triangles
+ * (meshlets) that can be culled as a whole on the CPU.
+ *
+ * Meshlets are consecutive ranges of the index buffer, built in index buffer
+ * order, so the order set by abcg::MeshOptimizer is kept and the index buffer
+ * does not change. Each meshlet has a bounding sphere for frustum culling and
+ * a cone that bounds the normals of its triangles for back-face culling.
+ *
+ */
+class abcg::Meshlets {
+ public:
+  /**
+   * @brief Range of the index buffer with its bounds, in model space.
+   */
+  struct Meshlet {
+    std::uint32_t firstIndex{};
+    std::uint32_t numIndices{};
+    /** @brief Center of the bounding sphere. */
+    glm::vec3 center{};
+    /** @brief Radius of the bounding sphere. */
+    float radius{};
+    /** @brief Mean direction of the front faces. */
+    glm::vec3 coneAxis{};
+    /** @brief Sine of the largest angle between a face normal and the axis,
+     * or 1 if the faces are not within 90 degrees of the axis. */
+    float coneCutoff{1.0f};
+  };
+
+  /**
+   * @brief Number of meshlets kept and removed by cull.
+   */
+  struct CullResult {
+    std::size_t numVisible{};
+    std::size_t numFrustumCulled{};
+    std::size_t numBackfaceCulled{};
+  };
+
+  [[nodiscard]] static std::vector<Meshlet> build(
+      std::span<const std::uint32_t> indices,
+      std::span<const glm::vec3> positions, std::size_t maxVertices = 64,
+      std::size_t maxTriangles = 124);
+
+  static CullResult cull(std::span<const Meshlet> meshlets,
+                         const glm::mat4 &modelMatrix,
+                         const glm::mat4 &viewMatrix,
+                         const glm::mat4 &projMatrix, bool cullBackfaces,
+                         std::vector<std::uint32_t> &visible);
+};
+
+#endif
@@ -0,0 +1,373 @@
+/**
+ * @file abcg_meshoptimizer.cpp
+ * @brief Definition of abcg::MeshOptimizer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshoptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <numeric>
+
+namespace {
+constexpr std::uint32_t invalidIndex{std::numeric_limits<std::uint32_t>::max()};
+
+// Parameters of Forsyth's vertex scoring
+constexpr std::size_t forsythCacheSize{32};
+constexpr std::size_t forsythMaxValence{32};
+constexpr float cacheDecayPower{1.5f};
+constexpr float lastTriangleScore{0.75f};
+constexpr float valenceBoostScale{2.0f};
+constexpr float valenceBoostPower{0.5f};
+
+// FIFO cache of post-transform vertices, as found in most GPUs
+class FifoCache {
+ public:
+  FifoCache(std::size_t numVertices, std::size_t cacheSize)
+      : m_cacheSize{cacheSize}, m_timestamps(numVertices, 0) {}
+
+  // Returns whether the vertex was transformed
+  bool access(std::uint32_t vertex) noexcept {
+    if (m_time - m_timestamps[vertex] < m_cacheSize) return false;
+    m_timestamps[vertex] = m_time++;
+    return true;
+  }
+
+  std::uint32_t accessTriangle(const std::uint32_t *triangle) noexcept {
+    return static_cast<std::uint32_t>(access(triangle[0])) +
+           static_cast<std::uint32_t>(access(triangle[1])) +
+           static_cast<std::uint32_t>(access(triangle[2]));
+  }
+
+  void clear() noexcept { m_time += m_cacheSize + 1; }
+
+ private:
+  std::size_t m_cacheSize{};
+  // Starts past the cache size so that no vertex is initially cached
+  std::size_t m_time{m_cacheSize + 1};
+  std::vector<std::size_t> m_timestamps;
+};
+
+// Score tables of Forsyth's algorithm
+struct ScoreTables {
+  std::array<float, forsythCacheSize> cache{};
+  std::array<float, forsythMaxValence> valence{};
+
+  ScoreTables() {
+    for (auto position : iter::range(forsythCacheSize)) {
+      if (position < 3) {
+        // The most recent triangle should not be reused right away
+        cache.at(position) = lastTriangleScore;
+      } else {
+        const auto scale{1.0f / static_cast<float>(forsythCacheSize - 3)};
+        cache.at(position) = std::pow(
+            1.0f - static_cast<float>(position - 3) * scale, cacheDecayPower);
+      }
+    }
+    for (auto valenceIndex : iter::range<std::size_t>(1, forsythMaxValence)) {
+      // Favor vertices with few triangles left, to avoid leaving them behind
+      valence.at(valenceIndex) =
+          valenceBoostScale * std::pow(static_cast<float>(valenceIndex),
+                                       -valenceBoostPower);
+    }
+  }
+
+  [[nodiscard]] float getScore(int cachePosition,
+                               std::uint32_t remaining) const {
+    if (remaining == 0) return -1.0f;
+    const auto cacheScore{
+        cachePosition < 0
+            ? 0.0f
+            : cache.at(static_cast<std::size_t>(cachePosition))};
+    return cacheScore + valence.at(std::min<std::size_t>(
+                            remaining, forsythMaxValence - 1));
+  }
+};
+}  // namespace
+
+/**
+ * @brief Reorders triangles to improve the hit ratio of the post-transform
+ * vertex cache.
+ *
+ * Uses Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+ *
+ * @param indices Triangle list indices, modified in place.
+ * @param numVertices Number of vertices referenced by the indices.
+ */
+void abcg::MeshOptimizer::optimizeVertexCache(std::span<std::uint32_t> indices,
+                                              std::size_t numVertices) {
+  const auto numTriangles{indices.size() / 3};
+  if (numTriangles < 2) return;
+
+  static const ScoreTables tables;
+
+  // Triangles adjacent to each vertex, stored as compressed rows. The first
+  // `remaining[vertex]` entries of a row are the triangles not yet emitted.
+  std::vector<std::uint32_t> remaining(numVertices);
+  for (const auto index : indices) ++remaining[index];
+  std::vector<std::size_t> offsets(numVertices + 1);
+  std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+  std::vector<std::uint32_t> adjacency(indices.size());
+  {
+    auto fill{offsets};
+    for (auto &&[corner, index] : iter::enumerate(indices)) {
+      adjacency[fill[index]++] = static_cast<std::uint32_t>(corner / 3);
+    }
+  }
+
+  std::vector<int> cachePositions(numVertices, -1);
+  std::vector<float> vertexScores(numVertices);
+  for (auto vertex : iter::range(numVertices)) {
+    vertexScores[vertex] = tables.getScore(-1, remaining[vertex]);
+  }
+  auto getTriangleScore{[&](std::size_t triangle) {
+    return vertexScores[indices[triangle * 3 + 0]] +
+           vertexScores[indices[triangle * 3 + 1]] +
+           vertexScores[indices[triangle * 3 + 2]];
+  }};
+
+  // Start with the best triangle overall
+  std::size_t bestTriangle{};
+  for (auto triangle : iter::range<std::size_t>(1, numTriangles)) {
+    if (getTriangleScore(triangle) > getTriangleScore(bestTriangle)) {
+      bestTriangle = triangle;
+    }
+  }
+
+  std::vector<bool> emitted(numTriangles, false);
+  std::vector<std::uint32_t> output;
+  output.reserve(indices.size());
+  std::vector<std::uint32_t> cache;
+  std::vector<std::uint32_t> newCache;
+  cache.reserve(forsythCacheSize + 3);
+  newCache.reserve(forsythCacheSize + 3);
+  std::size_t nextInput{};
+
+  for ([[maybe_unused]] auto step : iter::range(numTriangles)) {
+    if (bestTriangle == numTriangles) {
+      // Dead end: resume with the next triangle in input order
+      while (emitted[nextInput]) ++nextInput;
+      bestTriangle = nextInput;
+    }
+
+    const auto *triangle{&indices[bestTriangle * 3]};
+    output.insert(output.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = true;
+
+    // Remove the triangle from the adjacency of its vertices
+    for (auto corner : iter::range(3)) {
+      const auto vertex{triangle[corner]};
+      auto *row{adjacency.data() + offsets[vertex]};
+      auto *last{row + remaining[vertex] - 1};
+      std::iter_swap(std::find(row, last, bestTriangle), last);
+      --remaining[vertex];
+    }
+
+    // Move the triangle vertices to the front of the LRU cache
+    newCache.assign(triangle, triangle + 3);
+    for (const auto vertex : cache) {
+      if (vertex != triangle[0] && vertex != triangle[1] &&
+          vertex != triangle[2]) {
+        newCache.push_back(vertex);
+      }
+    }
+    for (auto &&[position, vertex] : iter::enumerate(newCache)) {
+      cachePositions[vertex] =
+          position < forsythCacheSize ? static_cast<int>(position) : -1;
+      vertexScores[vertex] =
+          tables.getScore(cachePositions[vertex], remaining[vertex]);
+    }
+    if (newCache.size() > forsythCacheSize) newCache.resize(forsythCacheSize);
+    std::swap(cache, newCache);
+
+    // Pick the best triangle that uses a cached vertex
+    bestTriangle = numTriangles;
+    auto bestScore{std::numeric_limits<float>::lowest()};
+    for (const auto vertex : cache) {
+      for (const auto candidate :
+           std::span{adjacency.data() + offsets[vertex], remaining[vertex]}) {
+        if (const auto score{getTriangleScore(candidate)}; score > bestScore) {
+          bestScore = score;
+          bestTriangle = candidate;
+        }
+      }
+    }
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+/**
+ * @brief Reorders triangles to reduce overdraw.
+ *
+ * The index buffer should already be optimized for the vertex cache. It is
+ * split into clusters wherever the cache is flushed, and clusters are further
+ * split while their cache miss ratio stays within `threshold` times the
+ * original one. Clusters are then sorted front to back from outside the mesh,
+ * so that outer surfaces are drawn first and occlude the inner ones.
+ *
+ * @param indices Triangle list indices, modified in place.
+ * @param positions Vertex positions.
+ * @param threshold Maximum allowed increase of the cache miss ratio.
+ */
+void abcg::MeshOptimizer::optimizeOverdraw(std::span<std::uint32_t> indices,
+                                           std::span<const glm::vec3> positions,
+                                           float threshold) {
+  const auto numTriangles{indices.size() / 3};
+  if (numTriangles < 2) return;
+
+  constexpr std::size_t cacheSize{16};
+  FifoCache cache{positions.size(), cacheSize};
+
+  // Hard boundaries: triangles whose three vertices miss the cache
+  std::vector<std::uint32_t> misses(numTriangles);
+  std::vector<std::size_t> hardClusters;
+  for (auto triangle : iter::range(numTriangles)) {
+    misses[triangle] = cache.accessTriangle(&indices[triangle * 3]);
+    if (triangle == 0 || misses[triangle] == 3) {
+      hardClusters.push_back(triangle);
+    }
+  }
+  hardClusters.push_back(numTriangles);
+
+  // Soft boundaries: end a cluster as soon as its miss ratio, starting from
+  // an empty cache, drops to the threshold
+  std::vector<std::size_t> clusters;
+  for (auto hardCluster : iter::range(hardClusters.size() - 1)) {
+    const auto begin{hardClusters[hardCluster]};
+    const auto end{hardClusters[hardCluster + 1]};
+    const auto clusterMisses{std::accumulate(
+        misses.begin() + static_cast<std::ptrdiff_t>(begin),
+        misses.begin() + static_cast<std::ptrdiff_t>(end), std::uint32_t{})};
+    const auto targetRatio{threshold * static_cast<float>(clusterMisses) /
+                           static_cast<float>(end - begin)};
+
+    cache.clear();
+    clusters.push_back(begin);
+    std::uint32_t softMisses{};
+    std::size_t softSize{};
+    for (auto triangle : iter::range(begin, end)) {
+      softMisses += cache.accessTriangle(&indices[triangle * 3]);
+      ++softSize;
+      if (triangle + 1 < end &&
+          static_cast<float>(softMisses) <=
+              targetRatio * static_cast<float>(softSize)) {
+        cache.clear();
+        clusters.push_back(triangle + 1);
+        softMisses = 0;
+        softSize = 0;
+      }
+    }
+  }
+  clusters.push_back(numTriangles);
+
+  // Area-weighted centroid and normal of each cluster and of the whole mesh
+  const auto numClusters{clusters.size() - 1};
+  std::vector<glm::vec3> centroids(numClusters);
+  std::vector<glm::vec3> normals(numClusters);
+  glm::vec3 meshCentroid{};
+  float meshArea{};
+  for (auto cluster : iter::range(numClusters)) {
+    glm::vec3 centroid{};
+    glm::vec3 normal{};
+    float area{};
+    for (auto triangle :
+         iter::range(clusters[cluster], clusters[cluster + 1])) {
+      const auto &a{positions[indices[triangle * 3 + 0]]};
+      const auto &b{positions[indices[triangle * 3 + 1]]};
+      const auto &c{positions[indices[triangle * 3 + 2]]};
+      const auto faceNormal{glm::cross(b - a, c - a)};
+      const auto faceArea{glm::length(faceNormal)};
+      centroid += (a + b + c) * (faceArea / 3.0f);
+      normal += faceNormal;
+      area += faceArea;
+    }
+    meshCentroid += centroid;
+    meshArea += area;
+    centroids[cluster] = area > 0.0f ? centroid / area : centroid;
+    normals[cluster] = normal;
+  }
+  if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+  std::vector<float> sortKeys(numClusters);
+  for (auto cluster : iter::range(numClusters)) {
+    const auto length{glm::length(normals[cluster])};
+    sortKeys[cluster] =
+        length > 0.0f ? glm::dot(centroids[cluster] - meshCentroid,
+                                 normals[cluster] / length)
+                      : 0.0f;
+  }
+
+  std::vector<std::size_t> order(numClusters);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](auto lhs, auto rhs) {
+    return sortKeys[lhs] > sortKeys[rhs];
+  });
+
+  std::vector<std::uint32_t> output;
+  output.reserve(indices.size());
+  for (const auto cluster : order) {
+    output.insert(
+        output.end(),
+        indices.begin() + static_cast<std::ptrdiff_t>(clusters[cluster] * 3),
+        indices.begin() +
+            static_cast<std::ptrdiff_t>(clusters[cluster + 1] * 3));
+  }
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+/**
+ * @brief Renumbers vertices in order of first use.
+ *
+ * Vertices that are not referenced by any triangle are moved to the end.
+ *
+ * @param indices Triangle list indices, renumbered in place.
+ * @param numVertices Number of vertices.
+ * @return Old index of each vertex in the new order. Vertex attributes must
+ * be permuted accordingly, i.e. newVertices[i] = oldVertices[order[i]].
+ */
+std::vector<std::uint32_t> abcg::MeshOptimizer::optimizeVertexFetch(
+    std::span<std::uint32_t> indices, std::size_t numVertices) {
+  std::vector<std::uint32_t> remap(numVertices, invalidIndex);
+  std::uint32_t nextVertex{};
+  for (auto &index : indices) {
+    if (remap[index] == invalidIndex) remap[index] = nextVertex++;
+    index = remap[index];
+  }
+
+  std::vector<std::uint32_t> order(numVertices);
+  for (auto &&[vertex, newIndex] : iter::enumerate(remap)) {
+    if (newIndex == invalidIndex) newIndex = nextVertex++;
+    order[newIndex] = static_cast<std::uint32_t>(vertex);
+  }
+  return order;
+}
+
+/**
+ * @brief Simulates a FIFO post-transform vertex cache.
+ *
+ * @param indices Triangle list indices.
+ * @param numVertices Number of vertices.
+ * @param cacheSize Number of entries of the simulated cache.
+ * @return Average cache miss ratio and average transform to vertex ratio.
+ */
+abcg::MeshOptimizer::Statistics abcg::MeshOptimizer::analyzeVertexCache(
+    std::span<const std::uint32_t> indices, std::size_t numVertices,
+    std::size_t cacheSize) {
+  const auto numTriangles{indices.size() / 3};
+  if (numTriangles == 0 || numVertices == 0) return {};
+
+  FifoCache cache{numVertices, cacheSize};
+  std::size_t misses{};
+  for (const auto index : indices) {
+    if (cache.access(index)) ++misses;
+  }
+  return {.acmr = static_cast<float>(misses) / static_cast<float>(numTriangles),
+          .atvr = static_cast<float>(misses) / static_cast<float>(numVertices)};
+}
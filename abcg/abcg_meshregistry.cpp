@@ -0,0 +1,98 @@
+/**
+ * @file abcg_meshregistry.cpp
+ * @brief Definition of abcg::MeshRegistry class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshregistry.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+/**
+ * @brief Deletes the buffers of the mesh.
+ *
+ * Buffers that were never created are not deleted, so a mesh can be
+ * released on a thread without an OpenGL context before its upload.
+ */
+abcg::MeshRegistry::Mesh::~Mesh() {
+  if (EBO != 0) glDeleteBuffers(1, &EBO);
+  if (VBO != 0) glDeleteBuffers(1, &VBO);
+}
+
+/**
+ * @brief Returns the registry shared by the whole application.
+ */
+abcg::MeshRegistry &abcg::MeshRegistry::getInstance() {
+  static MeshRegistry registry;
+  return registry;
+}
+
+/**
+ * @brief Makes the key of a mesh.
+ *
+ * The path is made canonical, so different paths to the same file give the
+ * same key.
+ *
+ * @param path Path of the source file.
+ * @param options Caller-defined hash of the options that change the
+ * processed mesh or the layout of its buffers.
+ * @return Key of the mesh.
+ */
+std::string abcg::MeshRegistry::makeKey(std::string_view path,
+                                        std::uint64_t options) {
+  std::error_code error;
+  auto canonicalPath{std::filesystem::weakly_canonical(path, error)};
+  if (error) canonicalPath = path;
+  return fmt::format("{}#{:016x}", canonicalPath.generic_string(), options);
+}
+
+/**
+ * @brief Lists the resident meshes, sorted by key.
+ */
+std::vector<abcg::MeshRegistry::Stats> abcg::MeshRegistry::getStats() {
+  std::scoped_lock lock{m_mutex};
+  removeExpired();
+
+  std::vector<Stats> stats;
+  stats.reserve(m_meshes.size());
+  for (const auto &[key, weakMesh] : m_meshes) {
+    // The mesh may have been released since removeExpired
+    const auto mesh{weakMesh.lock()};
+    if (!mesh) continue;
+    // Do not count the pointer locked here
+    stats.push_back(
+        {key, mesh->vertexBytes, mesh->indexBytes, mesh.use_count() - 1});
+  }
+  std::sort(stats.begin(), stats.end(),
+            [](const auto &lhs, const auto &rhs) { return lhs.key < rhs.key; });
+  return stats;
+}
+
+std::shared_ptr<const abcg::MeshRegistry::Mesh> abcg::MeshRegistry::findMesh(
+    std::string_view key) {
+  std::scoped_lock lock{m_mutex};
+  const auto iter{m_meshes.find(std::string{key})};
+  if (iter == m_meshes.end()) return nullptr;
+  return iter->second.lock();
+}
+
+std::shared_ptr<const abcg::MeshRegistry::Mesh> abcg::MeshRegistry::insertMesh(
+    std::string_view key, std::shared_ptr<const Mesh> mesh) {
+  std::scoped_lock lock{m_mutex};
+  removeExpired();
+
+  auto &entry{m_meshes[std::string{key}]};
+  if (auto resident{entry.lock()}) return resident;
+  entry = mesh;
+  return mesh;
+}
+
+void abcg::MeshRegistry::removeExpired() {
+  std::erase_if(m_meshes,
+                [](const auto &entry) { return entry.second.expired(); });
+}
@@ -0,0 +1,140 @@
+/**
+ * @file abcg_meshregistry.hpp
+ * @brief abcg::MeshRegistry header file.
+ *
+ * Declaration of abcg::MeshRegistry class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHREGISTRY_HPP_
+#define ABCG_MESHREGISTRY_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace abcg {
+class MeshRegistry;
+}  // namespace abcg
+
+/**
+ * @brief abcg::MeshRegistry class.
+ *
+ * Process-wide table of the meshes resident on the GPU, so that a mesh
+ * loaded by several models, windows or examples is processed and uploaded
+ * once.
+ *
+ * Meshes are handed out as shared pointers and the registry only keeps weak
+ * references: the buffers of a mesh are deleted when its last user releases
+ * it. Since the OpenGL contexts of the windows share their objects, a mesh
+ * can be used by any window, but it must be released while one of the
+ * contexts is current.
+ *
+ * The registry can be used from any thread.
+ *
+ */
+class abcg::MeshRegistry {
+ public:
+  /**
+   * @brief Vertex and index buffers of a registered mesh.
+   *
+   * Derive from this class to keep with the buffers the data needed to draw
+   * the mesh (ranges, bounds, materials...).
+   */
+  class Mesh {
+   public:
+    Mesh() = default;
+    virtual ~Mesh();
+
+    Mesh(const Mesh &) = delete;
+    Mesh(Mesh &&) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh &operator=(Mesh &&) = delete;
+
+    GLuint VBO{};
+    GLuint EBO{};
+    std::size_t vertexBytes{};
+    std::size_t indexBytes{};
+  };
+
+  /**
+   * @brief Description of a resident mesh.
+   */
+  struct Stats {
+    std::string key;
+    std::size_t vertexBytes{};
+    std::size_t indexBytes{};
+    /** @brief Number of shared pointers to the mesh. */
+    long useCount{};
+  };
+
+  MeshRegistry(const MeshRegistry &) = delete;
+  MeshRegistry(MeshRegistry &&) = delete;
+  MeshRegistry &operator=(const MeshRegistry &) = delete;
+  MeshRegistry &operator=(MeshRegistry &&) = delete;
+
+  [[nodiscard]] static MeshRegistry &getInstance();
+
+  [[nodiscard]] static std::string makeKey(std::string_view path,
+                                           std::uint64_t options);
+
+  template <typename T>
+  [[nodiscard]] std::shared_ptr<const T> find(std::string_view key);
+  template <typename T>
+  std::shared_ptr<const T> insert(std::string_view key,
+                                  std::shared_ptr<const T> mesh);
+
+  [[nodiscard]] std::vector<Stats> getStats();
+
+ private:
+  MeshRegistry() = default;
+
+  std::shared_ptr<const Mesh> findMesh(std::string_view key);
+  std::shared_ptr<const Mesh> insertMesh(std::string_view key,
+                                         std::shared_ptr<const Mesh> mesh);
+  void removeExpired();
+
+  std::unordered_map<std::string, std::weak_ptr<const Mesh>> m_meshes;
+  std::mutex m_mutex;
+};
+
+/**
+ * @brief Returns the mesh registered with a key.
+ *
+ * @tparam T Type of the mesh, derived from abcg::MeshRegistry::Mesh.
+ * @param key Key made by makeKey.
+ * @return Mesh, or a null pointer if no mesh of type T is resident with that
+ * key.
+ */
+template <typename T>
+std::shared_ptr<const T> abcg::MeshRegistry::find(std::string_view key) {
+  return std::dynamic_pointer_cast<const T>(findMesh(key));
+}
+
+/**
+ * @brief Registers an uploaded mesh.
+ *
+ * If a mesh is already resident with the same key (e.g. two models loaded
+ * the same file at the same time), that mesh is returned instead and the
+ * given one is left to be released by the caller.
+ *
+ * @tparam T Type of the mesh, derived from abcg::MeshRegistry::Mesh.
+ * @param key Key made by makeKey.
+ * @param mesh Mesh with its buffers filled.
+ * @return Mesh to use.
+ */
+template <typename T>
+std::shared_ptr<const T> abcg::MeshRegistry::insert(
+    std::string_view key, std::shared_ptr<const T> mesh) {
+  auto resident{std::dynamic_pointer_cast<const T>(insertMesh(key, mesh))};
+  return resident ? resident : mesh;
+}
+
+#endif
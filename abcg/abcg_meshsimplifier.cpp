@@ -0,0 +1,550 @@
+/**
+ * @file abcg_meshsimplifier.cpp
+ * @brief Definition of abcg::MeshSimplifier class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshsimplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#include "abcg_exception.hpp"
+#include "abcg_tangentspace.hpp"
+#include "abcg_vertexwelder.hpp"
+
+namespace {
+// Collapses that rotate a face normal by more than ~80 degrees are rejected
+constexpr float minNormalCosine{0.2f};
+
+// Area-weighted sum of squared distances to a set of planes
+class Quadric {
+ public:
+  void addPlane(const glm::vec3 &normal, float distance, float weight) {
+    const glm::dvec4 plane{normal, distance};
+    const auto planeWeight{static_cast<double>(weight)};
+    for (auto row : iter::range(4)) {
+      for (auto column : iter::range(row, 4)) {
+        m_terms[getTerm(row, column)] +=
+            planeWeight * plane[row] * plane[column];
+      }
+    }
+    m_weight += planeWeight;
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    for (auto term : iter::range(m_terms.size())) {
+      m_terms[term] += other.m_terms[term];
+    }
+    m_weight += other.m_weight;
+    return *this;
+  }
+
+  // Mean squared distance of a point to the planes
+  [[nodiscard]] double evaluate(const glm::vec3 &point) const {
+    if (m_weight <= 0.0) return 0.0;
+    const glm::dvec4 p{point, 1.0};
+    double sum{};
+    for (auto row : iter::range(4)) {
+      sum += m_terms[getTerm(row, row)] * p[row] * p[row];
+      for (auto column : iter::range(row + 1, 4)) {
+        sum += 2.0 * m_terms[getTerm(row, column)] * p[row] * p[column];
+      }
+    }
+    return std::max(sum, 0.0) / m_weight;
+  }
+
+ private:
+  // Upper triangle of the symmetric 4x4 matrix, row by row
+  std::array<double, 10> m_terms{};
+  double m_weight{};
+
+  static std::size_t getTerm(int row, int column) {
+    return static_cast<std::size_t>(row * 4 - row * (row - 1) / 2 +
+                                    (column - row));
+  }
+};
+
+// Collapse of a position onto an adjacent one. Every vertex at the source
+// position is collapsed onto a vertex at the target position.
+struct Collapse {
+  std::uint32_t source{};
+  std::uint32_t target{};
+  double cost{};
+};
+
+constexpr auto noVertex{std::numeric_limits<std::uint32_t>::max()};
+
+// Vertices at each position, in compressed sparse row form
+struct Copies {
+  std::vector<std::uint32_t> offsets;
+  std::vector<std::uint32_t> vertices;
+};
+
+Copies findCopies(std::span<const std::uint32_t> groups,
+                  std::size_t numGroups) {
+  Copies copies;
+  copies.offsets.resize(numGroups + 1);
+  for (const auto group : groups) {
+    ++copies.offsets[group + 1];
+  }
+  std::partial_sum(copies.offsets.begin(), copies.offsets.end(),
+                   copies.offsets.begin());
+  copies.vertices.resize(groups.size());
+  auto next{copies.offsets};
+  for (auto &&[vertex, group] : iter::enumerate(groups)) {
+    copies.vertices[next[group]++] = static_cast<std::uint32_t>(vertex);
+  }
+  return copies;
+}
+
+// Calls function with each face around a position
+template <typename Function>
+void forEachFace(std::uint32_t group, std::span<const std::uint32_t> indices,
+                 const abcg::TangentSpace::Adjacency &adjacency,
+                 const Copies &copies, Function &&function) {
+  for (auto copy :
+       iter::range(copies.offsets[group], copies.offsets[group + 1])) {
+    const auto vertex{copies.vertices[copy]};
+    for (auto position : iter::range(adjacency.offsets[vertex],
+                                     adjacency.offsets[vertex + 1])) {
+      function(&indices[adjacency.faces[position] * 3]);
+    }
+  }
+}
+
+// Pairs each vertex at the source position with the vertex at the target
+// position it shares faces with, so that the faces of each vertex keep
+// their attributes. Fails if a vertex shares faces with none or several of
+// the target vertices, or if two vertices would be collapsed onto the same
+// one, i.e. if the edge crosses a seam instead of following it.
+bool pairCopies(const Collapse &collapse,
+                std::span<const std::uint32_t> indices,
+                std::span<const std::uint32_t> groups,
+                const abcg::TangentSpace::Adjacency &adjacency,
+                const Copies &copies,
+                std::vector<std::pair<std::uint32_t, std::uint32_t>> &pairs) {
+  pairs.clear();
+  for (auto copy : iter::range(copies.offsets[collapse.source],
+                               copies.offsets[collapse.source + 1])) {
+    const auto vertex{copies.vertices[copy]};
+    // Vertices removed by earlier collapses have no faces
+    if (adjacency.offsets[vertex] == adjacency.offsets[vertex + 1]) continue;
+
+    auto match{noVertex};
+    for (auto position : iter::range(adjacency.offsets[vertex],
+                                     adjacency.offsets[vertex + 1])) {
+      const auto *face{&indices[adjacency.faces[position] * 3]};
+      for (auto corner : iter::range(3)) {
+        if (groups[face[corner]] != collapse.target) continue;
+        if (match != noVertex && match != face[corner]) return false;
+        match = face[corner];
+      }
+    }
+    if (match == noVertex ||
+        std::any_of(pairs.begin(), pairs.end(),
+                    [&](const auto &pair) { return pair.second == match; })) {
+      return false;
+    }
+    pairs.emplace_back(vertex, match);
+  }
+  return !pairs.empty();
+}
+
+glm::vec3 getFaceNormal(const glm::vec3 &a, const glm::vec3 &b,
+                        const glm::vec3 &c) {
+  return glm::cross(b - a, c - a);
+}
+
+// Positions on an open border or on a non-manifold edge. Their vertices are
+// never removed.
+std::vector<char> findLockedGroups(std::span<const std::uint32_t> indices,
+                                   std::span<const std::uint32_t> groups,
+                                   std::size_t numGroups) {
+  // Count the faces of each edge between positions
+  std::vector<std::uint64_t> edges;
+  edges.reserve(indices.size());
+  for (auto corner : iter::range(indices.size())) {
+    const auto next{corner - corner % 3 + (corner + 1) % 3};
+    const auto first{groups[indices[corner]]};
+    const auto second{groups[indices[next]]};
+    if (first == second) continue;
+    edges.push_back(std::uint64_t{std::min(first, second)} << 32 |
+                    std::max(first, second));
+  }
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<char> isGroupLocked(numGroups);
+  for (std::size_t begin{}; begin < edges.size();) {
+    auto end{begin + 1};
+    while (end < edges.size() && edges[end] == edges[begin]) ++end;
+    if (end - begin != 2) {
+      // Open border or non-manifold edge
+      isGroupLocked[edges[begin] >> 32] = 1;
+      isGroupLocked[edges[begin] & 0xffffffffU] = 1;
+    }
+    begin = end;
+  }
+  return isGroupLocked;
+}
+
+// Marks of positions for the link condition check, reused across collapses
+struct Neighborhood {
+  std::vector<std::uint32_t> marks;
+  std::uint32_t stamp{};
+};
+
+// Checks the link condition: the only positions adjacent to both ends of the
+// edge are the opposite corners of the faces of the edge. Otherwise the
+// collapse would make an edge shared by more than two faces.
+bool isLinkConditionMet(const Collapse &collapse,
+                        std::span<const std::uint32_t> indices,
+                        std::span<const std::uint32_t> groups,
+                        const abcg::TangentSpace::Adjacency &adjacency,
+                        const Copies &copies, Neighborhood &neighborhood) {
+  auto &marks{neighborhood.marks};
+  if (neighborhood.stamp > std::numeric_limits<std::uint32_t>::max() - 3) {
+    std::fill(marks.begin(), marks.end(), 0);
+    neighborhood.stamp = 0;
+  }
+  const auto sourceMark{++neighborhood.stamp};
+  const auto commonMark{++neighborhood.stamp};
+  const auto oppositeMark{++neighborhood.stamp};
+
+  const auto source{collapse.source};
+  const auto target{collapse.target};
+
+  // Positions adjacent to the source
+  forEachFace(source, indices, adjacency, copies, [&](const auto *face) {
+    for (auto corner : iter::range(3)) {
+      const auto group{groups[face[corner]]};
+      if (group != source) marks[group] = sourceMark;
+    }
+  });
+
+  // Positions adjacent to both ends
+  std::size_t numCommon{};
+  forEachFace(target, indices, adjacency, copies, [&](const auto *face) {
+    for (auto corner : iter::range(3)) {
+      const auto group{groups[face[corner]]};
+      if (group != target && marks[group] == sourceMark) {
+        marks[group] = commonMark;
+        ++numCommon;
+      }
+    }
+  });
+
+  // Opposite corners of the faces of the edge
+  std::size_t numOpposite{};
+  forEachFace(source, indices, adjacency, copies, [&](const auto *face) {
+    if (groups[face[0]] != target && groups[face[1]] != target &&
+        groups[face[2]] != target) {
+      return;
+    }
+    for (auto corner : iter::range(3)) {
+      const auto group{groups[face[corner]]};
+      if (marks[group] == commonMark) {
+        marks[group] = oppositeMark;
+        ++numOpposite;
+      }
+    }
+  });
+  return numCommon == numOpposite;
+}
+
+// Checks that no face around the removed vertices flips or degenerates, and
+// that the mesh stays manifold
+bool isCollapseValid(
+    const Collapse &collapse,
+    std::span<const std::pair<std::uint32_t, std::uint32_t>> pairs,
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions,
+    std::span<const std::uint32_t> groups,
+    const abcg::TangentSpace::Adjacency &adjacency, const Copies &copies,
+    Neighborhood &neighborhood) {
+  for (const auto &[vertex, target] : pairs) {
+    for (auto position : iter::range(adjacency.offsets[vertex],
+                                     adjacency.offsets[vertex + 1])) {
+      const auto *face{&indices[adjacency.faces[position] * 3]};
+      if (face[0] == target || face[1] == target || face[2] == target) {
+        // Removed by the collapse
+        continue;
+      }
+
+      std::array<glm::vec3, 3> corners{positions[face[0]], positions[face[1]],
+                                       positions[face[2]]};
+      const auto before{getFaceNormal(corners[0], corners[1], corners[2])};
+      for (auto corner : iter::range(corners.size())) {
+        if (face[corner] == vertex) corners[corner] = positions[target];
+      }
+      const auto after{getFaceNormal(corners[0], corners[1], corners[2])};
+
+      const auto lengths{glm::length(before) * glm::length(after)};
+      if (lengths <= 0.0f ||
+          glm::dot(before, after) < minNormalCosine * lengths) {
+        return false;
+      }
+    }
+  }
+  return isLinkConditionMet(collapse, indices, groups, adjacency, copies,
+                            neighborhood);
+}
+
+// Numbers the distinct values in increasing order, and stores them in
+// `distinct`. A table over the range of the values is used, which is small
+// for the index buffer of a submesh, as its vertices are stored together.
+std::vector<std::uint32_t> renumber(std::span<const std::uint32_t> values,
+                                    std::vector<std::uint32_t> &distinct) {
+  distinct.clear();
+  if (values.empty()) return {};
+
+  const auto [min, max]{std::minmax_element(values.begin(), values.end())};
+  const auto first{*min};
+  std::vector<std::uint32_t> numbers(std::size_t{*max} - first + 1);
+  for (const auto value : values) {
+    numbers[value - first] = 1;
+  }
+  for (auto &&[offset, number] : iter::enumerate(numbers)) {
+    if (number == 0) continue;
+    number = static_cast<std::uint32_t>(distinct.size());
+    distinct.push_back(first + static_cast<std::uint32_t>(offset));
+  }
+
+  std::vector<std::uint32_t> renumbered(values.size());
+  for (auto &&[newValue, value] : iter::zip(renumbered, values)) {
+    newValue = numbers[value - first];
+  }
+  return renumbered;
+}
+}  // namespace
+
+/**
+ * @brief Constructs a simplifier for a vertex buffer, welding its positions.
+ *
+ * @param positions Vertex positions. They are not copied and must outlive
+ * the simplifier.
+ */
+abcg::MeshSimplifier::MeshSimplifier(std::span<const glm::vec3> positions)
+    : m_positions{positions} {
+  if (positions.empty()) return;
+
+  // Group vertices with the same position
+  auto welded{VertexWelder::weld(
+      std::span{&positions.front().x, positions.size() * 3}, 3)};
+  m_groups = std::move(welded.indices);
+}
+
+/**
+ * @brief Simplifies an indexed triangle list of the vertex buffer.
+ *
+ * Collapses are done in passes of increasing cost. Each pass collapses at
+ * most one edge per neighborhood, so the checks for flipped faces stay
+ * valid, and the mesh is compacted after each pass. The vertices of the
+ * index buffer are numbered locally first, so the work done depends on the
+ * size of the index buffer and not on the size of the vertex buffer.
+ *
+ * @param indices Index buffer with three indices per triangle.
+ * @param targetIndexCount Number of indices at which to stop.
+ * @param maxError Largest distance allowed between the simplified and input
+ * surfaces.
+ * @return Simplified index buffer, with at least `targetIndexCount` indices
+ * unless a collapse removes more than one triangle, and its error.
+ *
+ * @throw abcg::Exception if the number of indices is not a multiple of 3 or
+ * if an index is out of bounds.
+ */
+abcg::MeshSimplifier::Result abcg::MeshSimplifier::simplify(
+    std::span<const std::uint32_t> indices, std::size_t targetIndexCount,
+    float maxError) const {
+  if (indices.size() % 3 != 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Number of indices is not a multiple of 3")};
+  }
+
+  // Vertices of the index buffer, in increasing order, and the indices of
+  // the buffer into them
+  std::vector<std::uint32_t> vertices;
+  auto localIndices{renumber(indices, vertices)};
+  if (!vertices.empty() && vertices.back() >= m_positions.size()) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Vertex index out of bounds")};
+  }
+
+  Result result;
+  result.indices.assign(indices.begin(), indices.end());
+  if (indices.size() <= targetIndexCount) return result;
+
+  // Attributes of the vertices, with their welded positions numbered
+  // locally as well
+  const auto numVertices{vertices.size()};
+  std::vector<glm::vec3> positions(numVertices);
+  std::vector<std::uint32_t> globalGroups(numVertices);
+  for (auto &&[vertex, globalVertex] : iter::enumerate(vertices)) {
+    positions[vertex] = m_positions[globalVertex];
+    globalGroups[vertex] = m_groups[globalVertex];
+  }
+  std::vector<std::uint32_t> groupIDs;
+  const auto groups{renumber(globalGroups, groupIDs)};
+  const auto numGroups{groupIDs.size()};
+  const auto copies{findCopies(groups, numGroups)};
+
+  // Positions on borders are kept
+  const auto isGroupLocked{findLockedGroups(localIndices, groups, numGroups)};
+
+  // Quadrics of the planes of the faces around each position
+  std::vector<Quadric> quadrics(numGroups);
+  for (auto face : iter::range(localIndices.size() / 3)) {
+    const auto *corners{&localIndices[face * 3]};
+    const auto &a{positions[corners[0]]};
+    const auto normal{
+        getFaceNormal(a, positions[corners[1]], positions[corners[2]])};
+    const auto length{glm::length(normal)};
+    if (length <= 0.0f) continue;
+
+    const auto unitNormal{normal / length};
+    for (auto corner : iter::range(3)) {
+      quadrics[groups[corners[corner]]].addPlane(
+          unitNormal, -glm::dot(unitNormal, a), length * 0.5f);
+    }
+  }
+
+  const auto maxCost{static_cast<double>(maxError) *
+                     static_cast<double>(maxError)};
+  double largestCost{};
+  auto adjacency{TangentSpace::buildAdjacency(localIndices, numVertices)};
+  std::vector<Collapse> collapses;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> pairs;
+  std::vector<char> isLocked(numGroups);
+  std::vector<std::uint32_t> remap(numVertices);
+  Neighborhood neighborhood{std::vector<std::uint32_t>(numGroups)};
+
+  while (localIndices.size() > targetIndexCount) {
+    // Cheapest collapse of each removable position that follows the seams
+    collapses.assign(numGroups,
+                     {0, 0, std::numeric_limits<double>::infinity()});
+    for (auto corner : iter::range(localIndices.size())) {
+      const auto next{corner - corner % 3 + (corner + 1) % 3};
+      for (auto &&[source, target] :
+           {std::pair{localIndices[corner], localIndices[next]},
+            std::pair{localIndices[next], localIndices[corner]}}) {
+        const auto sourceGroup{groups[source]};
+        const auto targetGroup{groups[target]};
+        if (isGroupLocked[sourceGroup] != 0 || sourceGroup == targetGroup) {
+          continue;
+        }
+        const Collapse collapse{
+            sourceGroup, targetGroup,
+            quadrics[sourceGroup].evaluate(positions[target])};
+        if (!(collapse.cost < collapses[sourceGroup].cost)) continue;
+        // Seams are checked here so that a collapse along the seam is kept
+        // over a cheaper one across it. Other positions are checked with
+        // the rest of the collapse.
+        const auto numCopies{copies.offsets[sourceGroup + 1] -
+                             copies.offsets[sourceGroup]};
+        if (numCopies > 1 && !pairCopies(collapse, localIndices, groups,
+                                         adjacency, copies, pairs)) {
+          continue;
+        }
+        collapses[sourceGroup] = collapse;
+      }
+    }
+    std::erase_if(collapses, [&](const Collapse &collapse) {
+      return !(collapse.cost <= maxCost);
+    });
+    std::sort(collapses.begin(), collapses.end(),
+              [](const auto &lhs, const auto &rhs) {
+                return lhs.cost < rhs.cost;
+              });
+
+    // Collapse in order of cost, one per neighborhood
+    const auto facesToRemove{(localIndices.size() - targetIndexCount) / 3};
+    std::size_t removedFaces{};
+    std::size_t numCollapses{};
+    std::fill(isLocked.begin(), isLocked.end(), 0);
+    std::iota(remap.begin(), remap.end(), 0U);
+    for (const auto &collapse : collapses) {
+      if (removedFaces >= facesToRemove) break;
+      if (isLocked[collapse.source] != 0 || isLocked[collapse.target] != 0) {
+        continue;
+      }
+      if (!pairCopies(collapse, localIndices, groups, adjacency, copies,
+                      pairs) ||
+          !isCollapseValid(collapse, pairs, localIndices, positions, groups,
+                           adjacency, copies, neighborhood)) {
+        continue;
+      }
+
+      forEachFace(collapse.source, localIndices, adjacency, copies,
+                  [&](const auto *face) {
+                    for (auto corner : iter::range(3)) {
+                      isLocked[groups[face[corner]]] = 1;
+                    }
+                    if (groups[face[0]] == collapse.target ||
+                        groups[face[1]] == collapse.target ||
+                        groups[face[2]] == collapse.target) {
+                      ++removedFaces;
+                    }
+                  });
+      for (const auto &[vertex, target] : pairs) {
+        remap[vertex] = target;
+      }
+      quadrics[collapse.target] += quadrics[collapse.source];
+      largestCost = std::max(largestCost, collapse.cost);
+      ++numCollapses;
+    }
+    if (numCollapses == 0) break;
+
+    // Apply the collapses and remove degenerate faces
+    std::size_t size{};
+    for (auto face : iter::range(localIndices.size() / 3)) {
+      const auto a{remap[localIndices[face * 3 + 0]]};
+      const auto b{remap[localIndices[face * 3 + 1]]};
+      const auto c{remap[localIndices[face * 3 + 2]]};
+      if (a == b || b == c || c == a) continue;
+      localIndices[size++] = a;
+      localIndices[size++] = b;
+      localIndices[size++] = c;
+    }
+    localIndices.resize(size);
+    adjacency = TangentSpace::buildAdjacency(localIndices, numVertices);
+  }
+
+  result.indices.resize(localIndices.size());
+  for (auto &&[index, localIndex] : iter::zip(result.indices, localIndices)) {
+    index = vertices[localIndex];
+  }
+  result.error = static_cast<float>(std::sqrt(largestCost));
+  return result;
+}
+
+/**
+ * @brief Simplifies an indexed triangle list.
+ *
+ * Welds the positions on each call. To simplify several index buffers of
+ * the same vertices, construct a simplifier once and call its simplify
+ * member function instead.
+ *
+ * @param indices Index buffer with three indices per triangle.
+ * @param positions Vertex positions.
+ * @param targetIndexCount Number of indices at which to stop.
+ * @param maxError Largest distance allowed between the simplified and input
+ * surfaces.
+ * @return Simplified index buffer and its error.
+ *
+ * @throw abcg::Exception if the number of indices is not a multiple of 3 or
+ * if an index is out of bounds.
+ */
+abcg::MeshSimplifier::Result abcg::MeshSimplifier::simplify(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions, std::size_t targetIndexCount,
+    float maxError) {
+  return MeshSimplifier{positions}.simplify(indices, targetIndexCount,
+                                            maxError);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file abcg_meshsimplifier.hpp
+ * @brief abcg::MeshSimplifier header file.
+ *
+ * Declaration of abcg::MeshSimplifier class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHSIMPLIFIER_HPP_
+#define ABCG_MESHSIMPLIFIER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+namespace abcg {
+class MeshSimplifier;
+}  // namespace abcg
+
+/**
+ * @brief abcg::MeshSimplifier class.
+ *
+ * Reduces the triangle count of an indexed triangle list with quadric error
+ * metrics (Garland and Heckbert). Edges are collapsed onto one of their
+ * endpoints, so the simplified index buffer refers to the original vertices
+ * and every level of detail can share the same vertex buffer.
+ *
+ * Edges are collapsed position by position. Vertices that share a position
+ * (seams of normals or texture coordinates) are collapsed together, each
+ * onto the vertex at the target position it shares faces with, so a seam
+ * can only be collapsed along itself and keeps its attributes on both sides.
+ * Vertices on open borders are never removed, so silhouettes of open meshes
+ * are preserved. Collapses that would make an edge shared by more than two
+ * faces are rejected.
+ *
+ * The positions are welded once, when the simplifier is constructed, and
+ * each call to simplify only works on the vertices of its index buffer. The
+ * same simplifier can thus simplify every submesh and every level of detail
+ * of a mesh.
+ *
+ */
+class abcg::MeshSimplifier {
+ public:
+  /**
+   * @brief Result of a simplification.
+   */
+  struct Result {
+    /** @brief Index buffer of the simplified mesh. */
+    std::vector<std::uint32_t> indices;
+    /** @brief Largest distance between the simplified and input surfaces,
+     * estimated from the quadrics, in the units of the positions. */
+    float error{};
+  };
+
+  explicit MeshSimplifier(std::span<const glm::vec3> positions);
+
+  [[nodiscard]] Result simplify(std::span<const std::uint32_t> indices,
+                                std::size_t targetIndexCount,
+                                float maxError) const;
+
+  [[nodiscard]] static Result simplify(std::span<const std::uint32_t> indices,
+                                       std::span<const glm::vec3> positions,
+                                       std::size_t targetIndexCount,
+                                       float maxError);
+
+ private:
+  // Positions of the vertices, owned by the caller
+  std::span<const glm::vec3> m_positions;
+  // Welded position of each vertex
+  std::vector<std::uint32_t> m_groups;
+};
+
+#endif
@@ -0,0 +1,545 @@
+/**
+ * @file abcg_mipstreamer.cpp
+ * @brief Definition of abcg::MipStreamer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_mipstreamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Levels up to this width and height are always resident
+constexpr int tailSize{64};
+
+// Pixel buffers of the upload ring, and the size of each. Buffers grow to
+// hold at least one row, or one compressed level.
+constexpr std::size_t numBuffers{3};
+constexpr std::size_t bufferSize{std::size_t{256} * 1024};
+
+int getLevelSize(int size, int level) { return std::max(size >> level, 1); }
+
+// Averages 2x2 blocks of an image into the next mipmap level. The last row
+// and column of odd sizes are clamped.
+abcg::opengl::Image downsample(const abcg::opengl::Image &image) {
+  abcg::opengl::Image level;
+  level.width = std::max(image.width / 2, 1);
+  level.height = std::max(image.height / 2, 1);
+  level.format = image.format;
+  level.pixels.resize(level.getRowSize() *
+                      static_cast<std::size_t>(level.height));
+
+  const std::size_t channels{image.format == GL_RGBA ? 4U : 3U};
+  const auto width{static_cast<std::size_t>(image.width)};
+  const auto rowSize{image.getRowSize()};
+  auto *target{level.pixels.data()};
+  for (auto row : iter::range(level.height)) {
+    const auto *row0{image.pixels.data() +
+                     rowSize * static_cast<std::size_t>(
+                                   std::min(row * 2, image.height - 1))};
+    const auto *row1{image.pixels.data() +
+                     rowSize * static_cast<std::size_t>(
+                                   std::min(row * 2 + 1, image.height - 1))};
+    for (auto column : iter::range(static_cast<std::size_t>(level.width))) {
+      const auto left{std::min(column * 2, width - 1) * channels};
+      const auto right{std::min(column * 2 + 1, width - 1) * channels};
+      for (auto channel : iter::range(channels)) {
+        const auto sum{std::to_integer<unsigned>(row0[left + channel]) +
+                       std::to_integer<unsigned>(row0[right + channel]) +
+                       std::to_integer<unsigned>(row1[left + channel]) +
+                       std::to_integer<unsigned>(row1[right + channel])};
+        *target++ = static_cast<std::byte>((sum + 2) / 4);
+      }
+    }
+  }
+  return level;
+}
+
+// Defines a level of the bound texture with the given content, or without
+// content if pixels is null
+void defineLevel(const abcg::MipStreamer::MipChain &chain, int level,
+                 const std::byte *pixels) {
+  const auto width{getLevelSize(chain.width, level)};
+  const auto height{getLevelSize(chain.height, level)};
+  if (chain.isCompressed) {
+    const auto &data{chain.levels.at(static_cast<std::size_t>(level))};
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, chain.format, width, height,
+                           0, static_cast<GLsizei>(data.size()), data.data());
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(chain.format), width,
+                 height, 0, chain.format, GL_UNSIGNED_BYTE, pixels);
+  }
+}
+
+// Redefines a level of the bound texture with zero size, so that the driver
+// can release its memory
+void releaseLevel(const abcg::MipStreamer::MipChain &chain, int level) {
+  if (chain.isCompressed) {
+    // Zero bytes, but not a null pointer, which WebGL rejects
+    const auto &data{chain.levels.at(static_cast<std::size_t>(level))};
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, chain.format, 0, 0, 0, 0,
+                           data.data());
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, level, static_cast<GLint>(chain.format), 0, 0,
+                 0, chain.format, GL_UNSIGNED_BYTE, nullptr);
+  }
+}
+}  // namespace
+
+/**
+ * @brief Returns the streamer shared by the whole application.
+ *
+ * The streamer is never destroyed, so that no texture is deleted after the
+ * OpenGL contexts are gone.
+ */
+abcg::MipStreamer &abcg::MipStreamer::getInstance() {
+  static auto *streamer{new MipStreamer};  // NOLINT
+  return *streamer;
+}
+
+/**
+ * @brief Computes the mipmap levels of an image by averaging 2x2 blocks.
+ *
+ * This function makes no OpenGL calls.
+ *
+ * @param image Image of the full-size level.
+ * @return Levels of the image.
+ */
+abcg::MipStreamer::MipChain abcg::MipStreamer::makeMipChain(
+    opengl::Image image) {
+  MipChain chain;
+  chain.width = image.width;
+  chain.height = image.height;
+  chain.format = image.format;
+  while (true) {
+    const auto isLast{image.width == 1 && image.height == 1};
+    auto next{isLast ? opengl::Image{} : downsample(image)};
+    chain.levels.push_back(std::move(image.pixels));
+    if (isLast) break;
+    image = std::move(next);
+  }
+  return chain;
+}
+
+/**
+ * @brief Takes the levels of a compressed image.
+ *
+ * This function makes no OpenGL calls.
+ *
+ * @param image Compressed image with its mipmap levels.
+ * @return Levels of the image.
+ */
+abcg::MipStreamer::MipChain abcg::MipStreamer::makeMipChain(
+    opengl::CompressedImage image) {
+  MipChain chain;
+  chain.width = image.width;
+  chain.height = image.height;
+  chain.format = opengl::getCompressedInternalFormat(image.format);
+  chain.isCompressed = true;
+  chain.levels = std::move(image.levels);
+  return chain;
+}
+
+/**
+ * @brief Returns the number of bytes of every level of a mip chain.
+ */
+std::size_t abcg::MipStreamer::getBytes(const MipChain &chain) noexcept {
+  std::size_t bytes{};
+  for (const auto &level : chain.levels) {
+    bytes += level.size();
+  }
+  return bytes;
+}
+
+/**
+ * @brief Creates a texture with the coarsest levels of a mip chain.
+ *
+ * The finer levels are uploaded by update once requested.
+ *
+ * @param chain Levels of the texture.
+ * @return Texture ID. Call remove before deleting the texture.
+ *
+ * @throw abcg::Exception if the chain has no levels.
+ */
+GLuint abcg::MipStreamer::create(MipChain chain) {
+  if (chain.levels.empty()) {
+    throw abcg::Exception{abcg::Exception::Runtime("Mip chain has no levels")};
+  }
+
+  Texture texture;
+  texture.chain = std::move(chain);
+  const auto numLevels{static_cast<int>(texture.chain.levels.size())};
+  texture.tailLevel = numLevels - 1;
+  while (texture.tailLevel > 0 &&
+         getLevelSize(texture.chain.width, texture.tailLevel - 1) <=
+             tailSize &&
+         getLevelSize(texture.chain.height, texture.tailLevel - 1) <=
+             tailSize) {
+    --texture.tailLevel;
+  }
+  texture.residentLevel = texture.tailLevel;
+  texture.wantedLevel = texture.tailLevel;
+  texture.requestedLevel = texture.tailLevel;
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (auto level : iter::range(texture.tailLevel, numLevels)) {
+    const auto &data{texture.chain.levels.at(static_cast<std::size_t>(level))};
+    defineLevel(texture.chain, level, data.data());
+    texture.bytes += data.size();
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  // Sample the resident levels only
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.tailLevel);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, numLevels - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  m_residentBytes += texture.bytes;
+  m_textures.emplace(textureID, std::move(texture));
+  return textureID;
+}
+
+/**
+ * @brief Stops managing a texture, before it is deleted.
+ *
+ * Does nothing if the texture was not created by the streamer.
+ *
+ * @param textureID Texture ID returned by create.
+ */
+void abcg::MipStreamer::remove(GLuint textureID) {
+  const auto textureIter{m_textures.find(textureID)};
+  if (textureIter == m_textures.end()) return;
+
+  m_residentBytes -= textureIter->second.bytes;
+  if (m_loading == textureID) m_loading = 0;
+  m_textures.erase(textureIter);
+}
+
+/**
+ * @brief Requests the levels of a texture needed to draw it this frame.
+ *
+ * The finest level needed has about one texel per pixel. A texture
+ * requested several times in a frame gets the finest of the levels
+ * requested.
+ *
+ * @param textureID Texture ID returned by create. Other textures are
+ * ignored.
+ * @param screenSize Size on screen, in pixels, of the whole texture (e.g.
+ * the projected size of an object whose texture coordinates span [0, 1]).
+ */
+void abcg::MipStreamer::request(GLuint textureID, float screenSize) {
+  const auto textureIter{m_textures.find(textureID)};
+  if (textureIter == m_textures.end()) return;
+
+  auto &texture{textureIter->second};
+  auto level{texture.tailLevel};
+  if (screenSize > 0.0f) {
+    const auto size{static_cast<float>(
+        std::max(texture.chain.width, texture.chain.height))};
+    level = static_cast<int>(
+        std::clamp(std::floor(std::log2(size / screenSize)), 0.0f,
+                   static_cast<float>(texture.tailLevel)));
+  }
+  texture.requestedLevel = std::min(texture.requestedLevel, level);
+  texture.lastRequest = m_frame;
+}
+
+/**
+ * @brief Uploads the levels requested since the last call, releasing
+ * levels as needed to stay within the budget.
+ *
+ * Call once per frame, after the frame's requests. Levels are uploaded in
+ * bands of rows (compressed levels at once), and sampled once complete.
+ * The function never waits for the GPU: it returns early when the next
+ * pixel buffer of the ring is still being read.
+ *
+ * @param maxBytes Maximum number of bytes to upload in this call.
+ * @return Whether every requested level is resident.
+ */
+bool abcg::MipStreamer::update(std::size_t maxBytes) {
+  // Textures not drawn since the last update keep the level they had, until
+  // their levels are released for other textures
+  for (auto &[textureID, texture] : m_textures) {
+    if (texture.lastRequest == m_frame) {
+      texture.wantedLevel = texture.requestedLevel;
+    }
+    texture.requestedLevel = texture.tailLevel;
+  }
+  while (m_residentBytes > m_budget && evictFor(nullptr, m_loading)) {
+  }
+
+  auto budget{maxBytes};
+  while (budget > 0) {
+    if (m_loading == 0) {
+      const auto textureID{pickLoad()};
+      if (textureID == 0) break;
+
+      // Make room for the level, if textures less needed can give it
+      auto &texture{m_textures.at(textureID)};
+      const auto levelBytes{
+          texture.chain.levels
+              .at(static_cast<std::size_t>(texture.residentLevel - 1))
+              .size()};
+      while (m_residentBytes + levelBytes > m_budget &&
+             evictFor(&texture, textureID)) {
+      }
+      if (m_residentBytes + levelBytes > m_budget) break;
+
+      texture.nextRow = 0;
+      texture.bytes += levelBytes;
+      m_residentBytes += levelBytes;
+      m_loading = textureID;
+    }
+
+    // Continue on the next update instead of waiting for the GPU
+    if (!acquireBuffer()) break;
+    uploadRows(m_loading, m_textures.at(m_loading), budget);
+  }
+
+  ++m_frame;
+  return m_loading == 0 && pickLoad() == 0;
+}
+
+/**
+ * @brief Sets the memory budget of the resident levels, and releases levels
+ * until it is met.
+ *
+ * The coarsest levels of every texture stay resident, so the budget can be
+ * exceeded.
+ *
+ * @param bytes Budget in bytes. The default is 128 MiB.
+ */
+void abcg::MipStreamer::setBudget(std::size_t bytes) {
+  m_budget = bytes;
+  while (m_residentBytes > m_budget && evictFor(nullptr, m_loading)) {
+  }
+}
+
+/**
+ * @brief Returns the finest resident level of a texture, or -1 if the
+ * texture was not created by the streamer.
+ */
+int abcg::MipStreamer::getResidentLevel(GLuint textureID) const {
+  const auto textureIter{m_textures.find(textureID)};
+  return textureIter == m_textures.end() ? -1
+                                         : textureIter->second.residentLevel;
+}
+
+/**
+ * @brief Returns the counters and memory use of the streamer.
+ */
+abcg::MipStreamer::Stats abcg::MipStreamer::getStats() const {
+  auto stats{m_stats};
+  stats.numTextures = m_textures.size();
+  for (const auto &[textureID, texture] : m_textures) {
+    if (texture.residentLevel > texture.wantedLevel) ++stats.numStreaming;
+    stats.totalBytes += getBytes(texture.chain);
+  }
+  stats.residentBytes = m_residentBytes;
+  stats.budget = m_budget;
+  return stats;
+}
+
+// Returns the texture whose next level is most needed: the most recently
+// requested, then the one furthest from its wanted level. Returns 0 if
+// every texture has its wanted level.
+GLuint abcg::MipStreamer::pickLoad() const {
+  GLuint best{};
+  std::tuple<std::uint64_t, int> bestPriority{};
+  for (const auto &[textureID, texture] : m_textures) {
+    if (texture.residentLevel <= texture.wantedLevel) continue;
+    const std::tuple priority{texture.lastRequest,
+                              texture.residentLevel - texture.wantedLevel};
+    if (best == 0 || priority > bestPriority) {
+      best = textureID;
+      bestPriority = priority;
+    }
+  }
+  return best;
+}
+
+// Releases the finest level of the texture that needs it least: first
+// textures with more detail than wanted, then the least recently requested,
+// then the largest level.
+// To make room for a texture, only textures less needed than it are
+// considered. Returns false if no level can be released.
+bool abcg::MipStreamer::evictFor(const Texture *texture, GLuint keep) {
+  GLuint victimID{};
+  Texture *victim{};
+  std::tuple<bool, std::uint64_t, std::size_t> victimPriority{};
+  for (auto &[textureID, candidate] : m_textures) {
+    if (textureID == keep || candidate.residentLevel >= candidate.tailLevel) {
+      continue;
+    }
+    const auto hasExtraLevels{candidate.residentLevel <
+                              candidate.wantedLevel};
+    if (texture != nullptr && !hasExtraLevels &&
+        candidate.lastRequest >= texture->lastRequest) {
+      continue;
+    }
+    const std::tuple priority{
+        hasExtraLevels, ~candidate.lastRequest,
+        candidate.chain.levels
+            .at(static_cast<std::size_t>(candidate.residentLevel))
+            .size()};
+    if (victim == nullptr || priority > victimPriority) {
+      victimID = textureID;
+      victim = &candidate;
+      victimPriority = priority;
+    }
+  }
+  if (victim == nullptr) return false;
+
+  evictLevel(victimID, *victim);
+  return true;
+}
+
+void abcg::MipStreamer::evictLevel(GLuint textureID, Texture &texture) {
+  const auto level{texture.residentLevel};
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+  releaseLevel(texture.chain, level);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  const auto levelBytes{
+      texture.chain.levels.at(static_cast<std::size_t>(level)).size()};
+  texture.residentLevel = level + 1;
+  texture.bytes -= levelBytes;
+  m_residentBytes -= levelBytes;
+  ++m_stats.evictedLevels;
+}
+
+// Returns whether the next pixel buffer of the ring is free, without
+// waiting for the GPU. The buffers are created on first use.
+bool abcg::MipStreamer::acquireBuffer() {
+  if (m_buffers.empty()) {
+    m_buffers.resize(numBuffers);
+    for (auto &buffer : m_buffers) {
+      glGenBuffers(1, &buffer.bufferID);
+    }
+  }
+
+  auto &buffer{m_buffers.at(m_nextBuffer)};
+  if (buffer.fence == nullptr) return true;
+
+  // Flush so that the fence is eventually signaled even if nothing else is
+  // submitted
+  if (glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) ==
+      GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+  glDeleteSync(buffer.fence);
+  buffer.fence = nullptr;
+  return true;
+}
+
+// Copies bytes into the next pixel buffer of the ring, which must be free,
+// and leaves it bound to GL_PIXEL_UNPACK_BUFFER
+void abcg::MipStreamer::fillBuffer(const std::byte *data,
+                                   std::size_t numBytes) {
+  auto &buffer{m_buffers.at(m_nextBuffer)};
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.bufferID);
+  if (buffer.size < numBytes) {
+    buffer.size = std::max(bufferSize, numBytes);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER,
+                 static_cast<GLsizeiptr>(buffer.size), nullptr,
+                 GL_STREAM_DRAW);
+  }
+
+#if defined(__EMSCRIPTEN__)
+  // WebGL cannot map buffers
+  glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0,
+                  static_cast<GLsizeiptr>(numBytes), data);
+#else
+  // The fence guarantees the GPU is done with the buffer, so the driver
+  // does not need to synchronize
+  auto *target{glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(numBytes),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT)};
+  if (target != nullptr) {
+    std::memcpy(target, data, numBytes);
+  }
+  // The content of a mapped buffer may be lost, e.g. on a mode change
+  if (target == nullptr || glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+    glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0,
+                    static_cast<GLsizeiptr>(numBytes), data);
+  }
+#endif
+}
+
+// Uploads the next band of rows of the level being loaded through the next
+// pixel buffer of the ring, which must be free. The band fits the budget
+// and a buffer, but has at least one row. Compressed levels are uploaded at
+// once.
+void abcg::MipStreamer::uploadRows(GLuint textureID, Texture &texture,
+                                   std::size_t &budget) {
+  const auto level{texture.residentLevel - 1};
+  const auto &chain{texture.chain};
+  const auto &data{chain.levels.at(static_cast<std::size_t>(level))};
+  const auto width{getLevelSize(chain.width, level)};
+  const auto height{getLevelSize(chain.height, level)};
+
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (chain.isCompressed) {
+    fillBuffer(data.data(), data.size());
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, chain.format, width, height,
+                           0, static_cast<GLsizei>(data.size()), nullptr);
+    budget -= std::min(budget, data.size());
+    texture.nextRow = height;
+  } else {
+    // Allocate the level before a pixel buffer is bound, so that nothing is
+    // read from it
+    if (texture.nextRow == 0) defineLevel(chain, level, nullptr);
+
+    const auto rowSize{data.size() / static_cast<std::size_t>(height)};
+    const auto numRows{static_cast<int>(std::clamp<std::size_t>(
+        std::min(budget, bufferSize) / rowSize, 1,
+        static_cast<std::size_t>(height - texture.nextRow)))};
+    const auto numBytes{rowSize * static_cast<std::size_t>(numRows)};
+    fillBuffer(
+        data.data() + rowSize * static_cast<std::size_t>(texture.nextRow),
+        numBytes);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, texture.nextRow, width, numRows,
+                    chain.format, GL_UNSIGNED_BYTE, nullptr);
+    budget -= std::min(budget, numBytes);
+    texture.nextRow += numRows;
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  // The buffer is written again once the GPU has read it
+  m_buffers.at(m_nextBuffer).fence =
+      glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_nextBuffer = (m_nextBuffer + 1) % m_buffers.size();
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  // Sample the level once complete
+  if (texture.nextRow == height) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    texture.residentLevel = level;
+    texture.nextRow = -1;
+    m_loading = 0;
+    ++m_stats.loadedLevels;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
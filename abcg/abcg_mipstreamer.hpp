@@ -0,0 +1,155 @@
+/**
+ * @file abcg_mipstreamer.hpp
+ * @brief abcg::MipStreamer header file.
+ *
+ * Declaration of abcg::MipStreamer class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MIPSTREAMER_HPP_
+#define ABCG_MIPSTREAMER_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_compressedimage.hpp"
+#include "abcg_image.hpp"
+
+namespace abcg {
+class MipStreamer;
+}  // namespace abcg
+
+/**
+ * @brief abcg::MipStreamer class.
+ *
+ * Keeps the mipmap levels of 2D textures on the CPU and makes only the
+ * levels needed on screen resident on the GPU.
+ *
+ * A texture starts with its coarsest levels, up to 64x64, which always stay
+ * resident. Each frame, the textures drawn are requested with their size on
+ * screen, from which the finest level worth sampling is computed. update
+ * then uploads the missing levels, one level at a time from coarse to fine,
+ * and lowers GL_TEXTURE_BASE_LEVEL once a level is complete, so that
+ * sampling never reads a level being uploaded.
+ *
+ * Levels are copied into a small ring of pixel unpack buffers and uploaded
+ * from there, so the driver copies the pixels asynchronously. A fence
+ * follows each upload, and a buffer is written again only once its fence
+ * has signaled. If it has not, update stops and resumes on the next call.
+ *
+ * When the resident levels exceed the memory budget, the finest levels of
+ * textures that have more detail than requested, or that were not drawn
+ * recently, are released first. A released level is redefined with zero
+ * size and excluded by GL_TEXTURE_BASE_LEVEL.
+ *
+ * The streamer is shared by the whole application, so the budget applies to
+ * every texture it manages. It must be used on a thread with a current
+ * OpenGL context, except makeMipChain, which can run on any thread.
+ *
+ */
+class abcg::MipStreamer {
+ public:
+  /**
+   * @brief Mipmap levels of a texture, from full size to 1x1.
+   *
+   * Levels hold 8-bit pixels or compressed blocks, with rows stored bottom
+   * to top.
+   */
+  struct MipChain {
+    int width{};
+    int height{};
+    /** @brief GL_RGB or GL_RGBA for pixels, or the internal format of
+     * compressed blocks. */
+    GLenum format{};
+    bool isCompressed{false};
+    std::vector<std::vector<std::byte>> levels;
+  };
+
+  /**
+   * @brief Counters and memory use of the streamer.
+   */
+  struct Stats {
+    std::size_t numTextures{};
+    /** @brief Textures with fewer levels resident than requested. */
+    std::size_t numStreaming{};
+    std::size_t residentBytes{};
+    /** @brief Bytes of every level of every texture. */
+    std::size_t totalBytes{};
+    std::size_t budget{};
+    /** @brief Levels uploaded and released since the start. */
+    std::size_t loadedLevels{};
+    std::size_t evictedLevels{};
+  };
+
+  MipStreamer(const MipStreamer &) = delete;
+  MipStreamer(MipStreamer &&) = delete;
+  MipStreamer &operator=(const MipStreamer &) = delete;
+  MipStreamer &operator=(MipStreamer &&) = delete;
+
+  [[nodiscard]] static MipStreamer &getInstance();
+
+  [[nodiscard]] static MipChain makeMipChain(opengl::Image image);
+  [[nodiscard]] static MipChain makeMipChain(opengl::CompressedImage image);
+  [[nodiscard]] static std::size_t getBytes(const MipChain &chain) noexcept;
+
+  [[nodiscard]] GLuint create(MipChain chain);
+  void remove(GLuint textureID);
+
+  void request(GLuint textureID, float screenSize);
+  bool update(std::size_t maxBytes);
+
+  void setBudget(std::size_t bytes);
+  [[nodiscard]] int getResidentLevel(GLuint textureID) const;
+  [[nodiscard]] Stats getStats() const;
+
+ private:
+  MipStreamer() = default;
+  ~MipStreamer() = default;
+
+  struct Texture {
+    MipChain chain;
+    // Levels from tailLevel on are always resident
+    int tailLevel{};
+    // Finest resident level, and finest level wanted by the last requests
+    int residentLevel{};
+    int wantedLevel{};
+    // Finest level requested since the last update
+    int requestedLevel{};
+    std::uint64_t lastRequest{};
+    // Next row of the level being uploaded (residentLevel - 1), or -1
+    int nextRow{-1};
+    // Bytes of the resident levels and of the level being uploaded
+    std::size_t bytes{};
+  };
+
+  // Pixel buffer of the upload ring
+  struct Buffer {
+    GLuint bufferID{};
+    GLsync fence{};
+    std::size_t size{};
+  };
+
+  bool acquireBuffer();
+  void fillBuffer(const std::byte *data, std::size_t numBytes);
+  GLuint pickLoad() const;
+  bool evictFor(const Texture *texture, GLuint keep);
+  void evictLevel(GLuint textureID, Texture &texture);
+  void uploadRows(GLuint textureID, Texture &texture, std::size_t &budget);
+
+  std::unordered_map<GLuint, Texture> m_textures;
+  // Texture whose level is being uploaded, if any
+  GLuint m_loading{};
+  std::vector<Buffer> m_buffers;
+  std::size_t m_nextBuffer{};
+  // Number of updates so far
+  std::uint64_t m_frame{1};
+  std::size_t m_residentBytes{};
+  std::size_t m_budget{std::size_t{128} * 1024 * 1024};
+  Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,760 @@
+/**
+ * @file abcg_objparser.cpp
+ * @brief Definition of abcg::ObjParser class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_objparser.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cppitertools/itertools.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <span>
+
+#include "abcg_mappedfile.hpp"
+#include "abcg_threadpool.hpp"
+
+namespace {
+// Files smaller than this are parsed by a single thread
+constexpr std::size_t minChunkSize{256 * 1024};
+
+// Attribute of a face corner whose index is relative to the end of the chunk
+enum class Attribute : std::uint32_t { Position, Normal, TexCoord };
+
+// Run of faces of a chunk that belongs to a single shape
+struct Piece {
+  std::string name;
+  // Whether the piece was opened by a `g` or `o` record of the chunk, or
+  // continues the last shape of the previous chunk
+  bool startsShape{};
+
+  // Polygons as parsed
+  std::vector<tinyobj::index_t> corners;
+  std::vector<std::uint32_t> polygonSizes;
+  // Line of each polygon, counted from the start of the chunk
+  std::vector<std::size_t> polygonLines;
+  std::vector<int> materialSlots;
+  std::vector<unsigned int> smoothingGroups;
+  // Corners (index * 4 + attribute) that must be offset by the number of
+  // elements of the previous chunks
+  std::vector<std::size_t> relativeCorners;
+
+  // Triangulated faces, filled in during the merge
+  tinyobj::mesh_t mesh;
+};
+
+struct Chunk {
+  std::vector<tinyobj::real_t> vertices;
+  std::vector<tinyobj::real_t> normals;
+  std::vector<tinyobj::real_t> texcoords;
+  std::vector<Piece> pieces;
+
+  // Material names used by `usemtl`, indexed by the material slots
+  std::vector<std::string> materialNames;
+  std::vector<std::vector<std::string>> materialLibraries;
+
+  // Faces that inherit the material and smoothing group of the previous chunk
+  std::size_t facesBeforeMaterial{};
+  std::size_t facesBeforeSmoothing{};
+  std::optional<int> lastMaterialSlot;
+  std::optional<unsigned int> lastSmoothingGroup;
+
+  std::size_t numLines{};
+  std::size_t numFaces{};
+  std::size_t errorLine{};
+  std::string error;
+};
+
+bool isSpace(char character) noexcept {
+  return character == ' ' || character == '\t' || character == '\r';
+}
+
+void skipSpaces(const char *&cursor, const char *end) noexcept {
+  while (cursor != end && isSpace(*cursor)) ++cursor;
+}
+
+std::string_view parseToken(const char *&cursor, const char *end) noexcept {
+  skipSpaces(cursor, end);
+  const auto *begin{cursor};
+  while (cursor != end && !isSpace(*cursor)) ++cursor;
+  return {begin, static_cast<std::size_t>(cursor - begin)};
+}
+
+std::string_view trim(std::string_view string) noexcept {
+  while (!string.empty() && isSpace(string.front())) string.remove_prefix(1);
+  while (!string.empty() && isSpace(string.back())) string.remove_suffix(1);
+  return string;
+}
+
+// Parses a real number, or returns the default value if there is none
+tinyobj::real_t parseReal(const char *&cursor, const char *end,
+                          tinyobj::real_t defaultValue = 0) noexcept {
+  const auto token{parseToken(cursor, end)};
+  auto first{token.data()};
+  const auto last{token.data() + token.size()};
+  if (first != last && *first == '+') ++first;
+
+  tinyobj::real_t value{defaultValue};
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  if (std::from_chars(first, last, value).ec != std::errc{}) {
+    return defaultValue;
+  }
+#else
+  // The mapped file is not null terminated
+  std::array<char, 64> buffer{};
+  const auto length{std::min<std::size_t>(last - first, buffer.size() - 1)};
+  std::memcpy(buffer.data(), first, length);
+  char *parsedEnd{};
+  value = std::strtof(buffer.data(), &parsedEnd);
+  if (parsedEnd == buffer.data()) return defaultValue;
+#endif
+  return value;
+}
+
+bool parseInt(const char *&cursor, const char *end, int &value) noexcept {
+  if (cursor != end && *cursor == '+') ++cursor;
+  const auto result{std::from_chars(cursor, end, value)};
+  if (result.ec != std::errc{}) return false;
+  cursor = result.ptr;
+  return true;
+}
+
+// Converts a one-based or negative OBJ index to a zero-based index local to
+// the chunk. Returns false for the invalid index 0.
+bool convertIndex(int objIndex, std::size_t localCount, int &index,
+                  bool &relative) noexcept {
+  if (objIndex > 0) {
+    index = objIndex - 1;
+    relative = false;
+    return true;
+  }
+  if (objIndex < 0) {
+    index = static_cast<int>(localCount) + objIndex;
+    relative = true;
+    return true;
+  }
+  return false;
+}
+
+class ChunkParser {
+ public:
+  explicit ChunkParser(Chunk &chunk) : m_chunk{chunk} {
+    m_chunk.pieces.emplace_back();
+  }
+
+  void parse(const char *begin, const char *end) {
+    const auto *cursor{begin};
+    while (cursor != end) {
+      const auto *lineEnd{static_cast<const char *>(
+          std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)))};
+      if (lineEnd == nullptr) lineEnd = end;
+      ++m_chunk.numLines;
+      if (!parseLine(cursor, lineEnd)) {
+        m_chunk.errorLine = m_chunk.numLines;
+        return;
+      }
+      cursor = lineEnd == end ? end : lineEnd + 1;
+    }
+  }
+
+ private:
+  bool parseLine(const char *cursor, const char *end) {
+    skipSpaces(cursor, end);
+    const auto keyword{parseToken(cursor, end)};
+    if (keyword.empty() || keyword.front() == '#') return true;
+
+    if (keyword == "v") {
+      for ([[maybe_unused]] auto index : iter::range(3)) {
+        m_chunk.vertices.push_back(parseReal(cursor, end));
+      }
+    } else if (keyword == "vn") {
+      for ([[maybe_unused]] auto index : iter::range(3)) {
+        m_chunk.normals.push_back(parseReal(cursor, end));
+      }
+    } else if (keyword == "vt") {
+      m_chunk.texcoords.push_back(parseReal(cursor, end));
+      m_chunk.texcoords.push_back(parseReal(cursor, end));
+    } else if (keyword == "f") {
+      return parseFace(cursor, end);
+    } else if (keyword == "g") {
+      // Multiple group names are concatenated, as in tinyobj
+      std::string name;
+      for (auto token{parseToken(cursor, end)}; !token.empty();
+           token = parseToken(cursor, end)) {
+        if (!name.empty()) name += ' ';
+        name += token;
+      }
+      startShape(std::move(name));
+    } else if (keyword == "o") {
+      startShape(std::string{trim({cursor, end})});
+    } else if (keyword == "usemtl") {
+      const auto name{parseToken(cursor, end)};
+      auto found{std::find(m_chunk.materialNames.begin(),
+                           m_chunk.materialNames.end(), name)};
+      if (found == m_chunk.materialNames.end()) {
+        found = m_chunk.materialNames.emplace(found, name);
+      }
+      m_material = static_cast<int>(found - m_chunk.materialNames.begin());
+      if (!m_chunk.lastMaterialSlot) {
+        m_chunk.facesBeforeMaterial = m_chunk.numFaces;
+      }
+      m_chunk.lastMaterialSlot = m_material;
+    } else if (keyword == "mtllib") {
+      std::vector<std::string> fileNames;
+      for (auto token{parseToken(cursor, end)}; !token.empty();
+           token = parseToken(cursor, end)) {
+        fileNames.emplace_back(token);
+      }
+      m_chunk.materialLibraries.push_back(std::move(fileNames));
+    } else if (keyword == "s") {
+      const auto token{parseToken(cursor, end)};
+      int group{};
+      if (!token.empty() && token != "off") {
+        auto *first{token.data()};
+        if (!parseInt(first, token.data() + token.size(), group) || group < 0) {
+          group = 0;
+        }
+      }
+      m_smoothingGroup = static_cast<unsigned int>(group);
+      if (!m_chunk.lastSmoothingGroup) {
+        m_chunk.facesBeforeSmoothing = m_chunk.numFaces;
+      }
+      m_chunk.lastSmoothingGroup = m_smoothingGroup;
+    }
+    // Other records (lines, points, tags...) are ignored
+    return true;
+  }
+
+  bool parseFace(const char *cursor, const char *end) {
+    m_corners.clear();
+    while (true) {
+      skipSpaces(cursor, end);
+      if (cursor == end) break;
+      if (!parseCorner(cursor, end)) {
+        m_chunk.error = "Failed to parse `f' line (e.g. zero value for face "
+                        "index)";
+        return false;
+      }
+    }
+
+    // Faces with less than 3 vertices are skipped
+    if (m_corners.size() < 3) return true;
+
+    auto &piece{m_chunk.pieces.back()};
+    for (const auto &[index, relative] : m_corners) {
+      const auto position{piece.corners.size() * 4};
+      for (auto attribute :
+           {Attribute::Position, Attribute::Normal, Attribute::TexCoord}) {
+        const auto bit{1U << static_cast<std::uint32_t>(attribute)};
+        if ((relative & bit) != 0) {
+          piece.relativeCorners.push_back(
+              position + static_cast<std::size_t>(attribute));
+        }
+      }
+      piece.corners.push_back(index);
+    }
+    piece.polygonSizes.push_back(static_cast<std::uint32_t>(m_corners.size()));
+    piece.polygonLines.push_back(m_chunk.numLines);
+    piece.materialSlots.push_back(m_material);
+    piece.smoothingGroups.push_back(m_smoothingGroup);
+    ++m_chunk.numFaces;
+    return true;
+  }
+
+  // Parses "v", "v/vt", "v//vn" or "v/vt/vn"
+  bool parseCorner(const char *&cursor, const char *end) {
+    tinyobj::index_t index{-1, -1, -1};
+    std::uint32_t relative{};
+    auto convert{[&](int objIndex, std::size_t count, Attribute attribute,
+                     int &result) {
+      bool isRelative{};
+      if (!convertIndex(objIndex, count, result, isRelative)) return false;
+      if (isRelative) {
+        relative |= 1U << static_cast<std::uint32_t>(attribute);
+      }
+      return true;
+    }};
+
+    int objIndex{};
+    if (!parseInt(cursor, end, objIndex) ||
+        !convert(objIndex, m_chunk.vertices.size() / 3, Attribute::Position,
+                 index.vertex_index)) {
+      return false;
+    }
+
+    if (cursor != end && *cursor == '/') {
+      ++cursor;
+      if (cursor != end && *cursor != '/') {
+        if (!parseInt(cursor, end, objIndex) ||
+            !convert(objIndex, m_chunk.texcoords.size() / 2,
+                     Attribute::TexCoord, index.texcoord_index)) {
+          return false;
+        }
+      }
+      if (cursor != end && *cursor == '/') {
+        ++cursor;
+        if (!parseInt(cursor, end, objIndex) ||
+            !convert(objIndex, m_chunk.normals.size() / 3, Attribute::Normal,
+                     index.normal_index)) {
+          return false;
+        }
+      }
+    }
+
+    if (cursor != end && !isSpace(*cursor)) return false;
+    m_corners.emplace_back(index, relative);
+    return true;
+  }
+
+  void startShape(std::string name) {
+    auto &piece{m_chunk.pieces.back()};
+    if (!piece.corners.empty() || piece.startsShape) {
+      m_chunk.pieces.emplace_back();
+    }
+    m_chunk.pieces.back().name = std::move(name);
+    m_chunk.pieces.back().startsShape = true;
+  }
+
+  Chunk &m_chunk;
+  int m_material{};
+  unsigned int m_smoothingGroup{};
+  std::vector<std::pair<tinyobj::index_t, std::uint32_t>> m_corners;
+};
+
+// Point-in-polygon test used by the ear clipping, as in tinyobj
+bool isInside(const std::array<tinyobj::real_t, 3> &vx,
+              const std::array<tinyobj::real_t, 3> &vy, tinyobj::real_t x,
+              tinyobj::real_t y) noexcept {
+  auto inside{false};
+  for (std::size_t i{0}, j{2}; i < 3; j = i++) {
+    if (((vy[i] > y) != (vy[j] > y)) &&
+        (x < (vx[j] - vx[i]) * (y - vy[i]) / (vy[j] - vy[i]) + vx[i])) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+// Triangulates a polygon by ear clipping on its dominant plane. This is the
+// algorithm of tinyobj, so both parsers output the same triangles.
+// Returns the number of triangles appended.
+std::size_t triangulate(std::span<const tinyobj::index_t> polygon,
+                        std::span<const tinyobj::real_t> positions,
+                        std::vector<tinyobj::index_t> &triangles) {
+  using real = tinyobj::real_t;
+
+  if (polygon.size() == 3) {
+    triangles.insert(triangles.end(), polygon.begin(), polygon.end());
+    return 1;
+  }
+
+  auto getPosition{[&](const tinyobj::index_t &index) -> const real * {
+    const auto offset{static_cast<std::size_t>(index.vertex_index) * 3};
+    if (index.vertex_index < 0 || offset + 2 >= positions.size()) {
+      return nullptr;
+    }
+    return &positions[offset];
+  }};
+
+  // Find the two axes of the dominant plane
+  std::array<std::size_t, 2> axes{1, 2};
+  const auto size{polygon.size()};
+  for (auto k : iter::range(size)) {
+    const auto *p0{getPosition(polygon[k])};
+    const auto *p1{getPosition(polygon[(k + 1) % size])};
+    const auto *p2{getPosition(polygon[(k + 2) % size])};
+    if (p0 == nullptr || p1 == nullptr || p2 == nullptr) continue;
+
+    const std::array e0{p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const std::array e1{p2[0] - p1[0], p2[1] - p1[1], p2[2] - p1[2]};
+    const auto cx{std::fabs(e0[1] * e1[2] - e0[2] * e1[1])};
+    const auto cy{std::fabs(e0[2] * e1[0] - e0[0] * e1[2])};
+    const auto cz{std::fabs(e0[0] * e1[1] - e0[1] * e1[0])};
+    constexpr auto epsilon{std::numeric_limits<real>::epsilon()};
+    if (cx > epsilon || cy > epsilon || cz > epsilon) {
+      if (!(cx > cy && cx > cz)) {
+        axes[0] = 0;
+        if (cz > cx && cz > cy) axes[1] = 1;
+      }
+      break;
+    }
+  }
+
+  // Signed area on the projection plane
+  real area{};
+  for (auto k : iter::range(size)) {
+    const auto *p0{getPosition(polygon[k])};
+    const auto *p1{getPosition(polygon[(k + 1) % size])};
+    if (p0 == nullptr || p1 == nullptr) continue;
+    area += (p0[axes[0]] * p1[axes[1]] - p0[axes[1]] * p1[axes[0]]) *
+            static_cast<real>(0.5);
+  }
+
+  std::vector<tinyobj::index_t> remaining(polygon.begin(), polygon.end());
+  std::size_t numTriangles{};
+  std::size_t guess{};
+  auto remainingIterations{remaining.size()};
+  auto previousSize{remaining.size()};
+  while (remaining.size() > 3 && remainingIterations > 0) {
+    const auto count{remaining.size()};
+    if (guess >= count) guess -= count;
+    if (previousSize != count) {
+      previousSize = count;
+      remainingIterations = count;
+    } else {
+      --remainingIterations;
+    }
+
+    std::array<tinyobj::index_t, 3> ear{};
+    std::array<real, 3> vx{};
+    std::array<real, 3> vy{};
+    for (auto k : iter::range(std::size_t{3})) {
+      ear.at(k) = remaining[(guess + k) % count];
+      if (const auto *position{getPosition(ear.at(k))}) {
+        vx.at(k) = position[axes[0]];
+        vy.at(k) = position[axes[1]];
+      }
+    }
+
+    // Skip reflex vertices
+    const auto cross{(vx[1] - vx[0]) * (vy[2] - vy[1]) -
+                     (vy[1] - vy[0]) * (vx[2] - vx[1])};
+    if (cross * area < static_cast<real>(0)) {
+      ++guess;
+      continue;
+    }
+
+    // Skip ears that contain any other vertex
+    auto overlap{false};
+    for (auto other : iter::range<std::size_t>(3, count)) {
+      const auto *position{getPosition(remaining[(guess + other) % count])};
+      if (position != nullptr &&
+          isInside(vx, vy, position[axes[0]], position[axes[1]])) {
+        overlap = true;
+        break;
+      }
+    }
+    if (overlap) {
+      ++guess;
+      continue;
+    }
+
+    triangles.insert(triangles.end(), ear.begin(), ear.end());
+    ++numTriangles;
+    remaining.erase(remaining.begin() +
+                    static_cast<std::ptrdiff_t>((guess + 1) % count));
+  }
+
+  if (remaining.size() == 3) {
+    triangles.insert(triangles.end(), remaining.begin(), remaining.end());
+    ++numTriangles;
+  }
+  return numTriangles;
+}
+
+// Number of reals of each attribute
+struct AttributeCounts {
+  std::size_t vertices{};
+  std::size_t normals{};
+  std::size_t texcoords{};
+};
+
+template <typename T>
+void append(std::vector<T> &destination, const std::vector<T> &source) {
+  destination.insert(destination.end(), source.begin(), source.end());
+}
+
+// Whether an index is in [0, count), or is -1 for an optional attribute
+// that is not given
+bool isValidIndex(int index, int count, bool isOptional) noexcept {
+  return (index >= 0 && index < count) || (isOptional && index == -1);
+}
+
+// Converts the polygons of a chunk to triangles with global indices and
+// material ids. Sets the error of the chunk if a face has an index out of
+// bounds.
+void resolveChunk(Chunk &chunk, const AttributeCounts &base,
+                  const AttributeCounts &total,
+                  std::span<const tinyobj::real_t> positions,
+                  std::span<const int> materialIds,
+                  std::pair<int, unsigned int> inherited) {
+  const std::array offsets{static_cast<int>(base.vertices / 3),
+                           static_cast<int>(base.normals / 3),
+                           static_cast<int>(base.texcoords / 2)};
+  const auto numVertices{static_cast<int>(total.vertices / 3)};
+  const auto numNormals{static_cast<int>(total.normals / 3)};
+  const auto numTexCoords{static_cast<int>(total.texcoords / 2)};
+
+  std::size_t face{};
+  for (auto &piece : chunk.pieces) {
+    for (const auto corner : piece.relativeCorners) {
+      auto &index{piece.corners[corner / 4]};
+      const auto attribute{corner % 4};
+      auto &value{attribute == 0   ? index.vertex_index
+                  : attribute == 1 ? index.normal_index
+                                   : index.texcoord_index};
+      value += offsets.at(attribute);
+      // A relative index before the first element is invalid, and must not
+      // be taken for a missing attribute
+      if (value < 0) value = -2;
+    }
+
+    std::size_t corner{};
+    for (auto &&[size, line] :
+         iter::zip(piece.polygonSizes, piece.polygonLines)) {
+      for (const auto &index :
+           std::span{piece.corners}.subspan(corner, size)) {
+        if (!isValidIndex(index.vertex_index, numVertices, false) ||
+            !isValidIndex(index.normal_index, numNormals, true) ||
+            !isValidIndex(index.texcoord_index, numTexCoords, true)) {
+          chunk.error = "Index out of bounds in `f' line";
+          chunk.errorLine = line;
+          return;
+        }
+      }
+      corner += size;
+    }
+
+    auto &mesh{piece.mesh};
+    mesh.indices.reserve(piece.corners.size());
+    std::size_t first{};
+    for (auto &&[size, slot, group] :
+         iter::zip(piece.polygonSizes, piece.materialSlots,
+                   piece.smoothingGroups)) {
+      const auto numTriangles{triangulate(
+          std::span{piece.corners}.subspan(first, size), positions,
+          mesh.indices)};
+      first += size;
+
+      const auto material{face < chunk.facesBeforeMaterial ||
+                                  !chunk.lastMaterialSlot
+                              ? inherited.first
+                              : materialIds[static_cast<std::size_t>(slot)]};
+      const auto smoothingGroup{face < chunk.facesBeforeSmoothing ||
+                                        !chunk.lastSmoothingGroup
+                                    ? inherited.second
+                                    : group};
+      mesh.num_face_vertices.insert(mesh.num_face_vertices.end(),
+                                    numTriangles, 3);
+      mesh.material_ids.insert(mesh.material_ids.end(), numTriangles,
+                               material);
+      mesh.smoothing_group_ids.insert(mesh.smoothing_group_ids.end(),
+                                      numTriangles, smoothingGroup);
+      ++face;
+    }
+  }
+}
+
+// Returns the first error of the chunks in file order, with its line, or an
+// empty string if there is none
+std::string getFirstError(std::span<const Chunk> chunks) {
+  std::size_t lineBase{};
+  for (const auto &chunk : chunks) {
+    if (!chunk.error.empty()) {
+      return fmt::format("{} (line {}).\n", chunk.error,
+                         lineBase + chunk.errorLine);
+    }
+    lineBase += chunk.numLines;
+  }
+  return {};
+}
+
+// Returns the start of each chunk, with chunks beginning at line boundaries
+std::vector<const char *> splitLines(std::string_view text,
+                                     std::size_t numChunks) {
+  std::vector<const char *> bounds{text.data()};
+  for (auto chunk : iter::range<std::size_t>(1, numChunks)) {
+    const auto newLine{text.find('\n', text.size() * chunk / numChunks)};
+    const auto *bound{newLine == std::string_view::npos
+                          ? text.data() + text.size()
+                          : text.data() + newLine + 1};
+    if (bound > bounds.back()) bounds.push_back(bound);
+  }
+  bounds.push_back(text.data() + text.size());
+  return bounds;
+}
+
+// Loads the first material library of the list that can be read
+// Loads the first library of an `mtllib` record that can be opened. Every
+// path tried is appended to searchedPaths.
+void loadMaterialLibrary(std::span<const std::string> fileNames,
+                         std::string_view searchPath,
+                         std::vector<tinyobj::material_t> &materials,
+                         std::map<std::string, int> &materialMap,
+                         std::vector<std::string> &searchedPaths,
+                         std::string &warning, std::string &error) {
+  if (fileNames.empty()) {
+    warning += "Looks like empty filename for mtllib. Use default material.\n";
+    return;
+  }
+
+  for (const auto &fileName : fileNames) {
+    const auto filePath{std::string{searchPath} + fileName};
+    searchedPaths.push_back(filePath);
+    std::ifstream stream(filePath);
+    if (!stream) {
+      warning += fmt::format("Material file [ {} ] not found.\n", filePath);
+      continue;
+    }
+    std::string materialWarning;
+    std::string materialError;
+    tinyobj::LoadMtl(&materialMap, &materials, &stream, &materialWarning,
+                     &materialError);
+    warning += materialWarning;
+    error += materialError;
+    return;
+  }
+  warning += "Failed to load material file(s). Use default material.\n";
+}
+}  // namespace
+
+/**
+ * @brief Parses an OBJ file and the material libraries it references.
+ *
+ * @param path Path to the OBJ file.
+ * @param mtlSearchPath Directory of the material libraries, including the
+ * trailing separator. If empty, libraries are searched in the working
+ * directory.
+ * @return Whether the file was parsed. On failure, getError returns the
+ * reason.
+ */
+bool abcg::ObjParser::parseFromFile(std::string_view path,
+                                    std::string_view mtlSearchPath) {
+  m_attrib = {};
+  m_shapes.clear();
+  m_materials.clear();
+  m_materialLibraries.clear();
+  m_error.clear();
+  m_warning.clear();
+
+  const MappedFile file{path};
+  if (!file.isOpen()) {
+    std::error_code error;
+    if (std::filesystem::is_regular_file(path, error) &&
+        std::filesystem::file_size(path, error) == 0 && !error) {
+      return true;
+    }
+    m_error = fmt::format("Cannot open file [{}]\n", path);
+    return false;
+  }
+
+  const auto bytes{file.getBytes()};
+  const std::string_view text{
+      reinterpret_cast<const char *>(bytes.data()),  // NOLINT
+      bytes.size()};
+
+  // Parse chunks in parallel
+  auto &pool{ThreadPool::getInstance()};
+  const auto bounds{splitLines(
+      text, std::clamp<std::size_t>(text.size() / minChunkSize, 1,
+                                    pool.getNumThreads()))};
+  std::vector<Chunk> chunks(bounds.size() - 1);
+  pool.parallelFor(chunks.size(), [&](std::size_t begin, std::size_t end) {
+    for (auto index : iter::range(begin, end)) {
+      ChunkParser{chunks[index]}.parse(bounds[index], bounds[index + 1]);
+    }
+  });
+
+  m_error = getFirstError(chunks);
+  if (!m_error.empty()) return false;
+
+  // Concatenate attributes
+  std::vector<AttributeCounts> bases(chunks.size() + 1);
+  for (auto &&[index, chunk] : iter::enumerate(chunks)) {
+    bases[index + 1] = {bases[index].vertices + chunk.vertices.size(),
+                        bases[index].normals + chunk.normals.size(),
+                        bases[index].texcoords + chunk.texcoords.size()};
+  }
+  m_attrib.vertices.resize(bases.back().vertices);
+  m_attrib.normals.resize(bases.back().normals);
+  m_attrib.texcoords.resize(bases.back().texcoords);
+  pool.parallelFor(chunks.size(), [&](std::size_t begin, std::size_t end) {
+    for (auto index : iter::range(begin, end)) {
+      const auto &chunk{chunks[index]};
+      std::copy(chunk.vertices.begin(), chunk.vertices.end(),
+                m_attrib.vertices.begin() +
+                    static_cast<std::ptrdiff_t>(bases[index].vertices));
+      std::copy(chunk.normals.begin(), chunk.normals.end(),
+                m_attrib.normals.begin() +
+                    static_cast<std::ptrdiff_t>(bases[index].normals));
+      std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+                m_attrib.texcoords.begin() +
+                    static_cast<std::ptrdiff_t>(bases[index].texcoords));
+    }
+  });
+
+  // Load material libraries in file order
+  std::map<std::string, int> materialMap;
+  for (const auto &chunk : chunks) {
+    for (const auto &fileNames : chunk.materialLibraries) {
+      loadMaterialLibrary(fileNames, mtlSearchPath, m_materials, materialMap,
+                          m_materialLibraries, m_warning, m_error);
+    }
+  }
+
+  // Resolve the material of each chunk, and the material and smoothing group
+  // inherited from the previous chunk
+  std::vector<std::vector<int>> materialIds(chunks.size());
+  std::vector<std::pair<int, unsigned int>> inherited(chunks.size());
+  std::pair<int, unsigned int> current{-1, 0};
+  for (auto &&[index, chunk] : iter::enumerate(chunks)) {
+    for (const auto &name : chunk.materialNames) {
+      const auto found{materialMap.find(name)};
+      if (found == materialMap.end()) {
+        m_warning += fmt::format("material [ '{}' ] not found in .mtl\n", name);
+      }
+      materialIds[index].push_back(found == materialMap.end() ? -1
+                                                              : found->second);
+    }
+    inherited[index] = current;
+    if (chunk.lastMaterialSlot) {
+      current.first = materialIds[index].at(
+          static_cast<std::size_t>(*chunk.lastMaterialSlot));
+    }
+    if (chunk.lastSmoothingGroup) current.second = *chunk.lastSmoothingGroup;
+  }
+
+  // Resolve relative indices, check bounds and triangulate
+  pool.parallelFor(chunks.size(), [&](std::size_t begin, std::size_t end) {
+    for (auto index : iter::range(begin, end)) {
+      resolveChunk(chunks[index], bases[index], bases.back(),
+                   m_attrib.vertices, materialIds[index], inherited[index]);
+    }
+  });
+  if (auto error{getFirstError(chunks)}; !error.empty()) {
+    m_error += error;
+    return false;
+  }
+
+  // Merge pieces into shapes
+  tinyobj::shape_t shape;
+  for (auto &chunk : chunks) {
+    for (auto &piece : chunk.pieces) {
+      if (piece.startsShape) {
+        if (!shape.mesh.indices.empty()) m_shapes.push_back(std::move(shape));
+        shape = {};
+        shape.name = std::move(piece.name);
+      }
+      append(shape.mesh.indices, piece.mesh.indices);
+      append(shape.mesh.num_face_vertices, piece.mesh.num_face_vertices);
+      append(shape.mesh.material_ids, piece.mesh.material_ids);
+      append(shape.mesh.smoothing_group_ids, piece.mesh.smoothing_group_ids);
+    }
+  }
+  if (!shape.mesh.indices.empty()) m_shapes.push_back(std::move(shape));
+
+  return true;
+}
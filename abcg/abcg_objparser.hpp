@@ -0,0 +1,84 @@
+/**
+ * @file abcg_objparser.hpp
+ * @brief abcg::ObjParser header file.
+ *
+ * Declaration of abcg::ObjParser class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OBJPARSER_HPP_
+#define ABCG_OBJPARSER_HPP_
+
+#include <tiny_obj_loader.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+class ObjParser;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ObjParser class.
+ *
+ * Multithreaded Wavefront OBJ parser producing the same attribute, shape and
+ * material layout as tinyobj::ObjReader, so it can be used as a drop-in
+ * replacement on the load path.
+ *
+ * The file is memory mapped and split at line boundaries into one chunk per
+ * thread of abcg::ThreadPool. Each chunk parses its `v`, `vn`, `vt`, `f`,
+ * `g`, `o`, `usemtl`, `mtllib` and `s` records independently, and the partial
+ * results are then merged in file order. Relative (negative) indices, shape
+ * names, materials and smoothing groups that continue across chunk
+ * boundaries are resolved during the merge.
+ *
+ * Polygons are triangulated by ear clipping on their dominant plane, the
+ * algorithm of tinyobj, so both parsers output the same triangles. Unlike
+ * tinyobj, a face with a position, normal or texture coordinate index out of
+ * bounds fails the parse, and getError names its line. Vertex colors, lines,
+ * points and tags are not supported.
+ *
+ */
+class abcg::ObjParser {
+ public:
+  bool parseFromFile(std::string_view path,
+                     std::string_view mtlSearchPath = {});
+
+  [[nodiscard]] const tinyobj::attrib_t &getAttrib() const noexcept {
+    return m_attrib;
+  }
+  [[nodiscard]] const std::vector<tinyobj::shape_t> &getShapes()
+      const noexcept {
+    return m_shapes;
+  }
+  [[nodiscard]] const std::vector<tinyobj::material_t> &getMaterials()
+      const noexcept {
+    return m_materials;
+  }
+  /**
+   * @brief Returns the path of every material library looked for, whether
+   * it was found or not, e.g. to tell when the materials are outdated.
+   */
+  [[nodiscard]] const std::vector<std::string> &getMaterialLibraries()
+      const noexcept {
+    return m_materialLibraries;
+  }
+  [[nodiscard]] const std::string &getError() const noexcept {
+    return m_error;
+  }
+  [[nodiscard]] const std::string &getWarning() const noexcept {
+    return m_warning;
+  }
+
+ private:
+  tinyobj::attrib_t m_attrib;
+  std::vector<tinyobj::shape_t> m_shapes;
+  std::vector<tinyobj::material_t> m_materials;
+  std::vector<std::string> m_materialLibraries;
+  std::string m_error;
+  std::string m_warning;
+};
+
+#endif
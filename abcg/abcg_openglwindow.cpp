@@ -13,8 +13,8 @@
 #include <imgui_impl_sdl.h>
 
 #include <algorithm>
+#include <cppitertools/itertools.hpp>
 #include <fstream>
-#include <regex>
 #include <sstream>
 #include <string_view>
 
@@ -23,30 +23,56 @@
 #include "abcg_application.hpp"
 #include "abcg_embeddedfonts.hpp"
 #include "abcg_openglfunctions.hpp"
-#include "abcg_string.hpp"
+#include "abcg_programcache.hpp"
+#include "abcg_uniformbuffer.hpp"
+
+// Prints how long initializeGL took to run, and the programs it created
+// since the counters were read, with the time saved by the program cache
+void printProgramStats(const abcg::ProgramCache::Stats &previous,
+                       double initializeTime, std::string_view compileMode) {
+  const auto stats{abcg::ProgramCache::getInstance().getStats()};
+  const auto hits{stats.hits - previous.hits};
+  const auto misses{stats.misses - previous.misses};
+  if (hits + misses == 0) return;
+
+  const auto loadTime{stats.loadTime - previous.loadTime};
+  const auto savedCompileTime{stats.savedCompileTime -
+                              previous.savedCompileTime};
+  fmt::print(
+      "initializeGL took {:.1f} ms with {}: created {} programs ({} from "
+      "cached binaries); the program cache saved {:.1f} ms\n",
+      initializeTime * 1000.0, compileMode, hits + misses, hits,
+      (savedCompileTime - loadTime) * 1000.0);
+}
 
-void printShaderInfoLog(GLuint shader, std::string_view prefix) {
-  GLint infoLogLength{};
-  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+// Attaches the per-frame and per-object uniform blocks of a program to their
+// binding points
+void bindUniformBlocks(const abcg::ShaderProgram &program) {
+  program.bindBlock(abcg::FrameBlock::name, abcg::FrameBlock::binding);
+  program.bindBlock(abcg::ObjectBlock::name, abcg::ObjectBlock::binding);
+}
 
-  if (infoLogLength > 0) {
-    std::vector<GLchar> infoLog{};
-    infoLog.reserve(static_cast<size_t>(infoLogLength));
-    glGetShaderInfoLog(shader, infoLogLength, nullptr, infoLog.data());
-    fmt::print("{} information log:\n{}\n", prefix, infoLog.data());
+bool hasExtension(std::string_view name) {
+  GLint numExtensions{};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+  for (auto index : iter::range(numExtensions)) {
+    const auto *extension{reinterpret_cast<const char *>(  // NOLINT
+        glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(index)))};
+    if (extension != nullptr && name == extension) return true;
   }
+  return false;
 }
 
-void printProgramInfoLog(GLuint program) {
-  GLint infoLogLength{};
-  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
-
-  if (infoLogLength > 0) {
-    std::vector<GLchar> infoLog{};
-    infoLog.reserve(static_cast<size_t>(infoLogLength));
-    glGetProgramInfoLog(program, infoLogLength, nullptr, infoLog.data());
-    fmt::print("Program information log:\n{}\n", infoLog.data());
+std::string readShaderFile(std::string_view path, std::string_view type) {
+  std::stringstream source;
+  if (std::ifstream stream(path.data()); stream) {
+    source << stream.rdbuf();
+    stream.close();
+  } else {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read {} shader file {}", type, path))};
   }
+  return source.str();
 }
 
 ImVec4 ColorAlpha(const ImVec4 &color, float alpha) {
@@ -282,116 +308,127 @@ void abcg::OpenGLWindow::resizeGL(int width, int height) {
 
 void abcg::OpenGLWindow::terminateGL() {}
 
-GLuint abcg::OpenGLWindow::createProgramFromFile(
-    std::string_view pathToVertexShader,
-    std::string_view pathToFragmentShader) {
-  std::stringstream vertexShaderSource;
-  if (std::ifstream stream(pathToVertexShader.data()); stream) {
-    vertexShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
-        "Failed to read vertex shader file {}", pathToVertexShader))};
-  }
-
-  std::stringstream fragmentShaderSource;
-  if (std::ifstream stream(pathToFragmentShader.data()); stream) {
-    fragmentShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
-    throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
-        "Failed to read fragment shader file {}", pathToFragmentShader))};
-  }
-
-  return createProgramFromString(vertexShaderSource.str(),
-                                 fragmentShaderSource.str());
+abcg::ShaderProgram abcg::OpenGLWindow::createProgramFromFile(
+    std::string_view pathToVertexShader, std::string_view pathToFragmentShader,
+    const ShaderPreprocessor::Defines &defines) {
+  return createProgramFromString(
+      readShaderFile(pathToVertexShader, "vertex"),
+      readShaderFile(pathToFragmentShader, "fragment"), defines);
 }
 
-GLuint abcg::OpenGLWindow::createProgramFromString(
-    std::string_view vertexShaderSource,
-    std::string_view fragmentShaderSource) {
-  using namespace std::string_literals;
+abcg::ShaderProgram abcg::OpenGLWindow::createProgramFromString(
+    std::string_view vertexShaderSource, std::string_view fragmentShaderSource,
+    const ShaderPreprocessor::Defines &defines) {
+  const std::array sources{ProgramShaders{std::string{vertexShaderSource},
+                                          std::string{fragmentShaderSource},
+                                          defines}};
+  auto program{createProgramsFromStrings(sources).front()};
+  program.wait();
+  return program;
+}
 
-  std::string vsSource{abcg::trimCopy(std::string{vertexShaderSource})};
-#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-  // Remove version header, if any
-  vsSource =
-      std::regex_replace(vsSource, std::regex("#version.*[\r\n|\n|\r]"), "");
-  // Add new header
-  vsSource = m_GLSLVersion + "\n" + vsSource;
-#else
-  // Add version header only if missing
-  if (!vsSource.starts_with("#version"))
-    vsSource = m_GLSLVersion + "\n\n" + vsSource;
-#endif
+/**
+ * @brief Creates programs from shader files.
+ *
+ * @param paths Paths of the vertex and fragment shaders of each program.
+ * @return Programs, in the order of the paths.
+ *
+ * @throw abcg::Exception if a file cannot be read.
+ *
+ * @sa createProgramsFromStrings
+ */
+std::vector<abcg::ShaderProgram> abcg::OpenGLWindow::createProgramsFromFiles(
+    std::span<const ProgramShaders> paths) {
+  std::vector<ProgramShaders> sources;
+  sources.reserve(paths.size());
+  for (const auto &path : paths) {
+    sources.push_back({readShaderFile(path.vertexShader, "vertex"),
+                       readShaderFile(path.fragmentShader, "fragment"),
+                       path.defines});
+  }
+  return createProgramsFromStrings(sources);
+}
 
-  std::string fsSource{abcg::trimCopy(std::string{fragmentShaderSource})};
-#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
-  // Remove version header, if any
-  fsSource =
-      std::regex_replace(fsSource, std::regex("#version.*[\r\n|\n|\r]"), "");
-
-  if (m_openGLSettings.profile == OpenGLProfile::ES) {
-    // c++20
-    // if (auto regex{std::regex("^precision.*float$", std::multiline)};
-    if (auto regex{std::regex("(^|\r\n|\n|\r)precision.*float")};
-        !std::regex_search(fsSource, regex)) {
-      fsSource = "precision mediump float;\n" + fsSource;
+/**
+ * @brief Creates programs from shader sources.
+ *
+ * Every compile and link is submitted before any status is read, so that
+ * the driver can build the programs in parallel, and the status of each
+ * program is checked when the program is first used (see
+ * abcg::ShaderProgram). Programs should therefore be created in one batch,
+ * e.g. at initialization, and their uniforms looked up afterwards.
+ *
+ * The sources are processed by abcg::ShaderPreprocessor, with the defines
+ * of each program and includes from the shaders directory of the assets.
+ *
+ * With OpenGLSettings::parallelShaderCompile set to false, each program is
+ * checked before the next one is submitted, as createProgramFromString
+ * does.
+ *
+ * @param sources Sources of the vertex and fragment shaders of each
+ * program.
+ * @return Programs, in the order of the sources.
+ */
+std::vector<abcg::ShaderProgram> abcg::OpenGLWindow::createProgramsFromStrings(
+    std::span<const ProgramShaders> sources) {
+  auto &programCache{abcg::ProgramCache::getInstance()};
+
+  std::vector<ShaderProgram> programs;
+  programs.reserve(sources.size());
+  for (const auto &source : sources) {
+    using Stage = ShaderPreprocessor::Stage;
+    const auto vsSource{m_shaderPreprocessor.process(
+        source.vertexShader, Stage::Vertex, source.defines)};
+    const auto fsSource{m_shaderPreprocessor.process(
+        source.fragmentShader, Stage::Fragment, source.defines)};
+
+    // Use the binary of the program if it was compiled before
+    const auto cacheKey{programCache.makeKey(vsSource, fsSource)};
+    if (const auto program{programCache.load(cacheKey)}; program != 0) {
+      const ShaderProgram shaderProgram{program};
+      bindUniformBlocks(shaderProgram);
+      programs.push_back(shaderProgram);
+      continue;
     }
-  }
-  // Add new header
-  fsSource = m_GLSLVersion + "\n" + fsSource;
-#else
-  // Add version header only if missing
-  if (!fsSource.starts_with("#version")) {
-    if (m_openGLSettings.profile == OpenGLProfile::ES)
-      fsSource = "precision mediump float;\n\n" + fsSource;
-    fsSource = m_GLSLVersion + "\n\n" + fsSource;
-  }
-#endif
+    const abcg::ElapsedTimer submitTimer;
 
-  GLint compileStatus{};
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-  const char *vsSourceConstChar = vsSource.c_str();
-  glShaderSource(vertexShader, 1, &vsSourceConstChar, nullptr);
-  glCompileShader(vertexShader);
-  glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compileStatus);
-  if (compileStatus == 0) {
-    printShaderInfoLog(vertexShader, "Vertex shader");
-    throw abcg::Exception{
-        abcg::Exception::Runtime("Failed to compile vertex shader")};
-  }
+    // Reading the compile or link status here would make the driver finish
+    // this program before the next one is submitted
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    const char *vsSourceConstChar = vsSource.c_str();
+    glShaderSource(vertexShader, 1, &vsSourceConstChar, nullptr);
+    glCompileShader(vertexShader);
 
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-  const char *fsSourceConstChar = fsSource.c_str();
-  glShaderSource(fragmentShader, 1, &fsSourceConstChar, nullptr);
-  glCompileShader(fragmentShader);
-  glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compileStatus);
-  if (compileStatus == 0) {
-    printShaderInfoLog(fragmentShader, "Fragment shader");
-    glDeleteShader(vertexShader);
-    throw abcg::Exception{
-        abcg::Exception::Runtime("Failed to compile fragment shader")};
-  }
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    const char *fsSourceConstChar = fsSource.c_str();
+    glShaderSource(fragmentShader, 1, &fsSourceConstChar, nullptr);
+    glCompileShader(fragmentShader);
 
-  GLuint shaderProgram = glCreateProgram();
-  glAttachShader(shaderProgram, vertexShader);
-  glAttachShader(shaderProgram, fragmentShader);
-
-  glLinkProgram(shaderProgram);
-  GLint linkStatus{};
-  glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linkStatus);
-  if (linkStatus == 0) {
-    printProgramInfoLog(shaderProgram);
-    glDeleteShader(fragmentShader);
-    glDeleteShader(vertexShader);
-    throw abcg::Exception{abcg::Exception::Runtime("Failed to link program")};
+    GLuint shaderProgram = glCreateProgram();
+#if !defined(__EMSCRIPTEN__)
+    if (programCache.isEnabled()) {
+      glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                          GL_TRUE);
+    }
+#endif
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+
+    // The time saved by the cache is the time taken by the calls above plus
+    // the link time measured by the program, not the time until first use
+    programs.emplace_back(
+        shaderProgram, vertexShader, fragmentShader,
+        m_hasParallelShaderCompile,
+        [cacheKey, submitTime = submitTimer.elapsed()](
+            const ShaderProgram &program, double linkTime) {
+          bindUniformBlocks(program);
+          abcg::ProgramCache::getInstance().save(cacheKey, program.getID(),
+                                                 submitTime + linkTime);
+        });
+    if (!m_openGLSettings.parallelShaderCompile) programs.back().wait();
   }
-
-  glDeleteShader(fragmentShader);
-  glDeleteShader(vertexShader);
-
-  return shaderProgram;
+  return programs;
 }
 
 std::string abcg::OpenGLWindow::getAssetsPath() { return m_assetsPath; }
@@ -562,6 +599,18 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
       m_GLSLVersion = "#version 300 es";
       break;
   }
+  // Shaders get the version of the context, includes from the shaders
+  // directory of the assets and, in OpenGL ES, a default float precision
+#if defined(__EMSCRIPTEN__) || defined(__APPLE__)
+  m_shaderPreprocessor.setVersion(m_GLSLVersion, true);
+#else
+  m_shaderPreprocessor.setVersion(m_GLSLVersion, false);
+#endif
+  m_shaderPreprocessor.setIncludeDirectory(m_assetsPath + "shaders/");
+  if (profile == OpenGLProfile::ES) {
+    m_shaderPreprocessor.setDefaultPrecision("mediump");
+  }
+
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, majorVersion);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minorVersion);
 
@@ -592,7 +641,10 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
                                            fullscreenchangeCallback);
 #endif
 
-  // Create OpenGL context
+  // Create OpenGL context. Contexts of other windows share their objects
+  // (buffers, textures, programs) with it, so that resources such as the
+  // meshes of abcg::MeshRegistry can be used by every window.
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
   m_GLContext = SDL_GL_CreateContext(m_window);
   if (m_GLContext == nullptr) {
     throw abcg::Exception{abcg::Exception::SDL("SDL_GL_CreateContext failed")};
@@ -617,6 +669,13 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   fmt::print("OpenGL version.: {}\n", glGetString(GL_VERSION));
   fmt::print("GLSL version...: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+  // With this extension, the driver compiles shaders on its own threads (as
+  // many as it chooses, by default) until their status is read
+  m_hasParallelShaderCompile =
+      m_openGLSettings.parallelShaderCompile &&
+      (hasExtension("GL_KHR_parallel_shader_compile") ||
+       hasExtension("GL_ARB_parallel_shader_compile"));
+
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -649,7 +708,14 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
     throw abcg::Exception{abcg::Exception::Runtime("Failed to load font file")};
   }
 
+  const auto programStats{abcg::ProgramCache::getInstance().getStats()};
+  const abcg::ElapsedTimer initializeTime;
   initializeGL();
+  const auto *compileMode{
+      !m_openGLSettings.parallelShaderCompile ? "serial shader compilation"
+      : m_hasParallelShaderCompile ? "parallel shader compilation"
+                                   : "deferred shader status checks"};
+  printProgramStats(programStats, initializeTime.elapsed(), compileMode);
 
   if (io.DisplaySize.x >= 0 && io.DisplaySize.y >= 0) {
     int width{static_cast<int>(io.DisplaySize.x)};
@@ -10,16 +10,21 @@
 #ifndef ABCG_OPENGLWINDOW_HPP_
 #define ABCG_OPENGLWINDOW_HPP_
 
+#include <span>
 #include <string>
+#include <vector>
 
 #include "abcg_elapsedtimer.hpp"
 #include "abcg_external.hpp"
+#include "abcg_shaderpreprocessor.hpp"
+#include "abcg_shaderprogram.hpp"
 
 namespace abcg {
 enum class OpenGLProfile;
 class Application;
 class OpenGLWindow;
 struct OpenGLSettings;
+struct ProgramShaders;
 struct WindowSettings;
 #if defined(__EMSCRIPTEN__)
 EM_BOOL fullscreenchangeCallback(int eventType,
@@ -43,6 +48,7 @@ struct abcg::OpenGLSettings {
   int samples{0};
   bool vsync{false};
   bool preserveWebGLDrawingBuffer{false};
+  bool parallelShaderCompile{true};
 };
 
 struct abcg::WindowSettings {
@@ -53,6 +59,17 @@ struct abcg::WindowSettings {
   std::string title{"ABCg Window"};
 };
 
+/**
+ * @brief Shaders of a program: the paths of the shader files, or their
+ * sources, and the macros they are compiled with.
+ *
+ */
+struct abcg::ProgramShaders {
+  std::string vertexShader;
+  std::string fragmentShader;
+  ShaderPreprocessor::Defines defines{};
+};
+
 /**
  * @brief abcg::OpenGLWindow class.
  *
@@ -80,12 +97,18 @@ class abcg::OpenGLWindow {
   virtual void resizeGL(int width, int height);
   virtual void terminateGL();
 
-  [[nodiscard]] GLuint createProgramFromFile(
+  [[nodiscard]] ShaderProgram createProgramFromFile(
       std::string_view pathToVertexShader,
-      std::string_view pathToFragmentShader);
-  [[nodiscard]] GLuint createProgramFromString(
+      std::string_view pathToFragmentShader,
+      const ShaderPreprocessor::Defines& defines = {});
+  [[nodiscard]] ShaderProgram createProgramFromString(
       std::string_view vertexShaderSource,
-      std::string_view fragmentShaderSource);
+      std::string_view fragmentShaderSource,
+      const ShaderPreprocessor::Defines& defines = {});
+  [[nodiscard]] std::vector<ShaderProgram> createProgramsFromFiles(
+      std::span<const ProgramShaders> paths);
+  [[nodiscard]] std::vector<ShaderProgram> createProgramsFromStrings(
+      std::span<const ProgramShaders> sources);
   std::string getAssetsPath();
   [[nodiscard]] double getDeltaTime() const;
   [[nodiscard]] double getElapsedTime() const;
@@ -101,6 +124,10 @@ class abcg::OpenGLWindow {
 
   std::string m_assetsPath{};
   std::string m_GLSLVersion{};
+  ShaderPreprocessor m_shaderPreprocessor;
+  // Whether the driver compiles shaders in parallel, with
+  // GL_COMPLETION_STATUS_KHR
+  bool m_hasParallelShaderCompile{false};
 
   SDL_Window* m_window{};
   SDL_GLContext m_GLContext{};
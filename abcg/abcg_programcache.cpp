@@ -0,0 +1,244 @@
+/**
+ * @file abcg_programcache.cpp
+ * @brief Definition of abcg::ProgramCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_programcache.hpp"
+
+#include <fmt/core.h>
+
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include "abcg_elapsedtimer.hpp"
+#include "abcg_hash.hpp"
+
+namespace {
+// Bump whenever the layout of the binary files changes
+constexpr std::uint32_t formatVersion{1};
+constexpr std::array<char, 8> formatMagic{'A', 'B', 'C', 'G',
+                                          'P', 'R', 'O', 'G'};
+
+struct Header {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t binaryFormat{};
+  std::uint64_t key{};
+  double compileTime{};
+  std::uint64_t size{};
+  std::uint64_t checksum{};
+};
+
+std::string_view getString(GLenum name) {
+  const auto *string{glGetString(name)};
+  return string == nullptr
+             ? std::string_view{}
+             : std::string_view{reinterpret_cast<const char *>(  // NOLINT
+                   string)};
+}
+}  // namespace
+
+/**
+ * @brief Returns the cache shared by the whole application.
+ */
+abcg::ProgramCache &abcg::ProgramCache::getInstance() {
+  static ProgramCache cache;
+  return cache;
+}
+
+// The binaries are stored in the temporary directory by default, so that
+// read-only asset directories are not a problem
+abcg::ProgramCache::ProgramCache() {
+  std::error_code error;
+  const auto temporaryPath{std::filesystem::temp_directory_path(error)};
+  if (!error) m_directory = (temporaryPath / "abcg" / "programs").string();
+}
+
+/**
+ * @brief Returns the key of a program in the cache.
+ *
+ * @param vertexShaderSource Final source of the vertex shader.
+ * @param fragmentShaderSource Final source of the fragment shader.
+ * @return Hash of the sources and of the strings that identify the driver.
+ */
+std::uint64_t abcg::ProgramCache::makeKey(
+    std::string_view vertexShaderSource,
+    std::string_view fragmentShaderSource) {
+  if (m_driverHash == 0) {
+    m_driverHash = hashString(getString(GL_VENDOR));
+    m_driverHash = hashString(getString(GL_RENDERER), m_driverHash);
+    m_driverHash = hashString(getString(GL_VERSION), m_driverHash);
+  }
+  auto key{hashString(vertexShaderSource, m_driverHash)};
+  // Sizes keep the boundary between the two sources in the hash
+  key = hashCombine(key, vertexShaderSource.size());
+  return hashString(fragmentShaderSource, key);
+}
+
+/**
+ * @brief Creates a program from its stored binary.
+ *
+ * A binary rejected by the driver (e.g. after a driver update that keeps
+ * the version string) is deleted.
+ *
+ * @param key Key of the program.
+ * @return Linked program, or 0 if there is no valid binary.
+ */
+GLuint abcg::ProgramCache::load(std::uint64_t key) {
+#if defined(__EMSCRIPTEN__)
+  static_cast<void>(key);
+  return 0;
+#else
+  if (!isEnabled()) return 0;
+
+  abcg::ElapsedTimer timer;
+  const auto path{getCachePath(key)};
+  std::ifstream input(path, std::ios::binary);
+  if (!input) return 0;
+  const std::vector<char> file{std::istreambuf_iterator<char>{input},
+                               std::istreambuf_iterator<char>{}};
+
+  Header header;
+  if (file.size() < sizeof(header)) return 0;
+  std::memcpy(&header, file.data(), sizeof(header));
+  const auto binary{std::as_bytes(std::span{file}.subspan(sizeof(header)))};
+  if (header.magic != formatMagic || header.version != formatVersion ||
+      header.key != key || header.size != binary.size() ||
+      hashBytes(binary) != header.checksum) {
+    return 0;
+  }
+
+  const auto program{glCreateProgram()};
+  glProgramBinary(program, header.binaryFormat, binary.data(),
+                  static_cast<GLsizei>(binary.size()));
+  GLint linkStatus{};
+  glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus == 0) {
+    glDeleteProgram(program);
+    input.close();
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    ++m_stats.rejected;
+    return 0;
+  }
+
+  ++m_stats.hits;
+  m_stats.loadTime += timer.elapsed();
+  m_stats.savedCompileTime += header.compileTime;
+  return program;
+#endif
+}
+
+/**
+ * @brief Stores the binary of a program compiled from source, and counts
+ * it as a miss.
+ *
+ * Failing to write the binary (e.g. the driver supports no binary format)
+ * is not an error: the program is simply compiled again on the next start.
+ * The program should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+ *
+ * @param key Key of the program.
+ * @param program Linked program.
+ * @param compileTime Time taken to compile and link the program, in
+ * seconds.
+ * @return Whether the binary was written.
+ */
+bool abcg::ProgramCache::save(std::uint64_t key, GLuint program,
+                              double compileTime) {
+  ++m_stats.misses;
+  m_stats.compileTime += compileTime;
+#if defined(__EMSCRIPTEN__)
+  static_cast<void>(key);
+  static_cast<void>(program);
+  return false;
+#else
+  if (!isEnabled()) return false;
+
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (numFormats == 0 || length <= 0) return false;
+
+  std::vector<std::byte> binary(static_cast<std::size_t>(length));
+  GLsizei size{};
+  GLenum binaryFormat{};
+  glGetProgramBinary(program, length, &size, &binaryFormat, binary.data());
+  binary.resize(static_cast<std::size_t>(size));
+  if (binary.empty()) return false;
+
+  Header header{.magic = formatMagic,
+                .version = formatVersion,
+                .binaryFormat = binaryFormat,
+                .key = key,
+                .compileTime = compileTime,
+                .size = binary.size(),
+                .checksum = hashBytes(binary)};
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  if (error) return false;
+
+  // Write to a temporary file first so that another instance never reads a
+  // partially written binary
+  const auto path{getCachePath(key)};
+  const auto temporaryPath{path + ".tmp"};
+  {
+    std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!output) return false;
+    output.write(reinterpret_cast<const char *>(&header),  // NOLINT
+                 sizeof(header));
+    output.write(reinterpret_cast<const char *>(binary.data()),  // NOLINT
+                 static_cast<std::streamsize>(binary.size()));
+    if (!output) return false;
+  }
+
+  std::filesystem::rename(temporaryPath, path, error);
+  if (error) {
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+  }
+  return true;
+#endif
+}
+
+/**
+ * @brief Sets the directory of the binary files.
+ *
+ * The directory is created when the first binary is stored.
+ *
+ * @param directory Path to the directory. An empty path disables the cache.
+ */
+void abcg::ProgramCache::setDirectory(std::string_view directory) {
+  m_directory = directory;
+}
+
+/**
+ * @brief Returns whether programs are loaded from and stored to the cache.
+ */
+bool abcg::ProgramCache::isEnabled() const {
+#if defined(__EMSCRIPTEN__)
+  return false;
+#else
+  return !m_directory.empty();
+#endif
+}
+
+/**
+ * @brief Returns the path of the binary file of a program.
+ *
+ * @param key Key of the program.
+ * @return Path of the binary file.
+ */
+std::string abcg::ProgramCache::getCachePath(std::uint64_t key) const {
+  return (std::filesystem::path{m_directory} / fmt::format("{:016x}.bin", key))
+      .string();
+}
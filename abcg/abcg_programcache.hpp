@@ -0,0 +1,94 @@
+/**
+ * @file abcg_programcache.hpp
+ * @brief abcg::ProgramCache header file.
+ *
+ * Declaration of abcg::ProgramCache class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROGRAMCACHE_HPP_
+#define ABCG_PROGRAMCACHE_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace abcg {
+class ProgramCache;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ProgramCache class.
+ *
+ * On-disk cache of linked program binaries, so that the programs created by
+ * abcg::OpenGLWindow::createProgramFromString are compiled from source only
+ * once per driver.
+ *
+ * A program is stored under a key made of a hash of its final shader
+ * sources (after the version and precision headers are added), of
+ * GL_VENDOR, GL_RENDERER and GL_VERSION, so that a driver update or another
+ * GPU never gets an incompatible binary. Binaries are read back with
+ * glProgramBinary; a binary rejected by the driver is deleted, and the
+ * program is compiled from source and stored again.
+ *
+ * Each binary file also records how long the program took to compile and
+ * link, so that the time saved by the cache can be reported.
+ *
+ * Program binaries are not available in WebGL, where the cache does
+ * nothing. All functions must be called on a thread with a current OpenGL
+ * context.
+ *
+ */
+class abcg::ProgramCache {
+ public:
+  /**
+   * @brief Counters of the cache since the start.
+   */
+  struct Stats {
+    /** @brief Programs loaded from their binaries. */
+    std::size_t hits{};
+    /** @brief Programs compiled from source. */
+    std::size_t misses{};
+    /** @brief Binaries rejected by the driver. */
+    std::size_t rejected{};
+    /** @brief Time spent loading binaries, in seconds. */
+    double loadTime{};
+    /** @brief Time spent compiling and linking from source, in seconds. */
+    double compileTime{};
+    /** @brief Time the programs loaded took to compile when stored, in
+     * seconds. */
+    double savedCompileTime{};
+  };
+
+  ProgramCache(const ProgramCache &) = delete;
+  ProgramCache(ProgramCache &&) = delete;
+  ProgramCache &operator=(const ProgramCache &) = delete;
+  ProgramCache &operator=(ProgramCache &&) = delete;
+
+  [[nodiscard]] static ProgramCache &getInstance();
+
+  [[nodiscard]] std::uint64_t makeKey(std::string_view vertexShaderSource,
+                                      std::string_view fragmentShaderSource);
+  [[nodiscard]] GLuint load(std::uint64_t key);
+  bool save(std::uint64_t key, GLuint program, double compileTime);
+
+  void setDirectory(std::string_view directory);
+  [[nodiscard]] std::string getDirectory() const { return m_directory; }
+  [[nodiscard]] bool isEnabled() const;
+  [[nodiscard]] std::string getCachePath(std::uint64_t key) const;
+  [[nodiscard]] Stats getStats() const { return m_stats; }
+
+ private:
+  ProgramCache();
+  ~ProgramCache() = default;
+
+  std::string m_directory;
+  // Hash of the driver strings, computed on first use
+  std::uint64_t m_driverHash{};
+  Stats m_stats;
+};
+
+#endif
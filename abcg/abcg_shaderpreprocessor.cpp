@@ -0,0 +1,194 @@
+/**
+ * @file abcg_shaderpreprocessor.cpp
+ * @brief Definition of abcg::ShaderPreprocessor class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shaderpreprocessor.hpp"
+
+#include <fmt/core.h>
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Calls function for each line of text, without its line break
+template <typename TFun>
+void forEachLine(std::string_view text, TFun function) {
+  while (!text.empty()) {
+    const auto end{text.find('\n')};
+    auto line{text.substr(0, end)};
+    if (line.ends_with('\r')) line.remove_suffix(1);
+    function(line);
+    if (end == std::string_view::npos) break;
+    text.remove_prefix(end + 1);
+  }
+}
+
+std::string_view trimStart(std::string_view text) {
+  const auto start{text.find_first_not_of(" \t")};
+  return start == std::string_view::npos ? std::string_view{}
+                                         : text.substr(start);
+}
+
+// Whether a directive (the text after '#') has the given name
+bool isDirective(std::string_view directive, std::string_view name) {
+  if (!directive.starts_with(name)) return false;
+  if (directive.size() == name.size()) return true;
+  const auto next{static_cast<unsigned char>(directive[name.size()])};
+  return std::isalnum(next) == 0 && next != '_';
+}
+
+// Returns the file name of an #include, given the text after "include"
+std::string_view getIncludeName(std::string_view arguments) {
+  arguments = trimStart(arguments);
+  if (arguments.size() >= 2 && (arguments[0] == '"' || arguments[0] == '<')) {
+    const auto closing{arguments[0] == '"' ? '"' : '>'};
+    if (const auto end{arguments.find(closing, 1)};
+        end != std::string_view::npos && end > 1) {
+      return arguments.substr(1, end - 1);
+    }
+  }
+  throw abcg::Exception{abcg::Exception::Runtime(
+      fmt::format("Malformed #include directive: {}", arguments))};
+}
+
+std::string readFile(const std::string &path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read shader include file {}", path))};
+  }
+  std::stringstream source;
+  source << stream.rdbuf();
+  return source.str();
+}
+}  // namespace
+
+/**
+ * @brief Sets the directory where included files are looked up.
+ *
+ * @param directory Path of the directory, usually the shaders directory of
+ * the assets.
+ */
+void abcg::ShaderPreprocessor::setIncludeDirectory(std::string_view directory) {
+  m_includeDirectory = directory;
+}
+
+/**
+ * @brief Sets the version line of the processed shaders.
+ *
+ * @param version Version line, such as "#version 300 es".
+ * @param replaceVersion Whether the version line of the sources is replaced.
+ * If false, only sources without a version line get this one.
+ */
+void abcg::ShaderPreprocessor::setVersion(std::string_view version,
+                                          bool replaceVersion) {
+  m_version = version;
+  m_replaceVersion = replaceVersion;
+}
+
+/**
+ * @brief Sets the default float precision of fragment shaders.
+ *
+ * @param precision Precision qualifier, such as "mediump", or an empty
+ * string to add no precision statement.
+ */
+void abcg::ShaderPreprocessor::setDefaultPrecision(
+    std::string_view precision) {
+  m_precision = precision;
+}
+
+/**
+ * @brief Processes the source of a shader.
+ *
+ * @param source GLSL source.
+ * @param stage Stage of the shader.
+ * @param defines Macros to define after the version line.
+ * @return Source ready to be compiled.
+ *
+ * @throw abcg::Exception if an #include is malformed or its file cannot be
+ * read.
+ */
+std::string abcg::ShaderPreprocessor::process(std::string_view source,
+                                              Stage stage,
+                                              const Defines &defines) const {
+  Context context;
+  context.output.reserve(source.size());
+  expand(source, 0, context);
+
+  std::string header;
+  if (const auto &version{m_replaceVersion || context.version.empty()
+                              ? m_version
+                              : context.version};
+      !version.empty()) {
+    header += version + "\n";
+  }
+  if (stage == Stage::Fragment && !m_precision.empty() &&
+      !context.hasPrecision) {
+    header += fmt::format("precision {} float;\n", m_precision);
+  }
+  for (const auto &[name, value] : defines) {
+    header += value.empty() ? fmt::format("#define {}\n", name)
+                            : fmt::format("#define {} {}\n", name, value);
+  }
+  header += "#line 1 0\n";
+
+  return header + context.output;
+}
+
+// Appends a source to the output, with its includes expanded
+void abcg::ShaderPreprocessor::expand(std::string_view source,
+                                      int sourceNumber,
+                                      Context &context) const {
+  auto &output{context.output};
+  auto lineNumber{0};
+  forEachLine(source, [&](std::string_view line) {
+    ++lineNumber;
+    const auto text{trimStart(line)};
+
+    if (text.starts_with('#')) {
+      const auto directive{trimStart(text.substr(1))};
+      if (isDirective(directive, "version")) {
+        if (sourceNumber == 0 && context.version.empty()) {
+          context.version = text;
+        }
+        output += '\n';
+        return;
+      }
+      if (isDirective(directive, "pragma") &&
+          isDirective(trimStart(directive.substr(6)), "once")) {
+        output += '\n';
+        return;
+      }
+      if (isDirective(directive, "include")) {
+        const auto name{getIncludeName(directive.substr(7))};
+        const auto path{
+            (std::filesystem::path{m_includeDirectory} / name)
+                .lexically_normal()
+                .string()};
+        if (!context.included.insert(path).second) {
+          output += '\n';
+          return;
+        }
+
+        const auto includeNumber{context.numSources++};
+        output += fmt::format("#line 1 {}\n", includeNumber);
+        expand(readFile(path), includeNumber, context);
+        output += fmt::format("#line {} {}\n", lineNumber + 1, sourceNumber);
+        return;
+      }
+    } else if (text.starts_with("precision") &&
+               text.find("float") != std::string_view::npos) {
+      context.hasPrecision = true;
+    }
+
+    output += line;
+    output += '\n';
+  });
+}
@@ -0,0 +1,88 @@
+/**
+ * @file abcg_shaderpreprocessor.hpp
+ * @brief abcg::ShaderPreprocessor header file.
+ *
+ * Declaration of abcg::ShaderPreprocessor class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADERPREPROCESSOR_HPP_
+#define ABCG_SHADERPREPROCESSOR_HPP_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace abcg {
+class ShaderPreprocessor;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ShaderPreprocessor class.
+ *
+ * Prepares GLSL sources for the current context, in a single pass over
+ * their lines:
+ *
+ * - The @c \#version line is replaced with (or, if missing, set to) the
+ *   version of the context;
+ * - Fragment shaders get a default float precision if they declare none,
+ *   as required by GLSL ES;
+ * - Macros of a define map are defined after the version line, so that
+ *   variants of a shader are made from a single file;
+ * - @c \#include "file" lines are replaced with the contents of the file,
+ *   looked up in the include directory. Each file is included at most once
+ *   per shader, as if it had include guards, so shared files may include
+ *   each other. @c \#pragma once lines are dropped.
+ *
+ * Directives are recognized at the start of lines only, and an include in
+ * a disabled @c \#if block is resolved all the same.
+ *
+ * @c \#line directives keep the line numbers of compiler messages right.
+ * Their source string number is 0 for the shader itself, and then numbers
+ * the included files in the order they are included.
+ *
+ */
+class abcg::ShaderPreprocessor {
+ public:
+  /**
+   * @brief Macros by name. An empty value defines the macro with no
+   * replacement.
+   */
+  using Defines = std::map<std::string, std::string, std::less<>>;
+
+  /**
+   * @brief Shader stages.
+   */
+  enum class Stage { Vertex, Fragment };
+
+  void setIncludeDirectory(std::string_view directory);
+  void setVersion(std::string_view version, bool replaceVersion);
+  void setDefaultPrecision(std::string_view precision);
+
+  [[nodiscard]] std::string process(std::string_view source, Stage stage,
+                                    const Defines &defines = {}) const;
+
+ private:
+  // State of the expansion of a shader
+  struct Context {
+    std::string output;
+    std::unordered_set<std::string> included;
+    int numSources{1};
+    // Version line of the shader, if any
+    std::string version;
+    bool hasPrecision{false};
+  };
+
+  void expand(std::string_view source, int sourceNumber,
+              Context &context) const;
+
+  std::string m_includeDirectory;
+  std::string m_version;
+  bool m_replaceVersion{true};
+  std::string m_precision;
+};
+
+#endif
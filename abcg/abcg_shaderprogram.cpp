@@ -0,0 +1,471 @@
+/**
+ * @file abcg_shaderprogram.cpp
+ * @brief Definition of abcg::ShaderProgram class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shaderprogram.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "abcg_exception.hpp"
+
+#if !defined(GL_COMPLETION_STATUS_KHR)
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+// Returns the name of an array without its "[0]" suffix
+std::string getBaseName(const std::vector<GLchar> &buffer, GLsizei length) {
+  std::string name{buffer.data(), static_cast<std::size_t>(length)};
+  if (name.ends_with("[0]")) name.resize(name.size() - 3);
+  return name;
+}
+
+std::vector<GLchar> makeNameBuffer(GLuint programID, GLenum maxLengthName) {
+  GLint maxLength{};
+  glGetProgramiv(programID, maxLengthName, &maxLength);
+  return std::vector<GLchar>(static_cast<std::size_t>(std::max(maxLength, 1)));
+}
+
+void printShaderInfoLog(GLuint shader, std::string_view prefix) {
+  GLint infoLogLength{};
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+  if (infoLogLength > 0) {
+    std::vector<GLchar> infoLog(static_cast<std::size_t>(infoLogLength));
+    glGetShaderInfoLog(shader, infoLogLength, nullptr, infoLog.data());
+    fmt::print("{} information log:\n{}\n", prefix, infoLog.data());
+  }
+}
+
+void printProgramInfoLog(GLuint program) {
+  GLint infoLogLength{};
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+  if (infoLogLength > 0) {
+    std::vector<GLchar> infoLog(static_cast<std::size_t>(infoLogLength));
+    glGetProgramInfoLog(program, infoLogLength, nullptr, infoLog.data());
+    fmt::print("Program information log:\n{}\n", infoLog.data());
+  }
+}
+}  // namespace
+
+/**
+ * @brief Reads the active uniforms, attributes and uniform blocks of a
+ * linked program.
+ *
+ * Uniforms of uniform blocks are listed with their blocks only.
+ *
+ * @param programID Linked program.
+ */
+abcg::ShaderProgram::ShaderProgram(GLuint programID)
+    : m_programID{programID}, m_tables{std::make_shared<Tables>()} {
+  reflect();
+}
+
+/**
+ * @brief Wraps a program that may still be compiling and linking.
+ *
+ * The status of the shaders and program is checked by wait, which is called
+ * when the program is first used. The shaders are deleted then.
+ *
+ * @param programID Program whose link was requested.
+ * @param vertexShader Vertex shader attached to the program.
+ * @param fragmentShader Fragment shader attached to the program.
+ * @param hasCompletionStatus Whether GL_KHR_parallel_shader_compile is
+ * available, so that isReady can query GL_COMPLETION_STATUS_KHR.
+ * @param onLinked Function called once the program is linked, e.g. to
+ * store its binary or to bind its uniform blocks.
+ */
+abcg::ShaderProgram::ShaderProgram(GLuint programID, GLuint vertexShader,
+                                   GLuint fragmentShader,
+                                   bool hasCompletionStatus,
+                                   LinkedCallback onLinked)
+    : m_programID{programID}, m_tables{std::make_shared<Tables>()} {
+  m_tables->pending = std::make_unique<Pending>();
+  auto &pending{*m_tables->pending};
+  pending.vertexShader = vertexShader;
+  pending.fragmentShader = fragmentShader;
+  pending.hasCompletionStatus = hasCompletionStatus;
+  pending.onLinked = std::move(onLinked);
+}
+
+/**
+ * @brief Returns the ID of the program, after checking that it is linked.
+ *
+ * @throw abcg::Exception if a shader failed to compile or the program
+ * failed to link.
+ */
+GLuint abcg::ShaderProgram::getID() const {
+  wait();
+  return m_programID;
+}
+
+/**
+ * @brief Returns whether the program can be used without waiting for the
+ * driver.
+ *
+ * Without GL_KHR_parallel_shader_compile, the completion cannot be queried
+ * and a pending program is reported as ready.
+ */
+bool abcg::ShaderProgram::isReady() const {
+  if (!m_tables || !m_tables->pending) return true;
+  if (!m_tables->pending->hasCompletionStatus) return true;
+
+  auto &pending{*m_tables->pending};
+  if (pending.linkTime) return true;
+
+  GLint completed{};
+  glGetProgramiv(m_programID, GL_COMPLETION_STATUS_KHR, &completed);
+  if (completed == 0) return false;
+  pending.linkTime = pending.submitTime.elapsed();
+  return true;
+}
+
+/**
+ * @brief Waits for the program to be linked and checks its status, if not
+ * done yet.
+ *
+ * The link time passed to the linked callback is the time from submission
+ * until isReady first reported the link done. If the program was never
+ * reported ready, it is the time spent waiting here, which is exact when
+ * the program is waited for right after submission.
+ *
+ * @throw abcg::Exception if a shader failed to compile or the program
+ * failed to link. The information logs are printed the first time, and the
+ * same exception is thrown on every later call.
+ */
+void abcg::ShaderProgram::wait() const {
+  if (!m_tables) return;
+  if (!m_tables->error.empty()) throw abcg::Exception{m_tables->error};
+  if (!m_tables->pending) return;
+  const auto pending{std::move(m_tables->pending)};
+  const abcg::ElapsedTimer waitTime;
+
+  const auto checkShader{[](GLuint shader, std::string_view prefix) {
+    GLint compileStatus{};
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
+    if (compileStatus == 0) printShaderInfoLog(shader, prefix);
+    return compileStatus != 0;
+  }};
+  const auto vertexShaderCompiled{
+      checkShader(pending->vertexShader, "Vertex shader")};
+  const auto fragmentShaderCompiled{
+      checkShader(pending->fragmentShader, "Fragment shader")};
+  GLint linkStatus{};
+  glGetProgramiv(m_programID, GL_LINK_STATUS, &linkStatus);
+  const auto linkTime{pending->linkTime.value_or(waitTime.elapsed())};
+  if (vertexShaderCompiled && fragmentShaderCompiled && linkStatus == 0) {
+    printProgramInfoLog(m_programID);
+  }
+  glDeleteShader(pending->fragmentShader);
+  glDeleteShader(pending->vertexShader);
+
+  if (!vertexShaderCompiled) {
+    m_tables->error =
+        abcg::Exception::Runtime("Failed to compile vertex shader");
+  } else if (!fragmentShaderCompiled) {
+    m_tables->error =
+        abcg::Exception::Runtime("Failed to compile fragment shader");
+  } else if (linkStatus == 0) {
+    m_tables->error = abcg::Exception::Runtime("Failed to link program");
+  }
+  if (!m_tables->error.empty()) throw abcg::Exception{m_tables->error};
+
+  reflect();
+  if (pending->onLinked) pending->onLinked(*this, linkTime);
+}
+
+// Fills the tables of a linked program
+void abcg::ShaderProgram::reflect() const {
+  const auto programID{m_programID};
+  auto &tables{*m_tables};
+
+  GLint numUniforms{};
+  glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &numUniforms);
+  auto name{makeNameBuffer(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH)};
+  for (auto index : iter::range(numUniforms)) {
+    GLsizei length{};
+    Variable uniform;
+    glGetActiveUniform(programID, static_cast<GLuint>(index),
+                       static_cast<GLsizei>(name.size()), &length,
+                       &uniform.size, &uniform.type, name.data());
+    uniform.location = glGetUniformLocation(programID, name.data());
+    if (uniform.location < 0) continue;
+
+    uniform.name = getBaseName(name, length);
+    tables.uniformIndices.emplace(uniform.name,
+                                  static_cast<int>(tables.uniforms.size()));
+    tables.uniforms.push_back(std::move(uniform));
+  }
+  tables.values.resize(tables.uniforms.size());
+
+  GLint numAttributes{};
+  glGetProgramiv(programID, GL_ACTIVE_ATTRIBUTES, &numAttributes);
+  name = makeNameBuffer(programID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH);
+  for (auto index : iter::range(numAttributes)) {
+    GLsizei length{};
+    Variable attribute;
+    glGetActiveAttrib(programID, static_cast<GLuint>(index),
+                      static_cast<GLsizei>(name.size()), &length,
+                      &attribute.size, &attribute.type, name.data());
+    attribute.location = glGetAttribLocation(programID, name.data());
+    if (attribute.location < 0) continue;
+
+    attribute.name = getBaseName(name, length);
+    tables.attribLocations.emplace(attribute.name, attribute.location);
+    tables.attributes.push_back(std::move(attribute));
+  }
+
+  GLint numBlocks{};
+  glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+  name = makeNameBuffer(programID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH);
+  for (auto index : iter::range(static_cast<GLuint>(numBlocks))) {
+    GLsizei length{};
+    Block block;
+    block.index = index;
+    glGetActiveUniformBlockName(programID, index,
+                                static_cast<GLsizei>(name.size()), &length,
+                                name.data());
+    glGetActiveUniformBlockiv(programID, index, GL_UNIFORM_BLOCK_DATA_SIZE,
+                              &block.dataSize);
+    glGetActiveUniformBlockiv(programID, index, GL_UNIFORM_BLOCK_BINDING,
+                              &block.binding);
+
+    block.name = std::string{name.data(), static_cast<std::size_t>(length)};
+    tables.blockIndices.emplace(block.name, block.index);
+    tables.blocks.push_back(std::move(block));
+  }
+}
+
+/**
+ * @brief Returns the index of a uniform, for the setUniform functions.
+ *
+ * @param name Name of the uniform. Arrays are named without "[0]".
+ * @return Index of the uniform, or -1 if the program has no such active
+ * uniform. Setting uniform -1 does nothing.
+ */
+int abcg::ShaderProgram::findUniform(std::string_view name) const {
+  if (!m_tables) return -1;
+  wait();
+  const auto iter{m_tables->uniformIndices.find(std::string{name})};
+  return iter == m_tables->uniformIndices.end() ? -1 : iter->second;
+}
+
+/**
+ * @brief Returns the location of a uniform, or -1 if it is not active.
+ */
+GLint abcg::ShaderProgram::getUniformLocation(std::string_view name) const {
+  const auto uniform{findUniform(name)};
+  return uniform < 0
+             ? -1
+             : m_tables->uniforms[static_cast<std::size_t>(uniform)].location;
+}
+
+/**
+ * @brief Returns the location of a vertex attribute, or -1 if it is not
+ * active.
+ */
+GLint abcg::ShaderProgram::getAttribLocation(std::string_view name) const {
+  if (!m_tables) return -1;
+  wait();
+  const auto iter{m_tables->attribLocations.find(std::string{name})};
+  return iter == m_tables->attribLocations.end() ? -1 : iter->second;
+}
+
+/**
+ * @brief Returns the index of a uniform block, or GL_INVALID_INDEX if it is
+ * not active.
+ */
+GLuint abcg::ShaderProgram::getBlockIndex(std::string_view name) const {
+  if (!m_tables) return GL_INVALID_INDEX;
+  wait();
+  const auto iter{m_tables->blockIndices.find(std::string{name})};
+  return iter == m_tables->blockIndices.end() ? GL_INVALID_INDEX
+                                              : iter->second;
+}
+
+/**
+ * @brief Returns the active uniforms outside uniform blocks, in the order
+ * of their indices.
+ */
+std::span<const abcg::ShaderProgram::Variable>
+abcg::ShaderProgram::getUniforms() const {
+  if (!m_tables) return {};
+  wait();
+  return m_tables->uniforms;
+}
+
+/**
+ * @brief Returns the active vertex attributes.
+ */
+std::span<const abcg::ShaderProgram::Variable>
+abcg::ShaderProgram::getAttributes() const {
+  if (!m_tables) return {};
+  wait();
+  return m_tables->attributes;
+}
+
+/**
+ * @brief Returns the active uniform blocks.
+ */
+std::span<const abcg::ShaderProgram::Block> abcg::ShaderProgram::getBlocks()
+    const {
+  if (!m_tables) return {};
+  wait();
+  return m_tables->blocks;
+}
+
+/**
+ * @brief Attaches a uniform block to a uniform buffer binding point.
+ *
+ * This replaces the layout(binding) qualifier, which GLSL 4.10 and GLSL ES
+ * 3.00 do not have.
+ *
+ * @param name Name of the block.
+ * @param binding Binding point, as given to abcg::UniformBuffer::create.
+ * @return Whether the program has such an active block.
+ */
+bool abcg::ShaderProgram::bindBlock(std::string_view name,
+                                    GLuint binding) const {
+  const auto index{getBlockIndex(name)};
+  if (index == GL_INVALID_INDEX) return false;
+
+  glUniformBlockBinding(m_programID, index, binding);
+  for (auto &block : m_tables->blocks) {
+    if (block.index == index) block.binding = static_cast<GLint>(binding);
+  }
+  return true;
+}
+
+/**
+ * @brief Sets an int, bool or sampler uniform, unless it already has the
+ * value.
+ *
+ * The program must be in use, as with glUniform*.
+ *
+ * @param uniform Index returned by findUniform.
+ * @param value Value of the uniform.
+ */
+void abcg::ShaderProgram::setUniform(int uniform, GLint value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniform1i(location, value);
+  }
+}
+
+/**
+ * @overload
+ */
+void abcg::ShaderProgram::setUniform(int uniform, float value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniform1f(location, value);
+  }
+}
+
+/**
+ * @overload
+ */
+void abcg::ShaderProgram::setUniform(int uniform,
+                                     const glm::vec2 &value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniform2fv(location, 1, &value.x);
+  }
+}
+
+/**
+ * @overload
+ */
+void abcg::ShaderProgram::setUniform(int uniform,
+                                     const glm::vec3 &value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniform3fv(location, 1, &value.x);
+  }
+}
+
+/**
+ * @overload
+ */
+void abcg::ShaderProgram::setUniform(int uniform,
+                                     const glm::vec4 &value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniform4fv(location, 1, &value.x);
+  }
+}
+
+/**
+ * @overload
+ */
+void abcg::ShaderProgram::setUniform(int uniform,
+                                     const glm::mat3 &value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+  }
+}
+
+/**
+ * @overload
+ */
+void abcg::ShaderProgram::setUniform(int uniform,
+                                     const glm::mat4 &value) const {
+  if (const auto location{update(uniform, &value, sizeof(value))};
+      location >= 0) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+  }
+}
+
+/**
+ * @brief Forgets the last value of a uniform, so that the next setUniform
+ * uploads its value.
+ *
+ * @param uniform Index returned by findUniform, or -1 to forget the values
+ * of every uniform.
+ */
+void abcg::ShaderProgram::forceUniform(int uniform) const {
+  if (!m_tables) return;
+  if (uniform < 0) {
+    for (auto &value : m_tables->values) {
+      value.isSet = false;
+    }
+  } else if (static_cast<std::size_t>(uniform) < m_tables->values.size()) {
+    m_tables->values[static_cast<std::size_t>(uniform)].isSet = false;
+  }
+}
+
+// Stores the value of a uniform. Returns the location of the uniform if the
+// value changed, or -1 if it did not or if the uniform is not active. Only
+// the first element of arrays is set, and always uploaded.
+GLint abcg::ShaderProgram::update(int uniform, const void *value,
+                                  std::size_t size) const {
+  if (!m_tables || uniform < 0 ||
+      static_cast<std::size_t>(uniform) >= m_tables->uniforms.size()) {
+    return -1;
+  }
+  const auto index{static_cast<std::size_t>(uniform)};
+  const auto &variable{m_tables->uniforms[index]};
+  if (variable.size > 1) return variable.location;
+
+  auto &last{m_tables->values[index]};
+  if (last.isSet && std::memcmp(last.bytes.data(), value, size) == 0) {
+    return -1;
+  }
+  std::memcpy(last.bytes.data(), value, size);
+  last.isSet = true;
+  return variable.location;
+}
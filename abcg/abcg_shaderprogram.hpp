@@ -0,0 +1,164 @@
+/**
+ * @file abcg_shaderprogram.hpp
+ * @brief abcg::ShaderProgram header file.
+ *
+ * Declaration of abcg::ShaderProgram class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADERPROGRAM_HPP_
+#define ABCG_SHADERPROGRAM_HPP_
+
+#include <abcg_external.hpp>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <glm/fwd.hpp>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_elapsedtimer.hpp"
+
+namespace abcg {
+class ShaderProgram;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ShaderProgram class.
+ *
+ * Linked program with the tables of its active uniforms, attributes and
+ * uniform blocks, read once when the program is created.
+ *
+ * Uniforms are looked up by name once (e.g. at initialization) with
+ * findUniform, and set every frame by index with the typed setUniform
+ * overloads. The last value set for each uniform is kept, so that setting
+ * the value a uniform already has makes no OpenGL call. Values are only
+ * tracked for uniforms set through this class: a uniform changed with
+ * glUniform* directly must be set again with forceUniform.
+ *
+ * A program may also be created before its shaders are known to compile,
+ * so that the driver compiles and links several programs in parallel (see
+ * abcg::OpenGLWindow::createProgramsFromStrings). The compile and link
+ * status is then checked when the program is first used, i.e. when it is
+ * converted to GLuint or its tables are read, and a program that failed to
+ * build throws at that point and on every later use. isReady tells whether
+ * the driver has finished without waiting for it.
+ *
+ * The program is not owned: copies share the same program, tables and
+ * last values, and the program is deleted with glDeleteProgram as usual.
+ * For compatibility with code that takes program IDs, the class converts
+ * implicitly to GLuint.
+ *
+ */
+class abcg::ShaderProgram {
+ public:
+  /**
+   * @brief Active uniform or attribute.
+   */
+  struct Variable {
+    /** @brief Name, without the "[0]" suffix of arrays. */
+    std::string name;
+    GLint location{-1};
+    /** @brief Type, such as GL_FLOAT_VEC3 or GL_SAMPLER_2D. */
+    GLenum type{};
+    /** @brief Number of elements of arrays, or 1. */
+    GLint size{};
+  };
+
+  /**
+   * @brief Active uniform block.
+   */
+  struct Block {
+    std::string name;
+    GLuint index{};
+    /** @brief Size in bytes of the block storage. */
+    GLint dataSize{};
+    GLint binding{};
+  };
+
+  /**
+   * @brief Function called once the program is linked, before it is used,
+   * with the time in seconds the driver took to link it (see wait).
+   */
+  using LinkedCallback =
+      std::function<void(const ShaderProgram &, double linkTime)>;
+
+  ShaderProgram() = default;
+  explicit ShaderProgram(GLuint programID);
+  ShaderProgram(GLuint programID, GLuint vertexShader, GLuint fragmentShader,
+                bool hasCompletionStatus, LinkedCallback onLinked);
+
+  [[nodiscard]] GLuint getID() const;
+  // NOLINTNEXTLINE(google-explicit-constructor)
+  operator GLuint() const { return getID(); }
+
+  [[nodiscard]] bool isReady() const;
+  void wait() const;
+
+  [[nodiscard]] int findUniform(std::string_view name) const;
+  [[nodiscard]] GLint getUniformLocation(std::string_view name) const;
+  [[nodiscard]] GLint getAttribLocation(std::string_view name) const;
+  [[nodiscard]] GLuint getBlockIndex(std::string_view name) const;
+
+  [[nodiscard]] std::span<const Variable> getUniforms() const;
+  [[nodiscard]] std::span<const Variable> getAttributes() const;
+  [[nodiscard]] std::span<const Block> getBlocks() const;
+
+  bool bindBlock(std::string_view name, GLuint binding) const;
+
+  void setUniform(int uniform, GLint value) const;
+  void setUniform(int uniform, float value) const;
+  void setUniform(int uniform, const glm::vec2 &value) const;
+  void setUniform(int uniform, const glm::vec3 &value) const;
+  void setUniform(int uniform, const glm::vec4 &value) const;
+  void setUniform(int uniform, const glm::mat3 &value) const;
+  void setUniform(int uniform, const glm::mat4 &value) const;
+  void forceUniform(int uniform) const;
+
+ private:
+  // Last value set for a uniform, up to a 4x4 matrix
+  struct Value {
+    std::array<std::byte, 64> bytes{};
+    bool isSet{false};
+  };
+
+  // Shaders of a program whose status is not checked yet
+  struct Pending {
+    GLuint vertexShader{};
+    GLuint fragmentShader{};
+    // Whether GL_COMPLETION_STATUS_KHR can be queried
+    bool hasCompletionStatus{false};
+    LinkedCallback onLinked;
+    ElapsedTimer submitTime;
+    // Time from submission until isReady first reported the link done
+    std::optional<double> linkTime;
+  };
+
+  struct Tables {
+    std::unique_ptr<Pending> pending;
+    // Why the program failed to build, thrown again on every later use
+    std::string error;
+    std::vector<Variable> uniforms;
+    std::vector<Variable> attributes;
+    std::vector<Block> blocks;
+    std::unordered_map<std::string, int> uniformIndices;
+    std::unordered_map<std::string, GLint> attribLocations;
+    std::unordered_map<std::string, GLuint> blockIndices;
+    std::vector<Value> values;
+  };
+
+  void reflect() const;
+  [[nodiscard]] GLint update(int uniform, const void *value,
+                             std::size_t size) const;
+
+  GLuint m_programID{};
+  std::shared_ptr<Tables> m_tables;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/**
+ * @file abcg_shadervariants.cpp
+ * @brief Definition of abcg::ShaderVariants class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shadervariants.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <limits>
+
+#include "abcg_exception.hpp"
+
+/**
+ * @brief Constructs the variants of a program.
+ *
+ * No program is created until a variant is used.
+ *
+ * @param shaders Paths of the shaders, and defines common to every variant.
+ * @param options Macros that select the variants.
+ * @param createPrograms Function that creates the programs.
+ *
+ * @throw abcg::Exception if the options have more combinations than keys.
+ */
+abcg::ShaderVariants::ShaderVariants(ProgramShaders shaders,
+                                     std::vector<Option> options,
+                                     CreateFunction createPrograms)
+    : m_shaders{std::move(shaders)},
+      m_options{std::move(options)},
+      m_createPrograms{std::move(createPrograms)} {
+  // Each option is a digit of the key, with one more value for undefined
+  std::uint64_t numKeys{1};
+  for (const auto &option : m_options) {
+    if (option.numValues < 1) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Shader option {} has no values", option.name))};
+    }
+    numKeys *= static_cast<std::uint64_t>(option.numValues) + 1;
+    if (numKeys > std::numeric_limits<Key>::max()) {
+      throw abcg::Exception{
+          abcg::Exception::Runtime("Too many shader variant combinations")};
+    }
+  }
+}
+
+/**
+ * @brief Returns the key of a variant.
+ *
+ * @param values Value of each option by name. Options not listed, or whose
+ * value is out of range, are left undefined. Names that are not options are
+ * ignored, so that the same values can select the variants of programs with
+ * different options.
+ * @return Key of the variant.
+ */
+abcg::ShaderVariants::Key abcg::ShaderVariants::makeKey(
+    std::initializer_list<std::pair<std::string_view, int>> values) const {
+  Key key{};
+  Key radix{1};
+  for (const auto &option : m_options) {
+    for (const auto &[name, value] : values) {
+      if (name == option.name && value >= 0 && value < option.numValues) {
+        key += radix * static_cast<Key>(value + 1);
+        break;
+      }
+    }
+    radix *= static_cast<Key>(option.numValues) + 1;
+  }
+  return key;
+}
+
+/**
+ * @brief Returns the macros of a variant.
+ *
+ * @param key Key of the variant.
+ * @return Defines of the shaders, followed by the options defined by the
+ * key.
+ */
+abcg::ShaderPreprocessor::Defines abcg::ShaderVariants::getDefines(
+    Key key) const {
+  auto defines{m_shaders.defines};
+  for (const auto &option : m_options) {
+    const auto radix{static_cast<Key>(option.numValues) + 1};
+    if (const auto digit{key % radix}; digit > 0) {
+      defines.insert_or_assign(option.name, std::to_string(digit - 1));
+    }
+    key /= radix;
+  }
+  return defines;
+}
+
+/**
+ * @brief Returns a variant, creating it if it is not created yet.
+ *
+ * The first call for a key compiles the program and waits for it.
+ *
+ * @param key Key of the variant.
+ * @return Linked program.
+ *
+ * @throw abcg::Exception if the program failed to build.
+ */
+const abcg::ShaderProgram &abcg::ShaderVariants::get(Key key) {
+  prepare({&key, 1});
+  const auto &program{m_programs.at(key)};
+  program.wait();
+  return program;
+}
+
+/**
+ * @brief Returns a variant if it is linked, without waiting for it.
+ *
+ * A variant that is not created yet is submitted for compilation. If the
+ * driver cannot tell whether it has finished, the program is waited for as
+ * in get.
+ *
+ * @param key Key of the variant.
+ * @return Linked program, or nullptr if it is still being built.
+ *
+ * @throw abcg::Exception if the program failed to build.
+ */
+const abcg::ShaderProgram *abcg::ShaderVariants::find(Key key) {
+  prepare({&key, 1});
+  const auto &program{m_programs.at(key)};
+  if (!program.isReady()) return nullptr;
+  program.wait();
+  return &program;
+}
+
+/**
+ * @brief Creates the variants that are not created yet, in one batch.
+ *
+ * Their compile and link status is checked when they are first used.
+ *
+ * @param keys Keys of the variants.
+ *
+ * @throw abcg::Exception if the variants have no create function.
+ */
+void abcg::ShaderVariants::prepare(std::span<const Key> keys) {
+  std::vector<Key> newKeys;
+  std::vector<ProgramShaders> shaders;
+  for (const auto key : keys) {
+    if (m_programs.contains(key) ||
+        std::find(newKeys.begin(), newKeys.end(), key) != newKeys.end()) {
+      continue;
+    }
+    newKeys.push_back(key);
+    shaders.push_back({m_shaders.vertexShader, m_shaders.fragmentShader,
+                       getDefines(key)});
+  }
+  if (shaders.empty()) return;
+  if (!m_createPrograms) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Shader variants have no create function")};
+  }
+
+  auto programs{m_createPrograms(shaders)};
+  for (auto index : iter::range(newKeys.size())) {
+    m_programs.emplace(newKeys.at(index), std::move(programs.at(index)));
+  }
+}
+
+/**
+ * @brief Deletes the programs of the variants created so far.
+ */
+void abcg::ShaderVariants::destroy() {
+  for (const auto &[key, program] : m_programs) {
+    glDeleteProgram(program);
+  }
+  m_programs.clear();
+}
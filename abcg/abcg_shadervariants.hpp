@@ -0,0 +1,99 @@
+/**
+ * @file abcg_shadervariants.hpp
+ * @brief abcg::ShaderVariants header file.
+ *
+ * Declaration of abcg::ShaderVariants class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADERVARIANTS_HPP_
+#define ABCG_SHADERVARIANTS_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "abcg_openglwindow.hpp"
+#include "abcg_shaderprogram.hpp"
+
+namespace abcg {
+class ShaderVariants;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ShaderVariants class.
+ *
+ * Programs specialized from the same shader files, one per combination of
+ * the values of a list of options. Each option is a macro with values from
+ * 0 to its number of values minus 1, e.g. a mapping mode with four values or
+ * a feature flag with two. A shader then selects its code paths with
+ * @c \#if, instead of branching at run time on uniforms, and each variant
+ * only has the code it uses.
+ *
+ * Variants are identified by a key made with makeKey, and are created on
+ * first use, so only the combinations that are drawn are compiled. An
+ * option whose value is out of range is left undefined, and the key in
+ * which every option is undefined (key 0) is the unspecialized program,
+ * whose shaders fall back to run-time branching.
+ *
+ * Programs are created by a function, usually a call to
+ * abcg::OpenGLWindow::createProgramsFromFiles, so that they are
+ * preprocessed, cached and compiled in parallel as the other programs of
+ * the window.
+ *
+ */
+class abcg::ShaderVariants {
+ public:
+  /**
+   * @brief Macro that selects a variant.
+   */
+  struct Option {
+    std::string name;
+    /** @brief Number of values, from 0 to numValues - 1. */
+    int numValues{2};
+  };
+
+  /**
+   * @brief Identifier of a variant.
+   */
+  using Key = std::uint32_t;
+
+  /**
+   * @brief Function that creates programs from shader files and defines.
+   */
+  using CreateFunction = std::function<std::vector<ShaderProgram>(
+      std::span<const ProgramShaders>)>;
+
+  ShaderVariants() = default;
+  ShaderVariants(ProgramShaders shaders, std::vector<Option> options,
+                 CreateFunction createPrograms);
+
+  [[nodiscard]] Key makeKey(
+      std::initializer_list<std::pair<std::string_view, int>> values) const;
+  [[nodiscard]] ShaderPreprocessor::Defines getDefines(Key key) const;
+
+  const ShaderProgram &get(Key key);
+  const ShaderProgram *find(Key key);
+  void prepare(std::span<const Key> keys);
+
+  [[nodiscard]] std::size_t getNumPrograms() const noexcept {
+    return m_programs.size();
+  }
+
+  void destroy();
+
+ private:
+  ProgramShaders m_shaders;
+  std::vector<Option> m_options;
+  CreateFunction m_createPrograms;
+  std::unordered_map<Key, ShaderProgram> m_programs;
+};
+
+#endif
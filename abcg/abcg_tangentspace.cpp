@@ -0,0 +1,251 @@
+/**
+ * @file abcg_tangentspace.cpp
+ * @brief Definition of abcg::TangentSpace class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_tangentspace.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat2x2.hpp>
+#include <limits>
+
+#include "abcg_exception.hpp"
+#include "abcg_threadpool.hpp"
+
+namespace {
+// Values of each face, stored as separate component arrays
+class FaceVectors {
+ public:
+  explicit FaceVectors(std::size_t numFaces)
+      : m_x(numFaces), m_y(numFaces), m_z(numFaces) {}
+
+  void set(std::size_t face, const glm::vec3 &value) noexcept {
+    m_x[face] = value.x;
+    m_y[face] = value.y;
+    m_z[face] = value.z;
+  }
+
+  [[nodiscard]] glm::vec3 get(std::size_t face) const noexcept {
+    return {m_x[face], m_y[face], m_z[face]};
+  }
+
+  // Sums the values of the faces incident to a vertex, in adjacency order
+  [[nodiscard]] glm::vec3 gather(
+      const abcg::TangentSpace::Adjacency &adjacency,
+      std::size_t vertex) const noexcept {
+    glm::vec3 sum{};
+    const auto *faces{adjacency.faces.data()};
+    for (auto position : iter::range(adjacency.offsets[vertex],
+                                     adjacency.offsets[vertex + 1])) {
+      sum += get(faces[position]);
+    }
+    return sum;
+  }
+
+ private:
+  std::vector<float> m_x;
+  std::vector<float> m_y;
+  std::vector<float> m_z;
+};
+
+// Checks that the adjacency was built from the given mesh, so that the
+// kernels can index without bounds checks
+void validateAdjacency(std::span<const std::uint32_t> indices,
+                       std::size_t numVertices,
+                       const abcg::TangentSpace::Adjacency &adjacency) {
+  if (adjacency.offsets.size() != numVertices + 1 ||
+      adjacency.faces.size() != indices.size() ||
+      adjacency.offsets.back() != adjacency.faces.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Vertex adjacency does not match the mesh")};
+  }
+}
+}  // namespace
+
+/**
+ * @brief Builds the vertex-to-face adjacency of an indexed triangle list.
+ *
+ * @param indices Index buffer with three indices per triangle.
+ * @param numVertices Number of vertices.
+ * @return Faces incident to each vertex, in increasing order.
+ *
+ * @throw abcg::Exception if the number of indices is not a multiple of 3 or
+ * if an index is out of bounds.
+ */
+abcg::TangentSpace::Adjacency abcg::TangentSpace::buildAdjacency(
+    std::span<const std::uint32_t> indices, std::size_t numVertices) {
+  if (indices.size() % 3 != 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Number of indices is not a multiple of 3")};
+  }
+  if (indices.size() >= std::numeric_limits<std::uint32_t>::max()) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Too many indices to build adjacency")};
+  }
+
+  Adjacency adjacency;
+  adjacency.offsets.resize(numVertices + 1);
+  for (const auto index : indices) {
+    if (index >= numVertices) {
+      throw abcg::Exception{
+          abcg::Exception::Runtime("Vertex index out of bounds")};
+    }
+    ++adjacency.offsets[index + 1];
+  }
+  for (auto vertex : iter::range(numVertices)) {
+    adjacency.offsets[vertex + 1] += adjacency.offsets[vertex];
+  }
+
+  // Counting sort of corners by vertex keeps faces in increasing order
+  adjacency.faces.resize(indices.size());
+  std::vector<std::uint32_t> next(adjacency.offsets.begin(),
+                                  adjacency.offsets.end() - 1);
+  for (auto &&[corner, index] : iter::enumerate(indices)) {
+    adjacency.faces[next[index]++] = static_cast<std::uint32_t>(corner / 3);
+  }
+
+  return adjacency;
+}
+
+/**
+ * @brief Computes area-weighted vertex normals.
+ *
+ * @param indices Index buffer with three indices per triangle.
+ * @param positions Vertex positions.
+ * @param adjacency Adjacency built from `indices`.
+ * @param maxThreads Maximum number of threads, or 0 to use every thread of
+ * abcg::ThreadPool.
+ * @return Unit normal of each vertex.
+ *
+ * @throw abcg::Exception if `adjacency` does not match the mesh.
+ */
+std::vector<glm::vec3> abcg::TangentSpace::computeNormals(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions, const Adjacency &adjacency,
+    std::size_t maxThreads) {
+  validateAdjacency(indices, positions.size(), adjacency);
+
+  auto &pool{ThreadPool::getInstance()};
+  const auto numFaces{indices.size() / 3};
+
+  // Face normals, not normalized so that larger faces weigh more
+  FaceVectors faceNormals{numFaces};
+  pool.parallelFor(
+      numFaces,
+      [&](std::size_t begin, std::size_t end) {
+        for (auto face : iter::range(begin, end)) {
+          const auto &a{positions[indices[face * 3 + 0]]};
+          const auto &b{positions[indices[face * 3 + 1]]};
+          const auto &c{positions[indices[face * 3 + 2]]};
+          faceNormals.set(face, glm::cross(b - a, c - b));
+        }
+      },
+      maxThreads);
+
+  std::vector<glm::vec3> normals(positions.size());
+  pool.parallelFor(
+      positions.size(),
+      [&](std::size_t begin, std::size_t end) {
+        for (auto vertex : iter::range(begin, end)) {
+          normals[vertex] =
+              glm::normalize(faceNormals.gather(adjacency, vertex));
+        }
+      },
+      maxThreads);
+
+  return normals;
+}
+
+/**
+ * @brief Computes vertex tangents from texture coordinates.
+ *
+ * @param indices Index buffer with three indices per triangle.
+ * @param positions Vertex positions.
+ * @param normals Unit vertex normals.
+ * @param texCoords Vertex texture coordinates.
+ * @param adjacency Adjacency built from `indices`.
+ * @param maxThreads Maximum number of threads, or 0 to use every thread of
+ * abcg::ThreadPool.
+ * @return Unit tangent of each vertex, orthogonal to the normal, with the
+ * handedness of the tangent basis in `w`.
+ *
+ * @throw abcg::Exception if the attribute arrays differ in size or if
+ * `adjacency` does not match the mesh.
+ */
+std::vector<glm::vec4> abcg::TangentSpace::computeTangents(
+    std::span<const std::uint32_t> indices,
+    std::span<const glm::vec3> positions, std::span<const glm::vec3> normals,
+    std::span<const glm::vec2> texCoords, const Adjacency &adjacency,
+    std::size_t maxThreads) {
+  if (normals.size() != positions.size() ||
+      texCoords.size() != positions.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Vertex attribute arrays differ in size")};
+  }
+  validateAdjacency(indices, positions.size(), adjacency);
+
+  auto &pool{ThreadPool::getInstance()};
+  const auto numFaces{indices.size() / 3};
+
+  // Face tangents and bitangents
+  FaceVectors faceTangents{numFaces};
+  FaceVectors faceBitangents{numFaces};
+  pool.parallelFor(
+      numFaces,
+      [&](std::size_t begin, std::size_t end) {
+        for (auto face : iter::range(begin, end)) {
+          const auto i1{indices[face * 3 + 0]};
+          const auto i2{indices[face * 3 + 1]};
+          const auto i3{indices[face * 3 + 2]};
+
+          const auto e1{positions[i2] - positions[i1]};
+          const auto e2{positions[i3] - positions[i1]};
+          const auto delta1{texCoords[i2] - texCoords[i1]};
+          const auto delta2{texCoords[i3] - texCoords[i1]};
+
+          // clang-format off
+          glm::mat2 M;
+          M[0][0] =  delta2.t;
+          M[0][1] = -delta1.t;
+          M[1][0] = -delta2.s;
+          M[1][1] =  delta1.s;
+          M *= (1.0f / (delta1.s * delta2.t - delta2.s * delta1.t));
+
+          faceTangents.set(face, {M[0][0] * e1.x + M[0][1] * e2.x,
+                                  M[0][0] * e1.y + M[0][1] * e2.y,
+                                  M[0][0] * e1.z + M[0][1] * e2.z});
+
+          faceBitangents.set(face, {M[1][0] * e1.x + M[1][1] * e2.x,
+                                    M[1][0] * e1.y + M[1][1] * e2.y,
+                                    M[1][0] * e1.z + M[1][1] * e2.z});
+          // clang-format on
+        }
+      },
+      maxThreads);
+
+  std::vector<glm::vec4> tangents(positions.size());
+  pool.parallelFor(
+      positions.size(),
+      [&](std::size_t begin, std::size_t end) {
+        for (auto vertex : iter::range(begin, end)) {
+          const auto &n{normals[vertex]};
+          const auto t{faceTangents.gather(adjacency, vertex)};
+
+          // Orthogonalize t with respect to n
+          const auto tangent{t - n * glm::dot(n, t)};
+
+          // Compute handedness of re-orthogonalized basis
+          const auto b{glm::cross(n, t)};
+          const auto handedness{
+              glm::dot(b, faceBitangents.gather(adjacency, vertex))};
+          tangents[vertex] = glm::vec4(glm::normalize(tangent),
+                                       (handedness < 0.0f) ? -1.0f : 1.0f);
+        }
+      },
+      maxThreads);
+
+  return tangents;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file abcg_tangentspace.hpp
+ * @brief abcg::TangentSpace header file.
+ *
+ * Declaration of abcg::TangentSpace class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TANGENTSPACE_HPP_
+#define ABCG_TANGENTSPACE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <vector>
+
+namespace abcg {
+class TangentSpace;
+}  // namespace abcg
+
+/**
+ * @brief abcg::TangentSpace class.
+ *
+ * Generates smooth vertex normals and tangents of an indexed triangle list.
+ *
+ * Each function runs in two phases on abcg::ThreadPool: face values are
+ * computed into separate component arrays, and then each vertex gathers the
+ * values of its incident faces through a vertex-to-face adjacency. No two
+ * threads write to the same vertex, and faces are summed in index buffer
+ * order, so the result does not depend on the number of threads.
+ *
+ * The adjacency is built once with buildAdjacency and may be shared by
+ * computeNormals and computeTangents.
+ *
+ */
+class abcg::TangentSpace {
+ public:
+  /**
+   * @brief Faces incident to each vertex, in compressed sparse row form.
+   *
+   * The faces of vertex `i` are `faces[offsets[i]]` to
+   * `faces[offsets[i + 1] - 1]`, in increasing order.
+   */
+  struct Adjacency {
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> faces;
+  };
+
+  [[nodiscard]] static Adjacency buildAdjacency(
+      std::span<const std::uint32_t> indices, std::size_t numVertices);
+
+  [[nodiscard]] static std::vector<glm::vec3> computeNormals(
+      std::span<const std::uint32_t> indices,
+      std::span<const glm::vec3> positions, const Adjacency &adjacency,
+      std::size_t maxThreads = 0);
+  [[nodiscard]] static std::vector<glm::vec4> computeTangents(
+      std::span<const std::uint32_t> indices,
+      std::span<const glm::vec3> positions, std::span<const glm::vec3> normals,
+      std::span<const glm::vec2> texCoords, const Adjacency &adjacency,
+      std::size_t maxThreads = 0);
+};
+
+#endif
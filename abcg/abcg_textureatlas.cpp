@@ -0,0 +1,251 @@
+/**
+ * @file abcg_textureatlas.cpp
+ * @brief Definition of texture array and texture atlas builders.
+ *
+ * This project is released under the MIT License.
+ */
+
+// imgui compiles stb_rect_pack with internal linkage, so this file compiles
+// its own copy
+#define STBRP_STATIC
+#define STBRP_LARGE_RECTS
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "abcg_textureatlas.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <cstddef>
+#include <glm/vec2.hpp>
+
+#include "abcg_exception.hpp"
+#include "imstb_rectpack.h"
+
+namespace {
+// Copies an image into an RGBA layer with its lower-left corner at (x, y).
+// The border pixels of the image are repeated over a margin around it, so
+// that filtering does not blend in the neighboring images.
+void blitImage(const abcg::opengl::Image &image, std::vector<std::byte> &layer,
+               glm::ivec2 layerSize, int x, int y, int margin) {
+  const auto channels{image.format == GL_RGBA ? 4 : 3};
+  for (auto row : iter::range(-margin, image.height + margin)) {
+    const auto layerRow{y + row};
+    if (layerRow < 0 || layerRow >= layerSize.y) continue;
+
+    const auto sourceRow{std::clamp(row, 0, image.height - 1)};
+    const auto *source{image.pixels.data() +
+                       image.getRowSize() *
+                           static_cast<std::size_t>(sourceRow)};
+    auto *target{layer.data() + static_cast<std::size_t>(layerRow) *
+                                    static_cast<std::size_t>(layerSize.x) * 4};
+    for (auto column : iter::range(-margin, image.width + margin)) {
+      const auto layerColumn{x + column};
+      if (layerColumn < 0 || layerColumn >= layerSize.x) continue;
+
+      const auto sourceColumn{std::clamp(column, 0, image.width - 1)};
+      const auto *texel{source + sourceColumn * channels};
+      auto *targetTexel{target + layerColumn * 4};
+      std::copy_n(texel, 3, targetTexel);
+      targetTexel[3] = channels == 4 ? texel[3] : std::byte{255};
+    }
+  }
+}
+
+// Creates and binds an RGBA texture array without content
+GLuint allocateTextureArray(int width, int height, int numLayers) {
+  GLint maxLayers{};
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  if (numLayers > maxLayers) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Texture array needs {} layers, but at most {} are "
+                    "supported",
+                    numLayers, maxLayers))};
+  }
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, numLayers, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  return textureID;
+}
+
+void uploadLayer(int width, int height, int layer, const std::byte *pixels) {
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1,
+                  GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+// Sets the sampling parameters of the bound texture array, after its
+// layers are uploaded, and unbinds it
+void finishTextureArray(bool generateMipmaps, GLint wrap) {
+  if (generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+  } else {
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  }
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+}  // namespace
+
+/**
+ * @brief Creates a texture array with one image per layer.
+ *
+ * Every region covers its whole layer, so the texture coordinates of the
+ * objects are used as is, and textures can be repeated. RGB images are
+ * stored as opaque RGBA.
+ *
+ * @param images Images of the same size.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture array and the region of each image.
+ *
+ * @throw abcg::Exception if there are no images, if their sizes differ, or
+ * if there are more images than the context supports layers.
+ */
+abcg::opengl::TextureAtlas
+abcg::opengl::createTextureArray(std::span<const Image> images,
+                                 bool generateMipmaps) {
+  if (images.empty()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Cannot create a texture array without images")};
+  }
+
+  TextureAtlas atlas;
+  atlas.width = images.front().width;
+  atlas.height = images.front().height;
+  atlas.numLayers = static_cast<int>(images.size());
+  for (auto &&[index, image] : iter::enumerate(images)) {
+    if (image.width != atlas.width || image.height != atlas.height) {
+      throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+          "Image {} is {}x{}, but the texture array is {}x{}", index,
+          image.width, image.height, atlas.width, atlas.height))};
+    }
+    AtlasRegion region;
+    region.layer = static_cast<int>(index);
+    atlas.regions.push_back(region);
+  }
+
+  atlas.textureID =
+      allocateTextureArray(atlas.width, atlas.height, atlas.numLayers);
+  std::vector<std::byte> layer;
+  for (auto &&[index, image] : iter::enumerate(images)) {
+    if (image.format == GL_RGBA) {
+      uploadLayer(atlas.width, atlas.height, static_cast<int>(index),
+                  image.pixels.data());
+      continue;
+    }
+    layer.resize(static_cast<std::size_t>(atlas.width) *
+                 static_cast<std::size_t>(atlas.height) * 4);
+    blitImage(image, layer, {atlas.width, atlas.height}, 0, 0, 0);
+    uploadLayer(atlas.width, atlas.height, static_cast<int>(index),
+                layer.data());
+  }
+  finishTextureArray(generateMipmaps, GL_REPEAT);
+
+  return atlas;
+}
+
+/**
+ * @brief Packs images of any size into the layers of a texture array.
+ *
+ * Images are packed with stb_rect_pack into square layers, and a layer is
+ * added whenever the images left do not fit. The texture coordinates of an
+ * object are mapped to the uvRect of its region, so its textures cannot be
+ * repeated.
+ *
+ * Each image is surrounded by a copy of its border pixels, so that images do
+ * not bleed into each other when filtered. With mipmaps, the padding shrinks
+ * at each level, so small padding only protects the finest levels.
+ *
+ * @param images Images to pack. RGB images are stored as opaque RGBA.
+ * @param size Width and height of the layers.
+ * @param padding Number of pixels around each image.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ * @return Texture array and the region of each image.
+ *
+ * @throw abcg::Exception if there are no images, if an image does not fit in
+ * a layer, or if the context does not support enough layers.
+ */
+abcg::opengl::TextureAtlas abcg::opengl::createTextureAtlas(
+    std::span<const Image> images, int size, int padding,
+    bool generateMipmaps) {
+  if (images.empty()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Cannot create a texture atlas without images")};
+  }
+
+  std::vector<stbrp_rect> rects;
+  rects.reserve(images.size());
+  for (auto &&[index, image] : iter::enumerate(images)) {
+    if (image.width + 2 * padding > size || image.height + 2 * padding > size) {
+      throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+          "Image {} is {}x{}, which does not fit in a {}x{} atlas layer",
+          index, image.width, image.height, size, size))};
+    }
+    stbrp_rect rect{};
+    rect.id = static_cast<int>(index);
+    rect.w = image.width + 2 * padding;
+    rect.h = image.height + 2 * padding;
+    rects.push_back(rect);
+  }
+
+  // Pack the images left into a new layer until every image is packed. A
+  // layer always takes at least one image, since each image fits alone.
+  TextureAtlas atlas;
+  atlas.width = size;
+  atlas.height = size;
+  atlas.regions.resize(images.size());
+  std::vector<stbrp_node> nodes(static_cast<std::size_t>(size));
+  std::span<stbrp_rect> pending{rects};
+  while (!pending.empty()) {
+    stbrp_context context{};
+    stbrp_init_target(&context, size, size, nodes.data(),
+                      static_cast<int>(nodes.size()));
+    stbrp_pack_rects(&context, pending.data(),
+                     static_cast<int>(pending.size()));
+
+    const auto unpacked{std::partition(
+        pending.begin(), pending.end(),
+        [](const auto &rect) { return rect.was_packed != 0; })};
+    for (const auto &rect : std::span{pending.begin(), unpacked}) {
+      const auto &image{images[static_cast<std::size_t>(rect.id)]};
+      const auto x{rect.x + padding};
+      const auto y{rect.y + padding};
+      const auto inverseSize{1.0f / static_cast<float>(size)};
+      auto &region{atlas.regions.at(static_cast<std::size_t>(rect.id))};
+      region.layer = atlas.numLayers;
+      region.uvRect = glm::vec4{static_cast<float>(x),
+                                static_cast<float>(y),
+                                static_cast<float>(x + image.width),
+                                static_cast<float>(y + image.height)} *
+                      inverseSize;
+    }
+    pending = std::span{unpacked, pending.end()};
+    ++atlas.numLayers;
+  }
+
+  // Fill and upload the layers one at a time
+  atlas.textureID = allocateTextureArray(size, size, atlas.numLayers);
+  std::vector<std::byte> layer;
+  for (auto layerIndex : iter::range(atlas.numLayers)) {
+    layer.assign(static_cast<std::size_t>(size) *
+                     static_cast<std::size_t>(size) * 4,
+                 std::byte{});
+    for (const auto &rect : rects) {
+      const auto &region{atlas.regions.at(static_cast<std::size_t>(rect.id))};
+      if (region.layer != layerIndex) continue;
+      blitImage(images[static_cast<std::size_t>(rect.id)], layer, {size, size},
+                rect.x + padding, rect.y + padding, padding);
+    }
+    uploadLayer(size, size, layerIndex, layer.data());
+  }
+  finishTextureArray(generateMipmaps, GL_CLAMP_TO_EDGE);
+
+  return atlas;
+}
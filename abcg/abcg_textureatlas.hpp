@@ -0,0 +1,55 @@
+/**
+ * @file abcg_textureatlas.hpp
+ * @brief Declaration of texture array and texture atlas builders.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TEXTUREATLAS_HPP_
+#define ABCG_TEXTUREATLAS_HPP_
+
+#include <abcg_external.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <vector>
+
+#include "abcg_image.hpp"
+
+namespace abcg::opengl {
+/**
+ * @brief Place of an image in a texture atlas.
+ */
+struct AtlasRegion {
+  /** @brief Layer of the texture array. */
+  int layer{};
+  /** @brief Texture coordinates of the lower-left (x, y) and upper-right
+   * (z, w) corners of the image in the layer. */
+  glm::vec4 uvRect{0.0f, 0.0f, 1.0f, 1.0f};
+};
+
+/**
+ * @brief Images packed into the layers of a GL_TEXTURE_2D_ARRAY texture.
+ *
+ * A set of objects that sample different images can be drawn with a single
+ * texture binding: each object samples the array with the texture
+ * coordinates mapped to the uvRect of its region, and the layer of its
+ * region.
+ */
+struct TextureAtlas {
+  GLuint textureID{};
+  int width{};
+  int height{};
+  int numLayers{};
+  /** @brief Region of each image, in the order the images were given. */
+  std::vector<AtlasRegion> regions;
+};
+
+[[nodiscard]] TextureAtlas createTextureArray(std::span<const Image> images,
+                                              bool generateMipmaps = true);
+[[nodiscard]] TextureAtlas createTextureAtlas(std::span<const Image> images,
+                                              int size = 2048,
+                                              int padding = 2,
+                                              bool generateMipmaps = true);
+}  // namespace abcg::opengl
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @file abcg_texturecache.cpp
+ * @brief Definition of abcg::TextureCache class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_texturecache.hpp"
+
+#include <fmt/core.h>
+
+#include <filesystem>
+#include <system_error>
+
+#include "abcg_hash.hpp"
+#include "abcg_mappedfile.hpp"
+#include "abcg_mipstreamer.hpp"
+
+/**
+ * @brief Deletes the texture, and stops streaming its mipmap levels if it
+ * was created by abcg::MipStreamer.
+ */
+abcg::TextureCache::Texture::~Texture() {
+  if (textureID == 0) return;
+  abcg::MipStreamer::getInstance().remove(textureID);
+  glDeleteTextures(1, &textureID);
+}
+
+/**
+ * @brief Returns the cache shared by the whole application.
+ *
+ * The cache is never destroyed, so that no texture is deleted after the
+ * OpenGL contexts are gone.
+ */
+abcg::TextureCache &abcg::TextureCache::getInstance() {
+  static auto *cache{new TextureCache};  // NOLINT
+  return *cache;
+}
+
+/**
+ * @brief Makes the key of a texture.
+ *
+ * The path is made canonical, so different paths to the same file give the
+ * same key.
+ *
+ * @param path Path of the file, or of the directory of the files (e.g. the
+ * faces of a cube map).
+ * @param flags Caller-defined hash of the load options (e.g. texture target,
+ * mipmapping).
+ * @return Key of the texture.
+ */
+std::string abcg::TextureCache::makeKey(std::string_view path,
+                                        std::uint64_t flags) {
+  std::error_code error;
+  auto canonicalPath{std::filesystem::weakly_canonical(
+      std::filesystem::absolute(path, error), error)};
+  if (error) canonicalPath = path;
+  return fmt::format("{}#{:016x}", canonicalPath.generic_string(), flags);
+}
+
+/**
+ * @brief Hashes the content of the files of a texture.
+ *
+ * @param paths Files of the texture, in order.
+ * @param flags Load options, as given to makeKey.
+ * @return Hash of the files and the options, or no value if a file cannot
+ * be read.
+ */
+std::optional<std::uint64_t> abcg::TextureCache::hashContent(
+    std::span<const std::string> paths, std::uint64_t flags) {
+  auto hash{hashMix(flags)};
+  for (const auto &path : paths) {
+    const abcg::MappedFile file{path};
+    if (!file.isOpen()) return std::nullopt;
+    hash = hashCombine(hash, hashBytes(file.getBytes()));
+  }
+  return hash;
+}
+
+/**
+ * @brief Returns the texture resident with a key.
+ *
+ * @param key Key made by makeKey.
+ * @return Texture, or a null pointer if not resident.
+ */
+abcg::TextureCache::Handle abcg::TextureCache::find(std::string_view key) {
+  std::scoped_lock lock{m_mutex};
+  const auto keyIter{m_keys.find(std::string{key})};
+  if (keyIter == m_keys.end()) return nullptr;
+  auto &entry{m_entries.at(keyIter->second)};
+  touch(entry);
+  ++m_stats.hits;
+  return entry.texture;
+}
+
+/**
+ * @brief Returns the texture resident with the same content as a key that
+ * find did not find.
+ *
+ * If found, the key is added to the texture, so the next lookups of the key
+ * hit with find.
+ *
+ * @param key Key made by makeKey.
+ * @param contentHash Hash made by hashContent.
+ * @return Texture, or a null pointer if not resident.
+ */
+abcg::TextureCache::Handle abcg::TextureCache::findContent(
+    std::string_view key, std::uint64_t contentHash) {
+  std::scoped_lock lock{m_mutex};
+  const auto entryIter{m_entries.find(contentHash)};
+  if (entryIter == m_entries.end()) return nullptr;
+  m_keys.insert_or_assign(std::string{key}, contentHash);
+  touch(entryIter->second);
+  ++m_stats.contentHits;
+  return entryIter->second.texture;
+}
+
+/**
+ * @brief Adds a texture created after a lookup failed.
+ *
+ * If a texture with the same content is already resident (e.g. two models
+ * loaded the same file at the same time), that texture is returned instead
+ * and the given one is left to be released by the caller. Unused textures
+ * are then deleted until the budget is met.
+ *
+ * @param key Key made by makeKey.
+ * @param contentHash Hash made by hashContent.
+ * @param texture Texture to add.
+ * @return Texture to use.
+ */
+abcg::TextureCache::Handle abcg::TextureCache::insert(
+    std::string_view key, std::uint64_t contentHash, Handle texture) {
+  std::scoped_lock lock{m_mutex};
+  m_keys.insert_or_assign(std::string{key}, contentHash);
+  if (auto entryIter{m_entries.find(contentHash)};
+      entryIter != m_entries.end()) {
+    touch(entryIter->second);
+    return entryIter->second.texture;
+  }
+
+  m_recentlyUsed.push_front(contentHash);
+  m_entries.emplace(contentHash, Entry{texture, m_recentlyUsed.begin()});
+  m_stats.residentBytes += texture->bytes;
+  ++m_stats.misses;
+  evict();
+  return texture;
+}
+
+/**
+ * @brief Sets the memory budget of the resident textures, and deletes unused
+ * textures until it is met.
+ *
+ * @param bytes Budget in bytes. The default is 256 MiB.
+ */
+void abcg::TextureCache::setBudget(std::size_t bytes) {
+  std::scoped_lock lock{m_mutex};
+  m_budget = bytes;
+  evict();
+}
+
+/**
+ * @brief Deletes every resident texture that is not in use.
+ */
+void abcg::TextureCache::trim() {
+  std::scoped_lock lock{m_mutex};
+  const auto budget{m_budget};
+  m_budget = 0;
+  evict();
+  m_budget = budget;
+}
+
+/**
+ * @brief Returns the counters and memory use of the cache.
+ */
+abcg::TextureCache::Stats abcg::TextureCache::getStats() {
+  std::scoped_lock lock{m_mutex};
+  auto stats{m_stats};
+  stats.numTextures = m_entries.size();
+  for (const auto &[contentHash, entry] : m_entries) {
+    if (entry.texture.use_count() == 1) ++stats.numUnused;
+  }
+  stats.budget = m_budget;
+  return stats;
+}
+
+void abcg::TextureCache::touch(Entry &entry) {
+  m_recentlyUsed.splice(m_recentlyUsed.begin(), m_recentlyUsed,
+                        entry.usePosition);
+}
+
+// Deletes unused textures, least recently used first, until the resident
+// textures fit the budget
+void abcg::TextureCache::evict() {
+  auto iter{m_recentlyUsed.end()};
+  while (m_stats.residentBytes > m_budget && iter != m_recentlyUsed.begin()) {
+    --iter;
+    const auto contentHash{*iter};
+    auto entryIter{m_entries.find(contentHash)};
+    // Only the cache holds unused textures
+    if (entryIter->second.texture.use_count() > 1) continue;
+
+    m_stats.residentBytes -= entryIter->second.texture->bytes;
+    ++m_stats.evictions;
+    m_entries.erase(entryIter);
+    std::erase_if(m_keys,
+                  [=](const auto &key) { return key.second == contentHash; });
+    iter = m_recentlyUsed.erase(iter);
+  }
+}
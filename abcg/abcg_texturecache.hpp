@@ -0,0 +1,142 @@
+/**
+ * @file abcg_texturecache.hpp
+ * @brief abcg::TextureCache header file.
+ *
+ * Declaration of abcg::TextureCache class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TEXTURECACHE_HPP_
+#define ABCG_TEXTURECACHE_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace abcg {
+class TextureCache;
+}  // namespace abcg
+
+/**
+ * @brief abcg::TextureCache class.
+ *
+ * Process-wide cache of the textures loaded from files, so that a texture
+ * used by several models, windows or examples is decoded and uploaded once.
+ *
+ * Textures are looked up by a key made of the canonical path of their files
+ * and caller-defined load flags. On a miss, they are looked up by a hash of
+ * the content of the files and the flags, so that copies of a file under
+ * other names also share a texture.
+ *
+ * Textures are handed out as shared pointers. The cache keeps a reference
+ * to every texture, so textures no longer used by anyone stay resident and
+ * are found again by later loads. When the estimated memory of the resident
+ * textures exceeds the budget, unused textures are deleted, least recently
+ * used first. Textures in use are never deleted, so the budget can be
+ * exceeded.
+ *
+ * Lookups can be made from any thread. Functions that may delete textures
+ * (insert, setBudget, trim) must be called on a thread with a current
+ * OpenGL context. Since the contexts of the windows share their objects, a
+ * texture can be used by any window.
+ *
+ */
+class abcg::TextureCache {
+ public:
+  /**
+   * @brief Texture owned by the cache.
+   */
+  class Texture {
+   public:
+    Texture(GLuint id, std::size_t numBytes) noexcept
+        : textureID{id}, bytes{numBytes} {}
+    ~Texture();
+
+    Texture(const Texture &) = delete;
+    Texture(Texture &&) = delete;
+    Texture &operator=(const Texture &) = delete;
+    Texture &operator=(Texture &&) = delete;
+
+    GLuint textureID{};
+    /** @brief Estimated size in video memory. */
+    std::size_t bytes{};
+  };
+
+  using Handle = std::shared_ptr<const Texture>;
+
+  /**
+   * @brief Counters and memory use of the cache.
+   */
+  struct Stats {
+    /** @brief Lookups that found the key. */
+    std::size_t hits{};
+    /** @brief Lookups that found the content under another key. */
+    std::size_t contentHits{};
+    /** @brief Textures created because they were not resident. */
+    std::size_t misses{};
+    std::size_t evictions{};
+    std::size_t numTextures{};
+    /** @brief Number of resident textures that are not in use. */
+    std::size_t numUnused{};
+    std::size_t residentBytes{};
+    std::size_t budget{};
+  };
+
+  TextureCache(const TextureCache &) = delete;
+  TextureCache(TextureCache &&) = delete;
+  TextureCache &operator=(const TextureCache &) = delete;
+  TextureCache &operator=(TextureCache &&) = delete;
+
+  [[nodiscard]] static TextureCache &getInstance();
+
+  [[nodiscard]] static std::string makeKey(std::string_view path,
+                                           std::uint64_t flags);
+  [[nodiscard]] static std::optional<std::uint64_t> hashContent(
+      std::span<const std::string> paths, std::uint64_t flags);
+
+  [[nodiscard]] Handle find(std::string_view key);
+  [[nodiscard]] Handle findContent(std::string_view key,
+                                   std::uint64_t contentHash);
+  Handle insert(std::string_view key, std::uint64_t contentHash,
+                Handle texture);
+
+  void setBudget(std::size_t bytes);
+  void trim();
+
+  [[nodiscard]] Stats getStats();
+
+ private:
+  TextureCache() = default;
+  ~TextureCache() = default;
+
+  struct Entry {
+    Handle texture;
+    // Position in m_recentlyUsed
+    std::list<std::uint64_t>::iterator usePosition;
+  };
+
+  void touch(Entry &entry);
+  void evict();
+
+  // Keys to content hashes, and resident textures by content hash
+  std::unordered_map<std::string, std::uint64_t> m_keys;
+  std::unordered_map<std::uint64_t, Entry> m_entries;
+  // Content hashes, most recently used first
+  std::list<std::uint64_t> m_recentlyUsed;
+
+  // Counters of getStats
+  Stats m_stats;
+  std::size_t m_budget{std::size_t{256} * 1024 * 1024};
+  std::mutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * @file abcg_threadpool.cpp
+ * @brief Definition of abcg::ThreadPool class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+
+namespace {
+// One worker per hardware thread, minus one for the calling thread, unless
+// the ABCG_NUM_THREADS environment variable sets the number of threads
+std::size_t getDefaultNumWorkers() {
+  if (const auto *value{std::getenv("ABCG_NUM_THREADS")}; value != nullptr) {
+    if (const auto numThreads{std::atoi(value)}; numThreads > 0) {
+      return static_cast<std::size_t>(numThreads) - 1;
+    }
+  }
+  return std::max(std::thread::hardware_concurrency(), 1U) - 1U;
+}
+}  // namespace
+
+/**
+ * @brief Constructs a pool with the given number of worker threads.
+ *
+ * @param numWorkers Number of worker threads. The thread that calls
+ * parallelFor also does work, so a pool for N cores needs N-1 workers.
+ */
+abcg::ThreadPool::ThreadPool(std::size_t numWorkers) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  numWorkers = 0;
+#endif
+  m_workers.reserve(numWorkers);
+  for (std::size_t index{}; index < numWorkers; ++index) {
+    m_workers.emplace_back([this] { workerLoop(); });
+  }
+}
+
+abcg::ThreadPool::~ThreadPool() {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  for (auto &worker : m_workers) {
+    worker.join();
+  }
+}
+
+/**
+ * @brief Returns the pool shared by the whole application.
+ *
+ * The pool is created on first use with one worker per hardware thread,
+ * minus one for the calling thread. Setting the ABCG_NUM_THREADS
+ * environment variable to N creates N-1 workers instead, e.g. to measure
+ * how a task scales.
+ */
+abcg::ThreadPool &abcg::ThreadPool::getInstance() {
+  static ThreadPool pool{getDefaultNumWorkers()};
+  return pool;
+}
+
+/**
+ * @brief Splits the range [0, count) into contiguous chunks and processes
+ * them concurrently.
+ *
+ * The calling thread claims chunks too, so parallelFor makes progress even
+ * when every worker is busy, and it may be nested or called from a worker
+ * thread. If any chunk throws, the first exception is rethrown on the calling
+ * thread after all chunks have finished.
+ *
+ * @param count Number of items.
+ * @param function Function called with the [begin, end) range of a chunk.
+ * @param maxThreads Maximum number of chunks, or 0 to use every thread of the
+ * pool.
+ */
+void abcg::ThreadPool::parallelFor(
+    std::size_t count,
+    const std::function<void(std::size_t begin, std::size_t end)> &function,
+    std::size_t maxThreads) {
+  if (count == 0) return;
+
+  auto numChunks{std::min(count, getNumThreads())};
+  if (maxThreads > 0) numChunks = std::min(numChunks, maxThreads);
+  if (numChunks == 1) {
+    function(0, count);
+    return;
+  }
+
+  // Shared with the helper tasks, which may start after this call returns
+  struct State {
+    const std::function<void(std::size_t, std::size_t)> *function{};
+    std::size_t count{};
+    std::size_t numChunks{};
+    std::atomic<std::size_t> nextChunk{0};
+    std::atomic<std::size_t> finishedChunks{0};
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::exception_ptr exception;
+  };
+  auto state{std::make_shared<State>()};
+  state->function = &function;
+  state->count = count;
+  state->numChunks = numChunks;
+
+  auto claimChunks{[](State &shared) {
+    while (true) {
+      const auto chunk{shared.nextChunk.fetch_add(1)};
+      if (chunk >= shared.numChunks) return;
+
+      const auto begin{shared.count * chunk / shared.numChunks};
+      const auto end{shared.count * (chunk + 1) / shared.numChunks};
+      try {
+        (*shared.function)(begin, end);
+      } catch (...) {
+        std::scoped_lock lock{shared.mutex};
+        if (!shared.exception) shared.exception = std::current_exception();
+      }
+
+      if (shared.finishedChunks.fetch_add(1) + 1 == shared.numChunks) {
+        std::scoped_lock lock{shared.mutex};
+        shared.condition.notify_all();
+      }
+    }
+  }};
+
+  for (std::size_t helper{1}; helper < numChunks; ++helper) {
+    enqueue([state, claimChunks] { claimChunks(*state); });
+  }
+
+  claimChunks(*state);
+
+  std::unique_lock lock{state->mutex};
+  state->condition.wait(
+      lock, [&] { return state->finishedChunks.load() == numChunks; });
+  if (state->exception) std::rethrow_exception(state->exception);
+}
+
+void abcg::ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::scoped_lock lock{m_mutex};
+    m_tasks.push_back(std::move(task));
+  }
+  m_condition.notify_all();
+}
+
+void abcg::ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock{m_mutex};
+      m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+      if (m_stopping && m_tasks.empty()) return;
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
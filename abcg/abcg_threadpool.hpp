@@ -0,0 +1,103 @@
+/**
+ * @file abcg_threadpool.hpp
+ * @brief abcg::ThreadPool header file.
+ *
+ * Declaration of abcg::ThreadPool class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_THREADPOOL_HPP_
+#define ABCG_THREADPOOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace abcg {
+class ThreadPool;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ThreadPool class.
+ *
+ * Fixed set of worker threads used by the CPU-side asset processing (OBJ
+ * parsing, vertex welding, normal generation, image decoding...).
+ *
+ * On platforms without thread support (Emscripten without pthreads), the
+ * pool has no workers and every task runs on the calling thread.
+ *
+ */
+class abcg::ThreadPool {
+ public:
+  explicit ThreadPool(std::size_t numWorkers);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  [[nodiscard]] static ThreadPool& getInstance();
+
+  /**
+   * @brief Returns the number of threads that take part in parallelFor (the
+   * workers plus the calling thread).
+   */
+  [[nodiscard]] std::size_t getNumThreads() const noexcept {
+    return m_workers.size() + 1;
+  }
+
+  void parallelFor(
+      std::size_t count,
+      const std::function<void(std::size_t begin, std::size_t end)>& function,
+      std::size_t maxThreads = 0);
+
+  template <typename TFun>
+  [[nodiscard]] auto submit(TFun&& function)
+      -> std::future<std::invoke_result_t<std::decay_t<TFun>>>;
+
+ private:
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread> m_workers;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stopping{false};
+};
+
+/**
+ * @brief Runs a function asynchronously on a worker thread.
+ *
+ * If the pool has no workers, the function is run immediately on the calling
+ * thread.
+ *
+ * @param function Callable object without arguments.
+ * @return Future holding the result of the function or the exception it
+ * threw.
+ */
+template <typename TFun>
+auto abcg::ThreadPool::submit(TFun&& function)
+    -> std::future<std::invoke_result_t<std::decay_t<TFun>>> {
+  using Result = std::invoke_result_t<std::decay_t<TFun>>;
+  auto task{std::make_shared<std::packaged_task<Result()>>(
+      std::forward<TFun>(function))};
+  auto future{task->get_future()};
+  if (m_workers.empty()) {
+    (*task)();
+  } else {
+    enqueue([task] { (*task)(); });
+  }
+  return future;
+}
+
+#endif
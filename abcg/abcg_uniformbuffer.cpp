@@ -0,0 +1,122 @@
+/**
+ * @file abcg_uniformbuffer.cpp
+ * @brief Definition of abcg::UniformBuffer class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_uniformbuffer.hpp"
+
+#include <algorithm>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/mat3x3.hpp>
+
+#include "abcg_exception.hpp"
+
+/**
+ * @brief Computes the per-frame uniforms from the camera and light.
+ *
+ * @param viewMatrix View matrix of the camera.
+ * @param projMatrix Projection matrix of the camera.
+ * @param lightDirWorldSpace Direction of the light, in world space.
+ * @param Ia Ambient intensity of the light.
+ * @param Id Diffuse intensity of the light.
+ * @param Is Specular intensity of the light.
+ * @return Data of the block.
+ */
+abcg::FrameBlock abcg::FrameBlock::make(const glm::mat4 &viewMatrix,
+                                        const glm::mat4 &projMatrix,
+                                        const glm::vec4 &lightDirWorldSpace,
+                                        const glm::vec4 &Ia,
+                                        const glm::vec4 &Id,
+                                        const glm::vec4 &Is) {
+  FrameBlock frame;
+  frame.viewMatrix = viewMatrix;
+  frame.projMatrix = projMatrix;
+  frame.viewProjMatrix = projMatrix * viewMatrix;
+  frame.lightDirWorldSpace = lightDirWorldSpace;
+  frame.lightDirViewSpace = viewMatrix * lightDirWorldSpace;
+  frame.Ia = Ia;
+  frame.Id = Id;
+  frame.Is = Is;
+  return frame;
+}
+
+/**
+ * @brief Computes the uniforms of an object.
+ *
+ * @param modelMatrix Model matrix of the object.
+ * @param frame Per-frame uniforms with the camera matrices.
+ * @return Data of the block.
+ */
+abcg::ObjectBlock abcg::ObjectBlock::make(const glm::mat4 &modelMatrix,
+                                          const FrameBlock &frame) {
+  ObjectBlock object;
+  object.modelMatrix = modelMatrix;
+  object.modelViewMatrix = frame.viewMatrix * modelMatrix;
+  object.modelViewProjMatrix = frame.projMatrix * object.modelViewMatrix;
+  const auto normalMatrix{
+      glm::inverseTranspose(glm::mat3{object.modelViewMatrix})};
+  for (auto column : {0, 1, 2}) {
+    object.normalMatrix[column] = glm::vec4{normalMatrix[column], 0.0f};
+  }
+  return object;
+}
+
+/**
+ * @brief Creates the buffer and attaches it to a binding point.
+ *
+ * @param binding Uniform buffer binding point.
+ * @param size Size in bytes of the block.
+ *
+ * @throw abcg::Exception if the binding point is not supported.
+ */
+void abcg::UniformBuffer::create(GLuint binding, std::size_t size) {
+  GLint maxBindings{};
+  glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings);
+  if (binding >= static_cast<GLuint>(maxBindings)) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Uniform buffer binding point is not supported")};
+  }
+
+  destroy();
+  m_binding = binding;
+  m_contents.assign(size, std::byte{});
+  glGenBuffers(1, &m_bufferID);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+  glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(size), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_bufferID);
+}
+
+/**
+ * @brief Uploads the data of the block, unless the buffer already has it.
+ *
+ * @param data Data of the block, at most the size given to create.
+ */
+void abcg::UniformBuffer::update(std::span<const std::byte> data) {
+  if (m_bufferID == 0) return;
+  data = data.first(std::min(data.size(), m_contents.size()));
+  if (m_isSet && std::equal(data.begin(), data.end(), m_contents.begin())) {
+    return;
+  }
+
+  std::copy(data.begin(), data.end(), m_contents.begin());
+  m_isSet = true;
+  glBindBuffer(GL_UNIFORM_BUFFER, m_bufferID);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(data.size()),
+                  data.data());
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/**
+ * @brief Deletes the buffer.
+ */
+void abcg::UniformBuffer::destroy() {
+  if (m_bufferID == 0) return;
+  glDeleteBuffers(1, &m_bufferID);
+  m_bufferID = 0;
+  m_contents.clear();
+  m_isSet = false;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file abcg_uniformbuffer.hpp
+ * @brief abcg::UniformBuffer header file.
+ *
+ * Declaration of abcg::UniformBuffer class and of the std140 layouts of the
+ * uniform blocks shared by the programs.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_UNIFORMBUFFER_HPP_
+#define ABCG_UNIFORMBUFFER_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <glm/mat3x4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace abcg {
+class UniformBuffer;
+struct FrameBlock;
+struct ObjectBlock;
+}  // namespace abcg
+
+/**
+ * @brief Uniforms that change once per frame, declared in GLSL as:
+ *
+ * @code{.glsl}
+ * layout(std140) uniform FrameBlock {
+ *   highp mat4 viewMatrix;
+ *   highp mat4 projMatrix;
+ *   highp mat4 viewProjMatrix;
+ *   highp vec4 lightDirWorldSpace;
+ *   highp vec4 lightDirViewSpace;
+ *   highp vec4 Ia, Id, Is;
+ * };
+ * @endcode
+ *
+ * The members are highp so that the block matches in vertex and fragment
+ * shaders of OpenGL ES, whose default float precisions differ.
+ */
+struct abcg::FrameBlock {
+  static constexpr std::string_view name{"FrameBlock"};
+  static constexpr GLuint binding{0};
+
+  glm::mat4 viewMatrix{1.0f};
+  glm::mat4 projMatrix{1.0f};
+  glm::mat4 viewProjMatrix{1.0f};
+  glm::vec4 lightDirWorldSpace{};
+  /** @brief Light direction in eye space, so that shaders need not
+   * transform it per vertex. */
+  glm::vec4 lightDirViewSpace{};
+  glm::vec4 Ia{};
+  glm::vec4 Id{};
+  glm::vec4 Is{};
+
+  [[nodiscard]] static FrameBlock make(const glm::mat4 &viewMatrix,
+                                       const glm::mat4 &projMatrix,
+                                       const glm::vec4 &lightDirWorldSpace,
+                                       const glm::vec4 &Ia, const glm::vec4 &Id,
+                                       const glm::vec4 &Is);
+};
+
+/**
+ * @brief Uniforms of the object being drawn, declared in GLSL as:
+ *
+ * @code{.glsl}
+ * layout(std140) uniform ObjectBlock {
+ *   highp mat4 modelMatrix;
+ *   highp mat4 modelViewMatrix;
+ *   highp mat4 modelViewProjMatrix;
+ *   highp mat3 normalMatrix;
+ * };
+ * @endcode
+ *
+ * The matrix products are computed once on the CPU instead of per vertex.
+ */
+struct abcg::ObjectBlock {
+  static constexpr std::string_view name{"ObjectBlock"};
+  static constexpr GLuint binding{1};
+
+  glm::mat4 modelMatrix{1.0f};
+  glm::mat4 modelViewMatrix{1.0f};
+  glm::mat4 modelViewProjMatrix{1.0f};
+  /** @brief Inverse transpose of the upper 3x3 of modelViewMatrix. In
+   * std140, the columns of a mat3 are padded to vec4. */
+  glm::mat3x4 normalMatrix{1.0f};
+
+  [[nodiscard]] static ObjectBlock make(const glm::mat4 &modelMatrix,
+                                        const FrameBlock &frame);
+};
+
+// Sizes of the std140 layouts
+static_assert(sizeof(abcg::FrameBlock) == 272);
+static_assert(sizeof(abcg::ObjectBlock) == 240);
+
+/**
+ * @brief abcg::UniformBuffer class.
+ *
+ * Buffer that holds the data of a uniform block, attached to a fixed
+ * binding point. Programs whose block is bound to the same point (see
+ * abcg::ShaderProgram::bindBlock) read the buffer without further calls, so
+ * a block shared by every program is uploaded once however many programs
+ * use it.
+ *
+ * The contents are kept on the CPU, so that uploading the data the buffer
+ * already has makes no OpenGL call.
+ *
+ */
+class abcg::UniformBuffer {
+ public:
+  void create(GLuint binding, std::size_t size);
+  void update(std::span<const std::byte> data);
+  void destroy();
+
+  /**
+   * @brief Uploads a block, unless the buffer already has its contents.
+   *
+   * @tparam T Trivially copyable type with the std140 layout of the block.
+   * @param block Data of the block.
+   */
+  template <typename T>
+  void update(const T &block) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    update(std::as_bytes(std::span{&block, 1}));
+  }
+
+  [[nodiscard]] GLuint getID() const noexcept { return m_bufferID; }
+  [[nodiscard]] GLuint getBinding() const noexcept { return m_binding; }
+
+ private:
+  GLuint m_bufferID{};
+  GLuint m_binding{};
+  std::vector<std::byte> m_contents;
+  bool m_isSet{false};
+};
+
+#endif
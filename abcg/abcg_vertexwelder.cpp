@@ -0,0 +1,243 @@
+/**
+ * @file abcg_vertexwelder.cpp
+ * @brief Definition of abcg::VertexWelder class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_vertexwelder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <limits>
+#include <numeric>
+
+#include "abcg_exception.hpp"
+#include "abcg_hash.hpp"
+#include "abcg_threadpool.hpp"
+
+namespace {
+constexpr std::uint32_t emptySlot{std::numeric_limits<std::uint32_t>::max()};
+
+// Inputs with fewer corners are welded by a single thread
+constexpr std::size_t minParallelCorners{64 * 1024};
+
+// Maps the components of each corner to integer grid cells
+class Quantizer {
+ public:
+  Quantizer(std::span<const float> corners, std::size_t numComponents,
+            float tolerance)
+      : m_corners{corners},
+        m_numComponents{numComponents},
+        m_scale{tolerance > 0.0f ? 1.0 / static_cast<double>(tolerance)
+                                 : 0.0} {}
+
+  [[nodiscard]] std::int64_t getKey(std::size_t corner,
+                                    std::size_t component) const noexcept {
+    const auto value{m_corners[corner * m_numComponents + component]};
+    if (m_scale == 0.0) {
+      // Exact comparison, with +0 and -0 in the same cell
+      return value == 0.0f ? 0 : std::bit_cast<std::int32_t>(value);
+    }
+    // Round half away from zero without calling into libm
+    constexpr auto limit{static_cast<double>(std::int64_t{1} << 62)};
+    const auto scaled{static_cast<double>(value) * m_scale};
+    if (!(std::fabs(scaled) < limit)) {
+      if (scaled > 0.0) return std::int64_t{1} << 62;
+      return scaled < 0.0 ? -(std::int64_t{1} << 62) : 0;
+    }
+    return static_cast<std::int64_t>(scaled + (scaled < 0.0 ? -0.5 : 0.5));
+  }
+
+  [[nodiscard]] std::uint64_t getHash(std::size_t corner) const noexcept {
+    // Cheap per-component step, strong finalizer
+    std::uint64_t hash{m_numComponents};
+    for (auto component : iter::range(m_numComponents)) {
+      hash ^= static_cast<std::uint64_t>(getKey(corner, component));
+      hash = std::rotl(hash * 0x9e3779b97f4a7c15ULL, 31);
+    }
+    return abcg::hashMix(hash);
+  }
+
+  [[nodiscard]] bool isEqual(std::size_t first,
+                             std::size_t second) const noexcept {
+    for (auto component : iter::range(m_numComponents)) {
+      if (getKey(first, component) != getKey(second, component)) return false;
+    }
+    return true;
+  }
+
+ private:
+  std::span<const float> m_corners;
+  std::size_t m_numComponents{};
+  double m_scale{};
+};
+
+// Open-addressing hash set of corners, with linear probing
+class CornerTable {
+ public:
+  explicit CornerTable(std::size_t maxCorners)
+      : m_mask{std::bit_ceil(std::max<std::size_t>(maxCorners * 2, 16)) - 1},
+        m_slots(m_mask + 1) {}
+
+  // Returns the first inserted corner that is equal to the given corner,
+  // inserting the corner if there is none
+  std::uint32_t findOrInsert(std::uint32_t corner, std::uint64_t hash,
+                             const Quantizer &quantizer) {
+    const auto tag{static_cast<std::uint32_t>(hash >> 32)};
+    for (auto position{hash & m_mask};; position = (position + 1) & m_mask) {
+      auto &slot{m_slots[position]};
+      if (slot.corner == emptySlot) {
+        slot = {tag, corner};
+        return corner;
+      }
+      if (slot.tag == tag && quantizer.isEqual(slot.corner, corner)) {
+        return slot.corner;
+      }
+    }
+  }
+
+ private:
+  struct Slot {
+    std::uint32_t tag{};
+    std::uint32_t corner{emptySlot};
+  };
+
+  std::size_t m_mask{};
+  std::vector<Slot> m_slots;
+};
+
+// Numbers unique vertices in order of first occurrence, given the first
+// equal corner of each corner
+abcg::VertexWelder::Result assignIndices(std::vector<std::uint32_t> leaders) {
+  abcg::VertexWelder::Result result;
+  result.indices = std::move(leaders);
+  for (auto &&[corner, index] : iter::enumerate(result.indices)) {
+    if (index == corner) {
+      result.firstCorners.push_back(static_cast<std::uint32_t>(corner));
+      index = static_cast<std::uint32_t>(result.firstCorners.size() - 1);
+    } else {
+      // Leaders always precede their corners
+      index = result.indices[index];
+    }
+  }
+  return result;
+}
+
+std::vector<std::uint32_t> findLeadersSerial(std::size_t numCorners,
+                                             const Quantizer &quantizer) {
+  std::vector<std::uint32_t> leaders(numCorners);
+  CornerTable table{numCorners};
+  for (auto corner : iter::range(numCorners)) {
+    leaders[corner] =
+        table.findOrInsert(static_cast<std::uint32_t>(corner),
+                           quantizer.getHash(corner), quantizer);
+  }
+  return leaders;
+}
+
+std::vector<std::uint32_t> findLeadersParallel(std::size_t numCorners,
+                                               const Quantizer &quantizer) {
+  auto &pool{abcg::ThreadPool::getInstance()};
+  const auto numChunks{pool.getNumThreads()};
+  const auto shardBits{std::bit_width(std::bit_ceil(numChunks * 4) - 1)};
+  const auto numShards{std::size_t{1} << shardBits};
+  // Shards take the top bits of the hash. Shift the upper half so that the
+  // result fits size_t on 32-bit targets too.
+  auto getShard{[&](std::uint64_t hash) {
+    return std::size_t{static_cast<std::uint32_t>(hash >> 32) >>
+                       (32 - shardBits)};
+  }};
+  auto getChunkBegin{
+      [&](std::size_t chunk) { return numCorners * chunk / numChunks; }};
+
+  // Hash corners and count them per chunk and shard
+  std::vector<std::uint64_t> hashes(numCorners);
+  std::vector<std::size_t> counts(numChunks * numShards);
+  pool.parallelFor(numChunks, [&](std::size_t begin, std::size_t end) {
+    for (auto chunk : iter::range(begin, end)) {
+      for (auto corner :
+           iter::range(getChunkBegin(chunk), getChunkBegin(chunk + 1))) {
+        hashes[corner] = quantizer.getHash(corner);
+        ++counts[getShard(hashes[corner]) * numChunks + chunk];
+      }
+    }
+  });
+
+  // Scatter corners to their shards, keeping them in increasing order
+  std::vector<std::size_t> offsets(counts.size() + 1);
+  std::partial_sum(counts.begin(), counts.end(), offsets.begin() + 1);
+  std::vector<std::uint32_t> order(numCorners);
+  pool.parallelFor(numChunks, [&](std::size_t begin, std::size_t end) {
+    for (auto chunk : iter::range(begin, end)) {
+      for (auto corner :
+           iter::range(getChunkBegin(chunk), getChunkBegin(chunk + 1))) {
+        auto &offset{offsets[getShard(hashes[corner]) * numChunks + chunk]};
+        order[offset++] = static_cast<std::uint32_t>(corner);
+      }
+    }
+  });
+
+  // Weld each shard independently. Equal corners always share a shard.
+  std::vector<std::uint32_t> leaders(numCorners);
+  pool.parallelFor(numShards, [&](std::size_t begin, std::size_t end) {
+    for (auto shard : iter::range(begin, end)) {
+      // After the scatter, offsets hold the end of each chunk of the shard
+      const auto shardBegin{shard == 0 ? 0 : offsets[shard * numChunks - 1]};
+      const auto shardEnd{offsets[(shard + 1) * numChunks - 1]};
+      CornerTable table{shardEnd - shardBegin};
+      for (auto position : iter::range(shardBegin, shardEnd)) {
+        const auto corner{order[position]};
+        leaders[corner] =
+            table.findOrInsert(corner, hashes[corner], quantizer);
+      }
+    }
+  });
+
+  return leaders;
+}
+}  // namespace
+
+/**
+ * @brief Welds the corners of a triangle soup into unique vertices.
+ *
+ * @param corners Flat array of corner components.
+ * @param numComponents Number of components per corner.
+ * @param tolerance Size of the quantization grid. If 0, components are
+ * compared exactly (except that +0 and -0 are equal).
+ * @param mode Whether to weld on the calling thread only or on all threads
+ * of abcg::ThreadPool. In automatic mode, large inputs are welded in
+ * parallel.
+ * @return Index of each corner and first corner of each unique vertex.
+ *
+ * @throw abcg::Exception if the size of `corners` is not a multiple of
+ * `numComponents` or if there are more corners than 32-bit indices can
+ * address.
+ */
+abcg::VertexWelder::Result abcg::VertexWelder::weld(
+    std::span<const float> corners, std::size_t numComponents,
+    float tolerance, Mode mode) {
+  if (numComponents == 0 || corners.size() % numComponents != 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Corner data size is not a multiple of the number of components")};
+  }
+  const auto numCorners{corners.size() / numComponents};
+  if (numCorners >= emptySlot) {
+    throw abcg::Exception{abcg::Exception::Runtime("Too many corners to weld")};
+  }
+
+  const Quantizer quantizer{corners, numComponents, tolerance};
+
+  if (mode == Mode::Automatic) {
+    mode = numCorners >= minParallelCorners &&
+                   ThreadPool::getInstance().getNumThreads() > 1
+               ? Mode::Parallel
+               : Mode::Serial;
+  }
+
+  return assignIndices(mode == Mode::Parallel
+                           ? findLeadersParallel(numCorners, quantizer)
+                           : findLeadersSerial(numCorners, quantizer));
+}
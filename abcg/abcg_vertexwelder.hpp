@@ -0,0 +1,60 @@
+/**
+ * @file abcg_vertexwelder.hpp
+ * @brief abcg::VertexWelder header file.
+ *
+ * Declaration of abcg::VertexWelder class.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VERTEXWELDER_HPP_
+#define ABCG_VERTEXWELDER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace abcg {
+class VertexWelder;
+}  // namespace abcg
+
+/**
+ * @brief abcg::VertexWelder class.
+ *
+ * Merges the duplicated corners of an unindexed triangle soup into unique
+ * vertices and produces the corresponding index buffer.
+ *
+ * Corners are given as a flat array of floats with a fixed number of
+ * components per corner (e.g. position, normal and texture coordinates).
+ * Two corners are welded when every component falls in the same cell of a
+ * grid of the given tolerance. Unique vertices are numbered in order of first
+ * occurrence, so the result does not depend on the mode or number of threads.
+ *
+ * Lookups use a flat open-addressing table with linear probing, keyed by a
+ * mixed hash of the quantized components. In parallel mode, the corners are
+ * sharded by hash and each shard is welded by a different thread of
+ * abcg::ThreadPool.
+ *
+ */
+class abcg::VertexWelder {
+ public:
+  enum class Mode { Automatic, Serial, Parallel };
+
+  /**
+   * @brief Result of a weld.
+   */
+  struct Result {
+    /** @brief Index of the unique vertex of each corner. */
+    std::vector<std::uint32_t> indices;
+    /** @brief First corner of each unique vertex. */
+    std::vector<std::uint32_t> firstCorners;
+  };
+
+  [[nodiscard]] static Result weld(std::span<const float> corners,
+                                   std::size_t numComponents,
+                                   float tolerance = 0.0f,
+                                   Mode mode = Mode::Automatic);
+};
+
+#endif
@@ -2,17 +2,15 @@
 
 layout(location = 0) in vec3 inPosition;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+#include "uniforms.glsl"
 
 out vec4 fragColor;
 
 void main() {
-  vec4 posEyeSpace = viewMatrix * modelMatrix * vec4(inPosition, 1);
+  vec4 posEyeSpace = modelViewMatrix * vec4(inPosition, 1);
 
   float i = 1.0 - (-posEyeSpace.z / 3.0);
   fragColor = vec4(i, i, i, 1);
 
-  gl_Position = projMatrix * posEyeSpace;
+  gl_Position = modelViewProjMatrix * vec4(inPosition, 1);
 }
\ No newline at end of file
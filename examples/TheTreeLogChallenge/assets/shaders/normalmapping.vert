@@ -5,11 +5,7 @@ layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec4 inTangent;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-
-uniform vec4 lightDirWorldSpace;
+#include "uniforms.glsl"
 
 out vec2 fragTexCoord;
 out vec3 fragPObj;
@@ -20,8 +16,8 @@ out vec3 fragLEye;
 out vec3 fragVEye;
 
 void main() {
-  vec3 PEye = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
-  vec3 LEye = -(viewMatrix * lightDirWorldSpace).xyz;
+  vec3 PEye = (modelViewMatrix * vec4(inPosition, 1.0)).xyz;
+  vec3 LEye = -lightDirViewSpace.xyz;
 
   fragTexCoord = inTexCoord;
 
@@ -33,5 +29,5 @@ void main() {
   fragLEye = LEye;
   fragVEye = -PEye;
 
-  gl_Position = projMatrix * vec4(PEye, 1.0);
+  gl_Position = modelViewProjMatrix * vec4(inPosition, 1.0);
 }
\ No newline at end of file
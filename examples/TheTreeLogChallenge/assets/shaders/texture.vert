@@ -4,12 +4,7 @@ layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
-uniform mat3 normalMatrix;
-
-uniform vec4 lightDirWorldSpace;
+#include "uniforms.glsl"
 
 out vec3 fragV;
 out vec3 fragL;
@@ -19,9 +14,9 @@ out vec3 fragPObj;
 out vec3 fragNObj;
 
 void main() {
-  vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
+  vec3 P = (modelViewMatrix * vec4(inPosition, 1.0)).xyz;
   vec3 N = normalMatrix * inNormal;
-  vec3 L = -(viewMatrix * lightDirWorldSpace).xyz;
+  vec3 L = -lightDirViewSpace.xyz;
 
   fragL = L;
   fragV = -P;
@@ -30,5 +25,5 @@ void main() {
   fragPObj = inPosition;
   fragNObj = inNormal;
 
-  gl_Position = projMatrix * vec4(P, 1.0);
+  gl_Position = modelViewProjMatrix * vec4(inPosition, 1.0);
 }
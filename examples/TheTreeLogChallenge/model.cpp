@@ -1,197 +1,732 @@
 #include "model.hpp"
 
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <tiny_obj_loader.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cppitertools/itertools.hpp>
 #include <filesystem>
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
 #include <unordered_map>
 
-// Custom specialization of std::hash injected in namespace std
-namespace std {
-template <>
-struct hash<Vertex> {
-  size_t operator()(Vertex const& vertex) const noexcept {
-    std::size_t h1{std::hash<glm::vec3>()(vertex.position)};
-    std::size_t h2{std::hash<glm::vec3>()(vertex.normal)};
-    std::size_t h3{std::hash<glm::vec2>()(vertex.texCoord)};
-    return h1 ^ h2 ^ h3;
-  }
-};
-}  // namespace std
-
-Model::~Model() {
-  glDeleteTextures(1, &m_cubeTexture);
-  glDeleteTextures(1, &m_normalTexture);
-  glDeleteTextures(1, &m_diffuseTexture);
-  glDeleteBuffers(1, &m_EBO);
-  glDeleteBuffers(1, &m_VBO);
-  glDeleteVertexArrays(1, &m_VAO);
+namespace {
+// Tags of the sections stored in the mesh cache
+constexpr auto vertexTag{abcg::MeshCache::makeTag('V', 'E', 'R', 'T')};
+constexpr auto indexTag{abcg::MeshCache::makeTag('I', 'N', 'D', 'X')};
+constexpr auto materialTag{abcg::MeshCache::makeTag('M', 'A', 'T', 'L')};
+constexpr auto flagsTag{abcg::MeshCache::makeTag('F', 'L', 'A', 'G')};
+constexpr auto lodTag{abcg::MeshCache::makeTag('L', 'O', 'D', 'S')};
+constexpr auto meshletTag{abcg::MeshCache::makeTag('M', 'S', 'H', 'L')};
+constexpr auto submeshTag{abcg::MeshCache::makeTag('S', 'U', 'B', 'M')};
+
+// Bump whenever the processing done in loadFromFile changes
+constexpr std::uint64_t pipelineVersion{6};
+
+// Corners are welded from position, normal and texture coordinates, with the
+// same tolerance as Vertex::operator==
+constexpr std::size_t numCornerComponents{8};
+constexpr float weldTolerance{std::numeric_limits<float>::epsilon()};
+
+// Each level of detail has half the triangles of the previous one, until
+// seams and borders stop the simplification or the mesh gets too small. The
+// error of a level is bounded by a fraction of the bounding radius.
+constexpr std::size_t maxLods{5};
+constexpr std::size_t minLodIndices{3 * 64};
+constexpr float maxLodError{0.05f};
+
+// Slots of the texture table used by materials without their own textures
+constexpr std::size_t defaultDiffuseSlot{0};
+constexpr std::size_t defaultNormalSlot{1};
+
+// Load flags of the textures and cube maps in the texture cache
+constexpr std::uint64_t textureFlags{1};
+constexpr std::uint64_t cubeTextureFlags{2};
+
+constexpr std::uint32_t hasNormalsFlag{1U << 0};
+constexpr std::uint32_t hasTexCoordsFlag{1U << 1};
+
+// Estimated video memory of a texture created from an image, with its
+// mipmap levels. RGB textures are usually stored with four channels.
+std::size_t getTextureBytes(const abcg::opengl::Image& image) {
+  const auto texels{static_cast<std::size_t>(image.width) *
+                    static_cast<std::size_t>(image.height)};
+  return texels * 4 * 4 / 3;
 }
 
-void Model::computeNormals() {
-  // Clear previous vertex normals
-  for (auto& vertex : m_vertices) {
-    vertex.normal = glm::zero<glm::vec3>();
+// Packed positions are normalized, so they can only hold meshes within the
+// standardized bounds (up to rounding errors of the standardization)
+bool hasNormalizedPositions(std::span<const Vertex> vertices) {
+  const glm::vec3 bound{1.0f + 1.0e-5f};
+  return std::all_of(vertices.begin(), vertices.end(), [&](const auto& vertex) {
+    return glm::all(glm::lessThanEqual(glm::abs(vertex.position), bound));
+  });
+}
+
+// Uploads the next part of a buffer within the byte budget. Returns whether
+// the whole buffer has been uploaded.
+bool uploadBufferPart(GLenum target, GLuint buffer,
+                      std::span<const std::byte> data, std::size_t& offset,
+                      std::size_t& budget) {
+  const auto size{std::min(data.size() - offset, budget)};
+  if (size > 0) {
+    glBindBuffer(target, buffer);
+    glBufferSubData(target, static_cast<GLintptr>(offset),
+                    static_cast<GLsizeiptr>(size), data.data() + offset);
+    glBindBuffer(target, 0);
+    offset += size;
+    budget -= size;
   }
+  return offset == data.size();
+}
 
-  // Compute face normals
-  for (const auto offset : iter::range<int>(0, m_indices.size(), 3)) {
-    // Get face vertices
-    Vertex& a{m_vertices.at(m_indices.at(offset + 0))};
-    Vertex& b{m_vertices.at(m_indices.at(offset + 1))};
-    Vertex& c{m_vertices.at(m_indices.at(offset + 2))};
+PackedVertex packVertex(const Vertex& vertex) {
+  const auto position{
+      glm::packSnorm<std::int16_t>(glm::vec4{vertex.position, 0.0f})};
 
-    // Compute normal
-    const auto edge1{b.position - a.position};
-    const auto edge2{c.position - b.position};
-    glm::vec3 normal{glm::cross(edge1, edge2)};
+  PackedVertex packed;
+  packed.position = {position.x, position.y, position.z, 0};
+  packed.normal = glm::packSnorm3x10_1x2(glm::vec4{vertex.normal, 0.0f});
+  packed.tangent = glm::packSnorm3x10_1x2(vertex.tangent);
+  packed.texCoord = glm::packHalf2x16(vertex.texCoord);
+  return packed;
+}
 
-    // Accumulate on vertices
-    a.normal += normal;
-    b.normal += normal;
-    c.normal += normal;
-  }
+abcg::MeshCache::Material convertMaterial(const tinyobj::material_t& mat) {
+  abcg::MeshCache::Material material;
+  material.Ka = glm::vec4(mat.ambient[0], mat.ambient[1], mat.ambient[2], 1);
+  material.Kd = glm::vec4(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1);
+  material.Ks = glm::vec4(mat.specular[0], mat.specular[1], mat.specular[2], 1);
+  material.shininess = mat.shininess;
+  material.diffuseTexName = mat.diffuse_texname;
+  material.normalTexName =
+      !mat.normal_texname.empty() ? mat.normal_texname : mat.bump_texname;
+  return material;
+}
 
-  // Normalize
-  for (auto& vertex : m_vertices) {
-    vertex.normal = glm::normalize(vertex.normal);
+// Material of faces without one
+abcg::MeshCache::Material getDefaultMaterial() {
+  const Model::Material defaults;
+  abcg::MeshCache::Material material;
+  material.Ka = defaults.Ka;
+  material.Kd = defaults.Kd;
+  material.Ks = defaults.Ks;
+  material.shininess = defaults.shininess;
+  return material;
+}
+}  // namespace
+
+Model::~Model() { glDeleteVertexArrays(1, &m_VAO); }
+
+void Model::computeNormals(const abcg::TangentSpace::Adjacency& adjacency) {
+  const auto normals{
+      abcg::TangentSpace::computeNormals(m_indices, getPositions(), adjacency)};
+  for (auto&& [vertex, normal] : iter::zip(m_vertices, normals)) {
+    vertex.normal = normal;
   }
 
   m_hasNormals = true;
 }
 
-void Model::computeTangents() {
-  // Reserve space for bitangents
-  std::vector<glm::vec3> bitangents(m_vertices.size(), glm::vec3(0));
+void Model::computeTangents(std::span<const GLuint> indices,
+                            const abcg::TangentSpace::Adjacency& adjacency) {
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texCoords;
+  normals.reserve(m_vertices.size());
+  texCoords.reserve(m_vertices.size());
+  for (const auto& vertex : m_vertices) {
+    normals.push_back(vertex.normal);
+    texCoords.push_back(vertex.texCoord);
+  }
+
+  const auto tangents{abcg::TangentSpace::computeTangents(
+      indices, getPositions(), normals, texCoords, adjacency)};
+  for (auto&& [vertex, tangent] : iter::zip(m_vertices, tangents)) {
+    vertex.tangent = tangent;
+  }
+}
+
+// Replaces the texture coordinates with those of the cylindrical or
+// spherical mapping, computed once per vertex instead of per fragment.
+// Interpolating them across a triangle gives the coordinates the shaders
+// compute, up to the curvature of the mapping, once the vertices are split
+// where u wraps: triangles that cross the seam get copies of their vertices
+// at u + 1, and triangles that touch the axis get their own copy of the
+// vertex on it, at the u of the triangle. Vertices are only appended and
+// index values rewritten, so the levels of detail, submeshes and meshlets,
+// which are ranges of m_indices, are kept.
+void Model::bakeTexCoords() {
+  abcg::ElapsedTimer timer;
+  auto& threadPool{abcg::ThreadPool::getInstance()};
+  const auto numVertices{m_vertices.size()};
+  const auto isSpherical{m_uvMapping == UVMapping::Spherical};
+
+  // Same as CylindricalMapping and SphericalMapping in mapping.glsl
+  threadPool.parallelFor(
+      numVertices, [&](std::size_t begin, std::size_t end) {
+        for (auto index : iter::range(begin, end)) {
+          auto& vertex{m_vertices[index]};
+          const auto& position{vertex.position};
+          const auto longitude{std::atan2(position.x, position.z)};
+          vertex.texCoord.x = longitude / glm::two_pi<float>() + 0.5f;
+          if (isSpherical) {
+            const auto length{glm::length(position)};
+            const auto sine{length > 0.0f ? position.y / length : 0.0f};
+            const auto latitude{std::asin(glm::clamp(sine, -1.0f, 1.0f))};
+            vertex.texCoord.y = latitude / glm::pi<float>() + 0.5f;
+          } else {
+            vertex.texCoord.y = position.y - 0.5f;
+          }
+        }
+      });
+
+  // Vertices on the axis have no longitude
+  const auto axisDistance{m_radius * 1.0e-6f};
+  const auto isOnAxis{[&](GLuint index) {
+    const auto& position{m_vertices[index].position};
+    return glm::length(glm::vec2{position.x, position.z}) <= axisDistance;
+  }};
+
+  // Find the triangles to split, in every level of detail
+  const auto numTriangles{m_indices.size() / 3};
+  std::vector<std::uint8_t> isSplit(numTriangles);
+  threadPool.parallelFor(
+      numTriangles, [&](std::size_t begin, std::size_t end) {
+        for (auto triangle : iter::range(begin, end)) {
+          auto minU{std::numeric_limits<float>::max()};
+          auto maxU{std::numeric_limits<float>::lowest()};
+          for (auto corner : iter::range(3)) {
+            const auto index{m_indices[triangle * 3 + corner]};
+            if (isOnAxis(index)) {
+              isSplit[triangle] = 1;
+              break;
+            }
+            minU = std::min(minU, m_vertices[index].texCoord.x);
+            maxU = std::max(maxU, m_vertices[index].texCoord.x);
+          }
+          if (maxU - minU > 0.5f) isSplit[triangle] = 1;
+        }
+      });
+
+  // Split them in order, so that the result does not depend on the threads.
+  // Copies at u + 1 are shared by the triangles of a vertex.
+  constexpr auto noCopy{std::numeric_limits<GLuint>::max()};
+  std::vector<GLuint> wrappedCopies(numVertices, noCopy);
+  std::vector<GLuint> copySources;
+  const auto addCopy{[&](GLuint source, glm::vec2 texCoord) {
+    auto vertex{m_vertices[source]};
+    vertex.texCoord = texCoord;
+    m_vertices.push_back(vertex);
+    copySources.push_back(source);
+    return static_cast<GLuint>(m_vertices.size() - 1);
+  }};
+  for (auto triangle : iter::range(numTriangles)) {
+    if (isSplit[triangle] == 0) continue;
+    auto* const corners{&m_indices[triangle * 3]};
+
+    std::array<bool, 3> onAxis{};
+    auto minU{std::numeric_limits<float>::max()};
+    auto maxU{std::numeric_limits<float>::lowest()};
+    for (auto corner : iter::range(3)) {
+      onAxis[corner] = isOnAxis(corners[corner]);
+      if (onAxis[corner]) continue;
+      minU = std::min(minU, m_vertices[corners[corner]].texCoord.x);
+      maxU = std::max(maxU, m_vertices[corners[corner]].texCoord.x);
+    }
+
+    auto sumU{0.0f};
+    auto numU{0};
+    for (auto corner : iter::range(3)) {
+      if (onAxis[corner]) continue;
+      auto& index{corners[corner]};
+      auto texCoord{m_vertices[index].texCoord};
+      if (maxU - minU > 0.5f && texCoord.x < 0.5f) {
+        texCoord.x += 1.0f;
+        if (wrappedCopies[index] == noCopy) {
+          wrappedCopies[index] = addCopy(index, texCoord);
+        }
+        index = wrappedCopies[index];
+      }
+      sumU += texCoord.x;
+      ++numU;
+    }
+
+    for (auto corner : iter::range(3)) {
+      if (!onAxis[corner] || numU == 0) continue;
+      auto& index{corners[corner]};
+      index = addCopy(index, {sumU / static_cast<float>(numU),
+                              m_vertices[index].texCoord.y});
+    }
+  }
+
+  // The tangent space follows the new coordinates. It is computed on the
+  // full mesh, and copies used only by coarser levels take the tangents of
+  // their source vertices.
+  const auto& lod{m_lods.front()};
+  const auto indices{
+      std::span{m_indices}.subspan(lod.firstIndex, lod.numIndices)};
+  computeTangents(indices, abcg::TangentSpace::buildAdjacency(
+                               indices, m_vertices.size()));
+  std::vector<bool> isUsed(m_vertices.size());
+  for (const auto index : indices) {
+    isUsed[index] = true;
+  }
+  for (auto&& [copy, source] : iter::enumerate(copySources)) {
+    const auto index{numVertices + copy};
+    if (!isUsed[index]) m_vertices[index].tangent = m_vertices[source].tangent;
+  }
+
+  printTiming("Baked {} mapping into {} vertices ({} split) in {:.1f} ms\n",
+              isSpherical ? "spherical" : "cylindrical", m_vertices.size(),
+              copySources.size(), timer.elapsed() * 1000.0);
+}
+
+// Appends a range of the index buffer to the ranges drawn next, extending
+// the last range if they are contiguous
+void Model::appendDrawRange(std::size_t firstIndex,
+                            std::size_t numIndices) const {
+  if (numIndices == 0) return;
+
+  const auto offset{firstIndex * sizeof(GLuint)};
+  if (!m_drawCounts.empty() &&
+      reinterpret_cast<std::size_t>(m_drawOffsets.back()) +
+              static_cast<std::size_t>(m_drawCounts.back()) * sizeof(GLuint) ==
+          offset) {
+    m_drawCounts.back() += static_cast<GLsizei>(numIndices);
+    return;
+  }
+  m_drawCounts.push_back(static_cast<GLsizei>(numIndices));
+  m_drawOffsets.push_back(reinterpret_cast<const void*>(offset));
+}
+
+// Sets the colors of a material and binds its textures, except those already
+// bound for the previous material. The mipmap levels of the textures are
+// requested for a size on screen of textureSize pixels.
+void Model::bindMaterial(const Material& material, const Material* previous,
+                         float textureSize) const {
+  m_program.setUniform(m_KaUniform, material.Ka);
+  m_program.setUniform(m_KdUniform, material.Kd);
+  m_program.setUniform(m_KsUniform, material.Ks);
+  m_program.setUniform(m_shininessUniform, material.shininess);
+
+  if (previous == nullptr ||
+      previous->diffuseTexture != material.diffuseTexture) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, getTextureID(material.diffuseTexture));
+  }
 
-  // Compute face tangents and bitangents
-  for (const auto offset : iter::range<int>(0, m_indices.size(), 3)) {
-    // Get face indices
-    const auto i1{m_indices.at(offset + 0)};
-    const auto i2{m_indices.at(offset + 1)};
-    const auto i3{m_indices.at(offset + 2)};
+  if (previous == nullptr ||
+      previous->normalTexture != material.normalTexture) {
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, getTextureID(material.normalTexture));
+  }
 
-    // Get face vertices
-    Vertex& v1{m_vertices.at(i1)};
-    Vertex& v2{m_vertices.at(i2)};
-    Vertex& v3{m_vertices.at(i3)};
+  auto& streamer{abcg::MipStreamer::getInstance()};
+  streamer.request(getTextureID(material.diffuseTexture), textureSize);
+  streamer.request(getTextureID(material.normalTexture), textureSize);
+}
 
-    const auto e1{v2.position - v1.position};
-    const auto e2{v3.position - v1.position};
-    const auto delta1{v2.texCoord - v1.texCoord};
-    const auto delta2{v3.texCoord - v1.texCoord};
+// Partitions each submesh into meshlets, in the final triangle order
+void Model::buildMeshlets() {
+  abcg::ElapsedTimer timer;
+  const auto positions{getPositions()};
+
+  m_meshlets.clear();
+  for (auto& submesh : m_submeshes) {
+    const auto meshlets{abcg::Meshlets::build(
+        std::span{m_indices}.subspan(submesh.firstIndex, submesh.numIndices),
+        positions)};
+    submesh.firstMeshlet = static_cast<std::uint32_t>(m_meshlets.size());
+    submesh.numMeshlets = static_cast<std::uint32_t>(meshlets.size());
+    for (auto meshlet : meshlets) {
+      meshlet.firstIndex += submesh.firstIndex;
+      m_meshlets.push_back(meshlet);
+    }
+  }
 
-    // clang-format off
-    glm::mat2 M;
-    M[0][0] =  delta2.t;
-    M[0][1] = -delta1.t;
-    M[1][0] = -delta2.s;
-    M[1][1] =  delta1.s;
-    M *= (1.0f / (delta1.s * delta2.t - delta2.s * delta1.t));
+  printTiming("Built {} meshlets in {:.1f} ms\n", m_meshlets.size(),
+              timer.elapsed() * 1000.0);
+}
 
-    auto tangent{glm::vec4(M[0][0] * e1.x + M[0][1] * e2.x,
-                           M[0][0] * e1.y + M[0][1] * e2.y,
-                           M[0][0] * e1.z + M[0][1] * e2.z, 0.0f)};
+// Decodes the staged textures and computes their mipmap levels
+// concurrently. Textures found in the texture cache are not decoded, and
+// textures baked by texturebaker are read from their baked files instead.
+void Model::decodeTextures() {
+  abcg::ElapsedTimer timer;
+  std::vector<TextureUpload*> textures;
+  std::vector<abcg::opengl::ImageSource> sources;
+  std::size_t numBaked{};
+  std::size_t numCached{};
+  for (auto& texture : m_upload.textures) {
+    if (texture.isDecoded) continue;
+    lookUpTexture(texture);
+    if (texture.cached) {
+      texture.isDecoded = true;
+      ++numCached;
+      continue;
+    }
+    if (const auto bakedPath{abcg::opengl::findBakedTexture(texture.path)};
+        !bakedPath.empty()) {
+      texture.compressed = abcg::opengl::loadDDS(bakedPath);
+      texture.isDecoded = true;
+      ++numBaked;
+      continue;
+    }
+    textures.push_back(&texture);
+    sources.push_back({texture.path});
+  }
+  if (sources.empty() && numBaked == 0 && numCached == 0) return;
+
+  auto images{abcg::opengl::loadImages(sources)};
+  abcg::ThreadPool::getInstance().parallelFor(
+      images.size(), [&](std::size_t begin, std::size_t end) {
+        for (auto index : iter::range(begin, end)) {
+          textures[index]->mipChain =
+              abcg::MipStreamer::makeMipChain(std::move(images[index]));
+          textures[index]->isDecoded = true;
+        }
+      });
+  printTiming(
+      "Decoded {} textures, read {} baked textures and found {} cached "
+      "textures in {:.1f} ms\n",
+      images.size(), numBaked, numCached, timer.elapsed() * 1000.0);
+}
 
-    auto bitangent{glm::vec3(M[1][0] * e1.x + M[1][1] * e2.x,
-                             M[1][0] * e1.y + M[1][1] * e2.y,
-                             M[1][0] * e1.z + M[1][1] * e2.z)};
-    // clang-format on
+// Draws submeshes in order, binding each material once. appendRanges is
+// called for each submesh to append the ranges of it to draw. textureSize is
+// the size on screen of the textures, in pixels.
+template <typename AppendRanges>
+void Model::drawSubmeshes(std::span<const Submesh> submeshes, float textureSize,
+                          AppendRanges&& appendRanges) const {
+  if (m_VAO == 0) return;
 
-    // Accumulate on vertices
-    v1.tangent += tangent;
-    v2.tangent += tangent;
-    v3.tangent += tangent;
+  glBindVertexArray(m_VAO);
 
-    bitangents.at(i1) += bitangent;
-    bitangents.at(i2) += bitangent;
-    bitangents.at(i3) += bitangent;
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, getCubeTexture());
+
+  const Material* boundMaterial{};
+  for (const auto& submesh : submeshes) {
+    m_drawCounts.clear();
+    m_drawOffsets.clear();
+    appendRanges(submesh);
+    if (m_drawCounts.empty()) continue;
+
+    const auto& material{m_materials.at(submesh.material)};
+    bindMaterial(material, boundMaterial, textureSize);
+    boundMaterial = &material;
+
+#if defined(__EMSCRIPTEN__)
+    // WebGL 2 has no glMultiDrawElements
+    for (auto&& [count, offset] : iter::zip(m_drawCounts, m_drawOffsets)) {
+      glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, offset);
+    }
+#else
+    glMultiDrawElements(GL_TRIANGLES, m_drawCounts.data(), GL_UNSIGNED_INT,
+                        m_drawOffsets.data(),
+                        static_cast<GLsizei>(m_drawCounts.size()));
+#endif
   }
 
-  for (auto&& [i, vertex] : iter::enumerate(m_vertices)) {
-    const auto& n{vertex.normal};
-    const auto& t{glm::vec3(vertex.tangent)};
+  glBindVertexArray(0);
+}
 
-    // Orthogonalize t with respect to n
-    const auto tangent = t - n * glm::dot(n, t);
-    vertex.tangent = glm::vec4(glm::normalize(tangent), 0);
+// Builds the levels of detail by simplifying each level into the next one,
+// and appends their indices to m_indices. Submeshes are simplified
+// separately, so the borders between materials are kept.
+void Model::generateLods() {
+  abcg::ElapsedTimer timer;
+  m_lods.assign(1, {0, static_cast<std::uint32_t>(m_indices.size()), 0.0f, 0,
+                    static_cast<std::uint32_t>(m_submeshes.size())});
+
+  // Positions are welded once for all levels and submeshes
+  const auto positions{getPositions()};
+  const abcg::MeshSimplifier simplifier{positions};
+  auto error{0.0f};
+  while (m_lods.size() < maxLods) {
+    const auto previous{m_lods.back()};
+    if (previous.numIndices / 6 * 3 < minLodIndices) break;
+
+    std::vector<GLuint> indices;
+    std::vector<Submesh> submeshes;
+    auto levelError{0.0f};
+    for (const auto& submesh : getLodSubmeshes(getNumLods() - 1)) {
+      // Small submeshes are kept as they are
+      const auto targetIndexCount{submesh.numIndices < minLodIndices
+                                      ? submesh.numIndices
+                                      : submesh.numIndices / 6 * 3};
+      const auto simplified{simplifier.simplify(
+          std::span{m_indices}.subspan(submesh.firstIndex, submesh.numIndices),
+          targetIndexCount, maxLodError * m_radius)};
+
+      Submesh simplifiedSubmesh;
+      simplifiedSubmesh.firstIndex =
+          static_cast<std::uint32_t>(m_indices.size() + indices.size());
+      simplifiedSubmesh.numIndices =
+          static_cast<std::uint32_t>(simplified.indices.size());
+      simplifiedSubmesh.material = submesh.material;
+      submeshes.push_back(simplifiedSubmesh);
+      indices.insert(indices.end(), simplified.indices.begin(),
+                     simplified.indices.end());
+      levelError = std::max(levelError, simplified.error);
+    }
+    // Stop when less than 10% of the triangles could be removed
+    if (indices.size() * 10 > std::size_t{previous.numIndices} * 9) break;
+
+    // Errors of consecutive levels add up
+    error += levelError;
+    m_lods.push_back({static_cast<std::uint32_t>(m_indices.size()),
+                      static_cast<std::uint32_t>(indices.size()), error,
+                      static_cast<std::uint32_t>(m_submeshes.size()),
+                      static_cast<std::uint32_t>(submeshes.size())});
+    m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+    m_submeshes.insert(m_submeshes.end(), submeshes.begin(), submeshes.end());
+  }
 
-    // Compute handedness of re-orthogonalized basis
-    const auto b{glm::cross(n, t)};
-    const auto handedness{glm::dot(b, bitangents.at(i))};
-    vertex.tangent.w = (handedness < 0.0f) ? -1.0f : 1.0f;
+  std::vector<int> triangles;
+  for (auto lod : iter::range(getNumLods())) {
+    triangles.push_back(getLodTriangles(lod));
   }
+  printTiming("Generated {} levels of detail in {:.1f} ms ({} triangles)\n",
+              m_lods.size(), timer.elapsed() * 1000.0,
+              fmt::join(triangles, ", "));
 }
 
-void Model::createBuffers() {
-  // Delete previous buffers
-  glDeleteBuffers(1, &m_EBO);
-  glDeleteBuffers(1, &m_VBO);
+float Model::getLodError(int lod) const {
+  if (lod < 0 || lod >= getNumLods()) return 0.0f;
+  return m_lods[lod].error;
+}
 
-  // VBO
-  glGenBuffers(1, &m_VBO);
-  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices[0]) * m_vertices.size(),
-               m_vertices.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+int Model::getLodMeshlets(int lod) const {
+  auto numMeshlets{0};
+  for (const auto& submesh : getLodSubmeshes(lod)) {
+    numMeshlets += static_cast<int>(submesh.numMeshlets);
+  }
+  return numMeshlets;
+}
 
-  // EBO
-  glGenBuffers(1, &m_EBO);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_indices[0]) * m_indices.size(),
-               m_indices.data(), GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+std::span<const Model::Submesh> Model::getLodSubmeshes(int lod) const {
+  if (lod < 0 || lod >= getNumLods()) return {};
+  return std::span{m_submeshes}.subspan(m_lods[lod].firstSubmesh,
+                                        m_lods[lod].numSubmeshes);
+}
+
+int Model::getLodTriangles(int lod) const {
+  if (lod < 0 || lod >= getNumLods()) return 0;
+  return static_cast<int>(m_lods[lod].numIndices / 3);
+}
+
+std::vector<glm::vec3> Model::getPositions() const {
+  std::vector<glm::vec3> positions;
+  positions.reserve(m_vertices.size());
+  for (const auto& vertex : m_vertices) {
+    positions.push_back(vertex.position);
+  }
+  return positions;
+}
+
+// Returns the texture of a slot, or 0 if the slot has none
+GLuint Model::getTextureID(std::size_t slot) const {
+  const auto& texture{m_textures.at(slot)};
+  return texture ? texture->textureID : 0;
+}
+
+float Model::getUploadProgress() const {
+  if (m_upload.totalBytes == 0) {
+    return (m_upload.mesh || m_upload.residentMesh ||
+            !m_upload.textures.empty())
+               ? 0.0f
+               : 1.0f;
+  }
+
+  const auto uploadedBytes{m_upload.vertexOffset + m_upload.indexOffset};
+  return static_cast<float>(uploadedBytes) /
+         static_cast<float>(m_upload.totalBytes);
+}
+
+std::span<const std::byte> Model::getVertexData() const {
+  if (m_isVBOPacked) {
+    return std::as_bytes(std::span{m_upload.packedVertices});
+  }
+  return std::as_bytes(std::span{m_vertices});
+}
+
+// Key of the mesh in abcg::MeshRegistry. Meshes of different vertex formats
+// or baked texture coordinates have different buffers.
+std::string Model::getMeshKey() const {
+  auto options{abcg::hashCombine(getCacheKey(m_standardize, m_optimize),
+                                 static_cast<std::uint64_t>(m_vertexFormat))};
+  options =
+      abcg::hashCombine(options, static_cast<std::uint64_t>(m_uvMapping));
+  return abcg::MeshRegistry::makeKey(m_path, options);
+}
+
+std::uint64_t Model::getCacheKey(bool standardize, bool optimize) {
+  auto key{abcg::hashCombine(pipelineVersion, sizeof(Vertex))};
+  key = abcg::hashCombine(key, standardize ? 1 : 0);
+  return abcg::hashCombine(key, optimize ? 1 : 0);
 }
 
 void Model::loadCubeTexture(const std::string& path) {
   if (!std::filesystem::exists(path)) return;
 
-  glDeleteTextures(1, &m_cubeTexture);
-  m_cubeTexture = abcg::opengl::loadCubemap(
-      {path + "px.png", path + "nx.png", path + "py.png",
-       path + "ny.png", path + "pz.png", path + "nz.png"});
+  // Look up the cube map by directory, then by the content of its faces
+  auto& cache{abcg::TextureCache::getInstance()};
+  const auto key{abcg::TextureCache::makeKey(path, cubeTextureFlags)};
+  m_cubeTexture = cache.find(key);
+  if (m_cubeTexture) return;
+
+  const std::array<std::string, 6> paths{path + "px.png", path + "nx.png",
+                                         path + "py.png", path + "ny.png",
+                                         path + "pz.png", path + "nz.png"};
+  const auto contentHash{
+      abcg::TextureCache::hashContent(paths, cubeTextureFlags)};
+  if (contentHash) {
+    m_cubeTexture = cache.findContent(key, *contentHash);
+    if (m_cubeTexture) return;
+  }
+
+  // Faces are stored top to bottom, as expected by cube map lookups
+  std::vector<abcg::opengl::ImageSource> sources;
+  for (const auto& facePath : paths) {
+    sources.push_back({facePath, false, false});
+  }
+  const auto faces{abcg::opengl::loadImages(sources)};
+  std::size_t bytes{};
+  for (const auto& face : faces) {
+    bytes += getTextureBytes(face);
+  }
+  auto texture{std::make_shared<abcg::TextureCache::Texture>(
+      abcg::opengl::createCubemap(
+          std::span<const abcg::opengl::Image, 6>{faces.data(), 6}),
+      bytes)};
+  m_cubeTexture = contentHash ? cache.insert(key, *contentHash, texture)
+                              : std::move(texture);
 }
 
+// Replaces the default diffuse texture and uses it for every material
 void Model::loadDiffuseTexture(std::string_view path) {
   if (!std::filesystem::exists(path)) return;
 
-  glDeleteTextures(1, &m_diffuseTexture);
-  m_diffuseTexture = abcg::opengl::loadTexture(path);
+  loadTexture(defaultDiffuseSlot, path);
+  for (auto& material : m_materials) {
+    material.diffuseTexture = defaultDiffuseSlot;
+  }
 }
 
+// Replaces the default normal texture and uses it for every material
 void Model::loadNormalTexture(std::string_view path) {
   if (!std::filesystem::exists(path)) return;
 
-  glDeleteTextures(1, &m_normalTexture);
-  m_normalTexture = abcg::opengl::loadTexture(path);
+  loadTexture(defaultNormalSlot, path);
+  for (auto& material : m_materials) {
+    material.normalTexture = defaultNormalSlot;
+  }
+}
+
+void Model::loadFromFile(std::string_view path, bool standardize,
+                         bool optimize) {
+  prepareFromFile(path, standardize, optimize);
+  uploadStep(std::numeric_limits<std::size_t>::max());
+}
+
+// Stages the default diffuse texture, used by materials without one
+void Model::prepareDiffuseTexture(std::string_view path) {
+  stageTexture(defaultDiffuseSlot, path);
 }
 
-void Model::loadFromFile(std::string_view path, bool standardize) {
+// Stages the default normal texture, used by materials without one
+void Model::prepareNormalTexture(std::string_view path) {
+  stageTexture(defaultNormalSlot, path);
+}
+
+// Returns false if canceled before the model was ready to upload
+bool Model::prepareFromFile(std::string_view path, bool standardize,
+                            bool optimize, const std::atomic<bool>* canceled) {
+  auto isCanceled{[canceled] { return canceled != nullptr && *canceled; }};
+  m_path = path;
+  m_standardize = standardize;
+  m_optimize = optimize;
+
+  std::vector<abcg::MeshCache::Material> materials;
+  if (!prepareMesh(canceled, materials)) return false;
+
+  auto basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+  applyMaterials(materials, basePath);
+  if (isCanceled()) return false;
+
+  decodeTextures();
+  return true;
+}
+
+// Gets the mesh of m_path from the mesh registry, the mesh cache or the
+// source file, and stages it for uploadStep. Returns false if canceled.
+bool Model::prepareMesh(const std::atomic<bool>* canceled,
+                        std::vector<abcg::MeshCache::Material>& meshMaterials) {
+  auto isCanceled{[canceled] { return canceled != nullptr && *canceled; }};
+  const std::string_view path{m_path};
   auto basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+  const auto cacheKey{getCacheKey(m_standardize, m_optimize)};
+
+  abcg::ElapsedTimer timer;
+
+  // Use the mesh already uploaded by another model, without reading the
+  // vertices and indices
+  if (auto mesh{
+          abcg::MeshRegistry::getInstance().find<SharedMesh>(getMeshKey())}) {
+    m_vertices.clear();
+    m_indices.clear();
+    m_lods = mesh->lods;
+    m_submeshes = mesh->submeshes;
+    m_meshlets = mesh->meshlets;
+    m_radius = mesh->radius;
+    m_hasNormals = mesh->hasNormals;
+    m_hasTexCoords = mesh->hasTexCoords;
+    meshMaterials = mesh->materials;
+
+    m_upload.mesh = nullptr;
+    m_upload.residentMesh = std::move(mesh);
+    m_upload.isStarted = false;
+    printTiming("Reused {} from mesh registry in {:.1f} ms\n", path,
+                timer.elapsed() * 1000.0);
+    return true;
+  }
 
-  tinyobj::ObjReaderConfig readerConfig;
-  readerConfig.mtl_search_path = basePath;  // Path to material files
+  // Warm start: use the processed mesh stored next to the source file
+  if (loadFromCache(path, cacheKey, meshMaterials)) {
+    if (m_uvMapping != UVMapping::None && !m_lods.empty()) {
+      bakeTexCoords();
+    }
+    stageVertices(meshMaterials);
+    printTiming("Loaded {} from mesh cache in {:.1f} ms\n", path,
+                timer.elapsed() * 1000.0);
+    return true;
+  }
 
-  tinyobj::ObjReader reader;
+  abcg::ObjParser parser;
 
-  if (!reader.ParseFromFile(path.data(), readerConfig)) {
-    if (!reader.Error().empty()) {
-      throw abcg::Exception{abcg::Exception::Runtime(
-          fmt::format("Failed to load model {} ({})", path, reader.Error()))};
+  if (!parser.parseFromFile(path, basePath)) {
+    if (!parser.getError().empty()) {
+      throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+          "Failed to load model {} ({})", path, parser.getError()))};
     }
     throw abcg::Exception{
         abcg::Exception::Runtime(fmt::format("Failed to load model {}", path))};
   }
 
-  if (!reader.Warning().empty()) {
-    fmt::print("Warning: {}\n", reader.Warning());
+  if (!parser.getWarning().empty()) {
+    fmt::print("Warning: {}\n", parser.getWarning());
   }
 
-  const auto& attrib{reader.GetAttrib()};
-  const auto& shapes{reader.GetShapes()};
-  const auto& materials{reader.GetMaterials()};
+  printTiming("Parsed {} in {:.1f} ms\n", path, timer.elapsed() * 1000.0);
+  if (isCanceled()) return false;
+
+  const auto& attrib{parser.getAttrib()};
+  const auto& shapes{parser.getShapes()};
+  const auto& materials{parser.getMaterials()};
 
   m_vertices.clear();
   m_indices.clear();
@@ -199,11 +734,17 @@ void Model::loadFromFile(std::string_view path, bool standardize) {
   m_hasNormals = false;
   m_hasTexCoords = false;
 
-  // A key:value map with key=Vertex and value=index
-  std::unordered_map<Vertex, GLuint> hash{};
+  std::vector<float> corners;
+  std::vector<int> faceMaterials;
 
   // Loop over shapes
   for (const auto& shape : shapes) {
+    const auto& materialIds{shape.mesh.material_ids};
+    for (const auto face : iter::range(shape.mesh.indices.size() / 3)) {
+      faceMaterials.push_back(face < materialIds.size() ? materialIds[face]
+                                                        : -1);
+    }
+
     // Loop over indices
     for (const auto offset : iter::range(shape.mesh.indices.size())) {
       // Access to vertex
@@ -237,90 +778,518 @@ void Model::loadFromFile(std::string_view path, bool standardize) {
         tv = attrib.texcoords.at(startIndex + 1);
       }
 
-      Vertex vertex{};
-      vertex.position = {vx, vy, vz};
-      vertex.normal = {nx, ny, nz};
-      vertex.texCoord = {tu, tv};
-
-      // If hash doesn't contain this vertex
-      if (hash.count(vertex) == 0) {
-        // Add this index (size of m_vertices)
-        hash[vertex] = m_vertices.size();
-        // Add this vertex
-        m_vertices.push_back(vertex);
-      }
+      corners.insert(corners.end(), {vx, vy, vz, nx, ny, nz, tu, tv});
+    }
+  }
+
+  // Merge duplicated corners into unique vertices
+  abcg::ElapsedTimer weldTimer;
+  const auto welded{
+      abcg::VertexWelder::weld(corners, numCornerComponents, weldTolerance)};
+  m_vertices.reserve(welded.firstCorners.size());
+  for (const auto corner : welded.firstCorners) {
+    const auto* attributes{&corners.at(corner * numCornerComponents)};
+    Vertex vertex{};
+    vertex.position = {attributes[0], attributes[1], attributes[2]};
+    vertex.normal = {attributes[3], attributes[4], attributes[5]};
+    vertex.texCoord = {attributes[6], attributes[7]};
+    m_vertices.push_back(vertex);
+  }
+  m_indices.assign(welded.indices.begin(), welded.indices.end());
+  printTiming("Welded {} corners into {} vertices in {:.1f} ms\n",
+              welded.indices.size(), m_vertices.size(),
+              weldTimer.elapsed() * 1000.0);
+  if (isCanceled()) return false;
+
+  // Keep the materials used by faces, sorted by textures so that materials
+  // with the same textures are drawn one after the other. Faces without a
+  // material (-1) or with an unknown one get the default material.
+  std::vector<int> usedMaterials;
+  for (auto& materialId : faceMaterials) {
+    if (materialId >= static_cast<int>(materials.size())) materialId = -1;
+    usedMaterials.push_back(materialId);
+  }
+  std::sort(usedMaterials.begin(), usedMaterials.end());
+  usedMaterials.erase(std::unique(usedMaterials.begin(), usedMaterials.end()),
+                      usedMaterials.end());
+  const auto getTexNames{[&](int materialId) {
+    if (materialId < 0) return std::pair<std::string, std::string>{};
+    const auto material{convertMaterial(materials.at(materialId))};
+    return std::pair{material.diffuseTexName, material.normalTexName};
+  }};
+  std::stable_sort(usedMaterials.begin(), usedMaterials.end(),
+                   [&](int lhs, int rhs) {
+                     return getTexNames(lhs) < getTexNames(rhs);
+                   });
+
+  std::vector<abcg::MeshCache::Material> modelMaterials;
+  std::unordered_map<int, std::uint32_t> materialIndices;
+  for (const auto materialId : usedMaterials) {
+    materialIndices.emplace(materialId, modelMaterials.size());
+    modelMaterials.push_back(materialId < 0
+                                 ? getDefaultMaterial()
+                                 : convertMaterial(materials.at(materialId)));
+  }
 
-      m_indices.push_back(hash[vertex]);
+  // Group faces by material with a counting sort, keeping their order within
+  // each material. Each material gets one submesh.
+  m_submeshes.assign(modelMaterials.size(), {});
+  for (auto& materialId : faceMaterials) {
+    materialId = static_cast<int>(materialIndices.at(materialId));
+    m_submeshes[materialId].numIndices += 3;
+  }
+  for (auto&& [material, submesh] : iter::enumerate(m_submeshes)) {
+    submesh.material = static_cast<std::uint32_t>(material);
+    if (material > 0) {
+      const auto& previous{m_submeshes[material - 1]};
+      submesh.firstIndex = previous.firstIndex + previous.numIndices;
     }
   }
+  std::vector<GLuint> sortedIndices(m_indices.size());
+  std::vector<std::uint32_t> nextIndices(m_submeshes.size());
+  std::transform(m_submeshes.begin(), m_submeshes.end(), nextIndices.begin(),
+                 [](const auto& submesh) { return submesh.firstIndex; });
+  for (auto&& [face, material] : iter::enumerate(faceMaterials)) {
+    auto& next{nextIndices[material]};
+    std::copy_n(m_indices.begin() + face * 3, 3, sortedIndices.begin() + next);
+    next += 3;
+  }
+  m_indices = std::move(sortedIndices);
+  if (isCanceled()) return false;
+
+  if (m_standardize) {
+    standardize();
+  }
+  updateRadius();
 
-  // Use properties of first material, if available
-  if (!materials.empty()) {
-    const auto& mat{materials.at(0)};  // First material
-    m_Ka = glm::vec4(mat.ambient[0], mat.ambient[1], mat.ambient[2], 1);
-    m_Kd = glm::vec4(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1);
-    m_Ks = glm::vec4(mat.specular[0], mat.specular[1], mat.specular[2], 1);
-    m_shininess = mat.shininess;
+  if (!m_hasNormals || m_hasTexCoords) {
+    abcg::ElapsedTimer tangentTimer;
+    const auto adjacency{
+        abcg::TangentSpace::buildAdjacency(m_indices, m_vertices.size())};
 
-    if (!mat.diffuse_texname.empty())
-      loadDiffuseTexture(basePath + mat.diffuse_texname);
+    if (!m_hasNormals) {
+      computeNormals(adjacency);
+    }
 
-    if (!mat.normal_texname.empty()) {
-      loadNormalTexture(basePath + mat.normal_texname);
-    } else if (!mat.bump_texname.empty()) {
-      loadNormalTexture(basePath + mat.bump_texname);
+    if (m_hasTexCoords) {
+      computeTangents(m_indices, adjacency);
     }
-  } else {
-    // Default values
-    m_Ka = {0.1f, 0.1f, 0.1f, 1.0f};
-    m_Kd = {0.7f, 0.7f, 0.7f, 1.0f};
-    m_Ks = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_shininess = 25.0f;
+
+    printTiming("Computed tangent space in {:.1f} ms\n",
+                tangentTimer.elapsed() * 1000.0);
+  }
+
+  if (isCanceled()) return false;
+
+  generateLods();
+  if (isCanceled()) return false;
+
+  if (m_optimize) {
+    optimizeMesh();
+  }
+
+  buildMeshlets();
+
+  // The cache holds the mesh with the texture coordinates of the file, and
+  // the mappings are baked when it is loaded
+  saveToCache(path, cacheKey, modelMaterials, parser.getMaterialLibraries());
+  if (m_uvMapping != UVMapping::None) {
+    bakeTexCoords();
+  }
+
+  stageVertices(modelMaterials);
+
+  printTiming("Loaded {} from source in {:.1f} ms\n", path,
+              timer.elapsed() * 1000.0);
+
+  meshMaterials = std::move(modelMaterials);
+  return true;
+}
+
+bool Model::loadFromCache(std::string_view path, std::uint64_t cacheKey,
+                          std::vector<abcg::MeshCache::Material>& materials) {
+  const auto cache{abcg::MeshCache::open(path, cacheKey)};
+  if (!cache) return false;
+
+  const auto vertices{cache->getSectionAs<Vertex>(vertexTag)};
+  const auto indices{cache->getSectionAs<GLuint>(indexTag)};
+  const auto flags{cache->getSectionAs<std::uint32_t>(flagsTag)};
+  const auto lods{cache->getSectionAs<Lod>(lodTag)};
+  const auto submeshes{cache->getSectionAs<Submesh>(submeshTag)};
+  const auto meshlets{
+      cache->getSectionAs<abcg::Meshlets::Meshlet>(meshletTag)};
+  materials = abcg::MeshCache::unpackMaterials(cache->getSection(materialTag));
+  if (vertices.empty() || indices.empty() || flags.size() != 1 ||
+      lods.empty()) {
+    return false;
   }
+  for (const auto& lod : lods) {
+    if (std::size_t{lod.firstIndex} + lod.numIndices > indices.size() ||
+        std::size_t{lod.firstSubmesh} + lod.numSubmeshes > submeshes.size()) {
+      return false;
+    }
+  }
+  for (const auto& submesh : submeshes) {
+    if (std::size_t{submesh.firstIndex} + submesh.numIndices >
+            indices.size() ||
+        std::size_t{submesh.firstMeshlet} + submesh.numMeshlets >
+            meshlets.size() ||
+        submesh.material >= materials.size()) {
+      return false;
+    }
+  }
+  for (const auto& meshlet : meshlets) {
+    if (std::size_t{meshlet.firstIndex} + meshlet.numIndices >
+        indices.size()) {
+      return false;
+    }
+  }
+
+  m_vertices.assign(vertices.begin(), vertices.end());
+  m_indices.assign(indices.begin(), indices.end());
+  m_lods.assign(lods.begin(), lods.end());
+  m_submeshes.assign(submeshes.begin(), submeshes.end());
+  m_meshlets.assign(meshlets.begin(), meshlets.end());
+  updateRadius();
+  m_hasNormals = (flags[0] & hasNormalsFlag) != 0;
+  m_hasTexCoords = (flags[0] & hasTexCoordsFlag) != 0;
+  return true;
+}
 
-  if (standardize) {
-    this->standardize();
+void Model::optimizeMesh() {
+  abcg::ElapsedTimer timer;
+  const auto getIndices{[this](const auto& range) {
+    return std::span{m_indices}.subspan(range.firstIndex, range.numIndices);
+  }};
+  const auto before{abcg::MeshOptimizer::analyzeVertexCache(
+      getIndices(m_lods.front()), m_vertices.size())};
+
+  // Triangles are reordered within each submesh, so submeshes stay
+  // contiguous
+  for (const auto& submesh : m_submeshes) {
+    abcg::MeshOptimizer::optimizeVertexCache(getIndices(submesh),
+                                             m_vertices.size());
   }
 
-  if (!m_hasNormals) {
-    computeNormals();
+  // Coarser levels are drawn at a distance, where overdraw matters less
+  const auto positions{getPositions()};
+  for (const auto& submesh : getLodSubmeshes(0)) {
+    abcg::MeshOptimizer::optimizeOverdraw(getIndices(submesh), positions);
   }
 
-  if (m_hasTexCoords) {
-    computeTangents();
+  // Store vertices in the order they are fetched by the full mesh, which
+  // uses every vertex of the coarser levels
+  const auto order{
+      abcg::MeshOptimizer::optimizeVertexFetch(m_indices, m_vertices.size())};
+  std::vector<Vertex> vertices;
+  vertices.reserve(order.size());
+  for (const auto index : order) {
+    vertices.push_back(m_vertices.at(index));
   }
+  m_vertices = std::move(vertices);
+
+  const auto after{abcg::MeshOptimizer::analyzeVertexCache(
+      getIndices(m_lods.front()), m_vertices.size())};
+  printTiming("Optimized mesh in {:.1f} ms (ACMR {:.3f} -> {:.3f}, ATVR {:.3f} "
+              "-> {:.3f})\n",
+              timer.elapsed() * 1000.0, before.acmr, after.acmr, before.atvr,
+              after.atvr);
+}
 
-  createBuffers();
+void Model::saveToCache(
+    std::string_view path, std::uint64_t cacheKey,
+    std::span<const abcg::MeshCache::Material> materials,
+    std::span<const std::string> materialLibraries) const {
+  const std::uint32_t flags{(m_hasNormals ? hasNormalsFlag : 0U) |
+                            (m_hasTexCoords ? hasTexCoordsFlag : 0U)};
+  const auto materialBytes{abcg::MeshCache::packMaterials(materials)};
+
+  const std::array sections{
+      abcg::MeshCache::Section{vertexTag, std::as_bytes(std::span{m_vertices})},
+      abcg::MeshCache::Section{indexTag, std::as_bytes(std::span{m_indices})},
+      abcg::MeshCache::Section{materialTag, materialBytes},
+      abcg::MeshCache::Section{flagsTag,
+                               std::as_bytes(std::span{&flags, 1})},
+      abcg::MeshCache::Section{lodTag, std::as_bytes(std::span{m_lods})},
+      abcg::MeshCache::Section{submeshTag,
+                               std::as_bytes(std::span{m_submeshes})},
+      abcg::MeshCache::Section{meshletTag,
+                               std::as_bytes(std::span{m_meshlets})}};
+
+  // Editing a material library outdates the cache too
+  if (!abcg::MeshCache::save(path, cacheKey, sections, materialLibraries)) {
+    fmt::print("Warning: could not write mesh cache for {}\n", path);
+  }
 }
 
+// Sets up the material table and stages the textures of the materials. Each
+// texture file is loaded once.
+void Model::applyMaterials(std::span<const abcg::MeshCache::Material> materials,
+                           std::string_view basePath) {
+  std::unordered_map<std::string, std::size_t> textureSlots;
+  auto nextSlot{defaultNormalSlot + 1};
+  const auto getTextureSlot{[&](const std::string& name, std::size_t slot) {
+    if (name.empty()) return slot;
+
+    const auto path{std::string{basePath} + name};
+    if (!std::filesystem::exists(path)) return slot;
+
+    auto [iter, isNew] = textureSlots.emplace(path, nextSlot);
+    if (isNew) {
+      stageTexture(nextSlot, path);
+      ++nextSlot;
+    }
+    return iter->second;
+  }};
+
+  m_materials.clear();
+  for (const auto& mat : materials) {
+    Material material;
+    material.Ka = mat.Ka;
+    material.Kd = mat.Kd;
+    material.Ks = mat.Ks;
+    material.shininess = mat.shininess;
+    material.diffuseTexture =
+        getTextureSlot(mat.diffuseTexName, defaultDiffuseSlot);
+    material.normalTexture =
+        getTextureSlot(mat.normalTexName, defaultNormalSlot);
+    m_materials.push_back(material);
+  }
+
+  // Slots are only added, so that textures of a previous model are deleted
+  // when their slots are reused
+  m_textures.resize(std::max(m_textures.size(), nextSlot));
+}
+
+// Without camera matrices, textures are requested with full detail
 void Model::render(int numTriangles) const {
-  glBindVertexArray(m_VAO);
+  auto remaining{numTriangles < 0
+                     ? std::numeric_limits<std::size_t>::max()
+                     : static_cast<std::size_t>(numTriangles) * 3};
+  drawSubmeshes(getLodSubmeshes(0), std::numeric_limits<float>::max(),
+                [&](const Submesh& submesh) {
+                  const auto numIndices{
+                      std::min<std::size_t>(submesh.numIndices, remaining)};
+                  appendDrawRange(submesh.firstIndex, numIndices);
+                  remaining -= numIndices;
+                });
+}
 
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
+// Renders the coarsest level of detail whose error, projected on the
+// viewport, is at most maxPixelError pixels. Returns the level rendered.
+int Model::render(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix,
+                  const glm::mat4& projMatrix, int viewportHeight,
+                  float maxPixelError) const {
+  const auto lod{selectLod(modelMatrix, viewMatrix, projMatrix, viewportHeight,
+                           maxPixelError)};
+  renderLod(lod, modelMatrix, viewMatrix, projMatrix);
+  return lod;
+}
 
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+void Model::renderLod(int lod) const {
+  drawSubmeshes(getLodSubmeshes(lod), std::numeric_limits<float>::max(),
+                [this](const Submesh& submesh) {
+                  appendDrawRange(submesh.firstIndex, submesh.numIndices);
+                });
+}
 
-  glActiveTexture(GL_TEXTURE2);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeTexture);
+// Renders a level of detail without the meshlets that are out of view,
+// according to the meshlet culling mode. Textures are requested for the
+// projected size of the bounding sphere, as if they covered the model once.
+void Model::renderLod(int lod, const glm::mat4& modelMatrix,
+                      const glm::mat4& viewMatrix,
+                      const glm::mat4& projMatrix) const {
+  const auto submeshes{getLodSubmeshes(lod)};
+  if (submeshes.empty()) return;
+
+  std::array<GLint, 4> viewport{};
+  glGetIntegerv(GL_VIEWPORT, viewport.data());
+  const auto textureSize{
+      2.0f * m_radius *
+      getPixelsPerUnit(modelMatrix, viewMatrix, projMatrix, viewport[3])};
+
+  // The meshlets of the submeshes of a level are contiguous
+  const auto firstMeshlet{submeshes.front().firstMeshlet};
+  const auto meshlets{std::span{m_meshlets}.subspan(
+      firstMeshlet, submeshes.back().firstMeshlet +
+                        submeshes.back().numMeshlets - firstMeshlet)};
+  if (m_meshletCulling == MeshletCulling::Off || meshlets.empty()) {
+    m_cullResult = {meshlets.size(), 0, 0};
+    drawSubmeshes(submeshes, textureSize, [this](const Submesh& submesh) {
+      appendDrawRange(submesh.firstIndex, submesh.numIndices);
+    });
+    return;
+  }
 
-  // Set minification and magnification parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  m_cullResult = abcg::Meshlets::cull(
+      meshlets, modelMatrix, viewMatrix, projMatrix,
+      m_meshletCulling == MeshletCulling::FrustumAndBackface,
+      m_visibleMeshlets);
+
+  // Visible meshlets are in increasing order, as are the submeshes
+  auto visible{m_visibleMeshlets.begin()};
+  drawSubmeshes(submeshes, textureSize, [&](const Submesh& submesh) {
+    const auto end{submesh.firstMeshlet + submesh.numMeshlets - firstMeshlet};
+    for (; visible != m_visibleMeshlets.end() && *visible < end; ++visible) {
+      const auto& meshlet{meshlets[*visible]};
+      appendDrawRange(meshlet.firstIndex, meshlet.numIndices);
+    }
+  });
+}
 
-  // Set texture wrapping parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+int Model::selectLod(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix,
+                     const glm::mat4& projMatrix, int viewportHeight,
+                     float maxPixelError) const {
+  const auto pixelsPerUnit{
+      getPixelsPerUnit(modelMatrix, viewMatrix, projMatrix, viewportHeight)};
+  auto lod{0};
+  while (lod + 1 < getNumLods() &&
+         m_lods[lod + 1].error * pixelsPerUnit <= maxPixelError) {
+    ++lod;
+  }
+  return lod;
+}
 
-  GLsizei numIndices = (numTriangles < 0) ? m_indices.size() : numTriangles * 3;
+// Pixels per unit of length in model space, at the nearest point of the
+// bounding sphere
+float Model::getPixelsPerUnit(const glm::mat4& modelMatrix,
+                              const glm::mat4& viewMatrix,
+                              const glm::mat4& projMatrix,
+                              int viewportHeight) const {
+  // Lengths are in model units: scale them by the largest axis scale
+  const auto scale{std::max({glm::length(glm::vec3{modelMatrix[0]}),
+                             glm::length(glm::vec3{modelMatrix[1]}),
+                             glm::length(glm::vec3{modelMatrix[2]})})};
+
+  // Pixels per unit of length at unit distance from the camera, or at any
+  // distance with an orthographic projection
+  const auto pixelsPerUnit{projMatrix[1][1] *
+                           static_cast<float>(viewportHeight) * 0.5f};
+
+  // Distance to the nearest point of the bounding sphere
+  auto distance{1.0f};
+  if (projMatrix[3][3] == 0.0f) {
+    const auto center{viewMatrix * modelMatrix * glm::vec4{0, 0, 0, 1}};
+    distance = std::max(glm::length(glm::vec3{center}) - m_radius * scale,
+                        1.0e-3f);
+  }
 
-  glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, nullptr);
+  return scale * pixelsPerUnit / distance;
+}
 
-  glBindVertexArray(0);
+// Uploads staged data, at most maxBytes per call. Returns true once the
+// buffers have been uploaded. Textures are created at once with their
+// coarsest levels; their finer levels are streamed by updateTextures.
+bool Model::uploadStep(std::size_t maxBytes) {
+  const auto vertexData{getVertexData()};
+  const auto indexData{std::as_bytes(std::span{m_indices})};
+
+  if (!m_upload.isStarted) {
+    // Decode the textures staged without prepareFromFile, then create every
+    // staged texture
+    decodeTextures();
+    for (auto& texture : m_upload.textures) {
+      uploadTexture(texture);
+    }
+    m_upload.textures.clear();
+
+    m_upload.isStarted = true;
+    m_upload.totalBytes = 0;
+
+    if (m_upload.mesh) {
+      // Allocate the buffers of the new mesh, filled below. The previous
+      // mesh is kept until the upload is complete.
+      auto& mesh{*m_upload.mesh};
+      glGenBuffers(1, &mesh.VBO);
+      glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+      glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertexData.size()),
+                   nullptr, GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+      glGenBuffers(1, &mesh.EBO);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                   static_cast<GLsizeiptr>(indexData.size()), nullptr,
+                   GL_STATIC_DRAW);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+      mesh.vertexBytes = vertexData.size();
+      mesh.indexBytes = indexData.size();
+      m_upload.totalBytes += mesh.vertexBytes + mesh.indexBytes;
+    }
+  }
+
+  auto budget{maxBytes};
+  auto isComplete{true};
+  if (m_upload.mesh) {
+    isComplete &= uploadBufferPart(GL_ARRAY_BUFFER, m_upload.mesh->VBO,
+                                   vertexData, m_upload.vertexOffset, budget);
+    isComplete &= uploadBufferPart(GL_ELEMENT_ARRAY_BUFFER, m_upload.mesh->EBO,
+                                   indexData, m_upload.indexOffset, budget);
+  }
+  if (!isComplete) return false;
+
+  // Share the uploaded mesh with the models that load it next. If another
+  // model uploaded it meanwhile, its mesh is used instead.
+  if (m_upload.mesh) {
+    m_upload.residentMesh = abcg::MeshRegistry::getInstance().insert(
+        getMeshKey(),
+        std::shared_ptr<const SharedMesh>{std::move(m_upload.mesh)});
+  }
+  if (m_upload.residentMesh) {
+    m_mesh = std::move(m_upload.residentMesh);
+    m_isVBOPacked = m_mesh->isPacked;
+    m_bufferSize = m_mesh->vertexBytes + m_mesh->indexBytes;
+  }
+
+  // Release the staged data
+  m_upload = {};
+  return true;
+}
+
+// Creates the texture of a decoded staged texture and adds it to the
+// texture cache, or uses the texture found in the cache. A baked texture
+// whose format is not supported by the context is replaced by its source
+// file. Only the coarsest levels are uploaded here.
+void Model::uploadTexture(TextureUpload& texture) {
+  if (texture.cached) {
+    setTexture(texture.slot, std::move(texture.cached));
+    return;
+  }
+
+  if (!texture.compressed.levels.empty()) {
+    texture.mipChain =
+        abcg::opengl::isCompressedFormatSupported(texture.compressed.format)
+            ? abcg::MipStreamer::makeMipChain(std::move(texture.compressed))
+            : abcg::MipStreamer::makeMipChain(
+                  abcg::opengl::loadImage(texture.path));
+  }
+
+  const auto bytes{abcg::MipStreamer::getBytes(texture.mipChain)};
+  abcg::TextureCache::Handle created{
+      std::make_shared<abcg::TextureCache::Texture>(
+          abcg::MipStreamer::getInstance().create(std::move(texture.mipChain)),
+          bytes)};
+  // Files that cannot be hashed are not shared
+  if (!texture.contentHash) {
+    setTexture(texture.slot, std::move(created));
+    return;
+  }
+
+  // If another model added the same texture meanwhile, use that one
+  setTexture(texture.slot,
+             abcg::TextureCache::getInstance().insert(
+                 texture.key, *texture.contentHash, created));
 }
 
-void Model::setupVAO(GLuint program) {
+// Streams the mipmap levels requested by the render calls since the last
+// call, at most maxBytes per call (but at least one row). The streamer is
+// shared by every model, so this also streams the textures of the others.
+bool Model::updateTextures(std::size_t maxBytes) {
+  return abcg::MipStreamer::getInstance().update(maxBytes);
+}
+
+void Model::setupVAO(const abcg::ShaderProgram& program) {
   // Release previous VAO
   glDeleteVertexArrays(1, &m_VAO);
 
@@ -329,44 +1298,176 @@ void Model::setupVAO(GLuint program) {
   glBindVertexArray(m_VAO);
 
   // Bind EBO and VBO
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mesh ? m_mesh->EBO : 0);
+  glBindBuffer(GL_ARRAY_BUFFER, m_mesh ? m_mesh->VBO : 0);
+
+  // Bind vertex attributes. Packed attributes are normalized integers.
+  const auto stride{static_cast<GLsizei>(m_isVBOPacked ? sizeof(PackedVertex)
+                                                        : sizeof(Vertex))};
 
-  // Bind vertex attributes
-  GLint positionAttribute{glGetAttribLocation(program, "inPosition")};
+  GLint positionAttribute{program.getAttribLocation("inPosition")};
   if (positionAttribute >= 0) {
     glEnableVertexAttribArray(positionAttribute);
-    glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), nullptr);
+    if (m_isVBOPacked) {
+      GLsizei offset{offsetof(PackedVertex, position)};
+      glVertexAttribPointer(positionAttribute, 3, GL_SHORT, GL_TRUE, stride,
+                            reinterpret_cast<void*>(offset));
+    } else {
+      glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, stride,
+                            nullptr);
+    }
   }
 
-  GLint normalAttribute{glGetAttribLocation(program, "inNormal")};
+  GLint normalAttribute{program.getAttribLocation("inNormal")};
   if (normalAttribute >= 0) {
     glEnableVertexAttribArray(normalAttribute);
-    GLsizei offset{sizeof(glm::vec3)};
-    glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<void*>(offset));
+    if (m_isVBOPacked) {
+      GLsizei offset{offsetof(PackedVertex, normal)};
+      glVertexAttribPointer(normalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                            stride, reinterpret_cast<void*>(offset));
+    } else {
+      GLsizei offset{sizeof(glm::vec3)};
+      glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE, stride,
+                            reinterpret_cast<void*>(offset));
+    }
   }
 
-  GLint texCoordAttribute{glGetAttribLocation(program, "inTexCoord")};
+  GLint texCoordAttribute{program.getAttribLocation("inTexCoord")};
   if (texCoordAttribute >= 0) {
     glEnableVertexAttribArray(texCoordAttribute);
-    GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3)};
-    glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<void*>(offset));
+    if (m_isVBOPacked) {
+      GLsizei offset{offsetof(PackedVertex, texCoord)};
+      glVertexAttribPointer(texCoordAttribute, 2, GL_HALF_FLOAT, GL_FALSE,
+                            stride, reinterpret_cast<void*>(offset));
+    } else {
+      GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3)};
+      glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE, stride,
+                            reinterpret_cast<void*>(offset));
+    }
   }
 
-  GLint tangentCoordAttribute{glGetAttribLocation(program, "inTangent")};
+  GLint tangentCoordAttribute{program.getAttribLocation("inTangent")};
   if (tangentCoordAttribute >= 0) {
     glEnableVertexAttribArray(tangentCoordAttribute);
-    GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2)};
-    glVertexAttribPointer(tangentCoordAttribute, 4, GL_FLOAT, GL_FALSE,
-                          sizeof(Vertex), reinterpret_cast<void*>(offset));
+    if (m_isVBOPacked) {
+      GLsizei offset{offsetof(PackedVertex, tangent)};
+      glVertexAttribPointer(tangentCoordAttribute, 4, GL_INT_2_10_10_10_REV,
+                            GL_TRUE, stride, reinterpret_cast<void*>(offset));
+    } else {
+      GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2)};
+      glVertexAttribPointer(tangentCoordAttribute, 4, GL_FLOAT, GL_FALSE,
+                            stride, reinterpret_cast<void*>(offset));
+    }
   }
 
   // End of binding
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
+
+  // Material colors are set by the render functions
+  m_program = program;
+  m_KaUniform = program.findUniform("Ka");
+  m_KdUniform = program.findUniform("Kd");
+  m_KsUniform = program.findUniform("Ks");
+  m_shininessUniform = program.findUniform("shininess");
+}
+
+void Model::releaseCPUData() {
+  // The vertices are still needed by an upload in progress
+  if (m_upload.mesh) return;
+
+  m_vertices = {};
+  m_indices = {};
+}
+
+// Loads an image file, or its baked version, into a slot of the texture
+// table, unless the texture cache has it
+void Model::loadTexture(std::size_t slot, std::string_view path) {
+  TextureUpload texture;
+  texture.slot = slot;
+  texture.path = path;
+  lookUpTexture(texture);
+  if (texture.cached) {
+    // Nothing to decode
+  } else if (const auto bakedPath{abcg::opengl::findBakedTexture(path)};
+             !bakedPath.empty()) {
+    texture.compressed = abcg::opengl::loadDDS(bakedPath);
+  } else {
+    texture.mipChain =
+        abcg::MipStreamer::makeMipChain(abcg::opengl::loadImage(path));
+  }
+  texture.isDecoded = true;
+  uploadTexture(texture);
+}
+
+// Looks up a staged texture in the texture cache, by path and then by the
+// content of its file. Makes no OpenGL calls.
+void Model::lookUpTexture(TextureUpload& texture) const {
+  auto& cache{abcg::TextureCache::getInstance()};
+  texture.key = abcg::TextureCache::makeKey(texture.path, textureFlags);
+  texture.cached = cache.find(texture.key);
+  if (texture.cached) return;
+
+  const std::array paths{texture.path};
+  texture.contentHash = abcg::TextureCache::hashContent(paths, textureFlags);
+  if (texture.contentHash) {
+    texture.cached = cache.findContent(texture.key, *texture.contentHash);
+  }
+}
+
+// Replaces the texture of a slot
+void Model::setTexture(std::size_t slot, abcg::TextureCache::Handle texture) {
+  m_textures.at(slot) = std::move(texture);
+}
+
+// Schedules an image to be uploaded by uploadStep into a slot of the texture
+// table, replacing an image already staged for the slot. The image is
+// decoded by decodeTextures.
+void Model::stageTexture(std::size_t slot, std::string_view path) {
+  if (!std::filesystem::exists(path)) return;
+
+  std::erase_if(m_upload.textures,
+                [slot](const auto& texture) { return texture.slot == slot; });
+  TextureUpload texture;
+  texture.slot = slot;
+  texture.path = path;
+  m_upload.textures.push_back(std::move(texture));
+}
+
+// Converts the vertices to the upload format and sets up the mesh whose
+// buffers are created by uploadStep
+void Model::stageVertices(
+    std::span<const abcg::MeshCache::Material> materials) {
+  m_isVBOPacked = false;
+  if (m_vertexFormat == VertexFormat::Packed) {
+    m_isVBOPacked = hasNormalizedPositions(m_vertices);
+    if (!m_isVBOPacked) {
+      fmt::print("Warning: mesh is not standardized; using float vertices\n");
+    }
+  }
+
+  m_upload.packedVertices.clear();
+  if (m_isVBOPacked) {
+    m_upload.packedVertices.resize(m_vertices.size());
+    std::transform(m_vertices.begin(), m_vertices.end(),
+                   m_upload.packedVertices.begin(), packVertex);
+  }
+
+  auto mesh{std::make_shared<SharedMesh>()};
+  mesh->lods = m_lods;
+  mesh->submeshes = m_submeshes;
+  mesh->meshlets = m_meshlets;
+  mesh->materials.assign(materials.begin(), materials.end());
+  mesh->radius = m_radius;
+  mesh->hasNormals = m_hasNormals;
+  mesh->hasTexCoords = m_hasTexCoords;
+  mesh->isPacked = m_isVBOPacked;
+
+  m_upload.mesh = std::move(mesh);
+  m_upload.residentMesh = nullptr;
+  m_upload.isStarted = false;
+  m_upload.vertexOffset = 0;
+  m_upload.indexOffset = 0;
 }
 
 void Model::standardize() {
@@ -391,3 +1492,96 @@ void Model::standardize() {
     vertex.position = (vertex.position - center) * scaling;
   }
 }
+
+// Radius of the bounding sphere centered at the origin, used for selecting
+// the level of detail
+void Model::updateRadius() {
+  m_radius = 0.0f;
+  for (const auto& vertex : m_vertices) {
+    m_radius = std::max(m_radius, glm::length(vertex.position));
+  }
+}
+
+ModelLoader::~ModelLoader() {
+  // The worker threads may still be using the models
+  cancel();
+  for (auto& abandoned : m_abandoned) abandoned.prepared.wait();
+}
+
+// Starts loading a model. The model may already hold data set up on the
+// OpenGL thread. A load in progress is canceled.
+void ModelLoader::start(std::unique_ptr<Model> model,
+                        PrepareFunction prepare) {
+  cancel();
+
+  m_model = std::move(model);
+  m_canceled = std::make_shared<std::atomic<bool>>(false);
+  m_state = State::Preparing;
+  m_prepared = abcg::ThreadPool::getInstance().submit(
+      [model = m_model.get(), prepare = std::move(prepare),
+       canceled = m_canceled] { return prepare(*model, *canceled); });
+}
+
+// Cancels the load in progress, if any, without waiting for its worker, and
+// clears the error of the last load
+void ModelLoader::cancel() {
+  if (m_canceled) *m_canceled = true;
+  m_canceled = nullptr;
+  m_state = State::Idle;
+  m_error.clear();
+
+  // The result of the worker is dropped once it is done
+  if (m_prepared.valid()) {
+    m_abandoned.push_back({std::move(m_model), std::move(m_prepared)});
+  }
+  m_model.reset();
+}
+
+// Advances the load. Must be called on the OpenGL thread, typically once per
+// frame. Returns the model once it has been fully uploaded.
+std::unique_ptr<Model> ModelLoader::update(std::size_t maxUploadBytes) {
+  auto isReady{[](const std::future<bool>& future) {
+    return future.wait_for(std::chrono::seconds{0}) ==
+           std::future_status::ready;
+  }};
+
+  // Release the models of the canceled loads whose workers are done
+  std::erase_if(m_abandoned, [&](const Abandoned& abandoned) {
+    return isReady(abandoned.prepared);
+  });
+
+  if (m_prepared.valid()) {
+    if (!isReady(m_prepared)) return nullptr;
+
+    // The model is released here if preparing failed or was canceled
+    auto model{std::move(m_model)};
+    m_state = State::Idle;
+    m_canceled = nullptr;
+    try {
+      if (!m_prepared.get()) return nullptr;
+    } catch (const std::exception& exception) {
+      // The current model is kept, e.g. if the file is malformed
+      m_error = exception.what();
+      fmt::print(stderr, "{}\n", m_error);
+      // Drop the terminal color codes of abcg::Exception
+      for (auto begin{m_error.find('\033')}; begin != std::string::npos;
+           begin = m_error.find('\033', begin)) {
+        m_error.erase(begin, m_error.find('m', begin) - begin + 1);
+      }
+      return nullptr;
+    }
+    m_model = std::move(model);
+    m_state = State::Uploading;
+  }
+
+  if (m_state != State::Uploading || !m_model->uploadStep(maxUploadBytes)) {
+    return nullptr;
+  }
+
+  m_state = State::Idle;
+  return std::move(m_model);
+}
+
+float ModelLoader::getProgress() const {
+  return m_state == State::Uploading ? m_model->getUploadProgress() : 0.0f;
+}
@@ -3,7 +3,6 @@
 #include <imgui.h>
 
 #include <cppitertools/itertools.hpp>
-#include <glm/gtc/matrix_inverse.hpp>
 
 #include "imfilebrowser.h"
 
@@ -49,19 +48,40 @@ void OpenGLWindow::initializeGL() {
     }
   }
 
-  // Create programs
+  // Create the uniform buffers shared by every program
+  m_frameUniforms.create(abcg::FrameBlock::binding, sizeof(abcg::FrameBlock));
+  m_objectUniforms.create(abcg::ObjectBlock::binding,
+                          sizeof(abcg::ObjectBlock));
+
+  // Create programs. They are compiled together, and each one is checked
+  // when its uniforms are looked up. The mapping mode never changes, so the
+  // programs are the variants of that mode, without the other branches.
+  std::vector<abcg::ProgramShaders> paths;
   for (const auto& name : m_shaderNames) {
     auto path{getAssetsPath() + "shaders/" + name};
-    auto program{createProgramFromFile(path + ".vert", path + ".frag")};
-    m_programs.push_back(program);
+    paths.push_back({path + ".vert",
+                     path + ".frag",
+                     {{"MAPPING_MODE", std::to_string(m_mappingMode)}}});
+  }
+  m_programs = createProgramsFromFiles(paths);
+  for (const auto& program : m_programs) {
+    Uniforms uniforms;
+    uniforms.diffuseTex = program.findUniform("diffuseTex");
+    uniforms.normalTex = program.findUniform("normalTex");
+    uniforms.cubeTex = program.findUniform("cubeTex");
+    uniforms.texMatrix = program.findUniform("texMatrix");
+    uniforms.mappingMode = program.findUniform("mappingMode");
+    m_uniforms.push_back(uniforms);
   }
 
+  // The sky is drawn with the cube map of the current model, so give it to
+  // the empty model shown while the default model loads. The texture cache
+  // shares it with the models loaded later.
+  m_model->loadCubeTexture(getAssetsPath() + "maps/cube/");
+
   // Load default model
   loadModel(getAssetsPath() + "/Tree_Log/one_log.obj");
 
-  // Load cubemap
-  m_model.loadCubeTexture(getAssetsPath() + "maps/cube/");
-
   // Initial trackball spin
   m_trackBallModel.setAxis(glm::normalize(glm::vec3(1, 1, 1)));
 
@@ -75,6 +95,9 @@ void OpenGLWindow::initializeSkybox() {
   // Create skybox program
   auto path{getAssetsPath() + "shaders/" + m_skyShaderName};
   m_skyProgram = createProgramFromFile(path + ".vert", path + ".frag");
+  m_skyViewMatrixUniform = m_skyProgram.findUniform("viewMatrix");
+  m_skyProjMatrixUniform = m_skyProgram.findUniform("projMatrix");
+  m_skyTexUniform = m_skyProgram.findUniform("skyTex");
 
   // Generate VBO
   glGenBuffers(1, &m_skyVBO);
@@ -84,7 +107,7 @@ void OpenGLWindow::initializeSkybox() {
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 
   // Get location of attributes in the program
-  GLint positionAttribute{glGetAttribLocation(m_skyProgram, "inPosition")};
+  GLint positionAttribute{m_skyProgram.getAttribLocation("inPosition")};
 
   // Create VAO
   glGenVertexArrays(1, &m_skyVAO);
@@ -102,77 +125,70 @@ void OpenGLWindow::initializeSkybox() {
 }
 
 void OpenGLWindow::loadModel(std::string_view path) {
-  m_model.loadDiffuseTexture(getAssetsPath() + "maps/pattern.png");
-  m_model.loadNormalTexture(getAssetsPath() + "maps/pattern_normal.png");
-  m_model.loadFromFile(path);
-  m_model.setupVAO(m_programs.at(m_currentProgramIndex));
-  m_trianglesToDraw = m_model.getNumTriangles();
-
-  // Use material properties from the loaded model
-  m_Ka = m_model.getKa();
-  m_Kd = m_model.getKd();
-  m_Ks = m_model.getKs();
-  m_shininess = m_model.getShininess();
+  // The cubemap is loaded on this thread; the rest in the background
+  auto model{std::make_unique<Model>()};
+  model->loadCubeTexture(getAssetsPath() + "maps/cube/");
+  // Front faces are clockwise here, so meshlets are only frustum culled
+  model->setMeshletCulling(Model::MeshletCulling::Frustum);
+
+  m_modelLoader.start(
+      std::move(model),
+      [path = std::string{path}, assetsPath = getAssetsPath()](
+          Model& newModel, const std::atomic<bool>& canceled) {
+        newModel.prepareDiffuseTexture(assetsPath + "maps/pattern.png");
+        newModel.prepareNormalTexture(assetsPath + "maps/pattern_normal.png");
+        return newModel.prepareFromFile(path, true, true, &canceled);
+      });
+}
+
+void OpenGLWindow::updateModelLoader() {
+  // Mipmap levels requested by the last frame appear progressively
+  m_model->updateTextures(m_uploadBytesPerFrame);
+
+  auto model{m_modelLoader.update(m_uploadBytesPerFrame)};
+  if (!model) return;
+
+  m_model = std::move(model);
+  m_model->setupVAO(m_programs.at(m_currentProgramIndex));
+  m_model->releaseCPUData();
 }
 
 void OpenGLWindow::paintGL() {
+  updateModelLoader();
   update();
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_viewportWidth, m_viewportHeight);
 
-  // Use currently selected program
-  const auto program{m_programs.at(m_currentProgramIndex)};
+  // Use currently selected program. Uniforms that keep their values are
+  // not uploaded again.
+  const auto& program{m_programs.at(m_currentProgramIndex)};
+  const auto& uniforms{m_uniforms.at(m_currentProgramIndex)};
   glUseProgram(program);
 
-  // Get location of uniform variables
-  GLint viewMatrixLoc{glGetUniformLocation(program, "viewMatrix")};
-  GLint projMatrixLoc{glGetUniformLocation(program, "projMatrix")};
-  GLint modelMatrixLoc{glGetUniformLocation(program, "modelMatrix")};
-  GLint normalMatrixLoc{glGetUniformLocation(program, "normalMatrix")};
-  GLint lightDirLoc{glGetUniformLocation(program, "lightDirWorldSpace")};
-  GLint shininessLoc{glGetUniformLocation(program, "shininess")};
-  GLint IaLoc{glGetUniformLocation(program, "Ia")};
-  GLint IdLoc{glGetUniformLocation(program, "Id")};
-  GLint IsLoc{glGetUniformLocation(program, "Is")};
-  GLint KaLoc{glGetUniformLocation(program, "Ka")};
-  GLint KdLoc{glGetUniformLocation(program, "Kd")};
-  GLint KsLoc{glGetUniformLocation(program, "Ks")};
-  GLint diffuseTexLoc{glGetUniformLocation(program, "diffuseTex")};
-  GLint normalTexLoc{glGetUniformLocation(program, "normalTex")};
-  GLint cubeTexLoc{glGetUniformLocation(program, "cubeTex")};
-  GLint mappingModeLoc{glGetUniformLocation(program, "mappingMode")};
-  GLint texMatrixLoc{glGetUniformLocation(program, "texMatrix")};
-
   // Set uniform variables used by every scene object
-  glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_camera.m_viewMatrix[0][0]);
-  glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_camera.m_projMatrix[0][0]);
-  glUniform1i(diffuseTexLoc, 0);
-  glUniform1i(normalTexLoc, 1);
-  glUniform1i(cubeTexLoc, 2);
-  glUniform1i(mappingModeLoc, m_mappingMode);
-
-  glm::mat3 texMatrix{m_trackBallLight.getRotation()};
-  glUniformMatrix3fv(texMatrixLoc, 1, GL_TRUE, &texMatrix[0][0]);
-
-  auto lightDirRotated{m_trackBallLight.getRotation() * m_lightDir};
-  glUniform4fv(lightDirLoc, 1, &lightDirRotated.x);
-  glUniform4fv(IaLoc, 1, &m_Ia.x);
-  glUniform4fv(IdLoc, 1, &m_Id.x);
-  glUniform4fv(IsLoc, 1, &m_Is.x);
+  const glm::vec4 lightDirRotated{m_trackBallLight.getRotation() *
+                                  m_lightDir};
+  const auto frame{abcg::FrameBlock::make(m_camera.m_viewMatrix,
+                                          m_camera.m_projMatrix,
+                                          lightDirRotated, m_Ia, m_Id, m_Is)};
+  m_frameUniforms.update(frame);
+  program.setUniform(uniforms.diffuseTex, 0);
+  program.setUniform(uniforms.normalTex, 1);
+  program.setUniform(uniforms.cubeTex, 2);
+  program.setUniform(uniforms.mappingMode, m_mappingMode);
+
+  // The inverse of the rotation
+  const auto texMatrix{
+      glm::transpose(glm::mat3{m_trackBallLight.getRotation()})};
+  program.setUniform(uniforms.texMatrix, texMatrix);
 
   // Set uniform variables of the current object
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &m_modelMatrix[0][0]);
-
-  auto modelViewMatrix{glm::mat3(m_camera.m_viewMatrix * m_modelMatrix)};
-  glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+  m_objectUniforms.update(abcg::ObjectBlock::make(m_modelMatrix, frame));
 
-  glUniform1f(shininessLoc, m_shininess);
-  glUniform4fv(KaLoc, 1, &m_Ka.x);
-  glUniform4fv(KdLoc, 1, &m_Kd.x);
-  glUniform4fv(KsLoc, 1, &m_Ks.x);
-  m_model.render(m_trianglesToDraw);
+  // Material properties are set by the model
+  m_model->render(m_modelMatrix, m_camera.m_viewMatrix, m_camera.m_projMatrix,
+                  m_viewportHeight);
 
   if (m_currentProgramIndex == 0 || m_currentProgramIndex == 1) {
     renderSkybox();
@@ -182,21 +198,16 @@ void OpenGLWindow::paintGL() {
 void OpenGLWindow::renderSkybox() {
   glUseProgram(m_skyProgram);
 
-  // Get location of uniform variables
-  GLint viewMatrixLoc{glGetUniformLocation(m_skyProgram, "viewMatrix")};
-  GLint projMatrixLoc{glGetUniformLocation(m_skyProgram, "projMatrix")};
-  GLint skyTexLoc{glGetUniformLocation(m_skyProgram, "skyTex")};
-
   // Set uniform variables
-  auto viewMatrix{m_trackBallLight.getRotation()};
-  glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &viewMatrix[0][0]);
-  glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
-  glUniform1i(skyTexLoc, 0);
+  m_skyProgram.setUniform(m_skyViewMatrixUniform,
+                          m_trackBallLight.getRotation());
+  m_skyProgram.setUniform(m_skyProjMatrixUniform, m_projMatrix);
+  m_skyProgram.setUniform(m_skyTexUniform, 0);
 
   glBindVertexArray(m_skyVAO);
 
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, m_model.getCubeTexture());
+  glBindTexture(GL_TEXTURE_CUBE_MAP, m_model->getCubeTexture());
 
   glEnable(GL_CULL_FACE);
   glFrontFace(GL_CW);
@@ -222,7 +233,7 @@ void OpenGLWindow::paintUI() {
   {
     auto widgetSize{ImVec2(222, 190)};
 
-    if (!m_model.isUVMapped()) {
+    if (!m_model->isUVMapped()) {
       // Add extra space for static text
       widgetSize.y += 26;
     }
@@ -232,6 +243,33 @@ void OpenGLWindow::paintUI() {
         ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoDecoration};
     ImGui::Begin("Widget window", nullptr, flagsDisplayText);
 
+    // Progress of the log being loaded
+    if (m_modelLoader.getState() != ModelLoader::State::Idle) {
+      auto size{ImVec2(300, 40)};
+      auto position{ImVec2((m_viewportWidth - size.x) / 2.0f,
+                           (m_viewportHeight - size.y) / 2.0f)};
+
+      ImGui::SetNextWindowPos(position);
+      ImGui::SetNextWindowSize(size);
+      ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration);
+      const auto isPreparing{m_modelLoader.getState() ==
+                             ModelLoader::State::Preparing};
+      ImGui::ProgressBar(m_modelLoader.getProgress(), ImVec2(-1, 0),
+                         isPreparing ? "Loading..." : nullptr);
+      ImGui::End();
+    } else if (!m_modelLoader.getError().empty()) {
+      auto size{ImVec2(300, 80)};
+      auto position{ImVec2((m_viewportWidth - size.x) / 2.0f,
+                           (m_viewportHeight - size.y) / 2.0f)};
+
+      ImGui::SetNextWindowPos(position);
+      ImGui::SetNextWindowSize(size);
+      ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration);
+      ImGui::TextWrapped("Failed to load the log: %s",
+                         m_modelLoader.getError().c_str());
+      ImGui::End();
+    }
+
  
 
     // Aviso de gameover
@@ -354,6 +392,8 @@ void OpenGLWindow::terminateGL() {
   for (const auto& program : m_programs) {
     glDeleteProgram(program);
   }
+  m_frameUniforms.destroy();
+  m_objectUniforms.destroy();
   terminateSkybox();
 }
 
@@ -377,6 +417,9 @@ void OpenGLWindow::resetModelPosition(){
 }
 
 void OpenGLWindow::update() {
+  // The game starts once the log has been loaded
+  if (m_modelLoader.getState() != ModelLoader::State::Idle) return;
+
   float deltaTime{static_cast<float>(getDeltaTime())};
 
   elapsedTime += deltaTime;
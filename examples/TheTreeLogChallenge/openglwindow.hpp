@@ -1,6 +1,7 @@
 #ifndef OPENGLWINDOW_HPP_
 #define OPENGLWINDOW_HPP_
 
+#include <memory>
 #include <string_view>
 #include <imgui.h>
 
@@ -25,8 +26,10 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   int m_viewportWidth{};
   int m_viewportHeight{};
 
-  Model m_model;
-  int m_trianglesToDraw{};
+  std::unique_ptr<Model> m_model{std::make_unique<Model>()};
+  ModelLoader m_modelLoader;
+  // Maximum number of bytes uploaded per frame while loading a model
+  std::size_t m_uploadBytesPerFrame{4 * 1024 * 1024};
 
   Camera m_camera;
   float m_dollySpeed{0.0f};
@@ -86,28 +89,39 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   // Shaders
   const std::vector<const char*> m_shaderNames{
       "texture"};
-  std::vector<GLuint> m_programs;
+  std::vector<abcg::ShaderProgram> m_programs;
+  // Indices of the uniforms set by paintGL, looked up once per program
+  // (camera, light and object matrices are in the uniform buffers)
+  struct Uniforms {
+    int diffuseTex{-1};
+    int normalTex{-1};
+    int cubeTex{-1};
+    int texMatrix{-1};
+    int mappingMode{-1};
+  };
+  std::vector<Uniforms> m_uniforms;
+  abcg::UniformBuffer m_frameUniforms;
+  abcg::UniformBuffer m_objectUniforms;
   int m_currentProgramIndex{};
 
   // Mapping mode
   // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
   int m_mappingMode{3};
 
-  // Light and material properties
+  // Light properties
   glm::vec4 m_lightDir{-1.0f, -1.0f, -1.0f, 0.0f};
   glm::vec4 m_Ia{1.0f};
   glm::vec4 m_Id{1.0f};
   glm::vec4 m_Is{1.0f};
-  glm::vec4 m_Ka;
-  glm::vec4 m_Kd;
-  glm::vec4 m_Ks;
-  float m_shininess{};
 
   // Skybox
   const std::string m_skyShaderName{"skybox"};
   GLuint m_skyVAO{};
   GLuint m_skyVBO{};
-  GLuint m_skyProgram{};
+  abcg::ShaderProgram m_skyProgram;
+  int m_skyViewMatrixUniform{-1};
+  int m_skyProjMatrixUniform{-1};
+  int m_skyTexUniform{-1};
 
   // clang-format off
   const std::array<glm::vec3, 36>  m_skyPositions{
@@ -137,6 +151,7 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void terminateSkybox();
   void loadModel(std::string_view path);
   void update();
+  void updateModelLoader();
   void translateModel(float speed);
   void resetModelPosition();
   void checkCollisions();
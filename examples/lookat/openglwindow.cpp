@@ -6,19 +6,6 @@
 
 #include <cppitertools/itertools.hpp>
 #include <glm/gtx/fast_trigonometry.hpp>
-#include <glm/gtx/hash.hpp>
-#include <unordered_map>
-
-// Custom specialization of std::hash injected in namespace std
-namespace std {
-template <>
-struct hash<Vertex> {
-  size_t operator()(Vertex const& vertex) const noexcept {
-    std::size_t h1{std::hash<glm::vec3>()(vertex.position)};
-    return h1;
-  }
-};
-}  // namespace std
 
 void OpenGLWindow::handleEvent(SDL_Event& ev) {
   if (ev.type == SDL_KEYDOWN) {
@@ -132,33 +119,29 @@ void OpenGLWindow::initializeGL() {
 }
 
 void OpenGLWindow::loadModelFromFile(std::string_view path) {
-  tinyobj::ObjReaderConfig readerConfig;
-  readerConfig.mtl_search_path =
-      getAssetsPath() + "mtl/";  // Path to material files
-
-  tinyobj::ObjReader reader;
+  abcg::ObjParser parser;
 
-  if (!reader.ParseFromFile(path.data(), readerConfig)) {
-    if (!reader.Error().empty()) {
-      throw abcg::Exception{abcg::Exception::Runtime(
-          fmt::format("Failed to load model {} ({})", path, reader.Error()))};
+  // Path to material files
+  if (!parser.parseFromFile(path, getAssetsPath() + "mtl/")) {
+    if (!parser.getError().empty()) {
+      throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+          "Failed to load model {} ({})", path, parser.getError()))};
     }
     throw abcg::Exception{
         abcg::Exception::Runtime(fmt::format("Failed to load model {}", path))};
   }
 
-  if (!reader.Warning().empty()) {
-    fmt::print("Warning: {}\n", reader.Warning());
+  if (!parser.getWarning().empty()) {
+    fmt::print("Warning: {}\n", parser.getWarning());
   }
 
-  const auto& attrib{reader.GetAttrib()};
-  const auto& shapes{reader.GetShapes()};
+  const auto& attrib{parser.getAttrib()};
+  const auto& shapes{parser.getShapes()};
 
   m_vertices.clear();
   m_indices.clear();
 
-  // A key:value map with key=Vertex and value=index
-  std::unordered_map<Vertex, GLuint> hash{};
+  std::vector<float> positions;
 
   // Loop over shapes
   for (const auto& shape : shapes) {
@@ -180,22 +163,22 @@ void OpenGLWindow::loadModelFromFile(std::string_view path) {
         tinyobj::real_t vy = attrib.vertices[startIndex + 1];
         tinyobj::real_t vz = attrib.vertices[startIndex + 2];
 
-        Vertex vertex{};
-        vertex.position = {vx, vy, vz};
-
-        // If uniqueVertices doesn't contain this vertex
-        if (hash.count(vertex) == 0) {
-          // Add this index (size of m_vertices)
-          hash[vertex] = m_vertices.size();
-          // Add this vertex
-          m_vertices.push_back(vertex);
-        }
-
-        m_indices.push_back(hash[vertex]);
+        positions.insert(positions.end(), {vx, vy, vz});
       }
       indexOffset += numFaceVertices;
     }
   }
+
+  // Merge vertices with the same position
+  const auto welded{abcg::VertexWelder::weld(positions, 3)};
+  for (const auto corner : welded.firstCorners) {
+    Vertex vertex{};
+    vertex.position = {positions.at(corner * 3 + 0),
+                       positions.at(corner * 3 + 1),
+                       positions.at(corner * 3 + 2)};
+    m_vertices.push_back(vertex);
+  }
+  m_indices.assign(welded.indices.begin(), welded.indices.end());
 }
 
 void OpenGLWindow::paintGL() {
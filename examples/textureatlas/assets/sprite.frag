@@ -0,0 +1,9 @@
+#version 410
+
+in vec2 fragTexCoord;
+
+uniform sampler2D tex;
+
+out vec4 outColor;
+
+void main() { outColor = texture(tex, fragTexCoord); }
@@ -0,0 +1,15 @@
+#version 410
+
+layout(location = 0) in vec2 inPosition;
+
+// Corners of the sprite in normalized device coordinates, and of its image
+// in texture space: lower-left (x, y) and upper-right (z, w)
+uniform vec4 screenRect;
+uniform vec4 uvRect;
+
+out vec2 fragTexCoord;
+
+void main() {
+  fragTexCoord = mix(uvRect.xy, uvRect.zw, inPosition);
+  gl_Position = vec4(mix(screenRect.xy, screenRect.zw, inPosition), 0, 1);
+}
@@ -0,0 +1,11 @@
+#version 410
+
+in vec2 fragTexCoord;
+
+// Texture array or atlas, and the layer of the image of the sprite
+uniform sampler2DArray tex;
+uniform float layer;
+
+out vec4 outColor;
+
+void main() { outColor = texture(tex, vec3(fragTexCoord, layer)); }
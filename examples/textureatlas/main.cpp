@@ -0,0 +1,21 @@
+#include <fmt/core.h>
+
+#include "abcg.hpp"
+#include "openglwindow.hpp"
+
+int main(int argc, char **argv) {
+  try {
+    abcg::Application app(argc, argv);
+
+    auto window{std::make_unique<OpenGLWindow>()};
+    window->setOpenGLSettings({.samples = 0, .vsync = false});
+    window->setWindowSettings(
+        {.width = 600, .height = 600, .title = "Texture Atlas"});
+
+    app.run(window);
+  } catch (abcg::Exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+#include "openglwindow.hpp"
+
+#include <imgui.h>
+
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+
+namespace {
+constexpr int numImages{256};
+constexpr int imageSize{64};
+constexpr int maxSprites{16384};
+
+// Checkerboard with a different color and square size for each image
+abcg::opengl::Image makeImage(int index) {
+  abcg::opengl::Image image;
+  image.width = imageSize;
+  image.height = imageSize;
+  image.format = GL_RGB;
+  image.pixels.resize(image.getRowSize() * imageSize);
+
+  const glm::vec3 color{glm::fract(glm::vec3{0.13f, 0.57f, 0.91f} *
+                                   static_cast<float>(index + 1))};
+  const auto squareSize{4 << (index % 4)};
+  auto* pixel{image.pixels.data()};
+  for (auto y : iter::range(imageSize)) {
+    for (auto x : iter::range(imageSize)) {
+      const auto isDark{((x / squareSize) + (y / squareSize)) % 2 == 0};
+      const auto texel{isDark ? color * 0.5f : color};
+      for (auto channel : iter::range(3)) {
+        *pixel++ =
+            static_cast<std::byte>(static_cast<int>(texel[channel] * 255.0f));
+      }
+    }
+  }
+  return image;
+}
+}  // namespace
+
+void OpenGLWindow::initializeGL() {
+  glClearColor(0, 0, 0, 1);
+
+  m_textureProgram = createProgramFromFile(getAssetsPath() + "sprite.vert",
+                                           getAssetsPath() + "sprite.frag");
+  m_arrayProgram = createProgramFromFile(getAssetsPath() + "sprite.vert",
+                                         getAssetsPath() + "spritearray.frag");
+
+  // Unit square drawn as a triangle strip, stretched by the shaders
+  const std::array vertices{glm::vec2{0, 0}, glm::vec2{1, 0},
+                            glm::vec2{0, 1}, glm::vec2{1, 1}};
+  glGenBuffers(1, &m_VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(),
+               GL_STATIC_DRAW);
+
+  glGenVertexArrays(1, &m_VAO);
+  glBindVertexArray(m_VAO);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  std::vector<abcg::opengl::Image> images;
+  for (auto index : iter::range(numImages)) {
+    images.push_back(makeImage(index));
+    m_textures.push_back(abcg::opengl::createTexture(images.back()));
+  }
+  m_textureArray = abcg::opengl::createTextureArray(images);
+  m_atlas = abcg::opengl::createTextureAtlas(images, 1024);
+}
+
+void OpenGLWindow::paintGL() {
+  // Attribute the last frame time to the mode drawn in it
+  auto& frameTime{m_frameTimes.at(static_cast<std::size_t>(m_mode))};
+  const auto deltaTime{static_cast<float>(getDeltaTime()) * 1000.0f};
+  frameTime = (frameTime == 0.0f) ? deltaTime
+                                  : glm::mix(frameTime, deltaTime, 0.05f);
+
+  glClear(GL_COLOR_BUFFER_BIT);
+  glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+
+  switch (m_mode) {
+    case Mode::Textures:
+      drawSprites(m_textureProgram, nullptr);
+      break;
+    case Mode::TextureArray:
+      drawSprites(m_arrayProgram, &m_textureArray);
+      break;
+    case Mode::Atlas:
+      drawSprites(m_arrayProgram, &m_atlas);
+      break;
+  }
+}
+
+// Draws the sprites on a grid, one draw call each. Without an atlas, the
+// texture of each sprite is bound before drawing it; with one, the atlas is
+// bound once and each sprite selects its region with uniforms.
+void OpenGLWindow::drawSprites(GLuint program,
+                               const abcg::opengl::TextureAtlas* atlas) {
+  glUseProgram(program);
+  const auto screenRectLocation{glGetUniformLocation(program, "screenRect")};
+  const auto uvRectLocation{glGetUniformLocation(program, "uvRect")};
+  const auto layerLocation{glGetUniformLocation(program, "layer")};
+  glUniform1i(glGetUniformLocation(program, "tex"), 0);
+
+  glActiveTexture(GL_TEXTURE0);
+  if (atlas != nullptr) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, atlas->textureID);
+  } else {
+    const glm::vec4 uvRect{0.0f, 0.0f, 1.0f, 1.0f};
+    glUniform4fv(uvRectLocation, 1, &uvRect.x);
+  }
+
+  const auto columns{static_cast<int>(
+      std::ceil(std::sqrt(static_cast<float>(m_numSprites))))};
+  const auto cellSize{2.0f / static_cast<float>(columns)};
+  glBindVertexArray(m_VAO);
+  for (auto sprite : iter::range(m_numSprites)) {
+    const glm::vec2 corner{
+        -1.0f + cellSize * static_cast<float>(sprite % columns),
+        1.0f - cellSize * static_cast<float>(sprite / columns + 1)};
+    const glm::vec4 screenRect{corner, corner + cellSize};
+    glUniform4fv(screenRectLocation, 1, &screenRect.x);
+
+    const auto image{static_cast<std::size_t>(sprite % numImages)};
+    if (atlas != nullptr) {
+      const auto& region{atlas->regions.at(image)};
+      glUniform4fv(uvRectLocation, 1, &region.uvRect.x);
+      glUniform1f(layerLocation, static_cast<float>(region.layer));
+    } else {
+      glBindTexture(GL_TEXTURE_2D, m_textures.at(image));
+    }
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  }
+  glBindVertexArray(0);
+
+  glBindTexture(atlas != nullptr ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 0);
+  glUseProgram(0);
+}
+
+void OpenGLWindow::paintUI() {
+  abcg::OpenGLWindow::paintUI();
+
+  {
+    auto widgetSize{ImVec2(260, 150)};
+    ImGui::SetNextWindowPos(ImVec2(m_viewportWidth - widgetSize.x - 5, 5));
+    ImGui::SetNextWindowSize(widgetSize);
+    ImGui::Begin("Widget window", nullptr, ImGuiWindowFlags_NoDecoration);
+
+    // Mode combo box
+    {
+      static const std::array comboItems{"Separate textures", "Texture array",
+                                         "Atlas"};
+      auto currentIndex{static_cast<std::size_t>(m_mode)};
+
+      ImGui::PushItemWidth(150);
+      if (ImGui::BeginCombo("Mode", comboItems.at(currentIndex))) {
+        for (auto index : iter::range(comboItems.size())) {
+          const bool isSelected{currentIndex == index};
+          if (ImGui::Selectable(comboItems.at(index), isSelected))
+            currentIndex = index;
+          if (isSelected) ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+      }
+      ImGui::PopItemWidth();
+      m_mode = static_cast<Mode>(currentIndex);
+    }
+
+    ImGui::PushItemWidth(150);
+    ImGui::SliderInt("Sprites", &m_numSprites, 1, maxSprites);
+    ImGui::PopItemWidth();
+
+    // Draws per second of each mode, from its average frame time
+    for (auto&& [name, frameTime] : iter::zip(
+             std::array{"Separate", "Array", "Atlas"}, m_frameTimes)) {
+      const auto drawsPerSecond{
+          frameTime > 0.0f
+              ? static_cast<double>(m_numSprites) * 1000.0 /
+                    static_cast<double>(frameTime)
+              : 0.0};
+      ImGui::Text("%s: %.2f ms, %.2fM draws/s", name,
+                  static_cast<double>(frameTime), drawsPerSecond / 1.0e6);
+    }
+    ImGui::Text("Atlas: %d layers of %dx%d", m_atlas.numLayers,
+                m_atlas.width, m_atlas.height);
+
+    ImGui::End();
+  }
+}
+
+void OpenGLWindow::resizeGL(int width, int height) {
+  m_viewportWidth = width;
+  m_viewportHeight = height;
+}
+
+void OpenGLWindow::terminateGL() {
+  glDeleteTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+  glDeleteTextures(1, &m_textureArray.textureID);
+  glDeleteTextures(1, &m_atlas.textureID);
+  glDeleteBuffers(1, &m_VBO);
+  glDeleteVertexArrays(1, &m_VAO);
+  glDeleteProgram(m_textureProgram);
+  glDeleteProgram(m_arrayProgram);
+}
@@ -0,0 +1,47 @@
+#ifndef OPENGLWINDOW_HPP_
+#define OPENGLWINDOW_HPP_
+
+#include <array>
+#include <vector>
+
+#include "abcg.hpp"
+
+// Draws a grid of sprites, one draw call each, and compares the frame time
+// of binding a texture per sprite with binding a single texture array or
+// atlas for all of them
+class OpenGLWindow : public abcg::OpenGLWindow {
+ protected:
+  void initializeGL() override;
+  void paintGL() override;
+  void paintUI() override;
+  void resizeGL(int width, int height) override;
+  void terminateGL() override;
+
+ private:
+  // How the sprites sample their images
+  enum class Mode { Textures, TextureArray, Atlas };
+
+  int m_viewportWidth{};
+  int m_viewportHeight{};
+
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  // Programs sampling a 2D texture and a texture array
+  GLuint m_textureProgram{};
+  GLuint m_arrayProgram{};
+
+  // The images as separate textures, as the layers of a texture array, and
+  // packed into an atlas
+  std::vector<GLuint> m_textures;
+  abcg::opengl::TextureAtlas m_textureArray;
+  abcg::opengl::TextureAtlas m_atlas;
+
+  Mode m_mode{Mode::Textures};
+  int m_numSprites{4096};
+  // Moving average of the frame time of each mode, in ms
+  std::array<float, 3> m_frameTimes{};
+
+  void drawSprites(GLuint program, const abcg::opengl::TextureAtlas* atlas);
+};
+
+#endif
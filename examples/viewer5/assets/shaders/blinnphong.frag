@@ -4,38 +4,10 @@ in vec3 fragN;
 in vec3 fragL;
 in vec3 fragV;
 
-// Light properties
-uniform vec4 Ia, Id, Is;
-
-// Material properties
-uniform vec4 Ka, Kd, Ks;
-uniform float shininess;
+#include "lighting.glsl"
 
 out vec4 outColor;
 
-vec4 BlinnPhong(vec3 N, vec3 L, vec3 V) {
-  N = normalize(N);
-  L = normalize(L);
-
-  // Compute lambertian term
-  float lambertian = max(dot(N, L), 0.0);
-
-  // Compute specular term
-  float specular = 0.0;
-  if (lambertian > 0.0) {
-    V = normalize(V);
-    vec3 H = normalize(L + V);
-    float angle = max(dot(H, N), 0.0);
-    specular = pow(angle, shininess);
-  }
-
-  vec4 diffuseColor = Kd * Id * lambertian;
-  vec4 specularColor = Ks * Is * specular;
-  vec4 ambientColor = Ka * Ia;
-
-  return ambientColor + diffuseColor + specularColor;
-}
-
 void main() {
   vec4 color = BlinnPhong(fragN, fragL, fragV);
 
@@ -0,0 +1,69 @@
+// Reflection models, with the light properties of FrameBlock and the
+// material properties set by the model
+
+#include "uniforms.glsl"
+
+// Material properties
+uniform vec4 Ka, Kd, Ks;
+uniform float shininess;
+
+// Lambertian (x) and Blinn-Phong specular (y) terms
+vec2 BlinnPhongTerms(vec3 N, vec3 L, vec3 V) {
+  N = normalize(N);
+  L = normalize(L);
+
+  // Compute lambertian term
+  float lambertian = max(dot(N, L), 0.0);
+
+  // Compute specular term
+  float specular = 0.0;
+  if (lambertian > 0.0) {
+    V = normalize(V);
+    vec3 H = normalize(L + V);
+    float angle = max(dot(H, N), 0.0);
+    specular = pow(angle, shininess);
+  }
+
+  return vec2(lambertian, specular);
+}
+
+// Lambertian (x) and Phong specular (y) terms
+vec2 PhongTerms(vec3 N, vec3 L, vec3 V) {
+  N = normalize(N);
+  L = normalize(L);
+
+  // Compute lambertian term
+  float lambertian = max(dot(N, L), 0.0);
+
+  // Compute specular term
+  float specular = 0.0;
+  if (lambertian > 0.0) {
+    // vec3 R = normalize(2.0 * dot(N, L) * N - L);
+    vec3 R = reflect(-L, N);
+    V = normalize(V);
+    float angle = max(dot(R, V), 0.0);
+    specular = pow(angle, shininess);
+  }
+
+  return vec2(lambertian, specular);
+}
+
+// Color from the lambertian and specular terms. The ambient and diffuse
+// colors are modulated by the colors of the texture maps
+vec4 Shade(vec2 terms, vec4 map_Ka, vec4 map_Kd) {
+  vec4 diffuseColor = map_Kd * Kd * Id * terms.x;
+  vec4 specularColor = Ks * Is * terms.y;
+  vec4 ambientColor = map_Ka * Ka * Ia;
+
+  return ambientColor + diffuseColor + specularColor;
+}
+
+// Blinn-Phong reflection model
+vec4 BlinnPhong(vec3 N, vec3 L, vec3 V) {
+  return Shade(BlinnPhongTerms(N, L, V), vec4(1.0), vec4(1.0));
+}
+
+// Phong reflection model
+vec4 Phong(vec3 N, vec3 L, vec3 V) {
+  return Shade(PhongTerms(N, L, V), vec4(1.0), vec4(1.0));
+}
@@ -0,0 +1,34 @@
+// Texture coordinates of the procedural mapping modes, from positions in
+// object space
+//
+// Model::bakeTexCoords computes the cylindrical and spherical mappings on
+// the CPU in the same way; keep them in sync.
+
+#define PI 3.14159265358979323846
+
+// Planar mapping
+vec2 PlanarMappingX(vec3 P) { return vec2(1.0 - P.z, P.y); }
+vec2 PlanarMappingY(vec3 P) { return vec2(P.x, 1.0 - P.z); }
+vec2 PlanarMappingZ(vec3 P) { return P.xy; }
+
+// Cylindrical mapping
+vec2 CylindricalMapping(vec3 P) {
+  float longitude = atan(P.x, P.z);
+  float height = P.y;
+
+  float u = longitude / (2.0 * PI) + 0.5;  // From [-pi, pi] to [0, 1]
+  float v = height - 0.5;                  // Base at y = -0.5
+
+  return vec2(u, v);
+}
+
+// Spherical mapping
+vec2 SphericalMapping(vec3 P) {
+  float longitude = atan(P.x, P.z);
+  float latitude = asin(P.y / length(P));
+
+  float u = longitude / (2.0 * PI) + 0.5;  // From [-pi, pi] to [0, 1]
+  float v = latitude / PI + 0.5;           // From [-pi/2, pi/2] to [0, 1]
+
+  return vec2(u, v);
+}
@@ -9,14 +9,8 @@ in vec3 fragNObj;
 in vec3 fragLEye;
 in vec3 fragVEye;
 
-uniform mat3 normalMatrix;
-
-// Light properties
-uniform vec4 Ia, Id, Is;
-
-// Material properties
-uniform vec4 Ka, Kd, Ks;
-uniform float shininess;
+#include "lighting.glsl"
+#include "mapping.glsl"
 
 // Diffuse map sampler
 uniform sampler2D diffuseTex;
@@ -26,7 +20,18 @@ uniform sampler2D normalTex;
 
 // Mapping mode
 // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
+// Shader variants set it at compile time, and the branches of the other
+// modes are removed as dead code
+#if defined(MAPPING_MODE)
+const int mappingMode = MAPPING_MODE;
+#else
 uniform int mappingMode;
+#endif
+
+// Whether back faces are shaded in red
+#if !defined(HIGHLIGHT_BACK_FACES)
+#define HIGHLIGHT_BACK_FACES 1
+#endif
 
 out vec4 outColor;
 
@@ -39,35 +44,22 @@ mat3 ComputeTBN(vec3 TObj, vec3 BObj, vec3 NObj) {
               NEye.z);
 }
 
-// Blinn-Phong reflection model
-vec4 BlinnPhong(vec3 N, vec3 L, vec3 V, vec2 texCoord) {
-  N = normalize(N);
-  L = normalize(L);
-
-  // Compute lambertian term
-  float lambertian = max(dot(N, L), 0.0);
-
-  // Compute specular term
-  float specular = 0.0;
-  if (lambertian > 0.0) {
-    V = normalize(V);
-    vec3 H = normalize(L + V);
-    float angle = max(dot(H, N), 0.0);
-    specular = pow(angle, shininess);
-  }
+// Tangent-space normal from the normal map. Z is rebuilt from X and Y, so
+// that two-channel maps (BC5) work as well
+vec3 SampleNormal(vec2 texCoord) {
+  vec2 N = texture(normalTex, texCoord).xy * 2.0 - 1.0;  // To [-1, 1]
+  return vec3(N, sqrt(max(1.0 - dot(N, N), 0.0)));
+}
 
+// Blinn-Phong reflection model, with the diffuse map
+vec4 BlinnPhong(vec3 N, vec3 L, vec3 V, vec2 texCoord) {
   vec4 map_Kd = texture(diffuseTex, texCoord);
   vec4 map_Ka = map_Kd;
 
-  vec4 diffuseColor = map_Kd * Kd * Id * lambertian;
-  vec4 specularColor = Ks * Is * specular;
-  vec4 ambientColor = map_Ka * Ka * Ia;
-
-  return ambientColor + diffuseColor + specularColor;
+  return Shade(BlinnPhongTerms(N, L, V), map_Ka, map_Kd);
 }
 
 // Planar mapping
-vec2 PlanarMappingXUV(vec3 P) { return vec2(1.0 - P.z, P.y); }
 mat3 PlanarMappingXTBN(vec3 P) {
   vec3 T = vec3(0, 0, -1);
   vec3 N = fragNObj;
@@ -75,7 +67,6 @@ mat3 PlanarMappingXTBN(vec3 P) {
   return ComputeTBN(T, B, N);
 }
 
-vec2 PlanarMappingYUV(vec3 P) { return vec2(P.x, 1.0 - P.z); }
 mat3 PlanarMappingYTBN(vec3 P) {
   vec3 T = vec3(1, 0, 0);
   vec3 N = fragNObj;
@@ -83,7 +74,6 @@ mat3 PlanarMappingYTBN(vec3 P) {
   return ComputeTBN(T, B, N);
 }
 
-vec2 PlanarMappingZUV(vec3 P) { return P.xy; }
 mat3 PlanarMappingZTBN(vec3 P) {
   vec3 T = vec3(1, 0, 0);
   vec3 N = fragNObj;
@@ -91,19 +81,7 @@ mat3 PlanarMappingZTBN(vec3 P) {
   return ComputeTBN(T, B, N);
 }
 
-#define PI 3.14159265358979323846
-
 // Cylindrical mapping
-vec2 CylindricalUV(vec3 P) {
-  float longitude = atan(P.x, P.z);
-  float height = P.y;
-
-  float u = longitude / (2.0 * PI) + 0.5;  // From [-pi, pi] to [0, 1]
-  float v = height - 0.5;                  // Base at y = -0.5
-
-  return vec2(u, v);
-}
-
 mat3 CylindricalTBN(vec3 P) {
   vec3 T = vec3(P.z, 0, -P.x);
   vec3 N = fragNObj;
@@ -112,16 +90,6 @@ mat3 CylindricalTBN(vec3 P) {
 }
 
 // Spherical mapping
-vec2 SphericalUV(vec3 P) {
-  float longitude = atan(P.x, P.z);
-  float latitude = asin(P.y / length(P));
-
-  float u = longitude / (2.0 * PI) + 0.5;  // From [-pi, pi] to [0, 1]
-  float v = latitude / PI + 0.5;           // From [-pi/2, pi/2] to [0, 1]
-
-  return vec2(u, v);
-}
-
 mat3 SphericalTBN(vec3 P) {
   vec3 T = vec3(P.z, 0, -P.x);
   vec3 N = fragNObj;
@@ -139,30 +107,27 @@ void main() {
     vec3 offset = vec3(-0.5, -0.5, -0.5);
 
     // Sample with x planar mapping
-    vec2 texCoord1 = PlanarMappingXUV(fragPObj + offset);
+    vec2 texCoord1 = PlanarMappingX(fragPObj + offset);
     mat3 TBN = PlanarMappingXTBN(fragPObj + offset);
     vec3 LTan = TBN * normalize(fragLEye);
     vec3 VTan = TBN * normalize(fragVEye);
-    vec3 NTan = texture(normalTex, texCoord1).xyz;
-    NTan = normalize(NTan * 2.0 - 1.0);  // From [0, 1] to [-1, 1]
+    vec3 NTan = SampleNormal(texCoord1);
     vec4 color1 = BlinnPhong(NTan, LTan, VTan, texCoord1);
 
     // Sample with y planar mapping
-    vec2 texCoord2 = PlanarMappingYUV(fragPObj + offset);
+    vec2 texCoord2 = PlanarMappingY(fragPObj + offset);
     TBN = PlanarMappingYTBN(fragPObj + offset);
     LTan = TBN * normalize(fragLEye);
     VTan = TBN * normalize(fragVEye);
-    NTan = texture(normalTex, texCoord2).xyz;
-    NTan = normalize(NTan * 2.0 - 1.0);  // From [0, 1] to [-1, 1]
+    NTan = SampleNormal(texCoord2);
     vec4 color2 = BlinnPhong(NTan, LTan, VTan, texCoord2);
 
     // Sample with z planar mapping
-    vec2 texCoord3 = PlanarMappingZUV(fragPObj + offset);
+    vec2 texCoord3 = PlanarMappingZ(fragPObj + offset);
     TBN = PlanarMappingZTBN(fragPObj + offset);
     LTan = TBN * normalize(fragLEye);
     VTan = TBN * normalize(fragVEye);
-    NTan = texture(normalTex, texCoord3).xyz;
-    NTan = normalize(NTan * 2.0 - 1.0);  // From [0, 1] to [-1, 1]
+    NTan = SampleNormal(texCoord3);
     vec4 color3 = BlinnPhong(NTan, LTan, VTan, texCoord3);
 
     // Compute average based on normal
@@ -173,11 +138,11 @@ void main() {
     mat3 TBN;
     if (mappingMode == 1) {
       // Cylindrical mapping
-      texCoord = CylindricalUV(fragPObj);
+      texCoord = CylindricalMapping(fragPObj);
       TBN = CylindricalTBN(fragPObj);
     } else if (mappingMode == 2) {
       // Spherical mapping
-      texCoord = SphericalUV(fragPObj);
+      texCoord = SphericalMapping(fragPObj);
       TBN = SphericalTBN(fragPObj);
     } else if (mappingMode == 3) {
       // From mesh
@@ -188,16 +153,19 @@ void main() {
     // Compute tangent space vectors
     vec3 LTan = TBN * normalize(fragLEye);
     vec3 VTan = TBN * normalize(fragVEye);
-    vec3 NTan = texture(normalTex, texCoord).xyz;
-    NTan = normalize(NTan * 2.0 - 1.0);  // From [0, 1] to [-1, 1]
+    vec3 NTan = SampleNormal(texCoord);
 
     color = BlinnPhong(NTan, LTan, VTan, texCoord);
   }
 
+#if HIGHLIGHT_BACK_FACES
   if (gl_FrontFacing) {
     outColor = color;
   } else {
     float i = (color.r + color.g + color.b) / 3.0;
     outColor = vec4(i, 0, 0, 1.0);
   }
+#else
+  outColor = color;
+#endif
 }
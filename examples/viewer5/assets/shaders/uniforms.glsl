@@ -0,0 +1,20 @@
+// Uniform blocks filled by abcg::UniformBuffer. Their layouts are those of
+// abcg::FrameBlock and abcg::ObjectBlock.
+
+// Per-frame uniforms, shared by every program
+layout(std140) uniform FrameBlock {
+  highp mat4 viewMatrix;
+  highp mat4 projMatrix;
+  highp mat4 viewProjMatrix;
+  highp vec4 lightDirWorldSpace;
+  highp vec4 lightDirViewSpace;
+  highp vec4 Ia, Id, Is;
+};
+
+// Per-object uniforms
+layout(std140) uniform ObjectBlock {
+  highp mat4 modelMatrix;
+  highp mat4 modelViewMatrix;
+  highp mat4 modelViewProjMatrix;
+  highp mat3 normalMatrix;
+};
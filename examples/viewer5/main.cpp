@@ -1,5 +1,8 @@
 #include <fmt/core.h>
 
+#include <cppitertools/itertools.hpp>
+#include <string_view>
+
 #include "abcg.hpp"
 #include "openglwindow.hpp"
 
@@ -7,6 +10,13 @@ int main(int argc, char **argv) {
   try {
     abcg::Application app(argc, argv);
 
+    // Print the time taken by each stage of a model load
+    for (auto index : iter::range(1, argc)) {
+      if (std::string_view{argv[index]} == "--verbose") {
+        Model::setVerbose(true);
+      }
+    }
+
     auto window{std::make_unique<OpenGLWindow>()};
     window->setOpenGLSettings({.samples = 0});
     window->setWindowSettings(
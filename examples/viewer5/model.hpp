@@ -1,7 +1,19 @@
 #ifndef MODEL_HPP_
 #define MODEL_HPP_
 
+#include <fmt/core.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
+#include <utility>
 
 #include "abcg.hpp"
 
@@ -19,8 +31,44 @@ struct Vertex {
   }
 };
 
+// Vertices are written to and mapped from the mesh cache as raw bytes
+static_assert(std::is_trivially_copyable_v<Vertex>);
+
+// Vertex uploaded in the packed format: 16-bit normalized position relative
+// to the standardized bounds, 10:10:10:2 normal and tangent (handedness in
+// the 2-bit component) and half-float texture coordinates
+struct PackedVertex {
+  std::array<std::int16_t, 4> position{};
+  std::uint32_t normal{};
+  std::uint32_t tangent{};
+  std::uint32_t texCoord{};
+};
+
+static_assert(sizeof(PackedVertex) == 20);
+
 class Model {
  public:
+  enum class VertexFormat { Float, Packed };
+  // Culling of meshlets by the render functions that take camera matrices.
+  // Back-face culling assumes counterclockwise front faces.
+  enum class MeshletCulling { Off, Frustum, FrustumAndBackface };
+  // Texture coordinates baked into the vertices: those of the file, or
+  // those of the cylindrical or spherical mapping of the shaders, computed
+  // from the positions in object space
+  enum class UVMapping { None, Cylindrical, Spherical };
+
+  // Material of one or more submeshes. Textures are slots of the texture
+  // table; materials without a texture use the default texture slots, set
+  // by loadDiffuseTexture and loadNormalTexture.
+  struct Material {
+    glm::vec4 Ka{0.1f, 0.1f, 0.1f, 1.0f};
+    glm::vec4 Kd{0.7f, 0.7f, 0.7f, 1.0f};
+    glm::vec4 Ks{1.0f, 1.0f, 1.0f, 1.0f};
+    float shininess{25.0f};
+    std::size_t diffuseTexture{};
+    std::size_t normalTexture{};
+  };
+
   Model() = default;
   virtual ~Model();
 
@@ -31,43 +79,295 @@ class Model {
 
   void loadDiffuseTexture(std::string_view path);
   void loadNormalTexture(std::string_view path);
-  void loadFromFile(std::string_view path, bool standardize = true);
+  void loadFromFile(std::string_view path, bool standardize = true,
+                    bool optimize = true);
+
+  // Stages of loadFromFile, for loading in the background. The prepare
+  // functions make no OpenGL calls and may run on a worker thread.
+  void prepareDiffuseTexture(std::string_view path);
+  void prepareNormalTexture(std::string_view path);
+  bool prepareFromFile(std::string_view path, bool standardize = true,
+                       bool optimize = true,
+                       const std::atomic<bool>* canceled = nullptr);
+  bool uploadStep(std::size_t maxBytes);
+  [[nodiscard]] float getUploadProgress() const;
+
+  // Textures start with their coarsest mipmap levels, and the finer levels
+  // are streamed by abcg::MipStreamer as the render functions request them.
+  // Call once per frame; returns true once the levels requested are
+  // resident.
+  bool updateTextures(std::size_t maxBytes);
+
+  // Releases the vertices and indices kept on the CPU once uploaded
+  void releaseCPUData();
+
   void render(int numTriangles = -1) const;
-  void setupVAO(GLuint program);
+  int render(const glm::mat4& modelMatrix, const glm::mat4& viewMatrix,
+             const glm::mat4& projMatrix, int viewportHeight,
+             float maxPixelError = 1.0f) const;
+  void renderLod(int lod) const;
+  void renderLod(int lod, const glm::mat4& modelMatrix,
+                 const glm::mat4& viewMatrix,
+                 const glm::mat4& projMatrix) const;
+  void setupVAO(const abcg::ShaderProgram& program);
+  void setMeshletCulling(MeshletCulling culling) { m_meshletCulling = culling; }
+  // Sets the vertex format of the mesh staged by the next prepare function
+  void setVertexFormat(VertexFormat format) { m_vertexFormat = format; }
+  // Sets the texture coordinates baked by the next prepare function
+  void setUVMapping(UVMapping mapping) { m_uvMapping = mapping; }
 
-  [[nodiscard]] int getNumTriangles() const {
-    return static_cast<int>(m_indices.size()) / 3;
+  [[nodiscard]] int getNumTriangles() const { return getLodTriangles(0); }
+
+  // Levels of detail, from the full mesh (level 0) to the coarsest one
+  [[nodiscard]] int getNumLods() const {
+    return static_cast<int>(m_lods.size());
   }
+  [[nodiscard]] int getLodTriangles(int lod) const;
+  [[nodiscard]] float getLodError(int lod) const;
+  [[nodiscard]] int getLodMeshlets(int lod) const;
+  [[nodiscard]] int selectLod(const glm::mat4& modelMatrix,
+                              const glm::mat4& viewMatrix,
+                              const glm::mat4& projMatrix, int viewportHeight,
+                              float maxPixelError = 1.0f) const;
 
-  [[nodiscard]] glm::vec4 getKa() const { return m_Ka; }
-  [[nodiscard]] glm::vec4 getKd() const { return m_Kd; }
-  [[nodiscard]] glm::vec4 getKs() const { return m_Ks; }
-  [[nodiscard]] float getShininess() const { return m_shininess; }
+  // Materials, sorted by textures. Their colors are uploaded by the render
+  // functions to the uniforms Ka, Kd, Ks and shininess.
+  [[nodiscard]] int getNumMaterials() const {
+    return static_cast<int>(m_materials.size());
+  }
+  [[nodiscard]] Material& getMaterial(int material) {
+    return m_materials.at(material);
+  }
+  [[nodiscard]] const Material& getMaterial(int material) const {
+    return m_materials.at(material);
+  }
 
+  // Whether the file has texture coordinates, even if they are replaced by
+  // baked ones
   [[nodiscard]] bool isUVMapped() const { return m_hasTexCoords; }
+  [[nodiscard]] UVMapping getUVMapping() const { return m_uvMapping; }
+  // Prints the time taken by each loading stage. Off by default.
+  static void setVerbose(bool verbose) { m_verbose = verbose; }
+
+  // File the model was prepared from
+  [[nodiscard]] const std::string& getPath() const { return m_path; }
+
+  [[nodiscard]] MeshletCulling getMeshletCulling() const {
+    return m_meshletCulling;
+  }
+  // Meshlets kept and culled by the last render call
+  [[nodiscard]] const abcg::Meshlets::CullResult& getCullResult() const {
+    return m_cullResult;
+  }
+
+  [[nodiscard]] VertexFormat getVertexFormat() const { return m_vertexFormat; }
+  // Size in bytes of the vertex and index buffers
+  [[nodiscard]] std::size_t getBufferSize() const { return m_bufferSize; }
 
  private:
   GLuint m_VAO{};
-  GLuint m_VBO{};
-  GLuint m_EBO{};
 
-  glm::vec4 m_Ka;
-  glm::vec4 m_Kd;
-  glm::vec4 m_Ks;
-  float m_shininess;
-  GLuint m_diffuseTexture{};
-  GLuint m_normalTexture{};
+  VertexFormat m_vertexFormat{VertexFormat::Float};
+  // Format of the data currently stored in the VBO
+  bool m_isVBOPacked{false};
+  std::size_t m_bufferSize{};
+
+  std::vector<Material> m_materials;
+  // Textures of the materials, after the default diffuse and normal
+  // textures, shared through abcg::TextureCache with the other models
+  std::vector<abcg::TextureCache::Handle> m_textures{
+      std::vector<abcg::TextureCache::Handle>(2)};
+
+  // Program of the VAO, and the indices of its material color uniforms
+  abcg::ShaderProgram m_program;
+  int m_KaUniform{-1};
+  int m_KdUniform{-1};
+  int m_KsUniform{-1};
+  int m_shininessUniform{-1};
 
   std::vector<Vertex> m_vertices;
   std::vector<GLuint> m_indices;
 
+  // Range of each level of detail in m_indices, and its distance to the full
+  // mesh in model units
+  struct Lod {
+    std::uint32_t firstIndex{};
+    std::uint32_t numIndices{};
+    float error{};
+    std::uint32_t firstSubmesh{};
+    std::uint32_t numSubmeshes{};
+  };
+  std::vector<Lod> m_lods;
+
+  // Range of a level of detail that uses a single material, and its
+  // meshlets. The submeshes of a level are sorted by material.
+  struct Submesh {
+    std::uint32_t firstIndex{};
+    std::uint32_t numIndices{};
+    std::uint32_t material{};
+    std::uint32_t firstMeshlet{};
+    std::uint32_t numMeshlets{};
+  };
+  std::vector<Submesh> m_submeshes;
+
+  // Meshlets of every submesh, and the draw ranges of the submesh being
+  // rendered
+  std::vector<abcg::Meshlets::Meshlet> m_meshlets;
+  MeshletCulling m_meshletCulling{MeshletCulling::Off};
+  mutable abcg::Meshlets::CullResult m_cullResult;
+  mutable std::vector<std::uint32_t> m_visibleMeshlets;
+  mutable std::vector<GLsizei> m_drawCounts;
+  mutable std::vector<const void*> m_drawOffsets;
+  float m_radius{};
+
   bool m_hasNormals{false};
   bool m_hasTexCoords{false};
 
-  void computeNormals();
-  void computeTangents();
-  void createBuffers();
+  // Buffers of the mesh and what is needed to draw them, shared through
+  // abcg::MeshRegistry with the models that load the same file with the
+  // same options
+  struct SharedMesh : abcg::MeshRegistry::Mesh {
+    std::vector<Lod> lods;
+    std::vector<Submesh> submeshes;
+    std::vector<abcg::Meshlets::Meshlet> meshlets;
+    std::vector<abcg::MeshCache::Material> materials;
+    float radius{};
+    bool hasNormals{false};
+    bool hasTexCoords{false};
+    bool isPacked{false};
+  };
+  std::shared_ptr<const SharedMesh> m_mesh;
+
+  // Source of the mesh and its load options
+  std::string m_path;
+  bool m_standardize{true};
+  bool m_optimize{true};
+  UVMapping m_uvMapping{UVMapping::None};
+
+  // Data staged by the prepare functions and consumed by uploadStep.
+  // Textures are decoded together by decodeTextures.
+  struct TextureUpload {
+    std::size_t slot{};
+    std::string path;
+    bool isDecoded{false};
+    // Mipmap levels of the decoded file
+    abcg::MipStreamer::MipChain mipChain;
+    // Baked version of the file, used instead of the file if present
+    abcg::opengl::CompressedImage compressed;
+    // Key and content hash in the texture cache, and the texture found
+    // there, if any
+    std::string key;
+    std::optional<std::uint64_t> contentHash;
+    abcg::TextureCache::Handle cached;
+  };
+  struct Upload {
+    // Mesh whose buffers are created and filled, or mesh already resident
+    std::shared_ptr<SharedMesh> mesh;
+    std::shared_ptr<const SharedMesh> residentMesh;
+    bool isStarted{false};
+    std::vector<PackedVertex> packedVertices;
+    std::vector<TextureUpload> textures;
+    std::size_t vertexOffset{};
+    std::size_t indexOffset{};
+    std::size_t totalBytes{};
+  };
+  Upload m_upload;
+
+  inline static std::atomic<bool> m_verbose{false};
+
+  template <typename... Args>
+  static void printTiming(std::string_view format, Args&&... args) {
+    if (m_verbose) fmt::print(format, std::forward<Args>(args)...);
+  }
+
+  void applyMaterials(std::span<const abcg::MeshCache::Material> materials,
+                      std::string_view basePath);
+  void appendDrawRange(std::size_t firstIndex, std::size_t numIndices) const;
+  void bakeTexCoords();
+  void bindMaterial(const Material& material, const Material* previous,
+                    float textureSize) const;
+  void buildMeshlets();
+  void computeNormals(const abcg::TangentSpace::Adjacency& adjacency);
+  void computeTangents(std::span<const GLuint> indices,
+                       const abcg::TangentSpace::Adjacency& adjacency);
+  void decodeTextures();
+  template <typename AppendRanges>
+  void drawSubmeshes(std::span<const Submesh> submeshes, float textureSize,
+                     AppendRanges&& appendRanges) const;
+  void generateLods();
+  bool loadFromCache(std::string_view path, std::uint64_t cacheKey,
+                     std::vector<abcg::MeshCache::Material>& meshMaterials);
+  void optimizeMesh();
+  bool prepareMesh(const std::atomic<bool>* canceled,
+                   std::vector<abcg::MeshCache::Material>& meshMaterials);
+  void loadTexture(std::size_t slot, std::string_view path);
+  void lookUpTexture(TextureUpload& texture) const;
+  void saveToCache(std::string_view path, std::uint64_t cacheKey,
+                   std::span<const abcg::MeshCache::Material> materials,
+                   std::span<const std::string> materialLibraries) const;
+  void setTexture(std::size_t slot, abcg::TextureCache::Handle texture);
+  void stageTexture(std::size_t slot, std::string_view path);
+  void stageVertices(std::span<const abcg::MeshCache::Material> materials);
   void standardize();
+  void updateRadius();
+  void uploadTexture(TextureUpload& texture);
+
+  [[nodiscard]] std::span<const Submesh> getLodSubmeshes(int lod) const;
+  [[nodiscard]] std::string getMeshKey() const;
+  [[nodiscard]] float getPixelsPerUnit(const glm::mat4& modelMatrix,
+                                       const glm::mat4& viewMatrix,
+                                       const glm::mat4& projMatrix,
+                                       int viewportHeight) const;
+  [[nodiscard]] std::vector<glm::vec3> getPositions() const;
+  [[nodiscard]] GLuint getTextureID(std::size_t slot) const;
+  [[nodiscard]] std::span<const std::byte> getVertexData() const;
+
+  [[nodiscard]] static std::uint64_t getCacheKey(bool standardize,
+                                                 bool optimize);
+};
+
+// Loads a model in the background: the prepare stage runs on a worker thread
+// of abcg::ThreadPool and the upload is spread across frames
+class ModelLoader {
+ public:
+  enum class State { Idle, Preparing, Uploading };
+
+  // Prepares the model without OpenGL calls. Returns false if canceled.
+  using PrepareFunction =
+      std::function<bool(Model& model, const std::atomic<bool>& canceled)>;
+
+  ModelLoader() = default;
+  ~ModelLoader();
+
+  ModelLoader(const ModelLoader&) = delete;
+  ModelLoader(ModelLoader&&) = delete;
+  ModelLoader& operator=(const ModelLoader&) = delete;
+  ModelLoader& operator=(ModelLoader&&) = delete;
+
+  void start(std::unique_ptr<Model> model, PrepareFunction prepare);
+  void cancel();
+  [[nodiscard]] std::unique_ptr<Model> update(std::size_t maxUploadBytes);
+
+  [[nodiscard]] State getState() const { return m_state; }
+  [[nodiscard]] float getProgress() const;
+  // Why the last load failed, or empty if it did not
+  [[nodiscard]] const std::string& getError() const { return m_error; }
+
+ private:
+  // Canceled load whose worker may still be running. Its model is destroyed
+  // on the OpenGL thread once the worker is done with it.
+  struct Abandoned {
+    std::unique_ptr<Model> model;
+    std::future<bool> prepared;
+  };
+
+  State m_state{State::Idle};
+  std::unique_ptr<Model> m_model;
+  // Flag of the load in progress, shared with its worker
+  std::shared_ptr<std::atomic<bool>> m_canceled;
+  std::future<bool> m_prepared;
+  std::vector<Abandoned> m_abandoned;
+  std::string m_error;
 };
 
 #endif
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "openglwindow.hpp"
 
+#include <fmt/core.h>
 #include <imgui.h>
 
 #include <cppitertools/itertools.hpp>
-#include <glm/gtc/matrix_inverse.hpp>
+#include <filesystem>
 
 #include "imfilebrowser.h"
 
@@ -41,16 +42,39 @@ void OpenGLWindow::initializeGL() {
   glClearColor(0, 0, 0, 1);
   glEnable(GL_DEPTH_TEST);
 
-  // Create programs
+  // Create the uniform buffers shared by every program
+  m_frameUniforms.create(abcg::FrameBlock::binding, sizeof(abcg::FrameBlock));
+  m_objectUniforms.create(abcg::ObjectBlock::binding,
+                          sizeof(abcg::ObjectBlock));
+
+  // Create the variants of each program. Only the variants drawn are
+  // compiled, starting with the uber-shaders, which are compiled together
+  // and used while the variant of the current options is being built.
+  const auto createPrograms{[this](auto shaders) {
+    return createProgramsFromFiles(shaders);
+  }};
   for (const auto& name : m_shaderNames) {
     auto path{getAssetsPath() + "shaders/" + name};
-    auto program{createProgramFromFile(path + ".vert", path + ".frag")};
-    m_programs.push_back(program);
+    std::vector<abcg::ShaderVariants::Option> options;
+    if (std::string_view{name} == "normalmapping" ||
+        std::string_view{name} == "texture") {
+      options.push_back({"MAPPING_MODE", 4});
+      options.push_back({"HIGHLIGHT_BACK_FACES", 2});
+    }
+    m_programs.emplace_back(
+        abcg::ProgramShaders{path + ".vert", path + ".frag"},
+        std::move(options), createPrograms);
+  }
+  for (auto& variants : m_programs) {
+    const std::array key{variants.makeKey(
+        {{"HIGHLIGHT_BACK_FACES", m_highlightBackFaces ? 1 : 0}})};
+    variants.prepare(key);
   }
 
+  m_gpuTimer.create();
+
   // Load default model
   loadModel(getAssetsPath() + "roman_lamp.obj");
-  m_mappingMode = 3;  // "From mesh" option
 
   // Initial trackball spin
   m_trackBallModel.setAxis(glm::normalize(glm::vec3(1, 1, 1)));
@@ -58,74 +82,254 @@ void OpenGLWindow::initializeGL() {
 }
 
 void OpenGLWindow::loadModel(std::string_view path) {
-  m_model.loadDiffuseTexture(getAssetsPath() + "maps/pattern.png");
-  m_model.loadNormalTexture(getAssetsPath() + "maps/pattern_normal.png");
-  m_model.loadFromFile(path);
-  m_model.setupVAO(m_programs.at(m_currentProgramIndex));
-  m_trianglesToDraw = m_model.getNumTriangles();
-
-  // Use material properties from the loaded model
-  m_Ka = m_model.getKa();
-  m_Kd = m_model.getKd();
-  m_Ks = m_model.getKs();
-  m_shininess = m_model.getShininess();
+  // A new model starts with the texture coordinates of its file, and with
+  // the mapping mode that suits it
+  m_resetMappingMode = true;
+  startLoading(path, Model::UVMapping::None);
+}
+
+// Loads a model file, with the given texture coordinates baked into its
+// vertices
+void OpenGLWindow::startLoading(std::string_view path,
+                                Model::UVMapping uvMapping) {
+  // The current model is rendered until the new one is uploaded
+  m_uvMapping = uvMapping;
+  auto model{std::make_unique<Model>()};
+  model->setVertexFormat(m_vertexFormat);
+  model->setMeshletCulling(m_meshletCulling);
+  model->setUVMapping(uvMapping);
+
+  m_modelLoader.start(
+      std::move(model),
+      [path = std::string{path}, assetsPath = getAssetsPath()](
+          Model& newModel, const std::atomic<bool>& canceled) {
+        newModel.prepareDiffuseTexture(assetsPath + "maps/pattern.png");
+        newModel.prepareNormalTexture(assetsPath + "maps/pattern_normal.png");
+        return newModel.prepareFromFile(path, true, true, &canceled);
+      });
+}
+
+void OpenGLWindow::updateModelLoader() {
+  // Mipmap levels requested by the last frame appear progressively
+  m_model->updateTextures(m_uploadBytesPerFrame);
+
+  auto model{m_modelLoader.update(m_uploadBytesPerFrame)};
+  if (!model) return;
+
+  m_model = std::move(model);
+  // The VAO is set up by paintGL for the program of the new mapping mode
+  m_vaoProgram = 0;
+  m_model->releaseCPUData();
+  m_trianglesToDraw = m_model->getNumTriangles();
+  m_lodFrameTimes.assign(m_model->getNumLods(), 0.0f);
+  m_renderedLod = -1;
+  m_currentMaterial = 0;
+  m_gpuTimes = {};
+
+  if (!m_resetMappingMode) return;
+  if (m_model->isUVMapped()) {
+    // Use mesh texture coordinates if available...
+    m_mappingMode = 3;
+  } else {
+    // ...or triplanar mapping otherwise
+    m_mappingMode = 0;
+  }
+}
+
+// Mapping mode of the shaders: a mapping baked into the model is read from
+// the texture coordinates, as those of the file. The benchmark measures the
+// mappings computed by the shaders.
+int OpenGLWindow::getShaderMappingMode() const {
+  if (!m_bakeUVMapping || m_benchmarkFrame >= 0) return m_mappingMode;
+
+  const auto isBaked{
+      (m_mappingMode == 1 &&
+       m_model->getUVMapping() == Model::UVMapping::Cylindrical) ||
+      (m_mappingMode == 2 &&
+       m_model->getUVMapping() == Model::UVMapping::Spherical)};
+  return isBaked ? 3 : m_mappingMode;
+}
+
+// Loads the model again if the mapping mode needs other texture
+// coordinates. Triplanar mapping and the mappings computed by the shaders
+// use none.
+void OpenGLWindow::updateUVMapping() {
+  // A new file is left alone until it is loaded and its mapping mode reset,
+  // and a file that failed to load is not loaded again
+  const auto isLoading{m_modelLoader.getState() != ModelLoader::State::Idle};
+  if (m_benchmarkFrame >= 0 || (isLoading && m_resetMappingMode) ||
+      !m_modelLoader.getError().empty()) {
+    return;
+  }
+
+  // Coordinates of the model being loaded, or else of the model drawn (a
+  // canceled or failed load leaves the model drawn)
+  const auto currentMapping{isLoading ? m_uvMapping
+                                      : m_model->getUVMapping()};
+  auto uvMapping{currentMapping};
+  if (m_mappingMode == 3) {
+    uvMapping = Model::UVMapping::None;
+  } else if (m_bakeUVMapping) {
+    if (m_mappingMode == 1) uvMapping = Model::UVMapping::Cylindrical;
+    if (m_mappingMode == 2) uvMapping = Model::UVMapping::Spherical;
+  }
+  if (uvMapping == currentMapping || m_model->getPath().empty()) return;
+
+  m_resetMappingMode = false;
+  startLoading(m_model->getPath(), uvMapping);
+}
+
+// Loads the model again when another vertex format is selected. The mesh
+// is taken from the mesh registry or the mesh cache if it was loaded in that
+// format before, and is otherwise prepared again on a worker thread.
+void OpenGLWindow::updateVertexFormat() {
+  if (m_modelLoader.getState() != ModelLoader::State::Idle ||
+      !m_modelLoader.getError().empty() ||
+      m_model->getVertexFormat() == m_vertexFormat ||
+      m_model->getPath().empty()) {
+    return;
+  }
+
+  m_resetMappingMode = false;
+  startLoading(m_model->getPath(), m_model->getUVMapping());
 }
 
 void OpenGLWindow::paintGL() {
+  updateModelLoader();
+  updateBenchmark();
+  updateGPUTimes();
   update();
 
+  // Attribute the last frame time to the level of detail rendered in it
+  if (m_renderedLod >= 0 &&
+      m_renderedLod < static_cast<int>(m_lodFrameTimes.size())) {
+    auto& frameTime{m_lodFrameTimes.at(m_renderedLod)};
+    const auto deltaTime{static_cast<float>(getDeltaTime()) * 1000.0f};
+    frameTime = (frameTime == 0.0f) ? deltaTime
+                                    : glm::mix(frameTime, deltaTime, 0.05f);
+  }
+
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glViewport(0, 0, m_viewportWidth, m_viewportHeight);
 
-  // Use currently selected program
-  const auto program{m_programs.at(m_currentProgramIndex)};
+  // Use the program of the selected shader and options. Uniforms that keep
+  // their values are not uploaded again.
+  auto isVariant{false};
+  const auto& program{selectProgram(isVariant)};
+  const auto& uniforms{findUniforms(program)};
   glUseProgram(program);
 
-  // Get location of uniform variables
-  GLint viewMatrixLoc{glGetUniformLocation(program, "viewMatrix")};
-  GLint projMatrixLoc{glGetUniformLocation(program, "projMatrix")};
-  GLint modelMatrixLoc{glGetUniformLocation(program, "modelMatrix")};
-  GLint normalMatrixLoc{glGetUniformLocation(program, "normalMatrix")};
-  GLint lightDirLoc{glGetUniformLocation(program, "lightDirWorldSpace")};
-  GLint shininessLoc{glGetUniformLocation(program, "shininess")};
-  GLint IaLoc{glGetUniformLocation(program, "Ia")};
-  GLint IdLoc{glGetUniformLocation(program, "Id")};
-  GLint IsLoc{glGetUniformLocation(program, "Is")};
-  GLint KaLoc{glGetUniformLocation(program, "Ka")};
-  GLint KdLoc{glGetUniformLocation(program, "Kd")};
-  GLint KsLoc{glGetUniformLocation(program, "Ks")};
-  GLint diffuseTexLoc{glGetUniformLocation(program, "diffuseTex")};
-  GLint normalTexLoc{glGetUniformLocation(program, "normalTex")};
-  GLint mappingModeLoc{glGetUniformLocation(program, "mappingMode")};
+  // Set up VAO if shader program has changed
+  if (program.getID() != m_vaoProgram) {
+    m_vaoProgram = program.getID();
+    m_model->setupVAO(program);
+  }
 
   // Set uniform variables used by every scene object
-  glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_viewMatrix[0][0]);
-  glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
-  glUniform1i(diffuseTexLoc, 0);
-  glUniform1i(normalTexLoc, 1);
-  glUniform1i(mappingModeLoc, m_mappingMode);
-
-  auto lightDirRotated{m_trackBallLight.getRotation() * m_lightDir};
-  glUniform4fv(lightDirLoc, 1, &lightDirRotated.x);
-  glUniform4fv(IaLoc, 1, &m_Ia.x);
-  glUniform4fv(IdLoc, 1, &m_Id.x);
-  glUniform4fv(IsLoc, 1, &m_Is.x);
+  const glm::vec4 lightDirRotated{m_trackBallLight.getRotation() *
+                                  m_lightDir};
+  const auto frame{abcg::FrameBlock::make(m_viewMatrix, m_projMatrix,
+                                          lightDirRotated, m_Ia, m_Id, m_Is)};
+  m_frameUniforms.update(frame);
+  program.setUniform(uniforms.diffuseTex, 0);
+  program.setUniform(uniforms.normalTex, 1);
+  program.setUniform(uniforms.mappingMode, getShaderMappingMode());
 
   // Set uniform variables of the current object
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &m_modelMatrix[0][0]);
+  m_objectUniforms.update(abcg::ObjectBlock::make(m_modelMatrix, frame));
+
+  // Material properties are set by the model
+
+  // Measure the GPU time of the model with the program and mapping mode
+  m_gpuTimer.begin((m_currentProgramIndex * 2 + (isVariant ? 1 : 0)) * 4 +
+                   m_mappingMode);
+
+  if (m_lodMode == sliderLod) {
+    m_model->render(m_trianglesToDraw);
+    m_renderedLod = -1;
+  } else if (m_lodMode == autoLod) {
+    m_renderedLod = m_model->render(m_modelMatrix, m_viewMatrix, m_projMatrix,
+                                    m_viewportHeight);
+  } else {
+    m_renderedLod = std::min(m_lodMode, m_model->getNumLods() - 1);
+    m_model->renderLod(m_renderedLod, m_modelMatrix, m_viewMatrix,
+                       m_projMatrix);
+  }
 
-  auto modelViewMatrix{glm::mat3(m_viewMatrix * m_modelMatrix)};
-  glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
-  glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+  m_gpuTimer.end();
 
-  glUniform1f(shininessLoc, m_shininess);
-  glUniform4fv(KaLoc, 1, &m_Ka.x);
-  glUniform4fv(KdLoc, 1, &m_Kd.x);
-  glUniform4fv(KsLoc, 1, &m_Ks.x);
+  glUseProgram(0);
+}
+
+// Returns the program of the current shader and options: the variant of the
+// mapping mode once it is built, or the uber-shader until then
+const abcg::ShaderProgram& OpenGLWindow::selectProgram(bool& isVariant) {
+  auto& variants{m_programs.at(m_currentProgramIndex)};
+  const auto highlightBackFaces{m_highlightBackFaces ? 1 : 0};
+
+  if (!m_useUberShader) {
+    const auto key{
+        variants.makeKey({{"MAPPING_MODE", getShaderMappingMode()},
+                          {"HIGHLIGHT_BACK_FACES", highlightBackFaces}})};
+    if (const auto* program{variants.find(key)}) {
+      isVariant = true;
+      return *program;
+    }
+  }
 
-  m_model.render(m_trianglesToDraw);
+  isVariant = false;
+  return variants.get(
+      variants.makeKey({{"HIGHLIGHT_BACK_FACES", highlightBackFaces}}));
+}
 
-  glUseProgram(0);
+// Returns the uniforms of a program, looking them up on first use
+const OpenGLWindow::Uniforms& OpenGLWindow::findUniforms(
+    const abcg::ShaderProgram& program) {
+  auto [iter, isNew]{m_uniforms.try_emplace(program.getID())};
+  if (isNew) {
+    auto& uniforms{iter->second};
+    uniforms.diffuseTex = program.findUniform("diffuseTex");
+    uniforms.normalTex = program.findUniform("normalTex");
+    uniforms.mappingMode = program.findUniform("mappingMode");
+  }
+  return iter->second;
+}
+
+// Steps through the mapping modes, drawing each one with the uber-shader and
+// with its variant for the same number of frames
+void OpenGLWindow::updateBenchmark() {
+  if (m_benchmarkFrame < 0) return;
+
+  const auto numMappingModes{m_model->isUVMapped() ? 4 : 3};
+  const auto step{m_benchmarkFrame / benchmarkFramesPerMode};
+  if (step >= numMappingModes * 2) {
+    m_mappingMode = m_benchmarkMappingMode;
+    m_useUberShader = false;
+    m_benchmarkFrame = -1;
+    return;
+  }
+
+  m_mappingMode = step / 2;
+  m_useUberShader = step % 2 == 0;
+  if (m_benchmarkFrame % benchmarkFramesPerMode == 0) {
+    m_gpuTimes.at(m_useUberShader ? 0 : 1).at(m_mappingMode) = 0.0f;
+  }
+  ++m_benchmarkFrame;
+}
+
+// Adds the GPU times measured in previous frames to their moving averages
+void OpenGLWindow::updateGPUTimes() {
+  while (const auto result{m_gpuTimer.poll()}) {
+    const auto programIndex{result->tag / 8};
+    const auto isVariant{result->tag / 4 % 2};
+    const auto mappingMode{result->tag % 4};
+    if (programIndex != m_currentProgramIndex) continue;
+
+    auto& gpuTime{m_gpuTimes.at(isVariant).at(mappingMode)};
+    const auto milliseconds{static_cast<float>(result->milliseconds)};
+    gpuTime = (gpuTime == 0.0f) ? milliseconds
+                                : glm::mix(gpuTime, milliseconds, 0.05f);
+  }
 }
 
 void OpenGLWindow::paintUI() {
@@ -161,9 +365,9 @@ void OpenGLWindow::paintUI() {
 
   // Create main window widget
   {
-    auto widgetSize{ImVec2(222, 190)};
+    auto widgetSize{ImVec2(222, 354)};
 
-    if (!m_model.isUVMapped()) {
+    if (!m_model->isUVMapped()) {
       // Add extra space for static text
       widgetSize.y += 26;
     }
@@ -194,8 +398,10 @@ void OpenGLWindow::paintUI() {
 
     // Slider will be stretched horizontally
     ImGui::PushItemWidth(widgetSize.x - 16);
-    ImGui::SliderInt("", &m_trianglesToDraw, 0, m_model.getNumTriangles(),
-                     "%d triangles");
+    if (ImGui::SliderInt("", &m_trianglesToDraw, 0,
+                         m_model->getNumTriangles(), "%d triangles")) {
+      m_lodMode = sliderLod;
+    }
     ImGui::PopItemWidth();
 
     static bool faceCulling{};
@@ -207,6 +413,8 @@ void OpenGLWindow::paintUI() {
       glDisable(GL_CULL_FACE);
     }
 
+    auto isFrontFaceCCW{true};
+
     // CW/CCW combo box
     {
       static std::size_t currentIndex{};
@@ -230,6 +438,22 @@ void OpenGLWindow::paintUI() {
       } else {
         glFrontFace(GL_CW);
       }
+      isFrontFaceCCW = currentIndex == 0;
+    }
+
+    // Meshlets are culled against the frustum, and also against the view
+    // direction when back faces are culled
+    {
+      static bool meshletCulling{};
+      ImGui::Checkbox("Meshlet culling", &meshletCulling);
+
+      m_meshletCulling = Model::MeshletCulling::Off;
+      if (meshletCulling) {
+        m_meshletCulling = (faceCulling && isFrontFaceCCW)
+                               ? Model::MeshletCulling::FrustumAndBackface
+                               : Model::MeshletCulling::Frustum;
+      }
+      m_model->setMeshletCulling(m_meshletCulling);
     }
 
     // Projection combo box
@@ -278,14 +502,64 @@ void OpenGLWindow::paintUI() {
       }
       ImGui::PopItemWidth();
 
-      // Set up VAO if shader program has changed
+      // The VAO is set up by paintGL for the program of this shader
       if (static_cast<int>(currentIndex) != m_currentProgramIndex) {
         m_currentProgramIndex = currentIndex;
-        m_model.setupVAO(m_programs.at(m_currentProgramIndex));
+        m_gpuTimes = {};
       }
     }
 
-    if (!m_model.isUVMapped()) {
+    // Vertex format combo box
+    {
+      const std::array comboItems{"Float", "Packed"};
+      auto currentIndex{static_cast<std::size_t>(m_vertexFormat)};
+
+      ImGui::PushItemWidth(120);
+      if (ImGui::BeginCombo("Vertices", comboItems.at(currentIndex))) {
+        for (auto index : iter::range(comboItems.size())) {
+          const bool isSelected{currentIndex == index};
+          if (ImGui::Selectable(comboItems.at(index), isSelected))
+            currentIndex = index;
+          if (isSelected) ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+      }
+      ImGui::PopItemWidth();
+
+      m_vertexFormat = static_cast<Model::VertexFormat>(currentIndex);
+      updateVertexFormat();
+
+      // Compare buffer size and frame time of the formats
+      ImGui::Text("%.1f KiB, %.2f ms/frame",
+                  static_cast<double>(m_model->getBufferSize()) / 1024.0,
+                  1000.0 / ImGui::GetIO().Framerate);
+    }
+
+    // Level of detail combo box
+    {
+      std::vector<std::string> comboItems{"Slider", "Auto"};
+      for (auto lod : iter::range(m_model->getNumLods())) {
+        comboItems.push_back(fmt::format("LOD {}", lod));
+      }
+      const auto numItems{static_cast<int>(comboItems.size())};
+      auto currentIndex{std::min(m_lodMode - sliderLod, numItems - 1)};
+
+      ImGui::PushItemWidth(120);
+      if (ImGui::BeginCombo("LOD", comboItems.at(currentIndex).c_str())) {
+        for (auto index : iter::range(numItems)) {
+          const bool isSelected{currentIndex == index};
+          if (ImGui::Selectable(comboItems.at(index).c_str(), isSelected))
+            currentIndex = index;
+          if (isSelected) ImGui::SetItemDefaultFocus();
+        }
+        ImGui::EndCombo();
+      }
+      ImGui::PopItemWidth();
+
+      m_lodMode = currentIndex + sliderLod;
+    }
+
+    if (!m_model->isUVMapped()) {
       ImGui::TextColored(ImVec4(1, 1, 0, 1), "Mesh has no UV coords.");
     }
 
@@ -294,7 +568,7 @@ void OpenGLWindow::paintUI() {
       std::vector<std::string> comboItems{"Triplanar", "Cylindrical",
                                           "Spherical"};
 
-      if (m_model.isUVMapped()) comboItems.emplace_back("From mesh");
+      if (m_model->isUVMapped()) comboItems.emplace_back("From mesh");
 
       ImGui::PushItemWidth(120);
       if (ImGui::BeginCombo("UV mapping",
@@ -310,12 +584,22 @@ void OpenGLWindow::paintUI() {
       ImGui::PopItemWidth();
     }
 
+    // Options of the shader variants. The mapping mode is either a uniform
+    // of the uber-shader or selects a variant.
+    ImGui::Checkbox("Uber-shader", &m_useUberShader);
+    ImGui::Checkbox("Highlight back faces", &m_highlightBackFaces);
+
+    // Cylindrical and spherical coordinates are baked when selected
+    ImGui::Checkbox("Bake UV mapping", &m_bakeUVMapping);
+    updateUVMapping();
+
     ImGui::End();
   }
 
   // Create window for light sources
   if (m_currentProgramIndex < 4) {
-    auto widgetSize{ImVec2(222, 244)};
+    const auto numMaterials{m_model->getNumMaterials()};
+    auto widgetSize{ImVec2(222, numMaterials > 1 ? 268 : 244)};
     ImGui::SetNextWindowPos(ImVec2(m_viewportWidth - widgetSize.x - 5,
                                    m_viewportHeight - widgetSize.y - 5));
     ImGui::SetNextWindowSize(widgetSize);
@@ -334,17 +618,169 @@ void OpenGLWindow::paintUI() {
 
     ImGui::Text("Material properties");
 
-    // Slider to control material properties
-    ImGui::PushItemWidth(widgetSize.x - 36);
-    ImGui::ColorEdit3("Ka", &m_Ka.x, ImGuiColorEditFlags_Float);
-    ImGui::ColorEdit3("Kd", &m_Kd.x, ImGuiColorEditFlags_Float);
-    ImGui::ColorEdit3("Ks", &m_Ks.x, ImGuiColorEditFlags_Float);
-    ImGui::PopItemWidth();
+    // Slider to select the material to edit
+    if (numMaterials > 1) {
+      m_currentMaterial = std::min(m_currentMaterial, numMaterials - 1);
+      ImGui::PushItemWidth(widgetSize.x - 16);
+      ImGui::SliderInt("##material", &m_currentMaterial, 0, numMaterials - 1,
+                       "material: %d");
+      ImGui::PopItemWidth();
+    }
 
-    // Slider to control the specular shininess
-    ImGui::PushItemWidth(widgetSize.x - 16);
-    ImGui::SliderFloat("", &m_shininess, 0.0f, 500.0f, "shininess: %.1f");
-    ImGui::PopItemWidth();
+    if (numMaterials > 0) {
+      auto& material{m_model->getMaterial(m_currentMaterial)};
+
+      // Slider to control material properties
+      ImGui::PushItemWidth(widgetSize.x - 36);
+      ImGui::ColorEdit3("Ka", &material.Ka.x, ImGuiColorEditFlags_Float);
+      ImGui::ColorEdit3("Kd", &material.Kd.x, ImGuiColorEditFlags_Float);
+      ImGui::ColorEdit3("Ks", &material.Ks.x, ImGuiColorEditFlags_Float);
+      ImGui::PopItemWidth();
+
+      // Slider to control the specular shininess
+      ImGui::PushItemWidth(widgetSize.x - 16);
+      ImGui::SliderFloat("##shininess", &material.shininess, 0.0f, 500.0f,
+                         "shininess: %.1f");
+      ImGui::PopItemWidth();
+    }
+
+    ImGui::End();
+  }
+
+  // Create window for the triangle count and frame time of each level of
+  // detail, and the meshes, textures and mipmap levels resident on the GPU
+  if (m_model->getNumLods() > 0) {
+    const auto meshes{abcg::MeshRegistry::getInstance().getStats()};
+    const auto textures{abcg::TextureCache::getInstance().getStats()};
+    const auto mipmaps{abcg::MipStreamer::getInstance().getStats()};
+    auto widgetSize{ImVec2(
+        250, 192 + 18 * (m_model->getNumLods() +
+                         static_cast<int>(meshes.size())))};
+    ImGui::SetNextWindowPos(ImVec2(5, 5));
+    ImGui::SetNextWindowSize(widgetSize);
+    ImGui::Begin("Levels of detail", nullptr, ImGuiWindowFlags_NoDecoration);
+
+    ImGui::Text("Levels of detail");
+    for (auto lod : iter::range(m_model->getNumLods())) {
+      const auto color{lod == m_renderedLod ? ImVec4(1, 1, 0, 1)
+                                            : ImVec4(1, 1, 1, 1)};
+      ImGui::TextColored(color, "%d: %d triangles, %.2f ms", lod,
+                         m_model->getLodTriangles(lod),
+                         static_cast<double>(m_lodFrameTimes.at(lod)));
+    }
+
+    // Meshlets of the level rendered in the last frame
+    const auto& cullResult{m_model->getCullResult()};
+    ImGui::Text("Meshlets: %zu drawn", cullResult.numVisible);
+    ImGui::Text("Frustum culled: %zu", cullResult.numFrustumCulled);
+    ImGui::Text("Back-face culled: %zu", cullResult.numBackfaceCulled);
+
+    ImGui::Text("Resident meshes");
+    for (const auto& mesh : meshes) {
+      // Keys are the path of the source file and a hash of the options
+      const std::filesystem::path path{mesh.key.substr(0, mesh.key.rfind('#'))};
+      ImGui::Text("%s: %.1f KiB, %ld users", path.filename().string().c_str(),
+                  static_cast<double>(mesh.vertexBytes + mesh.indexBytes) /
+                      1024.0,
+                  mesh.useCount);
+    }
+
+    ImGui::Text("Resident textures: %zu (%zu unused)", textures.numTextures,
+                textures.numUnused);
+    ImGui::Text("%.1f of %.1f MiB",
+                static_cast<double>(textures.residentBytes) / 1048576.0,
+                static_cast<double>(textures.budget) / 1048576.0);
+    ImGui::Text("Hits: %zu + %zu, misses: %zu, evicted: %zu", textures.hits,
+                textures.contentHits, textures.misses, textures.evictions);
+    ImGui::Text("Mipmaps on GPU: %.1f of %.1f MiB",
+                static_cast<double>(mipmaps.residentBytes) / 1048576.0,
+                static_cast<double>(mipmaps.budget) / 1048576.0);
+    ImGui::Text("Streaming: %zu, loaded: %zu, released: %zu",
+                mipmaps.numStreaming, mipmaps.loadedLevels,
+                mipmaps.evictedLevels);
+
+    ImGui::End();
+  }
+
+  // Create window for the GPU time of each mapping mode, with the
+  // uber-shader and with the variant of the mode
+  if (m_currentProgramIndex < 2) {
+    const auto isLoading{
+        m_modelLoader.getState() != ModelLoader::State::Idle ||
+        !m_modelLoader.getError().empty()};
+    auto widgetSize{ImVec2(222, 150)};
+    ImGui::SetNextWindowPos(ImVec2(
+        5, m_viewportHeight - widgetSize.y - (isLoading ? 68 : 5)));
+    ImGui::SetNextWindowSize(widgetSize);
+    ImGui::Begin("GPU time", nullptr, ImGuiWindowFlags_NoDecoration);
+
+    if (m_gpuTimer.isSupported()) {
+      const std::array modeNames{"Triplanar", "Cylindrical", "Spherical",
+                                 "From mesh"};
+      ImGui::Text("GPU time (ms)  uber  variant");
+      for (auto mode : iter::range(modeNames.size())) {
+        const auto color{static_cast<int>(mode) == m_mappingMode
+                             ? ImVec4(1, 1, 0, 1)
+                             : ImVec4(1, 1, 1, 1)};
+        ImGui::TextColored(color, "%-12s %6.3f %6.3f", modeNames.at(mode),
+                           static_cast<double>(m_gpuTimes.at(0).at(mode)),
+                           static_cast<double>(m_gpuTimes.at(1).at(mode)));
+      }
+
+      if (m_benchmarkFrame >= 0) {
+        ImGui::Text("Benchmarking...");
+      } else if (ImGui::Button("Benchmark", ImVec2(-1, 0))) {
+        // Build every variant before they are measured
+        auto& variants{m_programs.at(m_currentProgramIndex)};
+        std::vector<abcg::ShaderVariants::Key> keys;
+        for (auto mode : iter::range(4)) {
+          keys.push_back(variants.makeKey(
+              {{"MAPPING_MODE", mode},
+               {"HIGHLIGHT_BACK_FACES", m_highlightBackFaces ? 1 : 0}}));
+        }
+        variants.prepare(keys);
+
+        m_gpuTimes = {};
+        m_benchmarkMappingMode = m_mappingMode;
+        m_benchmarkFrame = 0;
+      }
+    } else {
+      ImGui::TextWrapped("GPU timer queries are not supported.");
+    }
+
+    ImGui::End();
+  }
+
+  // Create window for the progress of the model being loaded
+  if (m_modelLoader.getState() != ModelLoader::State::Idle) {
+    auto widgetSize{ImVec2(222, 58)};
+    ImGui::SetNextWindowPos(ImVec2(5, m_viewportHeight - widgetSize.y - 5));
+    ImGui::SetNextWindowSize(widgetSize);
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration);
+
+    const auto isPreparing{m_modelLoader.getState() ==
+                           ModelLoader::State::Preparing};
+    ImGui::ProgressBar(m_modelLoader.getProgress(), ImVec2(-1, 0),
+                       isPreparing ? "Processing..." : nullptr);
+    if (ImGui::Button("Cancel", ImVec2(-1, 0))) {
+      m_modelLoader.cancel();
+    }
+
+    ImGui::End();
+  } else if (!m_modelLoader.getError().empty()) {
+    // The last load failed and the current model was kept
+    auto widgetSize{ImVec2(222, 58)};
+    ImGui::SetNextWindowPos(ImVec2(5, m_viewportHeight - widgetSize.y - 5));
+    ImGui::SetNextWindowSize(widgetSize);
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration);
+
+    ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "Failed to load model");
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("%s", m_modelLoader.getError().c_str());
+    }
+    if (ImGui::Button("Close", ImVec2(-1, 0))) {
+      m_modelLoader.cancel();
+    }
 
     ImGui::End();
   }
@@ -353,25 +789,17 @@ void OpenGLWindow::paintUI() {
   if (fileDialogModel.HasSelected()) {
     loadModel(fileDialogModel.GetSelected().string());
     fileDialogModel.ClearSelected();
-
-    if (m_model.isUVMapped()) {
-      // Use mesh texture coordinates if available...
-      m_mappingMode = 3;
-    } else {
-      // ...or triplanar mapping otherwise
-      m_mappingMode = 0;
-    }
   }
 
   fileDialogDiffuseMap.Display();
   if (fileDialogDiffuseMap.HasSelected()) {
-    m_model.loadDiffuseTexture(fileDialogDiffuseMap.GetSelected().string());
+    m_model->loadDiffuseTexture(fileDialogDiffuseMap.GetSelected().string());
     fileDialogDiffuseMap.ClearSelected();
   }
 
   fileDialogNormalMap.Display();
   if (fileDialogNormalMap.HasSelected()) {
-    m_model.loadNormalTexture(fileDialogNormalMap.GetSelected().string());
+    m_model->loadNormalTexture(fileDialogNormalMap.GetSelected().string());
     fileDialogNormalMap.ClearSelected();
   }
 }
@@ -385,9 +813,12 @@ void OpenGLWindow::resizeGL(int width, int height) {
 }
 
 void OpenGLWindow::terminateGL() {
-  for (const auto& program : m_programs) {
-    glDeleteProgram(program);
+  for (auto& variants : m_programs) {
+    variants.destroy();
   }
+  m_gpuTimer.destroy();
+  m_frameUniforms.destroy();
+  m_objectUniforms.destroy();
 }
 
 void OpenGLWindow::update() {
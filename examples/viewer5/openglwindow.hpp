@@ -1,7 +1,11 @@
 #ifndef OPENGLWINDOW_HPP_
 #define OPENGLWINDOW_HPP_
 
+#include <array>
+#include <memory>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "abcg.hpp"
 #include "model.hpp"
@@ -20,9 +24,27 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   int m_viewportWidth{};
   int m_viewportHeight{};
 
-  Model m_model;
+  std::unique_ptr<Model> m_model{std::make_unique<Model>()};
+  ModelLoader m_modelLoader;
+  // Texture coordinates baked by the load in progress
+  Model::UVMapping m_uvMapping{Model::UVMapping::None};
+  // Vertex format of the models loaded, as selected in the UI
+  Model::VertexFormat m_vertexFormat{Model::VertexFormat::Float};
+  // Whether the mapping mode is reset when the model is loaded
+  bool m_resetMappingMode{true};
+  // Maximum number of bytes uploaded per frame while loading a model
+  std::size_t m_uploadBytesPerFrame{4 * 1024 * 1024};
   int m_trianglesToDraw{};
 
+  // Level of detail rendered: one of the modes below or a fixed level
+  static constexpr int sliderLod{-2};  // First m_trianglesToDraw triangles
+  static constexpr int autoLod{-1};    // Selected from the screen-space error
+  int m_lodMode{autoLod};
+  int m_renderedLod{-1};
+  // Moving average of the frame time of each level of detail, in ms
+  std::vector<float> m_lodFrameTimes;
+  Model::MeshletCulling m_meshletCulling{Model::MeshletCulling::Off};
+
   TrackBall m_trackBallModel;
   TrackBall m_trackBallLight;
   float m_zoom{};
@@ -35,25 +57,63 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   std::vector<const char*> m_shaderNames{
       "normalmapping", "texture", "blinnphong", "phong",
       "gouraud",       "normal",  "depth"};
-  std::vector<GLuint> m_programs;
+  // Variants of each shader, specialized for the mapping mode and the
+  // back-face highlight, and created when first drawn
+  std::vector<abcg::ShaderVariants> m_programs;
+  // Indices of the uniforms set by paintGL, looked up once per program
+  // (camera, light and object matrices are in the uniform buffers)
+  struct Uniforms {
+    int diffuseTex{-1};
+    int normalTex{-1};
+    int mappingMode{-1};
+  };
+  std::unordered_map<GLuint, Uniforms> m_uniforms;
+  abcg::UniformBuffer m_frameUniforms;
+  abcg::UniformBuffer m_objectUniforms;
   int m_currentProgramIndex{};
+  // Program the VAO of the model was set up for
+  GLuint m_vaoProgram{};
 
   // Mapping mode
   // 0: triplanar; 1: cylindrical; 2: spherical; 3: from mesh
   int m_mappingMode{};
+  // Whether the mapping mode is a uniform of a single program, instead of
+  // selecting a variant
+  bool m_useUberShader{false};
+  bool m_highlightBackFaces{true};
+  // Whether the cylindrical and spherical mappings are baked into the
+  // texture coordinates of the model, instead of computed by the shaders
+  bool m_bakeUVMapping{true};
+
+  // GPU time of the model, by program (0: uber-shader; 1: variant) and
+  // mapping mode, as a moving average in ms
+  abcg::GPUTimer m_gpuTimer;
+  std::array<std::array<float, 4>, 2> m_gpuTimes{};
+  // Frame of the benchmark of every program and mapping mode, or -1
+  int m_benchmarkFrame{-1};
+  int m_benchmarkMappingMode{};
+  static constexpr int benchmarkFramesPerMode{120};
 
   // Light and material properties
   glm::vec4 m_lightDir{-1.0f, -1.0f, -1.0f, 0.0f};
   glm::vec4 m_Ia{1.0f};
   glm::vec4 m_Id{1.0f};
   glm::vec4 m_Is{1.0f};
-  glm::vec4 m_Ka{};
-  glm::vec4 m_Kd{};
-  glm::vec4 m_Ks{};
-  float m_shininess{};
+
+  // Material of the model edited in the UI
+  int m_currentMaterial{};
 
   void loadModel(std::string_view path);
+  void startLoading(std::string_view path, Model::UVMapping uvMapping);
+  [[nodiscard]] int getShaderMappingMode() const;
+  void updateUVMapping();
+  void updateVertexFormat();
+  const abcg::ShaderProgram& selectProgram(bool& isVariant);
+  const Uniforms& findUniforms(const abcg::ShaderProgram& program);
+  void updateBenchmark();
+  void updateGPUTimes();
   void update();
+  void updateModelLoader();
 };
 
 #endif
\ No newline at end of file
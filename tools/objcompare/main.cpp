@@ -0,0 +1,192 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg.hpp"
+
+// Parses OBJ files with both abcg::ObjParser and tinyobj::ObjReader, checks
+// that they produce the same attributes, shapes and materials, and prints
+// the best parse time of each over a few runs.
+//
+// Usage: objcompare [--runs count] file.obj...
+//
+// Material libraries are searched next to each file. The exit code is
+// nonzero if any file differs.
+
+namespace {
+void printUsage() {
+  fmt::print(stderr, "Usage: objcompare [--runs count] file.obj...\n");
+}
+
+// Largest difference between two attribute arrays, relative to the magnitude
+// of the values, or infinity if their sizes differ
+double getMaxDifference(std::span<const tinyobj::real_t> expected,
+                        std::span<const tinyobj::real_t> actual) {
+  if (expected.size() != actual.size()) {
+    return std::numeric_limits<double>::infinity();
+  }
+  double maxDifference{};
+  for (auto &&[first, second] : iter::zip(expected, actual)) {
+    const auto scale{std::max(1.0, std::abs(static_cast<double>(first)))};
+    maxDifference = std::max(
+        maxDifference,
+        std::abs(static_cast<double>(first) - static_cast<double>(second)) /
+            scale);
+  }
+  return maxDifference;
+}
+
+bool isSameIndex(const tinyobj::index_t &first,
+                 const tinyobj::index_t &second) {
+  return first.vertex_index == second.vertex_index &&
+         first.normal_index == second.normal_index &&
+         first.texcoord_index == second.texcoord_index;
+}
+
+// Returns the differences between the outputs of both parsers, one per line
+std::vector<std::string> compare(const tinyobj::ObjReader &reader,
+                                 const abcg::ObjParser &parser) {
+  std::vector<std::string> differences;
+
+  // Both parsers read the values with the same precision
+  constexpr double tolerance{1.0e-6};
+  const auto &expected{reader.GetAttrib()};
+  const auto &actual{parser.getAttrib()};
+  for (auto &&[name, first, second] : iter::zip(
+           std::array{"positions", "normals", "texture coordinates"},
+           std::array{&expected.vertices, &expected.normals,
+                      &expected.texcoords},
+           std::array{&actual.vertices, &actual.normals, &actual.texcoords})) {
+    if (const auto difference{getMaxDifference(*first, *second)};
+        difference > tolerance) {
+      differences.push_back(fmt::format(
+          "{}: {} vs {} values, max difference {:g}", name, first->size(),
+          second->size(), difference));
+    }
+  }
+
+  const auto &expectedShapes{reader.GetShapes()};
+  const auto &actualShapes{parser.getShapes()};
+  if (expectedShapes.size() != actualShapes.size()) {
+    differences.push_back(fmt::format("{} vs {} shapes",
+                                      expectedShapes.size(),
+                                      actualShapes.size()));
+  }
+  for (auto &&[index, first, second] :
+       iter::zip(iter::range(expectedShapes.size()), expectedShapes,
+                 actualShapes)) {
+    const auto &firstMesh{first.mesh};
+    const auto &secondMesh{second.mesh};
+    if (first.name != second.name) {
+      differences.push_back(fmt::format("shape {}: name [{}] vs [{}]", index,
+                                        first.name, second.name));
+    }
+    if (!std::equal(firstMesh.indices.begin(), firstMesh.indices.end(),
+                    secondMesh.indices.begin(), secondMesh.indices.end(),
+                    isSameIndex)) {
+      differences.push_back(fmt::format("shape {}: {} vs {} corners differ",
+                                        index, firstMesh.indices.size(),
+                                        secondMesh.indices.size()));
+    }
+    if (firstMesh.num_face_vertices != secondMesh.num_face_vertices) {
+      differences.push_back(fmt::format("shape {}: face sizes differ", index));
+    }
+    if (firstMesh.material_ids != secondMesh.material_ids) {
+      differences.push_back(
+          fmt::format("shape {}: material ids differ", index));
+    }
+    if (firstMesh.smoothing_group_ids != secondMesh.smoothing_group_ids) {
+      differences.push_back(
+          fmt::format("shape {}: smoothing groups differ", index));
+    }
+  }
+
+  const auto &expectedMaterials{reader.GetMaterials()};
+  const auto &actualMaterials{parser.getMaterials()};
+  if (!std::equal(expectedMaterials.begin(), expectedMaterials.end(),
+                  actualMaterials.begin(), actualMaterials.end(),
+                  [](const auto &first, const auto &second) {
+                    return first.name == second.name &&
+                           first.diffuse_texname == second.diffuse_texname &&
+                           first.normal_texname == second.normal_texname;
+                  })) {
+    differences.push_back(fmt::format("{} vs {} materials differ",
+                                      expectedMaterials.size(),
+                                      actualMaterials.size()));
+  }
+  return differences;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> paths;
+  auto numRuns{5};
+  for (auto index{1}; index < argc; ++index) {
+    const std::string_view argument{argv[index]};  // NOLINT
+    if (argument == "--runs" && index + 1 < argc) {
+      numRuns = std::max(1, std::atoi(argv[++index]));  // NOLINT
+    } else if (argument.starts_with("-")) {
+      printUsage();
+      return -1;
+    } else {
+      paths.emplace_back(argument);
+    }
+  }
+  if (paths.empty()) {
+    printUsage();
+    return -1;
+  }
+
+  auto numDifferent{0};
+  for (const auto &path : paths) {
+    const auto basePath{std::filesystem::path{path}.parent_path().string() +
+                        "/"};
+
+    // Best time of each parser over the runs, keeping the last outputs
+    tinyobj::ObjReader reader;
+    abcg::ObjParser parser;
+    auto readerTime{std::numeric_limits<double>::max()};
+    auto parserTime{std::numeric_limits<double>::max()};
+    auto isReaderParsed{false};
+    auto isParserParsed{false};
+    for ([[maybe_unused]] auto run : iter::range(numRuns)) {
+      abcg::ElapsedTimer timer;
+      tinyobj::ObjReaderConfig config;
+      config.mtl_search_path = basePath;
+      reader = {};
+      isReaderParsed = reader.ParseFromFile(path, config);
+      readerTime = std::min(readerTime, timer.restart());
+      isParserParsed = parser.parseFromFile(path, basePath);
+      parserTime = std::min(parserTime, timer.elapsed());
+    }
+
+    std::vector<std::string> differences;
+    if (isReaderParsed != isParserParsed) {
+      differences.push_back(fmt::format(
+          "tinyobj {}, ObjParser {}", isReaderParsed ? "parsed" : "failed",
+          isParserParsed ? "parsed" : "failed"));
+    } else if (isReaderParsed) {
+      differences = compare(reader, parser);
+    }
+
+    fmt::print("{}: tinyobj {:.1f} ms, ObjParser {:.1f} ms ({:.1f}x), {}\n",
+               path, readerTime * 1000.0, parserTime * 1000.0,
+               readerTime / std::max(parserTime, 1.0e-9),
+               differences.empty() ? "same output" : "DIFFERENT");
+    for (const auto &difference : differences) {
+      fmt::print("  {}\n", difference);
+    }
+    if (!differences.empty()) ++numDifferent;
+  }
+  return numDifferent == 0 ? 0 : 1;
+}
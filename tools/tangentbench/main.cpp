@@ -0,0 +1,160 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg.hpp"
+
+// Measures how abcg::TangentSpace scales with the number of threads on OBJ
+// files: normals and tangents are computed with 1 to N threads, where N is
+// the number of threads of abcg::ThreadPool, and the best time of a few runs
+// is printed for each count. The results must not depend on the number of
+// threads, which is checked as well. N is the number of hardware threads
+// unless the ABCG_NUM_THREADS environment variable sets it.
+//
+// Usage: tangentbench [--runs count] file.obj...
+//
+// Corners with the same position and texture coordinate indices share a
+// vertex, and faces without texture coordinates use (0, 0).
+
+namespace {
+void printUsage() {
+  fmt::print(stderr, "Usage: tangentbench [--runs count] file.obj...\n");
+}
+
+struct Mesh {
+  std::vector<std::uint32_t> indices;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+};
+
+Mesh readMesh(const std::string &path) {
+  abcg::ObjParser parser;
+  if (!parser.parseFromFile(
+          path, std::filesystem::path{path}.parent_path().string() + "/")) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to load model {} ({})", path, parser.getError()))};
+  }
+
+  const auto &attrib{parser.getAttrib()};
+  Mesh mesh;
+  std::unordered_map<std::uint64_t, std::uint32_t> vertices;
+  for (const auto &shape : parser.getShapes()) {
+    for (const auto &index : shape.mesh.indices) {
+      const auto key{
+          (static_cast<std::uint64_t>(index.vertex_index) << 32U) |
+          static_cast<std::uint32_t>(index.texcoord_index)};
+      const auto [found, isNew]{vertices.try_emplace(
+          key, static_cast<std::uint32_t>(mesh.positions.size()))};
+      if (isNew) {
+        const auto position{static_cast<std::size_t>(index.vertex_index) * 3};
+        mesh.positions.emplace_back(attrib.vertices.at(position),
+                                    attrib.vertices.at(position + 1),
+                                    attrib.vertices.at(position + 2));
+        glm::vec2 texCoord{};
+        if (index.texcoord_index >= 0) {
+          const auto offset{static_cast<std::size_t>(index.texcoord_index) *
+                            2};
+          texCoord = {attrib.texcoords.at(offset),
+                      attrib.texcoords.at(offset + 1)};
+        }
+        mesh.texCoords.push_back(texCoord);
+      }
+      mesh.indices.push_back(found->second);
+    }
+  }
+  return mesh;
+}
+
+// Bitwise comparison, so that NaN tangents (e.g. of faces without texture
+// coordinates) compare equal
+template <typename T>
+bool isSame(const std::vector<T> &first, const std::vector<T> &second) {
+  return first.size() == second.size() &&
+         std::memcmp(first.data(), second.data(), first.size() * sizeof(T)) ==
+             0;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<std::string> paths;
+  auto numRuns{5};
+  for (auto index{1}; index < argc; ++index) {
+    const std::string_view argument{argv[index]};  // NOLINT
+    if (argument == "--runs" && index + 1 < argc) {
+      numRuns = std::max(1, std::atoi(argv[++index]));  // NOLINT
+    } else if (argument.starts_with("-")) {
+      printUsage();
+      return -1;
+    } else {
+      paths.emplace_back(argument);
+    }
+  }
+  if (paths.empty()) {
+    printUsage();
+    return -1;
+  }
+
+  const auto maxThreads{abcg::ThreadPool::getInstance().getNumThreads()};
+  auto isDeterministic{true};
+  try {
+    for (const auto &path : paths) {
+      const auto mesh{readMesh(path)};
+      fmt::print("{}: {} vertices, {} triangles\n", path,
+                 mesh.positions.size(), mesh.indices.size() / 3);
+
+      abcg::ElapsedTimer timer;
+      const auto adjacency{abcg::TangentSpace::buildAdjacency(
+          mesh.indices, mesh.positions.size())};
+      fmt::print("  adjacency {:.2f} ms\n", timer.elapsed() * 1000.0);
+
+      std::vector<glm::vec3> firstNormals;
+      std::vector<glm::vec4> firstTangents;
+      double baseTime{};
+      for (auto numThreads : iter::range<std::size_t>(1, maxThreads + 1)) {
+        auto normalTime{std::numeric_limits<double>::max()};
+        auto tangentTime{std::numeric_limits<double>::max()};
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec4> tangents;
+        for ([[maybe_unused]] auto run : iter::range(numRuns)) {
+          timer.restart();
+          normals = abcg::TangentSpace::computeNormals(
+              mesh.indices, mesh.positions, adjacency, numThreads);
+          normalTime = std::min(normalTime, timer.restart());
+          tangents = abcg::TangentSpace::computeTangents(
+              mesh.indices, mesh.positions, normals, mesh.texCoords,
+              adjacency, numThreads);
+          tangentTime = std::min(tangentTime, timer.elapsed());
+        }
+
+        if (numThreads == 1) {
+          firstNormals = normals;
+          firstTangents = tangents;
+          baseTime = normalTime + tangentTime;
+        }
+        const auto isSameResult{isSame(normals, firstNormals) &&
+                                isSame(tangents, firstTangents)};
+        isDeterministic = isDeterministic && isSameResult;
+        fmt::print(
+            "  {:2} threads: normals {:.2f} ms, tangents {:.2f} ms, "
+            "speedup {:.2f}x{}\n",
+            numThreads, normalTime * 1000.0, tangentTime * 1000.0,
+            baseTime / (normalTime + tangentTime),
+            isSameResult ? "" : " (results differ from 1 thread)");
+      }
+    }
+  } catch (abcg::Exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return isDeterministic ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+#include <fmt/core.h>
+
+#include <cppitertools/itertools.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg.hpp"
+
+// Bakes image files into DDS files with block-compressed mipmap chains,
+// written next to the images. abcg::opengl::loadBakedTexture and the models
+// of the examples load the baked files in place of the images.
+//
+// Usage: texturebaker [--bc1 | --bc3 | --bc5 | --normal] image...
+//
+// A format option applies to the images that follow it. By default, images
+// with alpha are compressed to BC3 and the others to BC1. Normal maps must
+// be given with --normal (or --bc5).
+
+namespace {
+void printUsage() {
+  fmt::print(stderr,
+             "Usage: texturebaker [--bc1 | --bc3 | --bc5 | --normal] "
+             "image...\n");
+}
+
+std::string_view getFormatName(abcg::opengl::CompressedFormat format) {
+  switch (format) {
+    case abcg::opengl::CompressedFormat::BC1:
+      return "BC1";
+    case abcg::opengl::CompressedFormat::BC3:
+      return "BC3";
+    case abcg::opengl::CompressedFormat::BC5:
+      return "BC5";
+  }
+  return "";
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  using abcg::opengl::CompressedFormat;
+
+  std::vector<abcg::opengl::ImageSource> sources;
+  std::vector<std::optional<CompressedFormat>> formats;
+  std::optional<CompressedFormat> format;
+  for (auto index : iter::range(1, argc)) {
+    const std::string_view argument{argv[index]};  // NOLINT
+    if (argument == "--bc1") {
+      format = CompressedFormat::BC1;
+    } else if (argument == "--bc3") {
+      format = CompressedFormat::BC3;
+    } else if (argument == "--bc5" || argument == "--normal") {
+      format = CompressedFormat::BC5;
+    } else if (argument.starts_with("-")) {
+      printUsage();
+      return -1;
+    } else {
+      sources.push_back({std::string{argument}});
+      formats.push_back(format);
+    }
+  }
+  if (sources.empty()) {
+    printUsage();
+    return -1;
+  }
+
+  try {
+    const auto images{abcg::opengl::loadImages(sources)};
+    for (auto &&[source, image, imageFormat] :
+         iter::zip(sources, images, formats)) {
+      const auto compressedFormat{imageFormat.value_or(
+          image.format == GL_RGBA ? CompressedFormat::BC3
+                                  : CompressedFormat::BC1)};
+      abcg::ElapsedTimer timer;
+      const auto compressed{
+          abcg::opengl::compressImage(image, compressedFormat)};
+      const auto bakedPath{abcg::opengl::getBakedPath(source.path)};
+      abcg::opengl::saveDDS(bakedPath, compressed);
+
+      std::size_t compressedBytes{};
+      for (const auto &level : compressed.levels) {
+        compressedBytes += level.size();
+      }
+      fmt::print("{}: {}x{} {}, {} levels, {} KiB in {:.1f} ms\n", bakedPath,
+                 image.width, image.height, getFormatName(compressedFormat),
+                 compressed.levels.size(), compressedBytes / 1024,
+                 timer.elapsed() * 1000.0);
+    }
+  } catch (abcg::Exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}